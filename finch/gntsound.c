@@ -219,6 +219,14 @@ chat_user_join_cb(PurpleChatConversation *chat, const char *name,
 		play_conv_event(PURPLE_CONVERSATION(chat), event);
 }
 
+static void
+chat_users_join_cb(PurpleChatConversation *chat, GList *users,
+				   gboolean new_arrivals, PurpleSoundEventID event)
+{
+	if (new_arrivals)
+		play_conv_event(PURPLE_CONVERSATION(chat), event);
+}
+
 static void
 chat_user_left_cb(PurpleChatConversation *chat, const char *name,
 				   const char *reason, PurpleSoundEventID event)
@@ -393,6 +401,9 @@ finch_sound_init(void)
 	purple_signal_connect(conv_handle, "chat-user-joined",
 						gnt_sound_handle, PURPLE_CALLBACK(chat_user_join_cb),
 						GINT_TO_POINTER(PURPLE_SOUND_CHAT_JOIN));
+	purple_signal_connect(conv_handle, "chat-users-joined",
+						gnt_sound_handle, PURPLE_CALLBACK(chat_users_join_cb),
+						GINT_TO_POINTER(PURPLE_SOUND_CHAT_JOIN));
 	purple_signal_connect(conv_handle, "chat-user-left",
 						gnt_sound_handle, PURPLE_CALLBACK(chat_user_left_cb),
 						GINT_TO_POINTER(PURPLE_SOUND_CHAT_LEAVE));
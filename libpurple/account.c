@@ -42,6 +42,19 @@ struct _PurpleAccount
 	GObject gparent;
 };
 
+/*
+ * The permit and deny lists are kept in insertion order for the getters,
+ * with a table of the same (normalized) names for the lookups done on every
+ * incoming message.  The table maps each name to the link before its own,
+ * which is all a singly linked list needs to unlink it in constant time.
+ */
+typedef struct
+{
+	GSList *names;              /* The names, owned by the list.          */
+	GSList *tail;               /* The last link, for appending.          */
+	GHashTable *set;            /* Name => previous link, or NULL.        */
+} PurpleAccountPrivacyList;
+
 typedef struct
 {
 	char *username;             /* The username.                          */
@@ -69,16 +82,8 @@ typedef struct
 								/*   to NULL when the account inherits      */
 								/*   proxy settings from global prefs.      */
 
-	/*
-	 * TODO: Instead of linked lists for permit and deny, use a data
-	 * structure that allows fast lookups AND decent performance when
-	 * iterating through all items. Fast lookups should help performance
-	 * for protocols like MSN, where all your buddies exist in your permit
-	 * list therefore the permit list is large. Possibly GTree or
-	 * GHashTable.
-	 */
-	GSList *permit;             /* Permit list.                           */
-	GSList *deny;               /* Deny list.                             */
+	PurpleAccountPrivacyList permit;  /* Permit list.                     */
+	PurpleAccountPrivacyList deny;    /* Deny list.                       */
 	PurpleAccountPrivacyType privacy_type;  /* The permit/deny setting.   */
 
 	GList *status_types;        /* Status types.                          */
@@ -447,6 +452,207 @@ purple_account_get_password_got(PurpleAccount *account,
 	g_free(cbb);
 }
 
+static void
+privacy_list_init(PurpleAccountPrivacyList *list)
+{
+	list->names = NULL;
+	list->tail = NULL;
+	list->set = g_hash_table_new(g_str_hash, g_str_equal);
+}
+
+static void
+privacy_list_clear(PurpleAccountPrivacyList *list)
+{
+	g_hash_table_remove_all(list->set);
+	g_slist_free_full(list->names, g_free);
+	list->names = NULL;
+	list->tail = NULL;
+}
+
+/* Takes ownership of name, which must be normalized and not in the list */
+static void
+privacy_list_append(PurpleAccountPrivacyList *list, char *name)
+{
+	GSList *link = g_slist_alloc();
+
+	link->data = name;
+
+	if (list->tail != NULL)
+		list->tail->next = link;
+	else
+		list->names = link;
+
+	g_hash_table_insert(list->set, name, list->tail);
+	list->tail = link;
+}
+
+/* Returns the stored name, which the caller must free, or NULL */
+static char *
+privacy_list_steal(PurpleAccountPrivacyList *list, const char *name)
+{
+	GSList *link, *prev;
+	gpointer stored, value;
+
+	if (!g_hash_table_lookup_extended(list->set, name, &stored, &value))
+		return NULL;
+
+	prev = value;
+	link = (prev != NULL) ? prev->next : list->names;
+
+	g_hash_table_remove(list->set, stored);
+
+	/* The next name now follows our previous link */
+	if (link->next != NULL)
+		g_hash_table_insert(list->set, link->next->data, prev);
+
+	if (prev != NULL)
+		prev->next = link->next;
+	else
+		list->names = link->next;
+
+	if (list->tail == link)
+		list->tail = prev;
+
+	g_slist_free_1(link);
+	return stored;
+}
+
+static gboolean
+privacy_list_add(PurpleAccount *account, gboolean deny, const char *who,
+                 gboolean local_only)
+{
+	PurpleAccountPrivate *priv = purple_account_get_instance_private(account);
+	PurpleAccountPrivacyList *list = deny ? &priv->deny : &priv->permit;
+	PurpleAccountUiOps *ui_ops = purple_accounts_get_ui_ops();
+	PurpleBuddy *buddy;
+	char *name;
+
+	name = g_strdup(purple_normalize(account, who));
+
+	if (g_hash_table_contains(list->set, name)) {
+		/* This buddy already exists, so bail out */
+		g_free(name);
+		return FALSE;
+	}
+
+	privacy_list_append(list, name);
+
+	if (!local_only && purple_account_is_connected(account)) {
+		PurpleConnection *gc = purple_account_get_connection(account);
+
+		if (deny)
+			purple_serv_add_deny(gc, who);
+		else
+			purple_serv_add_permit(gc, who);
+	}
+
+	if (ui_ops != NULL) {
+		if (deny && ui_ops->deny_added != NULL)
+			ui_ops->deny_added(account, who);
+		else if (!deny && ui_ops->permit_added != NULL)
+			ui_ops->permit_added(account, who);
+	}
+
+	/* This lets the UI know a buddy has had its privacy setting changed */
+	buddy = purple_blist_find_buddy(account, name);
+	if (buddy != NULL) {
+		purple_signal_emit(purple_blist_get_handle(),
+                "buddy-privacy-changed", buddy);
+	}
+	return TRUE;
+}
+
+static gboolean
+privacy_list_remove(PurpleAccount *account, gboolean deny, const char *who,
+                    gboolean local_only)
+{
+	PurpleAccountPrivate *priv = purple_account_get_instance_private(account);
+	PurpleAccountPrivacyList *list = deny ? &priv->deny : &priv->permit;
+	PurpleAccountUiOps *ui_ops = purple_accounts_get_ui_ops();
+	PurpleBuddy *buddy;
+	char *name;
+
+	/* We should not free the stored name until we are done with who. There
+	 * can be occasions where it is the same string, and freeing it early can
+	 * cause crashes. */
+	name = privacy_list_steal(list, purple_normalize(account, who));
+	if (name == NULL)
+		/* We didn't find the buddy we were looking for, so bail out */
+		return FALSE;
+
+	if (!local_only && purple_account_is_connected(account)) {
+		PurpleConnection *gc = purple_account_get_connection(account);
+
+		if (deny)
+			purple_serv_rem_deny(gc, name);
+		else
+			purple_serv_rem_permit(gc, who);
+	}
+
+	if (ui_ops != NULL) {
+		if (deny && ui_ops->deny_removed != NULL)
+			ui_ops->deny_removed(account, who);
+		else if (!deny && ui_ops->permit_removed != NULL)
+			ui_ops->permit_removed(account, who);
+	}
+
+	buddy = purple_blist_find_buddy(account, name);
+	if (buddy != NULL) {
+		purple_signal_emit(purple_blist_get_handle(),
+                "buddy-privacy-changed", buddy);
+	}
+
+	g_free(name);
+	return TRUE;
+}
+
+/*
+ * Adds every name in names to the list, first removing everything that is
+ * not in names when replacing it.  The buddy list is only saved once.
+ */
+static guint
+privacy_list_import(PurpleAccount *account, gboolean deny, GSList *names,
+                    gboolean local_only, gboolean replace)
+{
+	PurpleAccountPrivate *priv = purple_account_get_instance_private(account);
+	PurpleAccountPrivacyList *list = deny ? &priv->deny : &priv->permit;
+	GSList *l;
+	guint changed = 0;
+
+	if (replace) {
+		GHashTable *keep = g_hash_table_new_full(g_str_hash, g_str_equal,
+				g_free, NULL);
+
+		for (l = names; l != NULL; l = l->next) {
+			if (l->data != NULL) {
+				g_hash_table_add(keep,
+						g_strdup(purple_normalize(account, l->data)));
+			}
+		}
+
+		for (l = list->names; l != NULL; ) {
+			char *person = l->data;
+			l = l->next;
+			if (!g_hash_table_contains(keep, person) &&
+			    privacy_list_remove(account, deny, person, local_only))
+				changed++;
+		}
+
+		g_hash_table_destroy(keep);
+	}
+
+	for (l = names; l != NULL; l = l->next) {
+		if (l->data != NULL &&
+		    privacy_list_add(account, deny, l->data, local_only))
+			changed++;
+	}
+
+	if (changed > 0)
+		purple_blist_save_account(purple_blist_get_default(), account);
+
+	return changed;
+}
+
 /*
  * This makes sure your permit list contains all buddies from your
  * buddy list and ONLY buddies from your buddy list.
@@ -458,7 +664,7 @@ add_all_buddies_to_permit_list(PurpleAccount *account, gboolean local)
 	PurpleAccountPrivate *priv = purple_account_get_instance_private(account);
 
 	/* Remove anyone in the permit list who is not in the buddylist */
-	for (list = priv->permit; list != NULL; ) {
+	for (list = priv->permit.names; list != NULL; ) {
 		char *person = list->data;
 		list = list->next;
 		if (!purple_blist_find_buddy(account, person))
@@ -472,7 +678,8 @@ add_all_buddies_to_permit_list(PurpleAccount *account, gboolean local)
 		PurpleBuddy *buddy = list->data;
 		const gchar *name = purple_buddy_get_name(buddy);
 
-		if (!g_slist_find_custom(priv->permit, name, (GCompareFunc)g_utf8_collate))
+		if (!g_hash_table_contains(priv->permit.set,
+				purple_normalize(account, name)))
 			purple_account_privacy_permit_add(account, name, local);
 		list = g_slist_delete_link(list, list);
 	}
@@ -964,6 +1171,8 @@ purple_account_init(PurpleAccount *account)
 	priv->system_log = NULL;
 
 	priv->privacy_type = PURPLE_ACCOUNT_PRIVACY_ALLOW_ALL;
+	privacy_list_init(&priv->permit);
+	privacy_list_init(&priv->deny);
 }
 
 static void
@@ -1071,8 +1280,10 @@ purple_account_finalize(GObject *object)
 	g_hash_table_destroy(priv->settings);
 	g_hash_table_destroy(priv->ui_settings);
 
-	g_slist_free_full(priv->deny, g_free);
-	g_slist_free_full(priv->permit, g_free);
+	privacy_list_clear(&priv->deny);
+	privacy_list_clear(&priv->permit);
+	g_hash_table_destroy(priv->deny.set);
+	g_hash_table_destroy(priv->permit.set);
 
 	G_OBJECT_CLASS(purple_account_parent_class)->finalize(object);
 }
@@ -1768,7 +1979,13 @@ purple_account_set_privacy_type(PurpleAccount *account, PurpleAccountPrivacyType
 	g_return_if_fail(PURPLE_IS_ACCOUNT(account));
 
 	priv = purple_account_get_instance_private(account);
+	if (priv->privacy_type == privacy_type)
+		return;
+
 	priv->privacy_type = privacy_type;
+
+	/* The privacy setting is written out with the privacy lists */
+	purple_blist_save_account(purple_blist_get_default(), account);
 }
 
 void
@@ -2276,39 +2493,13 @@ gboolean
 purple_account_privacy_permit_add(PurpleAccount *account, const char *who,
 						gboolean local_only)
 {
-	char *name;
-	PurpleBuddy *buddy;
-	PurpleAccountPrivate *priv;
-	PurpleAccountUiOps *ui_ops = purple_accounts_get_ui_ops();
-
 	g_return_val_if_fail(PURPLE_IS_ACCOUNT(account), FALSE);
 	g_return_val_if_fail(who     != NULL, FALSE);
 
-	priv = purple_account_get_instance_private(account);
-	name = g_strdup(purple_normalize(account, who));
-
-	if (g_slist_find_custom(priv->permit, name, (GCompareFunc)g_strcmp0) != NULL) {
-		/* This buddy already exists, so bail out */
-		g_free(name);
+	if (!privacy_list_add(account, FALSE, who, local_only))
 		return FALSE;
-	}
-
-	priv->permit = g_slist_append(priv->permit, name);
-
-	if (!local_only && purple_account_is_connected(account))
-		purple_serv_add_permit(purple_account_get_connection(account), who);
-
-	if (ui_ops != NULL && ui_ops->permit_added != NULL)
-		ui_ops->permit_added(account, who);
 
 	purple_blist_save_account(purple_blist_get_default(), account);
-
-	/* This lets the UI know a buddy has had its privacy setting changed */
-	buddy = purple_blist_find_buddy(account, name);
-	if (buddy != NULL) {
-		purple_signal_emit(purple_blist_get_handle(),
-                "buddy-privacy-changed", buddy);
-	}
 	return TRUE;
 }
 
@@ -2316,44 +2507,13 @@ gboolean
 purple_account_privacy_permit_remove(PurpleAccount *account, const char *who,
 						   gboolean local_only)
 {
-	GSList *l;
-	const char *name;
-	PurpleBuddy *buddy;
-	char *del;
-	PurpleAccountPrivate *priv;
-	PurpleAccountUiOps *ui_ops = purple_accounts_get_ui_ops();
-
 	g_return_val_if_fail(PURPLE_IS_ACCOUNT(account), FALSE);
 	g_return_val_if_fail(who     != NULL, FALSE);
 
-	priv = purple_account_get_instance_private(account);
-	name = purple_normalize(account, who);
-
-	l = g_slist_find_custom(priv->permit, name, (GCompareFunc)g_strcmp0);
-	if (l == NULL)
-		/* We didn't find the buddy we were looking for, so bail out */
+	if (!privacy_list_remove(account, FALSE, who, local_only))
 		return FALSE;
 
-	/* We should not free l->data just yet. There can be occasions where
-	 * l->data == who. In such cases, freeing l->data here can cause crashes
-	 * later when who is used. */
-	del = l->data;
-	priv->permit = g_slist_delete_link(priv->permit, l);
-
-	if (!local_only && purple_account_is_connected(account))
-		purple_serv_rem_permit(purple_account_get_connection(account), who);
-
-	if (ui_ops != NULL && ui_ops->permit_removed != NULL)
-		ui_ops->permit_removed(account, who);
-
 	purple_blist_save_account(purple_blist_get_default(), account);
-
-	buddy = purple_blist_find_buddy(account, name);
-	if (buddy != NULL) {
-		purple_signal_emit(purple_blist_get_handle(),
-                "buddy-privacy-changed", buddy);
-	}
-	g_free(del);
 	return TRUE;
 }
 
@@ -2361,38 +2521,13 @@ gboolean
 purple_account_privacy_deny_add(PurpleAccount *account, const char *who,
 					  gboolean local_only)
 {
-	char *name;
-	PurpleBuddy *buddy;
-	PurpleAccountPrivate *priv;
-	PurpleAccountUiOps *ui_ops = purple_accounts_get_ui_ops();
-
 	g_return_val_if_fail(PURPLE_IS_ACCOUNT(account), FALSE);
 	g_return_val_if_fail(who     != NULL, FALSE);
 
-	priv = purple_account_get_instance_private(account);
-	name = g_strdup(purple_normalize(account, who));
-
-	if (g_slist_find_custom(priv->deny, name, (GCompareFunc)g_strcmp0) != NULL) {
-		/* This buddy already exists, so bail out */
-		g_free(name);
+	if (!privacy_list_add(account, TRUE, who, local_only))
 		return FALSE;
-	}
-
-	priv->deny = g_slist_append(priv->deny, name);
-
-	if (!local_only && purple_account_is_connected(account))
-		purple_serv_add_deny(purple_account_get_connection(account), who);
-
-	if (ui_ops != NULL && ui_ops->deny_added != NULL)
-		ui_ops->deny_added(account, who);
 
 	purple_blist_save_account(purple_blist_get_default(), account);
-
-	buddy = purple_blist_find_buddy(account, name);
-	if (buddy != NULL) {
-		purple_signal_emit(purple_blist_get_handle(),
-                "buddy-privacy-changed", buddy);
-	}
 	return TRUE;
 }
 
@@ -2400,45 +2535,50 @@ gboolean
 purple_account_privacy_deny_remove(PurpleAccount *account, const char *who,
 						 gboolean local_only)
 {
-	GSList *l;
-	const char *normalized;
-	char *name;
-	PurpleBuddy *buddy;
-	PurpleAccountPrivate *priv;
-	PurpleAccountUiOps *ui_ops = purple_accounts_get_ui_ops();
-
 	g_return_val_if_fail(PURPLE_IS_ACCOUNT(account), FALSE);
 	g_return_val_if_fail(who     != NULL, FALSE);
 
-	priv = purple_account_get_instance_private(account);
-	normalized = purple_normalize(account, who);
-
-	l = g_slist_find_custom(priv->deny, normalized, (GCompareFunc)g_strcmp0);
-	if (l == NULL)
-		/* We didn't find the buddy we were looking for, so bail out */
+	if (!privacy_list_remove(account, TRUE, who, local_only))
 		return FALSE;
 
-	buddy = purple_blist_find_buddy(account, normalized);
+	purple_blist_save_account(purple_blist_get_default(), account);
+	return TRUE;
+}
 
-	name = l->data;
-	priv->deny = g_slist_delete_link(priv->deny, l);
+guint
+purple_account_privacy_permit_add_list(PurpleAccount *account, GSList *names,
+                                       gboolean local_only)
+{
+	g_return_val_if_fail(PURPLE_IS_ACCOUNT(account), 0);
+
+	return privacy_list_import(account, FALSE, names, local_only, FALSE);
+}
 
-	if (!local_only && purple_account_is_connected(account))
-		purple_serv_rem_deny(purple_account_get_connection(account), name);
+guint
+purple_account_privacy_permit_set_list(PurpleAccount *account, GSList *names,
+                                       gboolean local_only)
+{
+	g_return_val_if_fail(PURPLE_IS_ACCOUNT(account), 0);
 
-	if (ui_ops != NULL && ui_ops->deny_removed != NULL)
-		ui_ops->deny_removed(account, who);
+	return privacy_list_import(account, FALSE, names, local_only, TRUE);
+}
 
-	if (buddy != NULL) {
-		purple_signal_emit(purple_blist_get_handle(),
-                "buddy-privacy-changed", buddy);
-	}
+guint
+purple_account_privacy_deny_add_list(PurpleAccount *account, GSList *names,
+                                     gboolean local_only)
+{
+	g_return_val_if_fail(PURPLE_IS_ACCOUNT(account), 0);
 
-	g_free(name);
+	return privacy_list_import(account, TRUE, names, local_only, FALSE);
+}
 
-	purple_blist_save_account(purple_blist_get_default(), account);
+guint
+purple_account_privacy_deny_set_list(PurpleAccount *account, GSList *names,
+                                     gboolean local_only)
+{
+	g_return_val_if_fail(PURPLE_IS_ACCOUNT(account), 0);
 
-	return TRUE;
+	return privacy_list_import(account, TRUE, names, local_only, TRUE);
 }
 
 void
@@ -2461,7 +2601,7 @@ purple_account_privacy_allow(PurpleAccount *account, const char *who)
 			{
 				/* Empty the allow-list. */
 				const char *norm = purple_normalize(account, who);
-				for (list = priv->permit; list != NULL;) {
+				for (list = priv->permit.names; list != NULL;) {
 					char *person = list->data;
 					list = list->next;
 					if (!purple_strequal(norm, person))
@@ -2499,7 +2639,7 @@ purple_account_privacy_deny(PurpleAccount *account, const char *who)
 			{
 				/* Empty the deny-list. */
 				const char *norm = purple_normalize(account, who);
-				for (list = priv->deny; list != NULL; ) {
+				for (list = priv->deny.names; list != NULL; ) {
 					char *person = list->data;
 					list = list->next;
 					if (!purple_strequal(norm, person))
@@ -2541,7 +2681,7 @@ purple_account_privacy_get_permitted(PurpleAccount *account)
 	g_return_val_if_fail(PURPLE_IS_ACCOUNT(account), NULL);
 
 	priv = purple_account_get_instance_private(account);
-	return priv->permit;
+	return priv->permit.names;
 }
 
 GSList *
@@ -2552,13 +2692,15 @@ purple_account_privacy_get_denied(PurpleAccount *account)
 	g_return_val_if_fail(PURPLE_IS_ACCOUNT(account), NULL);
 
 	priv = purple_account_get_instance_private(account);
-	return priv->deny;
+	return priv->deny.names;
 }
 
 gboolean
 purple_account_privacy_check(PurpleAccount *account, const char *who)
 {
 	PurpleAccountPrivate *priv = purple_account_get_instance_private(account);
+	const gchar *norm;
+	gboolean ret;
 
 	switch (purple_account_get_privacy_type(account)) {
 		case PURPLE_ACCOUNT_PRIVACY_ALLOW_ALL:
@@ -2568,12 +2710,16 @@ purple_account_privacy_check(PurpleAccount *account, const char *who)
 			return FALSE;
 
 		case PURPLE_ACCOUNT_PRIVACY_ALLOW_USERS:
-			who = purple_normalize(account, who);
-			return (g_slist_find_custom(priv->permit, who, (GCompareFunc)g_strcmp0) != NULL);
+			norm = purple_normalize_atom(account, who);
+			ret = g_hash_table_contains(priv->permit.set, norm);
+			purple_normalize_atom_unref(norm);
+			return ret;
 
 		case PURPLE_ACCOUNT_PRIVACY_DENY_USERS:
-			who = purple_normalize(account, who);
-			return (g_slist_find_custom(priv->deny, who, (GCompareFunc)g_strcmp0) == NULL);
+			norm = purple_normalize_atom(account, who);
+			ret = !g_hash_table_contains(priv->deny.set, norm);
+			purple_normalize_atom_unref(norm);
+			return ret;
 
 		case PURPLE_ACCOUNT_PRIVACY_ALLOW_BUDDYLIST:
 			return (purple_blist_find_buddy(account, who) != NULL);
@@ -840,6 +840,78 @@ gboolean purple_account_privacy_deny_add(PurpleAccount *account,
 gboolean purple_account_privacy_deny_remove(PurpleAccount *account,
 									const char *name, gboolean local_only);
 
+/**
+ * purple_account_privacy_permit_add_list:
+ * @account:    The account.
+ * @names:      (element-type utf8): The names of the users to add to the list.
+ * @local_only: If TRUE, only the local list is updated, and not
+ *                   the server.
+ *
+ * Adds several users to the account's permit list at once. Names already on
+ * the list are skipped.
+ *
+ * Returns: The number of users added.
+ *
+ * Since: 3.0.0
+ */
+guint purple_account_privacy_permit_add_list(PurpleAccount *account,
+									GSList *names, gboolean local_only);
+
+/**
+ * purple_account_privacy_permit_set_list:
+ * @account:    The account.
+ * @names:      (element-type utf8): The names of the users that make up the
+ *              new list.
+ * @local_only: If TRUE, only the local list is updated, and not
+ *                   the server.
+ *
+ * Replaces the account's permit list with @names, such as when syncing it
+ * with the list stored on the server. Only the users that are not already on
+ * the list are added, and only the users missing from @names are removed.
+ *
+ * Returns: The number of users added or removed.
+ *
+ * Since: 3.0.0
+ */
+guint purple_account_privacy_permit_set_list(PurpleAccount *account,
+									GSList *names, gboolean local_only);
+
+/**
+ * purple_account_privacy_deny_add_list:
+ * @account:    The account.
+ * @names:      (element-type utf8): The names of the users to add to the list.
+ * @local_only: If TRUE, only the local list is updated, and not
+ *                   the server.
+ *
+ * Adds several users to the account's deny list at once. Names already on
+ * the list are skipped.
+ *
+ * Returns: The number of users added.
+ *
+ * Since: 3.0.0
+ */
+guint purple_account_privacy_deny_add_list(PurpleAccount *account,
+									GSList *names, gboolean local_only);
+
+/**
+ * purple_account_privacy_deny_set_list:
+ * @account:    The account.
+ * @names:      (element-type utf8): The names of the users that make up the
+ *              new list.
+ * @local_only: If TRUE, only the local list is updated, and not
+ *                   the server.
+ *
+ * Replaces the account's deny list with @names, such as when syncing it with
+ * the block list stored on the server. Only the users that are not already on
+ * the list are added, and only the users missing from @names are removed.
+ *
+ * Returns: The number of users added or removed.
+ *
+ * Since: 3.0.0
+ */
+guint purple_account_privacy_deny_set_list(PurpleAccount *account,
+									GSList *names, gboolean local_only);
+
 /**
  * purple_account_privacy_allow:
  * @account:	The account.
@@ -732,7 +732,8 @@ purple_accounts_find(const char *name, const char *protocol_id)
 {
 	PurpleAccount *account = NULL;
 	GList *l;
-	char *who;
+	const gchar *who, *username;
+	gboolean found;
 
 	g_return_val_if_fail(name != NULL, NULL);
 	g_return_val_if_fail(protocol_id != NULL, NULL);
@@ -743,12 +744,14 @@ purple_accounts_find(const char *name, const char *protocol_id)
 		if (!purple_strequal(purple_account_get_protocol_id(account), protocol_id))
 			continue;
 
-		who = g_strdup(purple_normalize(account, name));
-		if (purple_strequal(purple_normalize(account, purple_account_get_username(account)), who)) {
-			g_free(who);
+		who = purple_normalize_atom(account, name);
+		username = purple_normalize_atom(account, purple_account_get_username(account));
+		found = (who == username);
+		purple_normalize_atom_unref(username);
+		purple_normalize_atom_unref(who);
+
+		if (found)
 			return account;
-		}
-		g_free(who);
 	}
 
 	return NULL;
@@ -134,10 +134,18 @@ purple_blist_node_set_transient(PurpleBlistNode *node, gboolean transient)
 	g_return_if_fail(PURPLE_IS_BLIST_NODE(node));
 
 	priv = purple_blist_node_get_instance_private(node);
+	if (priv->transient == transient)
+		return;
+
 	priv->transient = transient;
 
 	g_object_notify_by_pspec(G_OBJECT(node),
 			bn_properties[BLNODE_PROP_TRANSIENT]);
+
+	/* A buddy, contact or chat already on the list has to be written out,
+	 * or left out, the next time the list is saved */
+	if (node->parent != NULL)
+		purple_blist_save_node(purple_blist_get_default(), node);
 }
 
 gboolean
@@ -102,8 +102,11 @@ struct _list_account_buddies {
 	PurpleAccount *account;
 };
 
+/* The name is an atom from purple_normalize_atom(), so it is compared
+ * and hashed by pointer.
+ */
 struct _purple_hbuddy {
-	char *name;
+	const gchar *name;
 	PurpleAccount *account;
 	PurpleBlistNode *group;
 };
@@ -111,7 +114,7 @@ struct _purple_hbuddy {
 /* This function must not use purple_normalize */
 static guint _purple_blist_hbuddy_hash(struct _purple_hbuddy *hb)
 {
-	return g_str_hash(hb->name) ^ g_direct_hash(hb->group) ^ g_direct_hash(hb->account);
+	return g_direct_hash(hb->name) ^ g_direct_hash(hb->group) ^ g_direct_hash(hb->account);
 }
 
 /* This function must not use purple_normalize */
@@ -119,12 +122,12 @@ static guint _purple_blist_hbuddy_equal(struct _purple_hbuddy *hb1, struct _purp
 {
 	return (hb1->group == hb2->group &&
 	        hb1->account == hb2->account &&
-	        purple_strequal(hb1->name, hb2->name));
+	        hb1->name == hb2->name);
 }
 
 static void _purple_blist_hbuddy_free_key(struct _purple_hbuddy *hb)
 {
-	g_free(hb->name);
+	purple_normalize_atom_unref(hb->name);
 	g_free(hb);
 }
 
@@ -294,34 +297,16 @@ chat_to_xmlnode(PurpleChat *chat)
 static PurpleXmlNode *
 group_to_xmlnode(PurpleGroup *group)
 {
-	PurpleXmlNode *node, *child;
-	PurpleBlistNode *cnode;
+	PurpleXmlNode *node;
 
 	node = purple_xmlnode_new("group");
 	if (group != purple_blist_get_default_group())
 		purple_xmlnode_set_attrib(node, "name", purple_group_get_name(group));
 
-	/* Write settings */
+	/* Write settings, the contacts and chats are written by the caller */
 	g_hash_table_foreach(purple_blist_node_get_settings(PURPLE_BLIST_NODE(group)),
 			value_to_xmlnode, node);
 
-	/* Write contacts and chats */
-	for (cnode = PURPLE_BLIST_NODE(group)->child; cnode != NULL; cnode = cnode->next)
-	{
-		if (purple_blist_node_is_transient(cnode))
-			continue;
-		if (PURPLE_IS_CONTACT(cnode))
-		{
-			child = contact_to_xmlnode(PURPLE_CONTACT(cnode));
-			purple_xmlnode_insert_child(node, child);
-		}
-		else if (PURPLE_IS_CHAT(cnode))
-		{
-			child = chat_to_xmlnode(PURPLE_CHAT(cnode));
-			purple_xmlnode_insert_child(node, child);
-		}
-	}
-
 	return node;
 }
 
@@ -353,26 +338,175 @@ accountprivacy_to_xmlnode(PurpleAccount *account)
 	return node;
 }
 
-static PurpleXmlNode *
-blist_to_xmlnode(void)
+/*
+ * blist.xml is assembled from fragments cached on the objects they were
+ * serialized from.  Contacts and chats keep theirs until they, or one of
+ * their buddies, are saved again, and accounts do the same for their privacy
+ * lists, so a save only serializes what changed.  The assembled file is then
+ * handed to the deferred writer.
+ */
+typedef struct {
+	GBytes *xml;          /* The fragment, or NULL once it is stale.        */
+	guint epoch;          /* The blist_xml_epoch it was serialized in.      */
+	char *username;       /* For accounts, the username and protocol the    */
+	char *protocol_id;    /*   buddies and chats were last written with.    */
+} PurpleBlistXml;
+
+G_DEFINE_QUARK(purple-blist-xml, purple_blist_xml);
+
+/* Bumped to throw every cached fragment away */
+static guint blist_xml_epoch = 0;
+static gsize blist_xml_size = 4096;
+
+static void
+purple_blist_xml_free(PurpleBlistXml *cache)
+{
+	if (cache->xml != NULL)
+		g_bytes_unref(cache->xml);
+	g_free(cache->username);
+	g_free(cache->protocol_id);
+	g_free(cache);
+}
+
+static PurpleBlistXml *
+purple_blist_xml_get(gpointer object)
 {
-	PurpleXmlNode *node, *child, *grandchild;
+	PurpleBlistXml *cache;
+
+	cache = g_object_get_qdata(G_OBJECT(object), purple_blist_xml_quark());
+	if (cache == NULL) {
+		cache = g_new0(PurpleBlistXml, 1);
+		g_object_set_qdata_full(G_OBJECT(object), purple_blist_xml_quark(),
+				cache, (GDestroyNotify)purple_blist_xml_free);
+	}
+
+	return cache;
+}
+
+static void
+purple_blist_xml_invalidate(gpointer object)
+{
+	PurpleBlistXml *cache;
+
+	cache = g_object_get_qdata(G_OBJECT(object), purple_blist_xml_quark());
+	if (cache != NULL)
+		g_clear_pointer(&cache->xml, g_bytes_unref);
+}
+
+/* Appends the contact, chat or account privacy fragment for object */
+static void
+purple_blist_xml_append(GString *xml, gpointer object, int depth)
+{
+	PurpleBlistXml *cache = purple_blist_xml_get(object);
+	gconstpointer data;
+	gsize size;
+
+	if (cache->xml == NULL || cache->epoch != blist_xml_epoch) {
+		PurpleXmlNode *node;
+		char *str;
+		int len;
+
+		if (PURPLE_IS_CONTACT(object)) {
+			node = contact_to_xmlnode(PURPLE_CONTACT(object));
+		} else if (PURPLE_IS_CHAT(object)) {
+			node = chat_to_xmlnode(PURPLE_CHAT(object));
+		} else {
+			PurpleAccount *account = PURPLE_ACCOUNT(object);
+
+			g_free(cache->username);
+			g_free(cache->protocol_id);
+			cache->username = g_strdup(purple_account_get_username(account));
+			cache->protocol_id = g_strdup(
+					purple_account_get_protocol_id(account));
+
+			node = accountprivacy_to_xmlnode(account);
+		}
+
+		str = _purple_xmlnode_to_formatted_str_at_depth(node, depth, &len);
+		purple_xmlnode_free(node);
+
+		if (cache->xml != NULL)
+			g_bytes_unref(cache->xml);
+
+		cache->xml = g_bytes_new_take(str, len);
+		cache->epoch = blist_xml_epoch;
+	}
+
+	data = g_bytes_get_data(cache->xml, &size);
+	g_string_append_len(xml, data, size);
+}
+
+static void
+purple_blist_xml_append_group(GString *xml, PurpleGroup *group)
+{
+	PurpleXmlNode *node, *child;
+	PurpleBlistNode *cnode;
+	const char *name;
+	char *escaped;
+
+	node = group_to_xmlnode(group);
+
+	name = purple_xmlnode_get_attrib(node, "name");
+	if (name != NULL) {
+		escaped = g_markup_escape_text(name, -1);
+		g_string_append_printf(xml, "\t\t<group name='%s'>" NEWLINE_S,
+				escaped);
+		g_free(escaped);
+	} else {
+		g_string_append(xml, "\t\t<group>" NEWLINE_S);
+	}
+
+	for (child = node->child; child != NULL; child = child->next) {
+		if (child->type == PURPLE_XMLNODE_TYPE_TAG) {
+			char *str;
+			int len;
+
+			str = _purple_xmlnode_to_formatted_str_at_depth(child, 3, &len);
+			g_string_append_len(xml, str, len);
+			g_free(str);
+		}
+	}
+	purple_xmlnode_free(node);
+
+	/* Write contacts and chats */
+	for (cnode = PURPLE_BLIST_NODE(group)->child; cnode != NULL; cnode = cnode->next)
+	{
+		if (purple_blist_node_is_transient(cnode))
+			continue;
+		if (PURPLE_IS_CONTACT(cnode) || PURPLE_IS_CHAT(cnode))
+			purple_blist_xml_append(xml, cnode, 3);
+	}
+
+	g_string_append(xml, "\t\t</group>" NEWLINE_S);
+}
+
+/* Assembles the whole file, serializing only the fragments that are missing
+ * or stale. */
+static GBytes *
+purple_blist_to_xml(void)
+{
+	GString *xml;
 	PurpleBlistNode *gnode;
 	GList *cur;
 	const gchar *localized_default;
 
-	node = purple_xmlnode_new("purple");
-	purple_xmlnode_set_attrib(node, "version", "1.0");
+	/* The file rarely changes size much between saves */
+	xml = g_string_sized_new(blist_xml_size);
+	g_string_append(xml, "<?xml version='1.0' encoding='UTF-8' ?>"
+			NEWLINE_S NEWLINE_S "<purple version='1.0'>" NEWLINE_S);
 
 	/* Write groups */
-	child = purple_xmlnode_new_child(node, "blist");
-
 	localized_default = localized_default_group_name;
 	if (!purple_strequal(_("Buddies"), "Buddies"))
 		localized_default = _("Buddies");
 	if (localized_default != NULL) {
-		purple_xmlnode_set_attrib(child,
-			"localized-default-group", localized_default);
+		char *escaped = g_markup_escape_text(localized_default, -1);
+		g_string_append_printf(xml,
+				"\t<blist localized-default-group='%s'>" NEWLINE_S,
+				escaped);
+		g_free(escaped);
+	} else {
+		g_string_append(xml, "\t<blist>" NEWLINE_S);
 	}
 
 	for (gnode = purple_blist_get_default_root(); gnode != NULL;
@@ -380,28 +514,29 @@ blist_to_xmlnode(void)
 		if (purple_blist_node_is_transient(gnode))
 			continue;
 		if (PURPLE_IS_GROUP(gnode))
-		{
-			grandchild = group_to_xmlnode(PURPLE_GROUP(gnode));
-			purple_xmlnode_insert_child(child, grandchild);
-		}
+			purple_blist_xml_append_group(xml, PURPLE_GROUP(gnode));
 	}
 
+	g_string_append(xml, "\t</blist>" NEWLINE_S);
+
 	/* Write privacy settings */
-	child = purple_xmlnode_new_child(node, "privacy");
+	g_string_append(xml, "\t<privacy>" NEWLINE_S);
 	for (cur = purple_accounts_get_all(); cur != NULL; cur = cur->next)
-	{
-		grandchild = accountprivacy_to_xmlnode(cur->data);
-		purple_xmlnode_insert_child(child, grandchild);
-	}
+		purple_blist_xml_append(xml, cur->data, 2);
+	g_string_append(xml, "\t</privacy>" NEWLINE_S);
 
-	return node;
+	g_string_append(xml, "</purple>" NEWLINE_S);
+
+	blist_xml_size = xml->len + 1;
+
+	return g_string_free_to_bytes(xml);
 }
 
 static void
 purple_blist_sync(void)
 {
-	PurpleXmlNode *node;
-	char *data;
+	GBytes *data;
+	char *filename;
 
 	if (!blist_loaded)
 	{
@@ -410,11 +545,11 @@ purple_blist_sync(void)
 		return;
 	}
 
-	node = blist_to_xmlnode();
-	data = purple_xmlnode_to_formatted_str(node, NULL);
-	purple_util_write_data_to_config_file("blist.xml", data, -1);
-	g_free(data);
-	purple_xmlnode_free(node);
+	data = purple_blist_to_xml();
+	filename = g_build_filename(purple_config_dir(), "blist.xml", NULL);
+	purple_util_write_data_to_file_deferred(filename, data);
+	g_free(filename);
+	g_bytes_unref(data);
 }
 
 static gboolean
@@ -435,20 +570,38 @@ purple_blist_real_schedule_save(void)
 static void
 purple_blist_real_save_account(PurpleBuddyList *list, PurpleAccount *account)
 {
-#if 1
-	purple_blist_real_schedule_save();
-#else
 	if (account != NULL) {
-		/* Save the buddies and privacy data for this account */
+		/* Save the privacy data for this account, and if the account was
+		 * renamed, all of its buddies and chats along with everything else */
+		PurpleBlistXml *cache = g_object_get_qdata(G_OBJECT(account),
+				purple_blist_xml_quark());
+
+		if (cache != NULL && (!purple_strequal(cache->username,
+				purple_account_get_username(account)) ||
+				!purple_strequal(cache->protocol_id,
+				purple_account_get_protocol_id(account))))
+			blist_xml_epoch++;
+
+		purple_blist_xml_invalidate(account);
 	} else {
 		/* Save all buddies and privacy data */
+		blist_xml_epoch++;
 	}
-#endif
+
+	purple_blist_real_schedule_save();
 }
 
 static void
 purple_blist_real_save_node(PurpleBuddyList *list, PurpleBlistNode *node)
 {
+	/* Buddies are written as part of their contact, and groups are
+	 * written out from scratch every time */
+	if (PURPLE_IS_BUDDY(node))
+		node = node->parent;
+
+	if (node != NULL && !PURPLE_IS_GROUP(node))
+		purple_blist_xml_invalidate(node);
+
 	purple_blist_real_schedule_save();
 }
 
@@ -664,6 +817,7 @@ load_blist(void)
 		for (anode = privacy->child; anode; anode = anode->next) {
 			PurpleXmlNode *x;
 			PurpleAccount *account;
+			GSList *permit = NULL, *deny = NULL;
 			int imode;
 			const char *acct_name, *proto, *mode;
 
@@ -689,14 +843,21 @@ load_blist(void)
 
 				if (purple_strequal(x->name, "permit")) {
 					name = purple_xmlnode_get_data(x);
-					purple_account_privacy_permit_add(account, name, TRUE);
-					g_free(name);
+					if (name != NULL)
+						permit = g_slist_prepend(permit, name);
 				} else if (purple_strequal(x->name, "block")) {
 					name = purple_xmlnode_get_data(x);
-					purple_account_privacy_deny_add(account, name, TRUE);
-					g_free(name);
+					if (name != NULL)
+						deny = g_slist_prepend(deny, name);
 				}
 			}
+
+			permit = g_slist_reverse(permit);
+			deny = g_slist_reverse(deny);
+			purple_account_privacy_permit_add_list(account, permit, TRUE);
+			purple_account_privacy_deny_add_list(account, deny, TRUE);
+			g_slist_free_full(permit, g_free);
+			g_slist_free_full(deny, g_free);
 		}
 	}
 
@@ -827,19 +988,20 @@ void purple_blist_update_buddies_cache(PurpleBuddy *buddy, const char *new_name)
 	name = (gchar *)purple_buddy_get_name(buddy);
 
 	hb = g_new(struct _purple_hbuddy, 1);
-	hb->name = (gchar *)purple_normalize(account, name);
+	hb->name = purple_normalize_atom(account, name);
 	hb->account = account;
 	hb->group = PURPLE_BLIST_NODE(buddy)->parent->parent;
 	g_hash_table_remove(priv->buddies, hb);
 
 	account_buddies = g_hash_table_lookup(buddies_cache, account);
 	g_hash_table_remove(account_buddies, hb);
+	purple_normalize_atom_unref(hb->name);
 
-	hb->name = g_strdup(purple_normalize(account, new_name));
+	hb->name = purple_normalize_atom(account, new_name);
 	g_hash_table_replace(priv->buddies, hb, buddy);
 
 	hb2 = g_new(struct _purple_hbuddy, 1);
-	hb2->name = g_strdup(hb->name);
+	hb2->name = purple_normalize_atom_ref(hb->name);
 	hb2->account = account;
 	hb2->group = PURPLE_BLIST_NODE(buddy)->parent->parent;
 
@@ -1037,9 +1199,13 @@ void purple_blist_add_buddy(PurpleBuddy *buddy, PurpleContact *contact, PurpleGr
 			klass->remove(purplebuddylist, bnode);
 		}
 
+		if (klass && klass->remove_node) {
+			klass->remove_node(purplebuddylist, bnode);
+		}
+
 		if (bnode->parent->parent != (PurpleBlistNode*)g) {
 			struct _purple_hbuddy hb;
-			hb.name = (gchar *)purple_normalize(account,
+			hb.name = purple_normalize_atom(account,
 					purple_buddy_get_name(buddy));
 			hb.account = account;
 			hb.group = bnode->parent->parent;
@@ -1047,6 +1213,7 @@ void purple_blist_add_buddy(PurpleBuddy *buddy, PurpleContact *contact, PurpleGr
 
 			account_buddies = g_hash_table_lookup(buddies_cache, account);
 			g_hash_table_remove(account_buddies, &hb);
+			purple_normalize_atom_unref(hb.name);
 		}
 
 		if (!bnode->parent->child) {
@@ -1092,7 +1259,7 @@ void purple_blist_add_buddy(PurpleBuddy *buddy, PurpleContact *contact, PurpleGr
 	purple_counting_node_change_total_size(contact_counter, +1);
 
 	hb = g_new(struct _purple_hbuddy, 1);
-	hb->name = g_strdup(purple_normalize(account, purple_buddy_get_name(buddy)));
+	hb->name = purple_normalize_atom(account, purple_buddy_get_name(buddy));
 	hb->account = account;
 	hb->group = PURPLE_BLIST_NODE(buddy)->parent->parent;
 
@@ -1101,7 +1268,7 @@ void purple_blist_add_buddy(PurpleBuddy *buddy, PurpleContact *contact, PurpleGr
 	account_buddies = g_hash_table_lookup(buddies_cache, account);
 
 	hb2 = g_new(struct _purple_hbuddy, 1);
-	hb2->name = g_strdup(hb->name);
+	hb2->name = purple_normalize_atom_ref(hb->name);
 	hb2->account = account;
 	hb2->group = ((PurpleBlistNode*)buddy)->parent->parent;
 
@@ -1172,7 +1339,7 @@ void purple_blist_add_contact(PurpleContact *contact, PurpleGroup *group, Purple
 				struct _purple_hbuddy *hb, *hb2;
 
 				hb = g_new(struct _purple_hbuddy, 1);
-				hb->name = g_strdup(purple_normalize(account, purple_buddy_get_name(b)));
+				hb->name = purple_normalize_atom(account, purple_buddy_get_name(b));
 				hb->account = account;
 				hb->group = cnode->parent;
 
@@ -1186,7 +1353,7 @@ void purple_blist_add_contact(PurpleContact *contact, PurpleGroup *group, Purple
 					g_hash_table_replace(priv->buddies, hb, b);
 
 					hb2 = g_new(struct _purple_hbuddy, 1);
-					hb2->name = g_strdup(hb->name);
+					hb2->name = purple_normalize_atom_ref(hb->name);
 					hb2->account = account;
 					hb2->group = gnode;
 
@@ -1199,8 +1366,7 @@ void purple_blist_add_contact(PurpleContact *contact, PurpleGroup *group, Purple
 
 					/* this buddy already exists in the group, so we're
 					 * gonna delete it instead */
-					g_free(hb->name);
-					g_free(hb);
+					_purple_blist_hbuddy_free_key(hb);
 					if (purple_account_get_connection(account))
 						purple_account_remove_buddy(account, b, PURPLE_GROUP(cnode->parent));
 
@@ -1473,13 +1639,14 @@ void purple_blist_remove_buddy(PurpleBuddy *buddy)
 	}
 
 	/* Remove this buddy from the buddies hash table */
-	hb.name = (gchar *)purple_normalize(account, purple_buddy_get_name(buddy));
+	hb.name = purple_normalize_atom(account, purple_buddy_get_name(buddy));
 	hb.account = account;
 	hb.group = gnode;
 	g_hash_table_remove(priv->buddies, &hb);
 
 	account_buddies = g_hash_table_lookup(buddies_cache, account);
 	g_hash_table_remove(account_buddies, &hb);
+	purple_normalize_atom_unref(hb.name);
 
 	/* Update the UI */
 	if (klass && klass->remove) {
@@ -1627,7 +1794,8 @@ PurpleBuddy *purple_blist_find_buddy(PurpleAccount *account, const char *name)
 	g_return_val_if_fail((name != NULL) && (*name != '\0'), NULL);
 
 	hb.account = account;
-	hb.name = (gchar *)purple_normalize(account, name);
+	hb.name = purple_normalize_atom(account, name);
+	buddy = NULL;
 
 	for (group = priv->root; group; group = group->next) {
 		if (!group->child)
@@ -1635,11 +1803,12 @@ PurpleBuddy *purple_blist_find_buddy(PurpleAccount *account, const char *name)
 
 		hb.group = group;
 		if ((buddy = g_hash_table_lookup(priv->buddies, &hb))) {
-			return buddy;
+			break;
 		}
 	}
 
-	return NULL;
+	purple_normalize_atom_unref(hb.name);
+	return buddy;
 }
 
 PurpleBuddy *purple_blist_find_buddy_in_group(PurpleAccount *account, const char *name,
@@ -1647,17 +1816,21 @@ PurpleBuddy *purple_blist_find_buddy_in_group(PurpleAccount *account, const char
 {
 	PurpleBuddyListPrivate *priv =
 			purple_buddy_list_get_instance_private(purplebuddylist);
+	PurpleBuddy *buddy;
 	struct _purple_hbuddy hb;
 
 	g_return_val_if_fail(PURPLE_IS_BUDDY_LIST(purplebuddylist), NULL);
 	g_return_val_if_fail(PURPLE_IS_ACCOUNT(account), NULL);
 	g_return_val_if_fail((name != NULL) && (*name != '\0'), NULL);
 
-	hb.name = (gchar *)purple_normalize(account, name);
+	hb.name = purple_normalize_atom(account, name);
 	hb.account = account;
 	hb.group = (PurpleBlistNode*)group;
 
-	return g_hash_table_lookup(priv->buddies, &hb);
+	buddy = g_hash_table_lookup(priv->buddies, &hb);
+	purple_normalize_atom_unref(hb.name);
+
+	return buddy;
 }
 
 static void find_acct_buddies(gpointer key, gpointer value, gpointer data)
@@ -1682,7 +1855,7 @@ GSList *purple_blist_find_buddies(PurpleAccount *account, const char *name)
 	if ((name != NULL) && (*name != '\0')) {
 		struct _purple_hbuddy hb;
 
-		hb.name = (gchar *)purple_normalize(account, name);
+		hb.name = purple_normalize_atom(account, name);
 		hb.account = account;
 
 		for (node = priv->root; node != NULL; node = node->next) {
@@ -1694,6 +1867,8 @@ GSList *purple_blist_find_buddies(PurpleAccount *account, const char *name)
 					&hb)) != NULL)
 				ret = g_slist_prepend(ret, buddy);
 		}
+
+		purple_normalize_atom_unref(hb.name);
 	} else {
 		GSList *list = NULL;
 		GHashTable *buddies = g_hash_table_lookup(buddies_cache, account);
@@ -1748,7 +1923,8 @@ purple_blist_find_chat(PurpleAccount *account, const char *name)
 	PurpleProtocolChatEntry *pce;
 	PurpleBlistNode *node, *group;
 	GList *parts;
-	char *normname;
+	const gchar *normname, *chat_normname;
+	gboolean found;
 
 	g_return_val_if_fail(PURPLE_IS_BUDDY_LIST(purplebuddylist), NULL);
 	g_return_val_if_fail((name != NULL) && (*name != '\0'), NULL);
@@ -1761,7 +1937,7 @@ purple_blist_find_chat(PurpleAccount *account, const char *name)
 	if (PURPLE_PROTOCOL_IMPLEMENTS(protocol, CLIENT, find_blist_chat))
 		return purple_protocol_client_iface_find_blist_chat(protocol, account, name);
 
-	normname = g_strdup(purple_normalize(account, name));
+	normname = purple_normalize_atom(account, name);
 	for (group = purple_blist_get_default_root(); group != NULL;
 	     group = group->next) {
 		for (node = group->child; node != NULL; node = node->next) {
@@ -1780,16 +1956,22 @@ purple_blist_find_chat(PurpleAccount *account, const char *name)
 												pce->identifier);
 				g_list_free_full(parts, g_free);
 
-				if (purple_chat_get_account(chat) == account && chat_name != NULL &&
-					purple_strequal(purple_normalize(account, chat_name), normname)) {
-					g_free(normname);
+				if (purple_chat_get_account(chat) != account || chat_name == NULL)
+					continue;
+
+				chat_normname = purple_normalize_atom(account, chat_name);
+				found = (chat_normname == normname);
+				purple_normalize_atom_unref(chat_normname);
+
+				if (found) {
+					purple_normalize_atom_unref(normname);
 					return chat;
 				}
 			}
 		}
 	}
 
-	g_free(normname);
+	purple_normalize_atom_unref(normname);
 	return NULL;
 }
 
@@ -61,6 +61,8 @@ typedef struct
 
 	GSList *active_chats;         /* A list of active chats
 	                                  (#PurpleChatConversation structs). */
+	GHashTable *active_chats_set; /* The same chats, for membership
+	                                  checks.                           */
 
 	/* TODO Remove this and use protocol-specific subclasses. */
 	void *proto_data;             /* Protocol-specific data.           */
@@ -414,6 +416,11 @@ _purple_connection_add_active_chat(PurpleConnection *gc, PurpleChatConversation
 	g_return_if_fail(PURPLE_IS_CONNECTION(gc));
 
 	priv = purple_connection_get_instance_private(gc);
+
+	if (priv->active_chats_set == NULL ||
+			!g_hash_table_add(priv->active_chats_set, chat))
+		return;
+
 	priv->active_chats = g_slist_append(priv->active_chats, chat);
 }
 
@@ -425,9 +432,27 @@ _purple_connection_remove_active_chat(PurpleConnection *gc, PurpleChatConversati
 	g_return_if_fail(PURPLE_IS_CONNECTION(gc));
 
 	priv = purple_connection_get_instance_private(gc);
+
+	if (priv->active_chats_set == NULL ||
+			!g_hash_table_remove(priv->active_chats_set, chat))
+		return;
+
 	priv->active_chats = g_slist_remove(priv->active_chats, chat);
 }
 
+gboolean
+_purple_connection_has_active_chat(PurpleConnection *gc,
+                                   PurpleChatConversation *chat)
+{
+	PurpleConnectionPrivate *priv = NULL;
+
+	g_return_val_if_fail(PURPLE_IS_CONNECTION(gc), FALSE);
+
+	priv = purple_connection_get_instance_private(gc);
+	return priv->active_chats_set != NULL &&
+	       g_hash_table_contains(priv->active_chats_set, chat);
+}
+
 gboolean
 _purple_connection_wants_to_die(PurpleConnection *gc)
 {
@@ -834,6 +859,10 @@ purple_connection_get_property(GObject *obj, guint param_id, GValue *value,
 static void
 purple_connection_init(PurpleConnection *gc)
 {
+	PurpleConnectionPrivate *priv = purple_connection_get_instance_private(gc);
+
+	priv->active_chats_set = g_hash_table_new(g_direct_hash, g_direct_equal);
+
 	purple_connection_set_state(gc, PURPLE_CONNECTION_CONNECTING);
 	connections = g_list_append(connections, gc);
 }
@@ -861,7 +890,7 @@ purple_connection_finalize(GObject *object)
 	PurpleConnection *gc = PURPLE_CONNECTION(object);
 	PurpleConnectionPrivate *priv = purple_connection_get_instance_private(gc);
 	PurpleAccount *account;
-	GSList *buddies;
+	GSList *buddies, *chats;
 	gboolean remove = FALSE;
 	gpointer handle;
 
@@ -877,12 +906,22 @@ purple_connection_finalize(GObject *object)
 
 	purple_signal_emit(handle, "signing-off", gc);
 
-	g_slist_free_full(priv->active_chats, (GDestroyNotify)purple_chat_conversation_leave);
+	/* Take the list first; leaving a chat may try to remove it again */
+	chats = priv->active_chats;
+	priv->active_chats = NULL;
+	g_hash_table_remove_all(priv->active_chats_set);
+	g_slist_free_full(chats, (GDestroyNotify)purple_chat_conversation_leave);
 
 	update_keepalive(gc, FALSE);
 
 	purple_protocol_class_close(priv->protocol, gc);
 
+	/* The protocol may still have reported chats as left while closing */
+	g_slist_free(priv->active_chats);
+	priv->active_chats = NULL;
+	g_hash_table_destroy(priv->active_chats_set);
+	priv->active_chats_set = NULL;
+
 	/* Clear out the proto data that was freed in the protocol's close method */
 	buddies = purple_blist_find_buddies(account, NULL);
 	while (buddies != NULL) {
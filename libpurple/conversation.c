@@ -51,7 +51,8 @@ struct _PurpleConversationPrivate
 	PurpleConversationUiOps *ui_ops;  /* UI-specific operations.           */
 
 	PurpleConnectionFlags features;   /* The supported features            */
-	GList *message_history; /* Message history, as a GList of PurpleMessages */
+	GQueue message_history; /* Message history, newest first             */
+	gsize history_size;     /* Estimated memory used by message_history  */
 
 	/* The list of remote smileys. This should be per-buddy (PurpleBuddy),
 	 * but we don't have any class for people not on our buddy
@@ -76,6 +77,123 @@ static GParamSpec *properties[PROP_LAST];
 G_DEFINE_ABSTRACT_TYPE_WITH_PRIVATE(PurpleConversation, purple_conversation,
 		G_TYPE_OBJECT);
 
+/* Estimated memory used by the message history of all conversations. */
+static gsize history_total_size = 0;
+
+G_DEFINE_QUARK(purple-conversation-history-size,
+		purple_conversation_history_size);
+
+/* Roughly what a PurpleMessage costs besides its strings. */
+#define HISTORY_MESSAGE_OVERHEAD 128
+
+static gsize
+history_message_size(PurpleMessage *msg)
+{
+	const gchar *str;
+	gsize size = HISTORY_MESSAGE_OVERHEAD;
+
+	if ((str = purple_message_get_author(msg)) != NULL)
+		size += strlen(str) + 1;
+	if ((str = purple_message_get_author_alias(msg)) != NULL)
+		size += strlen(str) + 1;
+	if ((str = purple_message_get_recipient(msg)) != NULL)
+		size += strlen(str) + 1;
+	if ((str = purple_message_get_contents(msg)) != NULL)
+		size += strlen(str) + 1;
+
+	return size;
+}
+
+static void
+history_push(PurpleConversationPrivate *priv, PurpleMessage *msg)
+{
+	gsize size = history_message_size(msg);
+
+	/* Remember what was accounted for, in case the message changes. */
+	g_object_set_qdata(G_OBJECT(msg),
+			purple_conversation_history_size_quark(),
+			GSIZE_TO_POINTER(size));
+	g_queue_push_head(&priv->message_history, g_object_ref(msg));
+
+	priv->history_size += size;
+	history_total_size += size;
+}
+
+static void
+history_pop_oldest(PurpleConversationPrivate *priv)
+{
+	PurpleMessage *msg = g_queue_pop_tail(&priv->message_history);
+	gsize size;
+
+	size = GPOINTER_TO_SIZE(g_object_get_qdata(G_OBJECT(msg),
+			purple_conversation_history_size_quark()));
+	priv->history_size -= size;
+	history_total_size -= size;
+
+	g_object_unref(msg);
+}
+
+/*
+ * Keeps the message history of a conversation within
+ * /purple/conversations/history/max_messages and max_size (in KiB), and
+ * that of all conversations together within total_size, by dropping the
+ * oldest messages of the biggest histories.  A limit of 0 disables it.
+ * Logs are unaffected, so anything dropped here can still be found there.
+ */
+static void
+history_trim(PurpleConversation *conv)
+{
+	PurpleConversationPrivate *priv =
+			purple_conversation_get_instance_private(conv);
+	gsize max_messages, max_size, total_size;
+
+	max_messages = MAX(purple_prefs_get_int(
+			"/purple/conversations/history/max_messages"), 0);
+	max_size = MAX(purple_prefs_get_int(
+			"/purple/conversations/history/max_size"), 0) * 1024;
+	total_size = MAX(purple_prefs_get_int(
+			"/purple/conversations/history/total_size"), 0) * 1024;
+
+	/* Always keep the newest message. */
+	while (priv->message_history.length > 1 &&
+			((max_messages > 0 && priv->message_history.length > max_messages) ||
+			 (max_size > 0 && priv->history_size > max_size))) {
+		history_pop_oldest(priv);
+	}
+
+	if (total_size > 0 && history_total_size > total_size) {
+		/* Go a bit below the limit so this doesn't run for every message. */
+		gsize target = total_size - total_size / 10;
+
+		while (history_total_size > target) {
+			PurpleConversationPrivate *biggest = NULL;
+			GList *l;
+			gsize goal;
+
+			for (l = purple_conversations_get_all(); l; l = l->next) {
+				PurpleConversationPrivate *p =
+					purple_conversation_get_instance_private(l->data);
+
+				if (p->message_history.length > 1 &&
+						(biggest == NULL || p->history_size > biggest->history_size)) {
+					biggest = p;
+				}
+			}
+
+			if (biggest == NULL)
+				break;
+
+			/* Take a quarter of the biggest history at a time. */
+			goal = biggest->history_size - biggest->history_size / 4;
+			do {
+				history_pop_oldest(biggest);
+			} while (biggest->message_history.length > 1 &&
+					biggest->history_size > goal &&
+					history_total_size > target);
+		}
+	}
+}
+
 static void
 common_send(PurpleConversation *conv, const char *message, PurpleMessageFlags msgflags)
 {
@@ -469,6 +587,20 @@ purple_conversation_close_logs(PurpleConversation *conv)
 	priv->logs = NULL;
 }
 
+/* Signal IDs never change once registered, so each is looked up once. */
+static gulong writing_im_msg_signal = 0, writing_chat_msg_signal = 0;
+static gulong wrote_im_msg_signal = 0, wrote_chat_msg_signal = 0;
+
+static gulong
+conversation_signal_id(gulong *signal_id, const char *signal)
+{
+	if (G_UNLIKELY(*signal_id == 0))
+		*signal_id = purple_signal_lookup(purple_conversations_get_handle(),
+		                                  signal);
+
+	return *signal_id;
+}
+
 void
 _purple_conversation_write_common(PurpleConversation *conv, PurpleMessage *pmsg)
 {
@@ -478,6 +610,7 @@ _purple_conversation_write_common(PurpleConversation *conv, PurpleMessage *pmsg)
 	PurpleAccount *account;
 	PurpleConversationUiOps *ops;
 	PurpleBuddy *b;
+	gulong signal_id;
 	int plugin_return;
 	/* int logging_font_options = 0; */
 
@@ -492,18 +625,19 @@ _purple_conversation_write_common(PurpleConversation *conv, PurpleMessage *pmsg)
 	if (account != NULL)
 		gc = purple_account_get_connection(account);
 
-	if (PURPLE_IS_CHAT_CONVERSATION(conv) &&
-		(gc != NULL && !g_slist_find(purple_connection_get_active_chats(gc), conv)))
+	if (PURPLE_IS_CHAT_CONVERSATION(conv) && gc != NULL &&
+		!_purple_connection_has_active_chat(gc, PURPLE_CHAT_CONVERSATION(conv)))
 		return;
 
 	if (PURPLE_IS_IM_CONVERSATION(conv) &&
-		!g_list_find(purple_conversations_get_all(), conv))
+		!_purple_conversations_contains(conv))
 		return;
 
-	plugin_return = GPOINTER_TO_INT(purple_signal_emit_return_1(
-		purple_conversations_get_handle(),
-		(PURPLE_IS_IM_CONVERSATION(conv) ? "writing-im-msg" : "writing-chat-msg"),
-		conv, pmsg));
+	signal_id = PURPLE_IS_IM_CONVERSATION(conv) ?
+		conversation_signal_id(&writing_im_msg_signal, "writing-im-msg") :
+		conversation_signal_id(&writing_chat_msg_signal, "writing-chat-msg");
+	plugin_return = purple_signal_has_handlers(signal_id) &&
+		GPOINTER_TO_INT(purple_signal_emit_return_1_by_id(signal_id, conv, pmsg));
 
 	if (purple_message_is_empty(pmsg))
 		return;
@@ -576,12 +710,14 @@ _purple_conversation_write_common(PurpleConversation *conv, PurpleMessage *pmsg)
 			ops->write_conv(conv, pmsg);
 	}
 
-	g_object_ref(pmsg);
-	priv->message_history = g_list_prepend(priv->message_history, pmsg);
+	history_push(priv, pmsg);
+	history_trim(conv);
 
-	purple_signal_emit(purple_conversations_get_handle(),
-		(PURPLE_IS_IM_CONVERSATION(conv) ? "wrote-im-msg" : "wrote-chat-msg"),
-		conv, pmsg);
+	signal_id = PURPLE_IS_IM_CONVERSATION(conv) ?
+		conversation_signal_id(&wrote_im_msg_signal, "wrote-im-msg") :
+		conversation_signal_id(&wrote_chat_msg_signal, "wrote-chat-msg");
+	if (purple_signal_has_handlers(signal_id))
+		purple_signal_emit_by_id(signal_id, conv, pmsg);
 }
 
 void
@@ -728,14 +864,12 @@ purple_conversation_get_extended_menu(PurpleConversation *conv)
 void purple_conversation_clear_message_history(PurpleConversation *conv)
 {
 	PurpleConversationPrivate *priv = NULL;
-	GList *list;
 
 	g_return_if_fail(PURPLE_IS_CONVERSATION(conv));
 
 	priv = purple_conversation_get_instance_private(conv);
-	list = priv->message_history;
-	g_list_free_full(list, g_object_unref);
-	priv->message_history = NULL;
+	while (!g_queue_is_empty(&priv->message_history))
+		history_pop_oldest(priv);
 
 	purple_signal_emit(purple_conversations_get_handle(),
 			"cleared-message-history", conv);
@@ -748,7 +882,7 @@ GList *purple_conversation_get_message_history(PurpleConversation *conv)
 	g_return_val_if_fail(PURPLE_IS_CONVERSATION(conv), NULL);
 
 	priv = purple_conversation_get_instance_private(conv);
-	return priv->message_history;
+	return priv->message_history.head;
 }
 
 void purple_conversation_set_ui_data(PurpleConversation *conv, gpointer ui_data)
@@ -223,7 +223,9 @@ struct _PurpleConversationClass {
  *              the UI will miss conversation error messages and your users will
  *              hate you. See purple_conversation_write_message().
  * @chat_add_users: Add @cbuddies to a chat.
- *                  <sbr/>@cbuddies:     A GList of #PurpleChatUser structs.
+ *                  <sbr/>@cbuddies:     A GList of #PurpleChatUser structs,
+ *                                       already sorted in display order, so
+ *                                       the UI can append them in one pass.
  *                  <sbr/>@new_arrivals: Whether join notices should be shown.
  *                                       (Join notices are actually written to
  *                                       the conversation by
@@ -537,6 +539,11 @@ void purple_conversation_update(PurpleConversation *conv, PurpleConversationUpda
  *
  * Retrieve the message history of a conversation.
  *
+ * Only recent messages are kept: the history is bounded by the
+ * /purple/conversations/history preferences, and the oldest messages are
+ * dropped once a conversation or all of them together exceed those.  The
+ * conversation's logs remain the complete record.
+ *
  * Returns: (element-type PurpleMessage) (transfer none):
  *          A GList of PurpleMessage's. You must not modify the
  *          list or the data within. The list contains the newest message at
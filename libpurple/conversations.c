@@ -33,12 +33,28 @@ static PurpleConversationUiOps *default_ops = NULL;
  */
 static GHashTable *conversation_cache = NULL;
 
+/*
+ * The conversations in the lists above, for cheap membership checks.
+ */
+static GHashTable *conversation_set = NULL;
+
+/*
+ * A hash table used for efficient lookups of chats by ID.
+ * struct _purple_hchat => GList of PurpleChatConversation*, newest first
+ */
+static GHashTable *chat_cache = NULL;
+
 struct _purple_hconv {
 	gboolean im;
 	char *name;
 	PurpleAccount *account;
 };
 
+struct _purple_hchat {
+	PurpleAccount *account;
+	int id;
+};
+
 static guint
 _purple_conversations_hconv_hash(struct _purple_hconv *hc)
 {
@@ -60,6 +76,64 @@ _purple_conversations_hconv_free_key(struct _purple_hconv *hc)
 	g_free(hc);
 }
 
+static guint
+_purple_conversations_hchat_hash(struct _purple_hchat *hc)
+{
+	return g_direct_hash(hc->account) ^ (guint)hc->id;
+}
+
+static gboolean
+_purple_conversations_hchat_equal(struct _purple_hchat *hc1, struct _purple_hchat *hc2)
+{
+	return (hc1->account == hc2->account && hc1->id == hc2->id);
+}
+
+static void
+_purple_conversations_chat_cache_add(PurpleChatConversation *chat,
+		PurpleAccount *account, int id)
+{
+	struct _purple_hchat lookup, *hc;
+	GList *list;
+
+	lookup.account = account;
+	lookup.id = id;
+
+	/* Steal the entry so replacing it does not free the list. */
+	if (g_hash_table_lookup_extended(chat_cache, &lookup, (gpointer *)&hc,
+			(gpointer *)&list)) {
+		g_hash_table_steal(chat_cache, &lookup);
+	} else {
+		hc = g_new(struct _purple_hchat, 1);
+		*hc = lookup;
+		list = NULL;
+	}
+
+	g_hash_table_insert(chat_cache, hc, g_list_prepend(list, chat));
+}
+
+static void
+_purple_conversations_chat_cache_remove(PurpleChatConversation *chat,
+		PurpleAccount *account, int id)
+{
+	struct _purple_hchat hc;
+	gpointer key;
+	GList *list;
+
+	hc.account = account;
+	hc.id = id;
+
+	if (!g_hash_table_lookup_extended(chat_cache, &hc, &key, (gpointer *)&list))
+		return;
+
+	g_hash_table_steal(chat_cache, &hc);
+
+	list = g_list_remove(list, chat);
+	if (list != NULL)
+		g_hash_table_insert(chat_cache, key, list);
+	else
+		g_free(key);
+}
+
 void
 purple_conversations_add(PurpleConversation *conv)
 {
@@ -68,17 +142,22 @@ purple_conversations_add(PurpleConversation *conv)
 
 	g_return_if_fail(conv != NULL);
 
-	if (g_list_find(conversations, conv) != NULL)
+	if (!g_hash_table_add(conversation_set, conv))
 		return;
 
 	conversations = g_list_prepend(conversations, conv);
 
-	if (PURPLE_IS_IM_CONVERSATION(conv))
+	account = purple_conversation_get_account(conv);
+
+	if (PURPLE_IS_IM_CONVERSATION(conv)) {
 		ims = g_list_prepend(ims, conv);
-	else
-		chats = g_list_prepend(chats, conv);
+	} else {
+		PurpleChatConversation *chat = PURPLE_CHAT_CONVERSATION(conv);
 
-	account = purple_conversation_get_account(conv);
+		chats = g_list_prepend(chats, conv);
+		_purple_conversations_chat_cache_add(chat, account,
+				purple_chat_conversation_get_id(chat));
+	}
 
 	hc = g_new(struct _purple_hconv, 1);
 	hc->name = g_strdup(purple_normalize(account,
@@ -97,14 +176,22 @@ purple_conversations_remove(PurpleConversation *conv)
 
 	g_return_if_fail(conv != NULL);
 
+	if (!g_hash_table_remove(conversation_set, conv))
+		return;
+
 	conversations = g_list_remove(conversations, conv);
 
-	if (PURPLE_IS_IM_CONVERSATION(conv))
+	account = purple_conversation_get_account(conv);
+
+	if (PURPLE_IS_IM_CONVERSATION(conv)) {
 		ims = g_list_remove(ims, conv);
-	else
-		chats = g_list_remove(chats, conv);
+	} else {
+		PurpleChatConversation *chat = PURPLE_CHAT_CONVERSATION(conv);
 
-	account = purple_conversation_get_account(conv);
+		chats = g_list_remove(chats, conv);
+		_purple_conversations_chat_cache_remove(chat, account,
+				purple_chat_conversation_get_id(chat));
+	}
 
 	hc.name = (gchar *)purple_normalize(account,
 				purple_conversation_get_name(conv));
@@ -134,6 +221,15 @@ _purple_conversations_update_cache(PurpleConversation *conv, const char *name,
 
 	g_hash_table_remove(conversation_cache, hc);
 
+	if (account && PURPLE_IS_CHAT_CONVERSATION(conv) &&
+			g_hash_table_contains(conversation_set, conv)) {
+		PurpleChatConversation *chat = PURPLE_CHAT_CONVERSATION(conv);
+		int id = purple_chat_conversation_get_id(chat);
+
+		_purple_conversations_chat_cache_remove(chat, old_account, id);
+		_purple_conversations_chat_cache_add(chat, account, id);
+	}
+
 	if (account)
 		hc->account = account;
 	if (name)
@@ -142,6 +238,30 @@ _purple_conversations_update_cache(PurpleConversation *conv, const char *name,
 	g_hash_table_insert(conversation_cache, hc, conv);
 }
 
+void
+_purple_conversations_update_chat_id(PurpleChatConversation *chat, int old_id)
+{
+	PurpleAccount *account;
+
+	g_return_if_fail(chat != NULL);
+
+	/* IDs are usually set before the chat is added to the lists. */
+	if (!g_hash_table_contains(conversation_set, chat))
+		return;
+
+	account = purple_conversation_get_account(PURPLE_CONVERSATION(chat));
+
+	_purple_conversations_chat_cache_remove(chat, account, old_id);
+	_purple_conversations_chat_cache_add(chat, account,
+			purple_chat_conversation_get_id(chat));
+}
+
+gboolean
+_purple_conversations_contains(PurpleConversation *conv)
+{
+	return g_hash_table_contains(conversation_set, conv);
+}
+
 GList *
 purple_conversations_get_all(void)
 {
@@ -223,12 +343,18 @@ purple_conversations_find_chat(const PurpleConnection *gc, int id)
 {
 	GList *l;
 	PurpleChatConversation *chat;
+	struct _purple_hchat hc;
+
+	g_return_val_if_fail(gc != NULL, NULL);
 
-	for (l = purple_conversations_get_chats(); l != NULL; l = l->next) {
+	hc.account = purple_connection_get_account((PurpleConnection *)gc);
+	hc.id = id;
+
+	/* The account may have moved on to a new connection. */
+	for (l = g_hash_table_lookup(chat_cache, &hc); l != NULL; l = l->next) {
 		chat = (PurpleChatConversation *)l->data;
 
-		if (purple_chat_conversation_get_id(chat) == id &&
-				purple_conversation_get_connection(PURPLE_CONVERSATION(chat)) == gc)
+		if (purple_conversation_get_connection(PURPLE_CONVERSATION(chat)) == gc)
 			return chat;
 	}
 
@@ -263,6 +389,10 @@ purple_conversations_init(void)
 	conversation_cache = g_hash_table_new_full((GHashFunc)_purple_conversations_hconv_hash,
 						(GEqualFunc)_purple_conversations_hconv_equal,
 						(GDestroyNotify)_purple_conversations_hconv_free_key, NULL);
+	conversation_set = g_hash_table_new(g_direct_hash, g_direct_equal);
+	chat_cache = g_hash_table_new_full((GHashFunc)_purple_conversations_hchat_hash,
+						(GEqualFunc)_purple_conversations_hchat_equal,
+						g_free, (GDestroyNotify)g_list_free);
 
 	/**********************************************************************
 	 * Register preferences
@@ -271,6 +401,12 @@ purple_conversations_init(void)
 	/* Conversations */
 	purple_prefs_add_none("/purple/conversations");
 
+	/* Conversations -> History */
+	purple_prefs_add_none("/purple/conversations/history");
+	purple_prefs_add_int("/purple/conversations/history/max_messages", 4000);
+	purple_prefs_add_int("/purple/conversations/history/max_size", 1024);
+	purple_prefs_add_int("/purple/conversations/history/total_size", 32 * 1024);
+
 	/* Conversations -> Chat */
 	purple_prefs_add_none("/purple/conversations/chat");
 	purple_prefs_add_bool("/purple/conversations/chat/show_nick_change", TRUE);
@@ -390,6 +526,12 @@ purple_conversations_init(void)
 						 G_TYPE_NONE, 4, PURPLE_TYPE_CHAT_CONVERSATION,
 						 G_TYPE_STRING, G_TYPE_UINT, G_TYPE_BOOLEAN);
 
+	purple_signal_register(handle, "chat-users-joined",
+						 purple_marshal_VOID__POINTER_POINTER_UINT,
+						 G_TYPE_NONE, 3, PURPLE_TYPE_CHAT_CONVERSATION,
+						 G_TYPE_POINTER, /* pointer to a GList of PurpleChatUser */
+						 G_TYPE_BOOLEAN);
+
 	purple_signal_register(handle, "chat-user-flags",
 						 purple_marshal_VOID__POINTER_UINT_UINT, G_TYPE_NONE, 3,
 						 PURPLE_TYPE_CHAT_USER, G_TYPE_UINT, G_TYPE_UINT);
@@ -464,5 +606,7 @@ purple_conversations_uninit(void)
 		g_object_unref(G_OBJECT(conversations->data));
 
 	g_hash_table_destroy(conversation_cache);
+	g_hash_table_destroy(conversation_set);
+	g_hash_table_destroy(chat_cache);
 	purple_signals_unregister_by_instance(purple_conversations_get_handle());
 }
@@ -121,6 +121,8 @@ typedef struct
 	                                  (This is currently always NULL.       */
 	gboolean buddy;                /* TRUE if this chat participant is on
 	                                  the buddy list; FALSE otherwise.      */
+	gboolean alias_pending;        /* TRUE if @alias has not been looked up
+	                                  yet; see chat_user_resolve_alias().   */
 	PurpleChatUserFlags flags;     /* A bitwise OR of flags for this
 	                                  participant, such as whether they
 	                                  are a channel operator.               */
@@ -778,7 +780,13 @@ purple_chat_conversation_set_id(PurpleChatConversation *chat, int id)
 	g_return_if_fail(PURPLE_IS_CHAT_CONVERSATION(chat));
 
 	priv = purple_chat_conversation_get_instance_private(chat);
-	priv->id = id;
+
+	if (priv->id != id) {
+		int old_id = priv->id;
+
+		priv->id = id;
+		_purple_conversations_update_chat_id(chat, old_id);
+	}
 
 	g_object_notify_by_pspec(G_OBJECT(chat), chat_properties[CHAT_PROP_ID]);
 }
@@ -839,6 +847,63 @@ purple_chat_conversation_add_user(PurpleChatConversation *chat, const char *user
 	g_list_free(flags2);
 }
 
+/*
+ * Joins larger than this are treated as a bulk join: the per-user signals and
+ * join notices are replaced by a single "chat-users-joined" signal and one
+ * summary notice.
+ */
+#define CHAT_USERS_BULK_JOIN 32
+
+/* Works out what a user added by purple_chat_conversation_add_users() is
+ * shown as.  This is deferred until the alias is first asked for, as a large
+ * join would otherwise look up every user in the buddy list up front. */
+static void
+chat_user_resolve_alias(PurpleChatUser *cb)
+{
+	PurpleChatUserPrivate *priv = purple_chat_user_get_instance_private(cb);
+	PurpleChatConversationPrivate *chat_priv;
+	PurpleAccount *account;
+	PurpleConnection *gc;
+	PurpleProtocol *protocol;
+	const char *alias = priv->name;
+	const gchar *norm;
+	gboolean is_me;
+
+	priv->alias_pending = FALSE;
+
+	account = purple_conversation_get_account(PURPLE_CONVERSATION(priv->chat));
+	gc = purple_account_get_connection(account);
+	protocol = gc ? purple_connection_get_protocol(gc) : NULL;
+
+	if (protocol != NULL &&
+			!(purple_protocol_get_options(protocol) & OPT_PROTO_UNIQUE_CHATNAME)) {
+		chat_priv = purple_chat_conversation_get_instance_private(priv->chat);
+
+		norm = purple_normalize_atom(account, priv->name);
+		is_me = purple_strequal(chat_priv->nick, norm);
+		purple_normalize_atom_unref(norm);
+
+		if (is_me) {
+			const char *alias2 = purple_account_get_private_alias(account);
+			if (alias2 != NULL)
+				alias = alias2;
+			else
+			{
+				const char *display_name = purple_connection_get_display_name(gc);
+				if (display_name != NULL)
+					alias = display_name;
+			}
+		} else if (priv->buddy) {
+			PurpleBuddy *buddy;
+			if ((buddy = purple_blist_find_buddy(account, priv->name)) != NULL)
+				alias = purple_buddy_get_contact_alias(buddy);
+		}
+	}
+
+	g_free(priv->alias);
+	priv->alias = g_strdup(alias);
+}
+
 void
 purple_chat_conversation_add_users(PurpleChatConversation *chat, GList *users, GList *extra_msgs,
 						 GList *flags, gboolean new_arrivals)
@@ -846,12 +911,13 @@ purple_chat_conversation_add_users(PurpleChatConversation *chat, GList *users, G
 	PurpleConversation *conv;
 	PurpleConversationUiOps *ops;
 	PurpleChatUser *chatuser;
+	PurpleChatUserPrivate *cu_priv;
 	PurpleChatConversationPrivate *priv;
-	PurpleAccount *account;
 	PurpleConnection *gc;
-	PurpleProtocol *protocol;
 	GList *ul, *fl;
 	GList *cbuddies = NULL;
+	gboolean bulk;
+	guint joined = 0;
 
 	g_return_if_fail(PURPLE_IS_CHAT_CONVERSATION(chat));
 	g_return_if_fail(users != NULL);
@@ -860,44 +926,31 @@ purple_chat_conversation_add_users(PurpleChatConversation *chat, GList *users, G
 	conv = PURPLE_CONVERSATION(chat);
 	ops  = purple_conversation_get_ui_ops(conv);
 
-	account = purple_conversation_get_account(conv);
 	gc = purple_conversation_get_connection(conv);
 	g_return_if_fail(PURPLE_IS_CONNECTION(gc));
-	protocol = purple_connection_get_protocol(gc);
-	g_return_if_fail(PURPLE_IS_PROTOCOL(protocol));
+	g_return_if_fail(PURPLE_IS_PROTOCOL(purple_connection_get_protocol(gc)));
+
+	bulk = (g_list_nth(users, CHAT_USERS_BULK_JOIN) != NULL);
 
 	ul = users;
 	fl = flags;
 	while ((ul != NULL) && (fl != NULL)) {
 		const char *user = (const char *)ul->data;
-		const char *alias = user;
 		gboolean quiet;
 		PurpleChatUserFlags flag = GPOINTER_TO_INT(fl->data);
 		const char *extra_msg = (extra_msgs ? extra_msgs->data : NULL);
 
-		if(!(purple_protocol_get_options(protocol) & OPT_PROTO_UNIQUE_CHATNAME)) {
-			if (purple_strequal(priv->nick, purple_normalize(account, user))) {
-				const char *alias2 = purple_account_get_private_alias(account);
-				if (alias2 != NULL)
-					alias = alias2;
-				else
-				{
-					const char *display_name = purple_connection_get_display_name(gc);
-					if (display_name != NULL)
-						alias = display_name;
-				}
-			} else {
-				PurpleBuddy *buddy;
-				if ((buddy = purple_blist_find_buddy(purple_connection_get_account(gc), user)) != NULL)
-					alias = purple_buddy_get_contact_alias(buddy);
-			}
+		if (bulk) {
+			quiet = purple_chat_conversation_is_ignored_user(chat, user);
+		} else {
+			quiet = GPOINTER_TO_INT(purple_signal_emit_return_1(purple_conversations_get_handle(),
+							 "chat-user-joining", chat, user, flag)) ||
+					purple_chat_conversation_is_ignored_user(chat, user);
 		}
 
-		quiet = GPOINTER_TO_INT(purple_signal_emit_return_1(purple_conversations_get_handle(),
-						 "chat-user-joining", chat, user, flag)) ||
-				purple_chat_conversation_is_ignored_user(chat, user);
-
-		chatuser = purple_chat_user_new(chat, user, alias, flag);
+		chatuser = purple_chat_user_new(chat, user, NULL, flag);
+		cu_priv = purple_chat_user_get_instance_private(chatuser);
+		cu_priv->alias_pending = TRUE;
 
 		g_hash_table_replace(priv->users,
 			g_strdup(purple_chat_user_get_name(chatuser)),
@@ -905,8 +958,11 @@ purple_chat_conversation_add_users(PurpleChatConversation *chat, GList *users, G
 
 		cbuddies = g_list_prepend(cbuddies, chatuser);
 
-		if (!quiet && new_arrivals) {
-			char *alias_esc = g_markup_escape_text(alias, -1);
+		if (!quiet && new_arrivals && bulk) {
+			joined++;
+		} else if (!quiet && new_arrivals) {
+			char *alias_esc = g_markup_escape_text(
+					purple_chat_user_get_alias(chatuser), -1);
 			char *tmp;
 
 			if (extra_msg == NULL)
@@ -924,19 +980,36 @@ purple_chat_conversation_add_users(PurpleChatConversation *chat, GList *users, G
 			g_free(tmp);
 		}
 
-		purple_signal_emit(purple_conversations_get_handle(),
-						 "chat-user-joined", chat, user, flag, new_arrivals);
+		if (!bulk) {
+			purple_signal_emit(purple_conversations_get_handle(),
+							 "chat-user-joined", chat, user, flag, new_arrivals);
+		}
 		ul = ul->next;
 		fl = fl->next;
 		if (extra_msgs != NULL)
 			extra_msgs = extra_msgs->next;
 	}
 
+	if (joined > 0) {
+		char *tmp = g_strdup_printf(dngettext(PACKAGE,
+				"%u person entered the room.",
+				"%u people entered the room.", joined), joined);
+
+		purple_conversation_write_system_message(
+			conv, tmp, PURPLE_MESSAGE_NO_LINKIFY);
+		g_free(tmp);
+	}
+
 	cbuddies = g_list_sort(cbuddies, (GCompareFunc)purple_chat_user_compare);
 
 	if (ops != NULL && ops->chat_add_users != NULL)
 		ops->chat_add_users(chat, cbuddies, new_arrivals);
 
+	if (bulk) {
+		purple_signal_emit(purple_conversations_get_handle(),
+						 "chat-users-joined", chat, cbuddies, new_arrivals);
+	}
+
 	g_list_free(cbuddies);
 }
 
@@ -1634,6 +1707,10 @@ purple_chat_user_get_alias(PurpleChatUser *cb)
 	g_return_val_if_fail(PURPLE_IS_CHAT_USER(cb), NULL);
 
 	priv = purple_chat_user_get_instance_private(cb);
+
+	if (priv->alias_pending)
+		chat_user_resolve_alias(cb);
+
 	return priv->alias;
 }
 
@@ -1764,6 +1841,7 @@ purple_chat_user_set_property(GObject *obj, guint param_id, const GValue *value,
 		case CU_PROP_ALIAS:
 			g_free(priv->alias);
 			priv->alias = g_value_dup_string(value);
+			priv->alias_pending = FALSE;
 			break;
 		case CU_PROP_FLAGS:
 			priv->flags = g_value_get_flags(value);
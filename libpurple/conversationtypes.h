@@ -508,6 +508,13 @@ void purple_chat_conversation_add_user(PurpleChatConversation *chat, const char
  *
  * The data is copied from @users, @extra_msgs, and @flags, so it is up to
  * the caller to free this list after calling this function.
+ *
+ * Large lists, such as the member list of a busy room, are added in bulk:
+ * instead of the per-user "chat-user-joining" and "chat-user-joined" signals,
+ * "chat-users-joined" is emitted once, and a single summary join notice is
+ * written in place of one per user.  @extra_msgs is not shown in that case.
+ * Protocols that learn the member list one user at a time should collect it
+ * and pass it here in a single call so that it takes this path.
  */
 void purple_chat_conversation_add_users(PurpleChatConversation *chat,
 		GList *users, GList *extra_msgs, GList *flags, gboolean new_arrivals);
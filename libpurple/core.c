@@ -252,6 +252,11 @@ purple_core_quit(void)
 	purple_cmds_uninit();
 	purple_log_uninit();
 	_purple_message_uninit();
+
+	/* Wait for the files saved above, which are written in the
+	 * background, to make it to disk. */
+	purple_util_flush_deferred_writes();
+
 	/* Everything after util_uninit cannot try to write things to the
 	 * confdir.
 	 */
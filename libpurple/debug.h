@@ -195,6 +195,23 @@ void purple_debug_set_enabled(gboolean enabled);
  */
 gboolean purple_debug_is_enabled(void);
 
+/**
+ * purple_debug_is_enabled_for:
+ * @level:    The debug level.
+ * @category: The category, or %NULL.
+ *
+ * Check if a debug message of @level and @category would be printed, either
+ * to the console or by the UI.  Callers can use this to skip building large
+ * debug messages nobody will see.
+ *
+ * Returns: TRUE if such a message would be printed, FALSE if it would be
+ *          dropped.
+ *
+ * Since: 3.0.0
+ */
+gboolean purple_debug_is_enabled_for(PurpleDebugLevel level,
+                                     const char *category);
+
 /**
  * purple_debug_set_verbose:
  * @verbose: TRUE to enable verbose debugging or FALSE to disable it.
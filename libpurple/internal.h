@@ -156,6 +156,12 @@ typedef union
 #define PURPLE_WEBSITE "https://pidgin.im/"
 #define PURPLE_DEVEL_WEBSITE "https://developer.pidgin.im/"
 
+#ifdef _WIN32
+# define NEWLINE_S "\r\n"
+#else
+# define NEWLINE_S "\n"
+#endif
+
 
 /* INTERNAL FUNCTIONS */
 
@@ -183,6 +189,22 @@ void _purple_account_set_current_error(PurpleAccount *account,
  */
 PurpleXmlNode *_purple_account_to_xmlnode(PurpleAccount *account);
 
+/**
+ * _purple_xmlnode_to_formatted_str_at_depth:
+ * @node:  The starting node to output.
+ * @depth: The depth @node is at in the document it will be part of.
+ * @len:   Address for the size of the string.
+ *
+ * Returns the node in a string of human readable xml, indented as if it was
+ * nested @depth levels deep, and without an XML declaration.  This lets
+ * callers assemble a formatted document from separately serialized parts.
+ *
+ * Returns: The node as human readable string.  You must g_free this string
+ *          when finished using it.
+ */
+char *_purple_xmlnode_to_formatted_str_at_depth(const PurpleXmlNode *node,
+                                                int depth, int *len);
+
 /**
  * _purple_blist_get_last_child:
  * @node:  The node whose last child is to be retrieved.
@@ -274,6 +296,19 @@ void _purple_connection_add_active_chat(PurpleConnection *gc,
 void _purple_connection_remove_active_chat(PurpleConnection *gc,
                                            PurpleChatConversation *chat);
 
+/**
+ * _purple_connection_has_active_chat:
+ * @gc:   The connection
+ * @chat: The chat conversation
+ *
+ * Checks whether a chat is in the active chats list of a connection, without
+ * walking the list.
+ *
+ * Returns: %TRUE if @chat is active on @gc.
+ */
+gboolean _purple_connection_has_active_chat(PurpleConnection *gc,
+                                            PurpleChatConversation *chat);
+
 /**
  * _purple_conversations_update_cache:
  * @conv:    The conversation.
@@ -290,6 +325,31 @@ void _purple_connection_remove_active_chat(PurpleConnection *gc,
 void _purple_conversations_update_cache(PurpleConversation *conv,
 		const char *name, PurpleAccount *account);
 
+/**
+ * _purple_conversations_update_chat_id:
+ * @chat:   The chat conversation.
+ * @old_id: The ID the chat was indexed under.
+ *
+ * Moves a chat to its current ID in the index used by
+ * purple_conversations_find_chat().
+ *
+ * Note: This function should only be called by
+ *       purple_chat_conversation_set_id() in conversationtypes.c.
+ */
+void _purple_conversations_update_chat_id(PurpleChatConversation *chat,
+		int old_id);
+
+/**
+ * _purple_conversations_contains:
+ * @conv: The conversation.
+ *
+ * Checks whether a conversation has been added with
+ * purple_conversations_add() and not yet removed.
+ *
+ * Returns: %TRUE if @conv is in the conversations list.
+ */
+gboolean _purple_conversations_contains(PurpleConversation *conv);
+
 /**
  * _purple_statuses_get_primitive_scores:
  *
@@ -29,35 +29,1600 @@
 #include "util.h"
 #include "time.h"
 
+#ifdef _WIN32
+# include <io.h> /* for _commit */
+#endif
+
 static GSList *loggers = NULL;
 
-static PurpleLogLogger *html_logger;
-static PurpleLogLogger *txt_logger;
+static PurpleLogLogger *html_logger;
+static PurpleLogLogger *txt_logger;
+
+static void log_get_log_sets_common(GHashTable *sets);
+static char *log_build_dir(const char *base, PurpleLogType type,
+                           const char *name, PurpleAccount *account);
+
+static gsize html_logger_write(PurpleLog *log, PurpleMessageFlags type,
+                               const char *from, GDateTime *time, const char *message);
+static void html_logger_finalize(PurpleLog *log);
+static GList *html_logger_list(PurpleLogType type, const char *sn, PurpleAccount *account);
+static GList *html_logger_list_syslog(PurpleAccount *account);
+static char *html_logger_read(PurpleLog *log, PurpleLogReadFlags *flags);
+static int html_logger_total_size(PurpleLogType type, const char *name, PurpleAccount *account);
+
+static gsize txt_logger_write(PurpleLog *log, PurpleMessageFlags type,
+                              const char *from, GDateTime *time, const char *message);
+static void txt_logger_finalize(PurpleLog *log);
+static GList *txt_logger_list(PurpleLogType type, const char *sn, PurpleAccount *account);
+static GList *txt_logger_list_syslog(PurpleAccount *account);
+static char *txt_logger_read(PurpleLog *log, PurpleLogReadFlags *flags);
+static int txt_logger_total_size(PurpleLogType type, const char *name, PurpleAccount *account);
+
+/**************************************************************************
+ * LOG INDEX **************************************************************
+ **************************************************************************/
+
+/*
+ * purple_log_get_total_size() and purple_log_get_activity_score() used to
+ * list and stat every log of a buddy whenever their in-memory cache missed,
+ * which included every cold start.  Their results now live in a per-account
+ * index that purple_log_write() keeps current and that is saved to
+ * <cache dir>/logs/<protocol>/<account>.index, so it can simply be mapped
+ * back in on the next start.
+ *
+ * An entry is trusted as long as the set of loggers is unchanged, it is
+ * younger than LOG_INDEX_MAX_AGE and the buddy's log directory still has the
+ * mtime the entry was built against.  That last check costs a stat and is
+ * done once per session; logs created, written or deleted through this API
+ * keep the entry current afterwards.
+ */
+#define LOG_INDEX_MAGIC "PLIX"
+#define LOG_INDEX_VERSION 1
+#define LOG_INDEX_MAX_AGE (7 * G_TIME_SPAN_DAY)
+#define LOG_INDEX_SAVE_DELAY 10
+
+/* Activity score counts bytes in the log, exponentially decayed with a
+ * half-life of 14 days. */
+#define LOG_ACTIVITY_HALF_LIFE (14 * G_TIME_SPAN_DAY)
+
+typedef struct {
+	gint64 mtime;		/* log directory mtime the entry was built against */
+	gint64 built;		/* when the entry was (re)built */
+	gint64 total;		/* total size in bytes, -1 until known */
+	gdouble score;		/* activity score at stamp, -1 until known */
+	gint64 stamp;
+	gboolean checked;	/* mtime verified this session */
+} PurpleLogIndexEntry;
+
+typedef struct {
+	PurpleAccount *account;
+	char *path;
+	char *signature;
+	GHashTable *entries;	/* "type:normalized name" => PurpleLogIndexEntry */
+	gboolean dirty;
+} PurpleLogIndex;
+
+static GHashTable *log_indexes = NULL;	/* loaded PurpleLogIndex set */
+static guint log_index_save_timer = 0;
+static char *log_index_signature = NULL;
+
+G_DEFINE_QUARK(purple-log-index, purple_log_index);
+
+static const char *
+log_index_get_signature(void)
+{
+	GSList *n;
+	GString *str;
+
+	if (log_index_signature != NULL)
+		return log_index_signature;
+
+	str = g_string_new(NULL);
+	for (n = loggers; n; n = n->next) {
+		PurpleLogLogger *logger = n->data;
+
+		if (str->len > 0)
+			g_string_append_c(str, ',');
+		g_string_append(str, logger->id);
+	}
+	log_index_signature = g_string_free(str, FALSE);
+
+	return log_index_signature;
+}
+
+static gdouble
+log_index_decay(GTimeSpan age)
+{
+	return pow(0.5, (gdouble)age / LOG_ACTIVITY_HALF_LIFE);
+}
+
+static GTimeSpan
+log_index_age(gint64 now, GDateTime *time)
+{
+	return now - (g_date_time_to_unix(time) * G_USEC_PER_SEC +
+	              g_date_time_get_microsecond(time));
+}
+
+static gint64
+log_index_get_mtime(PurpleLogType type, const char *name, PurpleAccount *account)
+{
+	char *dir;
+	GStatBuf st;
+	gint64 mtime = 0;
+
+	dir = purple_log_get_log_dir(type, name, account);
+	if (dir != NULL && g_stat(dir, &st) == 0)
+		mtime = st.st_mtime;
+	g_free(dir);
+
+	return mtime;
+}
+
+static char *
+log_index_get_key(PurpleLogType type, const char *name, PurpleAccount *account)
+{
+	return g_strdup_printf("%d:%s", type, purple_normalize(account, name));
+}
+
+static gboolean
+log_index_read(const gchar **data, const gchar *end, gpointer dest, gsize size)
+{
+	if ((gsize)(end - *data) < size)
+		return FALSE;
+
+	memcpy(dest, *data, size);
+	*data += size;
+
+	return TRUE;
+}
+
+static void
+log_index_load(PurpleLogIndex *index)
+{
+	GMappedFile *mapped;
+	GError *error = NULL;
+	const gchar *data, *end;
+	guint32 version, len;
+	gchar magic[4];
+
+	mapped = g_mapped_file_new(index->path, FALSE, &error);
+	if (mapped == NULL) {
+		if (!g_error_matches(error, G_FILE_ERROR, G_FILE_ERROR_NOENT)) {
+			purple_debug_warning("log", "Unable to map log index %s: %s\n",
+			                     index->path, error->message);
+		}
+		g_error_free(error);
+		return;
+	}
+
+	data = g_mapped_file_get_contents(mapped);
+	if (data == NULL) {
+		g_mapped_file_unref(mapped);
+		return;
+	}
+	end = data + g_mapped_file_get_length(mapped);
+
+	if (!log_index_read(&data, end, magic, sizeof(magic)) ||
+			memcmp(magic, LOG_INDEX_MAGIC, sizeof(magic)) != 0 ||
+			!log_index_read(&data, end, &version, sizeof(version)) ||
+			version != LOG_INDEX_VERSION ||
+			!log_index_read(&data, end, &len, sizeof(len)) ||
+			(gsize)(end - data) < len ||
+			strlen(index->signature) != len ||
+			memcmp(data, index->signature, len) != 0) {
+		/* Unknown format or different loggers; start over. */
+		g_mapped_file_unref(mapped);
+		return;
+	}
+	data += len;
+
+	while (data < end) {
+		PurpleLogIndexEntry entry;
+		char *key;
+
+		if (!log_index_read(&data, end, &len, sizeof(len)) ||
+				(gsize)(end - data) < len) {
+			break;
+		}
+		key = g_strndup(data, len);
+		data += len;
+
+		if (!log_index_read(&data, end, &entry.mtime, sizeof(entry.mtime)) ||
+				!log_index_read(&data, end, &entry.built, sizeof(entry.built)) ||
+				!log_index_read(&data, end, &entry.total, sizeof(entry.total)) ||
+				!log_index_read(&data, end, &entry.score, sizeof(entry.score)) ||
+				!log_index_read(&data, end, &entry.stamp, sizeof(entry.stamp))) {
+			g_free(key);
+			break;
+		}
+		entry.checked = FALSE;
+
+		g_hash_table_replace(index->entries, key,
+				g_slice_dup(PurpleLogIndexEntry, &entry));
+	}
+
+	g_mapped_file_unref(mapped);
+}
+
+static void
+log_index_save(PurpleLogIndex *index)
+{
+	GHashTableIter iter;
+	gpointer key, value;
+	GString *str;
+	guint32 version = LOG_INDEX_VERSION, len;
+
+	index->dirty = FALSE;
+
+	if (index->path == NULL)
+		return;
+
+	str = g_string_new(NULL);
+	g_string_append_len(str, LOG_INDEX_MAGIC, 4);
+	g_string_append_len(str, (const gchar *)&version, sizeof(version));
+	len = strlen(index->signature);
+	g_string_append_len(str, (const gchar *)&len, sizeof(len));
+	g_string_append_len(str, index->signature, len);
+
+	g_hash_table_iter_init(&iter, index->entries);
+	while (g_hash_table_iter_next(&iter, &key, &value)) {
+		PurpleLogIndexEntry *entry = value;
+
+		len = strlen(key);
+		g_string_append_len(str, (const gchar *)&len, sizeof(len));
+		g_string_append_len(str, key, len);
+		g_string_append_len(str, (const gchar *)&entry->mtime, sizeof(entry->mtime));
+		g_string_append_len(str, (const gchar *)&entry->built, sizeof(entry->built));
+		g_string_append_len(str, (const gchar *)&entry->total, sizeof(entry->total));
+		g_string_append_len(str, (const gchar *)&entry->score, sizeof(entry->score));
+		g_string_append_len(str, (const gchar *)&entry->stamp, sizeof(entry->stamp));
+	}
+
+	purple_util_write_data_to_file_deferred(index->path,
+			g_string_free_to_bytes(str));
+}
+
+static gboolean
+log_index_save_cb(gpointer data)
+{
+	GHashTableIter iter;
+	gpointer index;
+
+	log_index_save_timer = 0;
+
+	g_hash_table_iter_init(&iter, log_indexes);
+	while (g_hash_table_iter_next(&iter, &index, NULL)) {
+		if (((PurpleLogIndex *)index)->dirty)
+			log_index_save(index);
+	}
+
+	return FALSE;
+}
+
+static void
+log_index_set_dirty(PurpleLogIndex *index)
+{
+	index->dirty = TRUE;
+
+	if (log_index_save_timer == 0) {
+		log_index_save_timer = g_timeout_add_seconds(LOG_INDEX_SAVE_DELAY,
+				log_index_save_cb, NULL);
+	}
+}
+
+static void
+log_index_entry_free(PurpleLogIndexEntry *entry)
+{
+	g_slice_free(PurpleLogIndexEntry, entry);
+}
+
+static void
+log_index_free(PurpleLogIndex *index)
+{
+	if (log_indexes != NULL) {
+		if (index->dirty)
+			log_index_save(index);
+		g_hash_table_remove(log_indexes, index);
+	}
+
+	g_hash_table_destroy(index->entries);
+	g_free(index->signature);
+	g_free(index->path);
+	g_free(index);
+}
+
+static PurpleLogIndex *
+log_index_get(PurpleAccount *account)
+{
+	PurpleLogIndex *index;
+	PurpleProtocol *protocol;
+
+	index = g_object_get_qdata(G_OBJECT(account), purple_log_index_quark());
+	if (index != NULL) {
+		if (!purple_strequal(index->signature, log_index_get_signature())) {
+			/* A logger came or went, so every entry is off. */
+			g_hash_table_remove_all(index->entries);
+			g_free(index->signature);
+			index->signature = g_strdup(log_index_get_signature());
+			log_index_set_dirty(index);
+		}
+
+		return index;
+	}
+
+	index = g_new0(PurpleLogIndex, 1);
+	index->account = account;
+	index->signature = g_strdup(log_index_get_signature());
+	index->entries = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+			(GDestroyNotify)log_index_entry_free);
+
+	protocol = purple_protocols_find(purple_account_get_protocol_id(account));
+	if (protocol != NULL) {
+		char *acct_name;
+
+		acct_name = g_strdup_printf("%s.index",
+				purple_escape_filename(purple_normalize(account,
+						purple_account_get_username(account))));
+		index->path = g_build_filename(purple_cache_dir(), "logs",
+				purple_protocol_class_list_icon(protocol, account, NULL),
+				acct_name, NULL);
+		g_free(acct_name);
+
+		log_index_load(index);
+	}
+
+	g_hash_table_add(log_indexes, index);
+	g_object_set_qdata_full(G_OBJECT(account), purple_log_index_quark(), index,
+			(GDestroyNotify)log_index_free);
+
+	return index;
+}
+
+/* Returns the entry for a conversation, with the parts that went stale reset
+ * to "unknown". */
+static PurpleLogIndexEntry *
+log_index_lookup(PurpleLogType type, const char *name, PurpleAccount *account,
+                 PurpleLogIndex **index_ret)
+{
+	PurpleLogIndex *index = log_index_get(account);
+	PurpleLogIndexEntry *entry;
+	char *key;
+	gint64 now, mtime;
+
+	*index_ret = index;
+
+	key = log_index_get_key(type, name, account);
+	entry = g_hash_table_lookup(index->entries, key);
+
+	if (entry != NULL && entry->checked) {
+		g_free(key);
+		return entry;
+	}
+
+	now = g_get_real_time();
+	mtime = log_index_get_mtime(type, name, account);
+
+	if (entry == NULL) {
+		entry = g_slice_new(PurpleLogIndexEntry);
+		g_hash_table_insert(index->entries, key, entry);
+	} else {
+		g_free(key);
+
+		if (entry->mtime == mtime && now - entry->built < LOG_INDEX_MAX_AGE) {
+			entry->checked = TRUE;
+			return entry;
+		}
+	}
+
+	entry->mtime = mtime;
+	entry->built = now;
+	entry->total = -1;
+	entry->score = -1;
+	entry->stamp = now;
+	entry->checked = TRUE;
+	log_index_set_dirty(index);
+
+	return entry;
+}
+
+/* Accounts for bytes just written to a log in its conversation's entry. */
+static void
+log_index_add(PurpleLog *log, gsize written, gboolean new_file)
+{
+	PurpleLogIndex *index = log_index_get(log->account);
+	PurpleLogIndexEntry *entry;
+	char *key;
+	gint64 now;
+
+	key = log_index_get_key(log->type, log->name, log->account);
+	entry = g_hash_table_lookup(index->entries, key);
+	g_free(key);
+
+	/* Entries that haven't been checked yet will be on their first use. */
+	if (entry == NULL || !entry->checked)
+		return;
+
+	/* The log file we just created touched the log directory. */
+	if (new_file)
+		entry->mtime = log_index_get_mtime(log->type, log->name, log->account);
+
+	now = g_get_real_time();
+
+	if (entry->total >= 0)
+		entry->total += written;
+
+	if (entry->score >= 0 && log->time != NULL) {
+		entry->score = entry->score * log_index_decay(now - entry->stamp) +
+			written * log_index_decay(log_index_age(now, log->time));
+		entry->stamp = now;
+	}
+
+	log_index_set_dirty(index);
+}
+
+static void
+log_index_remove(PurpleLogType type, const char *name, PurpleAccount *account)
+{
+	PurpleLogIndex *index = log_index_get(account);
+	char *key;
+
+	key = log_index_get_key(type, name, account);
+	if (g_hash_table_remove(index->entries, key))
+		log_index_set_dirty(index);
+	g_free(key);
+}
+
+static void
+log_index_init(void)
+{
+	log_indexes = g_hash_table_new(g_direct_hash, g_direct_equal);
+}
+
+static void
+log_index_uninit(void)
+{
+	GHashTableIter iter;
+	gpointer index;
+	GList *accounts = NULL, *l;
+
+	if (log_index_save_timer != 0) {
+		g_source_remove(log_index_save_timer);
+		log_index_save_timer = 0;
+	}
+
+	g_hash_table_iter_init(&iter, log_indexes);
+	while (g_hash_table_iter_next(&iter, &index, NULL))
+		accounts = g_list_prepend(accounts, ((PurpleLogIndex *)index)->account);
+
+	/* Saves what's dirty and frees the indexes. */
+	for (l = accounts; l; l = l->next)
+		g_object_set_qdata(G_OBJECT(l->data), purple_log_index_quark(), NULL);
+	g_list_free(accounts);
+
+	g_hash_table_destroy(log_indexes);
+	log_indexes = NULL;
+
+	g_free(log_index_signature);
+	log_index_signature = NULL;
+}
+
+/**************************************************************************
+ * LOG SEARCH *************************************************************
+ **************************************************************************/
+
+/*
+ * Every conversation (account, type and name) gets an inverted index in
+ * <cache dir>/logs/<protocol>/<account>/<conversation>.search that maps each
+ * term to the logs it occurs in and how often.  purple_log_write() adds to it
+ * as messages are logged and logs written before it existed are picked up by
+ * a low priority backfill a while after start up.  purple_log_search() only
+ * answers from what is indexed already; logs it finds missing are moved to
+ * the front of the backfill and left out until they have been indexed.  The
+ * backfill emits "log-search-indexed" for each log it adds, so a search can
+ * be completed with purple_log_search_matches() rather than run again.
+ *
+ * Words shorter than LOG_SEARCH_MIN_TERM are not indexed.  Queries that use
+ * them are checked against the text of the logs instead, which means reading
+ * every log of the conversations searched when a query has no longer words.
+ *
+ * Indexes are loaded on demand, saved a few seconds after they change and
+ * dropped from memory again once they are saved and haven't been used for a
+ * minute.
+ */
+#define LOG_SEARCH_MAGIC "PLSX"
+#define LOG_SEARCH_VERSION 1
+#define LOG_SEARCH_TIMER_INTERVAL 10
+#define LOG_SEARCH_IDLE_TIME (60 * G_TIME_SPAN_SECOND)
+#define LOG_SEARCH_BACKFILL_DELAY 120
+#define LOG_SEARCH_MIN_TERM 2
+#define LOG_SEARCH_MAX_TERM 64
+#define LOG_SEARCH_SNIPPET_BEFORE 40
+#define LOG_SEARCH_SNIPPET_LENGTH 120
+
+typedef struct {
+	char *key;		/* "logger:time", NULL once the log is deleted */
+	guint32 id;
+	guint32 length;	/* number of terms */
+} PurpleLogSearchDoc;
+
+typedef struct {
+	guint32 doc;
+	guint32 count;
+} PurpleLogSearchPosting;
+
+typedef struct {
+	char *path;
+	GPtrArray *docs;		/* PurpleLogSearchDoc by id */
+	GHashTable *doc_keys;	/* key => PurpleLogSearchDoc */
+	GHashTable *terms;		/* term => GArray of PurpleLogSearchPosting,
+							 * sorted by doc */
+	GPtrArray *vocabulary;	/* sorted keys of terms, NULL when stale */
+	gint64 last_used;
+	gboolean dirty;
+} PurpleLogSearchIndex;
+
+typedef struct {
+	PurpleLogType type;
+	char *name;
+	PurpleAccount *account;
+	GList *logs;			/* left to index */
+} PurpleLogSearchJob;
+
+/* Return FALSE to stop tokenizing. */
+typedef gboolean (*PurpleLogSearchTermFunc)(const char *term, gsize offset,
+                                            gpointer data);
+
+static GHashTable *log_search_indexes = NULL;	/* path => index */
+static guint log_search_timer = 0;
+static GQueue log_search_jobs = G_QUEUE_INIT;
+static guint log_search_backfill_start_source = 0;
+static guint log_search_backfill_source = 0;
+
+static void
+log_search_tokenize(const char *text, PurpleLogSearchTermFunc func,
+                    gpointer data)
+{
+	const char *p = text, *start = NULL;
+
+	while (TRUE) {
+		gunichar c = g_utf8_get_char(p);
+
+		if (c != 0 && g_unichar_isalnum(c)) {
+			if (start == NULL)
+				start = p;
+		} else if (start != NULL) {
+			gsize len = p - start;
+
+			if (len <= LOG_SEARCH_MAX_TERM) {
+				char *normalized, *term;
+				gboolean more;
+
+				normalized = g_utf8_normalize(start, len, G_NORMALIZE_ALL);
+				term = g_utf8_casefold(normalized, -1);
+				more = func(term, start - text, data);
+				g_free(term);
+				g_free(normalized);
+
+				if (!more)
+					return;
+			}
+			start = NULL;
+		}
+
+		if (c == 0)
+			return;
+		p = g_utf8_next_char(p);
+	}
+}
+
+/* Returns plain, valid UTF-8 text for a logged message or a whole log. */
+static char *
+log_search_get_text(const char *html)
+{
+	char *text = purple_markup_strip_html(html);
+
+	if (!g_utf8_validate(text, -1, NULL)) {
+		char *tmp = purple_utf8_salvage(text);
+		g_free(text);
+		text = tmp;
+	}
+
+	return text;
+}
+
+static char *
+log_search_get_key(PurpleLog *log)
+{
+	return g_strdup_printf("%s:%" G_GINT64_FORMAT, log->logger->id,
+	                       g_date_time_to_unix(log->time));
+}
+
+static void
+log_search_postings_free(GArray *postings)
+{
+	g_array_free(postings, TRUE);
+}
+
+static void
+log_search_doc_free(PurpleLogSearchDoc *doc)
+{
+	g_free(doc->key);
+	g_slice_free(PurpleLogSearchDoc, doc);
+}
+
+static PurpleLogSearchDoc *
+log_search_add_doc(PurpleLogSearchIndex *index, char *key)
+{
+	PurpleLogSearchDoc *doc = g_slice_new0(PurpleLogSearchDoc);
+
+	doc->key = key;
+	doc->id = index->docs->len;
+	g_ptr_array_add(index->docs, doc);
+	if (key != NULL)
+		g_hash_table_insert(index->doc_keys, key, doc);
+
+	return doc;
+}
+
+static void
+log_search_add_term(PurpleLogSearchIndex *index, guint32 doc,
+                    const char *term, guint32 count)
+{
+	GArray *postings = g_hash_table_lookup(index->terms, term);
+	PurpleLogSearchPosting posting = { doc, count };
+	guint lo, hi;
+
+	if (postings == NULL) {
+		postings = g_array_new(FALSE, FALSE, sizeof(PurpleLogSearchPosting));
+		g_hash_table_insert(index->terms, g_strdup(term), postings);
+		g_clear_pointer(&index->vocabulary, g_ptr_array_unref);
+	}
+
+	/* Nearly always the newest log, which goes last. */
+	lo = 0;
+	hi = postings->len;
+	if (hi > 0 && g_array_index(postings, PurpleLogSearchPosting, hi - 1).doc < doc)
+		lo = hi;
+
+	while (lo < hi) {
+		guint mid = (lo + hi) / 2;
+		PurpleLogSearchPosting *p =
+			&g_array_index(postings, PurpleLogSearchPosting, mid);
+
+		if (p->doc == doc) {
+			p->count += count;
+			return;
+		} else if (p->doc < doc) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	g_array_insert_val(postings, lo, posting);
+}
+
+typedef struct {
+	PurpleLogSearchIndex *index;
+	PurpleLogSearchDoc *doc;
+} PurpleLogSearchAddData;
+
+static gboolean
+log_search_add_term_cb(const char *term, gsize offset, gpointer data)
+{
+	PurpleLogSearchAddData *add = data;
+
+	if (strlen(term) < LOG_SEARCH_MIN_TERM)
+		return TRUE;
+
+	log_search_add_term(add->index, add->doc->id, term, 1);
+	add->doc->length++;
+
+	return TRUE;
+}
+
+static void
+log_search_add_text(PurpleLogSearchIndex *index, PurpleLogSearchDoc *doc,
+                    const char *text)
+{
+	PurpleLogSearchAddData add = { index, doc };
+
+	log_search_tokenize(text, log_search_add_term_cb, &add);
+	index->dirty = TRUE;
+}
+
+static gboolean
+log_search_read(const gchar **data, const gchar *end, gpointer dest, gsize size)
+{
+	if ((gsize)(end - *data) < size)
+		return FALSE;
+
+	memcpy(dest, *data, size);
+	*data += size;
+
+	return TRUE;
+}
+
+static gboolean
+log_search_index_load(PurpleLogSearchIndex *index, const gchar *data,
+                      const gchar *end)
+{
+	guint32 version, count, len, i, j;
+	gchar magic[4];
+
+	if (!log_search_read(&data, end, magic, sizeof(magic)) ||
+			memcmp(magic, LOG_SEARCH_MAGIC, sizeof(magic)) != 0 ||
+			!log_search_read(&data, end, &version, sizeof(version)) ||
+			version != LOG_SEARCH_VERSION ||
+			!log_search_read(&data, end, &count, sizeof(count))) {
+		return FALSE;
+	}
+
+	for (i = 0; i < count; i++) {
+		PurpleLogSearchDoc *doc;
+
+		if (!log_search_read(&data, end, &len, sizeof(len)) ||
+				(gsize)(end - data) < len) {
+			return FALSE;
+		}
+		doc = log_search_add_doc(index, len > 0 ? g_strndup(data, len) : NULL);
+		data += len;
+
+		if (!log_search_read(&data, end, &doc->length, sizeof(doc->length)))
+			return FALSE;
+	}
+
+	if (!log_search_read(&data, end, &count, sizeof(count)))
+		return FALSE;
+
+	for (i = 0; i < count; i++) {
+		GArray *postings;
+		guint32 n;
+
+		if (!log_search_read(&data, end, &len, sizeof(len)) ||
+				(gsize)(end - data) < len) {
+			return FALSE;
+		}
+
+		postings = g_array_new(FALSE, FALSE, sizeof(PurpleLogSearchPosting));
+		g_hash_table_replace(index->terms, g_strndup(data, len), postings);
+		data += len;
+
+		if (!log_search_read(&data, end, &n, sizeof(n)))
+			return FALSE;
+
+		for (j = 0; j < n; j++) {
+			PurpleLogSearchPosting posting;
+
+			if (!log_search_read(&data, end, &posting, sizeof(posting)) ||
+					posting.doc >= index->docs->len) {
+				return FALSE;
+			}
+			g_array_append_val(postings, posting);
+		}
+	}
+
+	return TRUE;
+}
+
+static void
+log_search_index_save(PurpleLogSearchIndex *index)
+{
+	GHashTableIter iter;
+	gpointer key, value;
+	GString *str;
+	guint32 version = LOG_SEARCH_VERSION, len, i;
+
+	index->dirty = FALSE;
+
+	str = g_string_new(NULL);
+	g_string_append_len(str, LOG_SEARCH_MAGIC, 4);
+	g_string_append_len(str, (const gchar *)&version, sizeof(version));
+
+	len = index->docs->len;
+	g_string_append_len(str, (const gchar *)&len, sizeof(len));
+	for (i = 0; i < index->docs->len; i++) {
+		PurpleLogSearchDoc *doc = g_ptr_array_index(index->docs, i);
+
+		len = doc->key ? strlen(doc->key) : 0;
+		g_string_append_len(str, (const gchar *)&len, sizeof(len));
+		g_string_append_len(str, doc->key, len);
+		g_string_append_len(str, (const gchar *)&doc->length, sizeof(doc->length));
+	}
+
+	len = g_hash_table_size(index->terms);
+	g_string_append_len(str, (const gchar *)&len, sizeof(len));
+
+	g_hash_table_iter_init(&iter, index->terms);
+	while (g_hash_table_iter_next(&iter, &key, &value)) {
+		GArray *postings = value;
+
+		len = strlen(key);
+		g_string_append_len(str, (const gchar *)&len, sizeof(len));
+		g_string_append_len(str, key, len);
+		len = postings->len;
+		g_string_append_len(str, (const gchar *)&len, sizeof(len));
+		g_string_append_len(str, postings->data,
+				postings->len * sizeof(PurpleLogSearchPosting));
+	}
+
+	purple_util_write_data_to_file_deferred(index->path,
+			g_string_free_to_bytes(str));
+}
+
+static void
+log_search_index_free(PurpleLogSearchIndex *index)
+{
+	if (index->dirty)
+		log_search_index_save(index);
+
+	g_clear_pointer(&index->vocabulary, g_ptr_array_unref);
+	g_hash_table_destroy(index->terms);
+	g_hash_table_destroy(index->doc_keys);
+	g_ptr_array_free(index->docs, TRUE);
+	g_free(index->path);
+	g_free(index);
+}
+
+static gboolean
+log_search_timer_cb(gpointer data)
+{
+	GHashTableIter iter;
+	gpointer index;
+	gint64 now = g_get_monotonic_time();
+
+	g_hash_table_iter_init(&iter, log_search_indexes);
+	while (g_hash_table_iter_next(&iter, NULL, &index)) {
+		PurpleLogSearchIndex *search_index = index;
+
+		if (search_index->dirty) {
+			/* Only dropped on a later round, once the save has had time to
+			 * land, so that loading it again doesn't find an old copy. */
+			log_search_index_save(search_index);
+		} else if (now - search_index->last_used >= LOG_SEARCH_IDLE_TIME) {
+			g_hash_table_iter_remove(&iter);
+		}
+	}
+
+	if (g_hash_table_size(log_search_indexes) == 0) {
+		log_search_timer = 0;
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static PurpleLogSearchIndex *
+log_search_index_get(PurpleLogType type, const char *name,
+                     PurpleAccount *account)
+{
+	PurpleLogSearchIndex *index;
+	GMappedFile *mapped;
+	GError *error = NULL;
+	char *dir, *path;
+
+	dir = log_build_dir(purple_cache_dir(), type, name, account);
+	if (dir == NULL)
+		return NULL;
+	path = g_strconcat(dir, ".search", NULL);
+	g_free(dir);
+
+	index = g_hash_table_lookup(log_search_indexes, path);
+	if (index != NULL) {
+		g_free(path);
+		index->last_used = g_get_monotonic_time();
+		return index;
+	}
+
+	index = g_new0(PurpleLogSearchIndex, 1);
+	index->path = path;
+	index->docs = g_ptr_array_new_with_free_func(
+			(GDestroyNotify)log_search_doc_free);
+	index->doc_keys = g_hash_table_new(g_str_hash, g_str_equal);
+	index->terms = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+			(GDestroyNotify)log_search_postings_free);
+	index->last_used = g_get_monotonic_time();
+
+	mapped = g_mapped_file_new(path, FALSE, &error);
+	if (mapped != NULL) {
+		const gchar *data = g_mapped_file_get_contents(mapped);
+
+		if (data != NULL && !log_search_index_load(index, data,
+				data + g_mapped_file_get_length(mapped))) {
+			purple_debug_warning("log", "Discarding damaged search index "
+			                     "%s\n", path);
+			g_hash_table_remove_all(index->terms);
+			g_hash_table_remove_all(index->doc_keys);
+			g_ptr_array_set_size(index->docs, 0);
+		}
+
+		g_mapped_file_unref(mapped);
+	} else {
+		if (!g_error_matches(error, G_FILE_ERROR, G_FILE_ERROR_NOENT)) {
+			purple_debug_warning("log", "Unable to map search index %s: %s\n",
+			                     path, error->message);
+		}
+		g_error_free(error);
+	}
+
+	g_hash_table_insert(log_search_indexes, index->path, index);
+
+	if (log_search_timer == 0) {
+		log_search_timer = g_timeout_add_seconds(LOG_SEARCH_TIMER_INTERVAL,
+				log_search_timer_cb, NULL);
+	}
+
+	return index;
+}
+
+static PurpleLogSearchDoc *
+log_search_get_doc(PurpleLogSearchIndex *index, PurpleLog *log)
+{
+	PurpleLogSearchDoc *doc;
+	char *key = log_search_get_key(log);
+
+	doc = g_hash_table_lookup(index->doc_keys, key);
+	g_free(key);
+
+	return doc;
+}
+
+/* Reads a whole log into the index. */
+static void
+log_search_index_log(PurpleLogSearchIndex *index, PurpleLog *log)
+{
+	PurpleLogSearchDoc *doc;
+	char *html, *text;
+
+	doc = log_search_add_doc(index, log_search_get_key(log));
+
+	html = purple_log_read(log, NULL);
+	text = log_search_get_text(html);
+	log_search_add_text(index, doc, text);
+	g_free(text);
+	g_free(html);
+}
+
+static void
+log_search_add_message(PurpleLog *log, const char *from, const char *message)
+{
+	PurpleLogSearchIndex *index;
+	PurpleLogSearchDoc *doc;
+	char *text;
+
+	if (log->time == NULL || log_search_indexes == NULL)
+		return;
+
+	index = log_search_index_get(log->type, log->name, log->account);
+	if (index == NULL)
+		return;
+
+	doc = log_search_get_doc(index, log);
+	if (doc == NULL)
+		doc = log_search_add_doc(index, log_search_get_key(log));
+
+	if (from != NULL && g_utf8_validate(from, -1, NULL))
+		log_search_add_text(index, doc, from);
+
+	text = log_search_get_text(message);
+	log_search_add_text(index, doc, text);
+	g_free(text);
+}
+
+static void
+log_search_remove_log(PurpleLog *log)
+{
+	PurpleLogSearchIndex *index;
+	PurpleLogSearchDoc *doc;
+
+	if (log->time == NULL || log_search_indexes == NULL)
+		return;
+
+	index = log_search_index_get(log->type, log->name, log->account);
+	if (index == NULL)
+		return;
+
+	doc = log_search_get_doc(index, log);
+	if (doc != NULL) {
+		/* Its postings are ignored from now on. */
+		g_hash_table_remove(index->doc_keys, doc->key);
+		g_clear_pointer(&doc->key, g_free);
+		index->dirty = TRUE;
+	}
+}
+
+/* Returns the logs of a conversation that are not in its index yet and frees
+ * the rest. */
+static GList *
+log_search_filter_unindexed(PurpleLogSearchIndex *index, GList *logs)
+{
+	GList *l = logs;
+
+	while (l != NULL) {
+		GList *next = l->next;
+		PurpleLog *log = l->data;
+
+		if (log->time == NULL || log_search_get_doc(index, log) != NULL) {
+			purple_log_free(log);
+			logs = g_list_delete_link(logs, l);
+		}
+
+		l = next;
+	}
+
+	return logs;
+}
+
+/**************************************************************************
+ * Background indexing
+ **************************************************************************/
+static void
+log_search_job_free(PurpleLogSearchJob *job)
+{
+	g_list_free_full(job->logs, (GDestroyNotify)purple_log_free);
+	g_object_unref(job->account);
+	g_free(job->name);
+	g_slice_free(PurpleLogSearchJob, job);
+}
+
+static gboolean
+log_search_backfill_cb(gpointer data)
+{
+	PurpleLogSearchJob *job = g_queue_peek_head(&log_search_jobs);
+	PurpleLogSearchIndex *index;
+
+	if (job == NULL) {
+		log_search_backfill_source = 0;
+		return FALSE;
+	}
+
+	/* Looked up every time, as unused indexes get dropped. */
+	index = log_search_index_get(job->type, job->name, job->account);
+
+	if (index == NULL) {
+		g_queue_pop_head(&log_search_jobs);
+		log_search_job_free(job);
+	} else if (job->logs == NULL) {
+		/* Haven't looked at this conversation yet. */
+		job->logs = log_search_filter_unindexed(index,
+				purple_log_get_logs(job->type, job->name, job->account));
+
+		if (job->logs == NULL) {
+			g_queue_pop_head(&log_search_jobs);
+			log_search_job_free(job);
+		}
+	} else {
+		PurpleLog *log = job->logs->data;
+
+		job->logs = g_list_delete_link(job->logs, job->logs);
+
+		/* It might have been indexed by a search in the meantime. */
+		if (log_search_get_doc(index, log) == NULL) {
+			log_search_index_log(index, log);
+			purple_signal_emit(purple_log_get_handle(),
+			                   "log-search-indexed", log);
+		}
+		purple_log_free(log);
+
+		if (job->logs == NULL) {
+			g_queue_pop_head(&log_search_jobs);
+			log_search_job_free(job);
+		}
+	}
+
+	return TRUE;
+}
+
+static gboolean
+log_search_backfill_start_cb(gpointer data)
+{
+	GHashTable *sets;
+	GHashTableIter iter;
+	gpointer value;
+
+	log_search_backfill_start_source = 0;
+
+	sets = purple_log_get_log_sets();
+
+	g_hash_table_iter_init(&iter, sets);
+	while (g_hash_table_iter_next(&iter, NULL, &value)) {
+		PurpleLogSet *set = value;
+		PurpleLogSearchJob *job;
+
+		if (set->account == NULL)
+			continue;
+
+		job = g_slice_new0(PurpleLogSearchJob);
+		job->type = set->type;
+		job->name = g_strdup(set->name);
+		job->account = g_object_ref(set->account);
+		g_queue_push_tail(&log_search_jobs, job);
+	}
+
+	g_hash_table_destroy(sets);
+
+	if (!g_queue_is_empty(&log_search_jobs) && log_search_backfill_source == 0) {
+		log_search_backfill_source = g_idle_add_full(G_PRIORITY_LOW,
+				log_search_backfill_cb, NULL, NULL);
+	}
+
+	return FALSE;
+}
+
+/* Moves a conversation to the front of the backfill, starting it if needed. */
+static void
+log_search_backfill_prioritize(PurpleLogType type, const char *name,
+                               PurpleAccount *account)
+{
+	PurpleLogSearchJob *job;
+	GList *l;
+
+	for (l = log_search_jobs.head; l; l = l->next) {
+		job = l->data;
+
+		if (job->type == type && job->account == account &&
+				purple_strequal(job->name, name)) {
+			break;
+		}
+	}
+
+	if (l == NULL) {
+		job = g_slice_new0(PurpleLogSearchJob);
+		job->type = type;
+		job->name = g_strdup(name);
+		job->account = g_object_ref(account);
+		g_queue_push_head(&log_search_jobs, job);
+	} else if (l != log_search_jobs.head) {
+		g_queue_unlink(&log_search_jobs, l);
+		g_queue_push_head_link(&log_search_jobs, l);
+	}
+
+	if (log_search_backfill_source == 0) {
+		log_search_backfill_source = g_idle_add_full(G_PRIORITY_LOW,
+				log_search_backfill_cb, NULL, NULL);
+	}
+}
+
+/**************************************************************************
+ * Queries
+ **************************************************************************/
+typedef struct {
+	GPtrArray *terms;		/* words looked up in the index */
+	GPtrArray *substrings;	/* checked against the text of the logs */
+} PurpleLogSearchQuery;
+
+static void
+log_search_query_add(GPtrArray *array, const char *str)
+{
+	guint i;
+
+	for (i = 0; i < array->len; i++) {
+		if (purple_strequal(g_ptr_array_index(array, i), str))
+			return;
+	}
+
+	g_ptr_array_add(array, g_strdup(str));
+}
+
+static gboolean
+log_search_query_term_cb(const char *term, gsize offset, gpointer data)
+{
+	PurpleLogSearchQuery *query = data;
+
+	if (strlen(term) < LOG_SEARCH_MIN_TERM)
+		log_search_query_add(query->substrings, term);
+	else
+		log_search_query_add(query->terms, term);
+
+	return TRUE;
+}
+
+static char *
+log_search_fold(const char *text)
+{
+	char *normalized, *folded;
+
+	normalized = g_utf8_normalize(text, -1, G_NORMALIZE_ALL);
+	folded = g_utf8_casefold(normalized, -1);
+	g_free(normalized);
+
+	return folded;
+}
+
+/* Returns FALSE, with nothing to clear, if there is nothing to look for. */
+static gboolean
+log_search_query_parse(PurpleLogSearchQuery *parsed, const char *query)
+{
+	parsed->terms = g_ptr_array_new_with_free_func(g_free);
+	parsed->substrings = g_ptr_array_new_with_free_func(g_free);
+	log_search_tokenize(query, log_search_query_term_cb, parsed);
+
+	/* Only punctuation and such, look for it as it is. */
+	if (parsed->terms->len == 0 && parsed->substrings->len == 0 &&
+			*query != '\0') {
+		g_ptr_array_add(parsed->substrings, log_search_fold(query));
+	}
+
+	if (parsed->terms->len == 0 && parsed->substrings->len == 0) {
+		g_ptr_array_free(parsed->terms, TRUE);
+		g_ptr_array_free(parsed->substrings, TRUE);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static void
+log_search_query_clear(PurpleLogSearchQuery *parsed)
+{
+	g_ptr_array_free(parsed->terms, TRUE);
+	g_ptr_array_free(parsed->substrings, TRUE);
+}
+
+static int
+log_search_vocabulary_compare(gconstpointer a, gconstpointer b)
+{
+	return strcmp(*(const char **)a, *(const char **)b);
+}
+
+static GPtrArray *
+log_search_index_get_vocabulary(PurpleLogSearchIndex *index)
+{
+	if (index->vocabulary == NULL) {
+		GHashTableIter iter;
+		gpointer key;
+
+		index->vocabulary = g_ptr_array_sized_new(
+				g_hash_table_size(index->terms));
+		g_hash_table_iter_init(&iter, index->terms);
+		while (g_hash_table_iter_next(&iter, &key, NULL))
+			g_ptr_array_add(index->vocabulary, key);
+		g_ptr_array_sort(index->vocabulary, log_search_vocabulary_compare);
+	}
+
+	return index->vocabulary;
+}
+
+/* Returns the position of the first term in the vocabulary that is not less
+ * than query; the terms it is a prefix of sort right after it. */
+static guint
+log_search_vocabulary_find(GPtrArray *vocabulary, const char *query)
+{
+	guint lo = 0, hi = vocabulary->len;
+
+	while (lo < hi) {
+		guint mid = (lo + hi) / 2;
+
+		if (strcmp(g_ptr_array_index(vocabulary, mid), query) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+/* Returns doc id => score for the docs matching every term; a term matches
+ * every indexed term it is a prefix of. */
+static GHashTable *
+log_search_index_query(PurpleLogSearchIndex *index, GPtrArray *terms)
+{
+	GPtrArray *vocabulary = log_search_index_get_vocabulary(index);
+	GHashTable *scores = NULL;
+	guint i, alive = g_hash_table_size(index->doc_keys);
+
+	for (i = 0; i < terms->len; i++) {
+		const char *query = g_ptr_array_index(terms, i);
+		GHashTable *counts, *next;
+		GHashTableIter iter;
+		gpointer key, value;
+		gdouble idf;
+		guint lo;
+
+		/* doc id => occurrences of the term and its extensions */
+		counts = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+		for (lo = log_search_vocabulary_find(vocabulary, query);
+				lo < vocabulary->len; lo++) {
+			const char *term = g_ptr_array_index(vocabulary, lo);
+			GArray *postings;
+			guint j;
+
+			if (!g_str_has_prefix(term, query))
+				break;
+
+			postings = g_hash_table_lookup(index->terms, term);
+			for (j = 0; j < postings->len; j++) {
+				PurpleLogSearchPosting *posting =
+					&g_array_index(postings, PurpleLogSearchPosting, j);
+				gpointer doc = GUINT_TO_POINTER(posting->doc);
+				PurpleLogSearchDoc *d;
+
+				d = g_ptr_array_index(index->docs, posting->doc);
+				if (d->key == NULL)
+					continue;
+
+				g_hash_table_insert(counts, doc, GUINT_TO_POINTER(
+						GPOINTER_TO_UINT(g_hash_table_lookup(counts, doc)) +
+						posting->count));
+			}
+		}
+
+		idf = log(1.0 + (gdouble)alive / MAX(g_hash_table_size(counts), 1));
+		next = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL,
+				g_free);
+
+		g_hash_table_iter_init(&iter, counts);
+		while (g_hash_table_iter_next(&iter, &key, &value)) {
+			gdouble *score;
+
+			if (scores != NULL && !g_hash_table_contains(scores, key))
+				continue;
+
+			score = g_new(gdouble, 1);
+			*score = (1.0 + log(GPOINTER_TO_UINT(value))) * idf;
+			if (scores != NULL)
+				*score += *(gdouble *)g_hash_table_lookup(scores, key);
+			g_hash_table_insert(next, key, score);
+		}
+
+		g_hash_table_destroy(counts);
+		if (scores != NULL)
+			g_hash_table_destroy(scores);
+		scores = next;
+
+		if (g_hash_table_size(scores) == 0)
+			break;
+	}
+
+	return scores;
+}
+
+/* Returns whether a single doc matches every term, like
+ * log_search_index_query() would, without scoring every other doc. */
+static gboolean
+log_search_index_has_doc(PurpleLogSearchIndex *index, GPtrArray *terms,
+                         guint32 doc)
+{
+	GPtrArray *vocabulary = log_search_index_get_vocabulary(index);
+	guint i;
+
+	for (i = 0; i < terms->len; i++) {
+		const char *query = g_ptr_array_index(terms, i);
+		gboolean found = FALSE;
+		guint pos;
+
+		for (pos = log_search_vocabulary_find(vocabulary, query);
+				pos < vocabulary->len && !found; pos++) {
+			const char *term = g_ptr_array_index(vocabulary, pos);
+			GArray *postings;
+			guint lo = 0, hi;
+
+			if (!g_str_has_prefix(term, query))
+				break;
+
+			/* Postings are sorted by doc. */
+			postings = g_hash_table_lookup(index->terms, term);
+			hi = postings->len;
+			while (lo < hi) {
+				guint mid = (lo + hi) / 2;
+
+				if (g_array_index(postings, PurpleLogSearchPosting,
+						mid).doc < doc) {
+					lo = mid + 1;
+				} else {
+					hi = mid;
+				}
+			}
+
+			found = lo < postings->len &&
+				g_array_index(postings, PurpleLogSearchPosting, lo).doc == doc;
+		}
+
+		if (!found)
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* Returns whether the text of a log contains every substring of a query. */
+static gboolean
+log_search_log_contains(PurpleLog *log, GPtrArray *substrings)
+{
+	char *html, *text, *folded;
+	gboolean found = TRUE;
+	guint i;
+
+	html = purple_log_read(log, NULL);
+	text = log_search_get_text(html);
+	folded = log_search_fold(text);
+	g_free(text);
+	g_free(html);
+
+	for (i = 0; i < substrings->len && found; i++)
+		found = strstr(folded, g_ptr_array_index(substrings, i)) != NULL;
+
+	g_free(folded);
+
+	return found;
+}
+
+typedef struct {
+	PurpleLogSearchQuery *query;
+	gsize offset;
+	gboolean found;
+} PurpleLogSearchSnippetData;
+
+static gboolean
+log_search_snippet_term_cb(const char *term, gsize offset, gpointer data)
+{
+	PurpleLogSearchSnippetData *snippet = data;
+	GPtrArray *terms = snippet->query->terms;
+	GPtrArray *substrings = snippet->query->substrings;
+	guint i;
+
+	for (i = 0; i < terms->len; i++) {
+		if (g_str_has_prefix(term, g_ptr_array_index(terms, i)))
+			break;
+	}
+
+	if (i == terms->len) {
+		for (i = 0; i < substrings->len; i++) {
+			if (strstr(term, g_ptr_array_index(substrings, i)) != NULL)
+				break;
+		}
+
+		if (i == substrings->len)
+			return TRUE;
+	}
+
+	snippet->offset = offset;
+	snippet->found = TRUE;
+
+	return FALSE;
+}
+
+static char *
+log_search_get_snippet(PurpleLog *log, PurpleLogSearchQuery *query)
+{
+	PurpleLogSearchSnippetData data = { query, 0, FALSE };
+	char *html, *text, *start, *end, *snippet;
+	glong i;
+
+	html = purple_log_read(log, NULL);
+	text = log_search_get_text(html);
+	g_free(html);
+
+	log_search_tokenize(text, log_search_snippet_term_cb, &data);
+
+	start = text + data.offset;
+	for (i = 0; i < LOG_SEARCH_SNIPPET_BEFORE && start > text; i++)
+		start = g_utf8_prev_char(start);
+
+	end = start;
+	for (i = 0; i < LOG_SEARCH_SNIPPET_LENGTH && *end != '\0'; i++)
+		end = g_utf8_next_char(end);
+
+	snippet = g_strdup_printf("%s%.*s%s", start > text ? "..." : "",
+	                          (int)(end - start), start,
+	                          *end != '\0' ? "..." : "");
+	g_strdelimit(snippet, "\r\n\t", ' ');
+	g_free(text);
+
+	return snippet;
+}
+
+static gint
+log_search_hit_compare(gconstpointer a, gconstpointer b)
+{
+	const PurpleLogSearchHit *hit_a = a, *hit_b = b;
+
+	if (hit_a->score != hit_b->score)
+		return hit_a->score > hit_b->score ? -1 : 1;
+
+	/* Newer logs first. */
+	return purple_log_compare(hit_a->log, hit_b->log);
+}
+
+static GList *
+log_search_conversation(PurpleLogType type, const char *name,
+                        PurpleAccount *account, PurpleLogSearchQuery *query,
+                        GList *hits, guint *unindexed)
+{
+	PurpleLogSearchIndex *index;
+	GHashTable *scores = NULL;
+	GList *logs, *l;
+	gboolean queued = FALSE;
+
+	index = log_search_index_get(type, name, account);
+	if (index == NULL)
+		return hits;
+
+	logs = purple_log_get_logs(type, name, account);
+
+	if (query->terms->len > 0)
+		scores = log_search_index_query(index, query->terms);
+
+	for (l = logs; l; l = l->next) {
+		PurpleLog *log = l->data;
+		PurpleLogSearchDoc *doc;
+		gdouble *score = NULL;
+		gboolean match;
+
+		doc = log->time ? log_search_get_doc(index, log) : NULL;
+
+		if (scores == NULL) {
+			/* Nothing to look up, so every log is a candidate. */
+			match = TRUE;
+		} else if (doc == NULL) {
+			/* Left out until the backfill gets to it. */
+			if (log->time != NULL) {
+				if (!queued)
+					log_search_backfill_prioritize(type, name, account);
+				queued = TRUE;
+				(*unindexed)++;
+			}
+			match = FALSE;
+		} else {
+			score = g_hash_table_lookup(scores, GUINT_TO_POINTER(doc->id));
+			match = score != NULL;
+		}
+
+		if (match && query->substrings->len > 0)
+			match = log_search_log_contains(log, query->substrings);
 
-struct _purple_logsize_user {
-	char *name;
-	PurpleAccount *account;
-};
-static GHashTable *logsize_users = NULL;
-static GHashTable *logsize_users_decayed = NULL;
+		if (match) {
+			PurpleLogSearchHit *hit = g_new0(PurpleLogSearchHit, 1);
 
-static void log_get_log_sets_common(GHashTable *sets);
+			hit->log = log;
+			hit->score = score ? *score : 0.0;
+			hits = g_list_prepend(hits, hit);
+		} else {
+			purple_log_free(log);
+		}
+	}
 
-static gsize html_logger_write(PurpleLog *log, PurpleMessageFlags type,
-                               const char *from, GDateTime *time, const char *message);
-static void html_logger_finalize(PurpleLog *log);
-static GList *html_logger_list(PurpleLogType type, const char *sn, PurpleAccount *account);
-static GList *html_logger_list_syslog(PurpleAccount *account);
-static char *html_logger_read(PurpleLog *log, PurpleLogReadFlags *flags);
-static int html_logger_total_size(PurpleLogType type, const char *name, PurpleAccount *account);
+	g_list_free(logs);
+	if (scores != NULL)
+		g_hash_table_destroy(scores);
 
-static gsize txt_logger_write(PurpleLog *log, PurpleMessageFlags type,
-                              const char *from, GDateTime *time, const char *message);
-static void txt_logger_finalize(PurpleLog *log);
-static GList *txt_logger_list(PurpleLogType type, const char *sn, PurpleAccount *account);
-static GList *txt_logger_list_syslog(PurpleAccount *account);
-static char *txt_logger_read(PurpleLog *log, PurpleLogReadFlags *flags);
-static int txt_logger_total_size(PurpleLogType type, const char *name, PurpleAccount *account);
+	return hits;
+}
+
+static void
+log_search_init(void)
+{
+	log_search_indexes = g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+			(GDestroyNotify)log_search_index_free);
+
+	log_search_backfill_start_source = g_timeout_add_seconds(
+			LOG_SEARCH_BACKFILL_DELAY, log_search_backfill_start_cb, NULL);
+}
+
+static void
+log_search_uninit(void)
+{
+	if (log_search_backfill_start_source != 0) {
+		g_source_remove(log_search_backfill_start_source);
+		log_search_backfill_start_source = 0;
+	}
+	if (log_search_backfill_source != 0) {
+		g_source_remove(log_search_backfill_source);
+		log_search_backfill_source = 0;
+	}
+	g_queue_foreach(&log_search_jobs, (GFunc)log_search_job_free, NULL);
+	g_queue_clear(&log_search_jobs);
+
+	if (log_search_timer != 0) {
+		g_source_remove(log_search_timer);
+		log_search_timer = 0;
+	}
+
+	/* Saves what's dirty. */
+	g_hash_table_destroy(log_search_indexes);
+	log_search_indexes = NULL;
+}
 
 /**************************************************************************
  * PUBLIC LOGGING FUNCTIONS ***********************************************
@@ -102,43 +1667,18 @@ void purple_log_free(PurpleLog *log)
 void purple_log_write(PurpleLog *log, PurpleMessageFlags type,
                       const char *from, GDateTime *time, const char *message)
 {
-	struct _purple_logsize_user *lu;
-	gsize written, total = 0;
-	gpointer ptrsize;
+	gboolean new_file;
+	gsize written;
 
 	g_return_if_fail(log);
 	g_return_if_fail(log->logger);
 	g_return_if_fail(log->logger->write);
 
+	new_file = (log->logger_data == NULL);
 	written = (log->logger->write)(log, type, from, time, message);
 
-	lu = g_new(struct _purple_logsize_user, 1);
-
-	lu->name = g_strdup(purple_normalize(log->account, log->name));
-	lu->account = log->account;
-
-	if(g_hash_table_lookup_extended(logsize_users, lu, NULL, &ptrsize)) {
-		char *tmp = lu->name;
-
-		total = GPOINTER_TO_INT(ptrsize);
-		total += written;
-		g_hash_table_replace(logsize_users, lu, GINT_TO_POINTER(total));
-
-		/* The hash table takes ownership of lu, so create a new one
-		 * for the logsize_users_decayed check below. */
-		lu = g_new(struct _purple_logsize_user, 1);
-		lu->name = g_strdup(tmp);
-		lu->account = log->account;
-	}
-
-	if(g_hash_table_lookup_extended(logsize_users_decayed, lu, NULL, &ptrsize)) {
-		total = GPOINTER_TO_INT(ptrsize);
-		total += written;
-		g_hash_table_replace(logsize_users_decayed, lu, GINT_TO_POINTER(total));
-	} else {
-		g_free(lu->name);
-		g_free(lu);
-	}
+	log_index_add(log, written, new_file);
+	log_search_add_message(log, from, message);
 }
 
 char *purple_log_read(PurpleLog *log, PurpleLogReadFlags *flags)
@@ -162,39 +1702,17 @@ int purple_log_get_size(PurpleLog *log)
 	return 0;
 }
 
-static guint _purple_logsize_user_hash(struct _purple_logsize_user *lu)
-{
-	return g_str_hash(lu->name);
-}
-
-static guint _purple_logsize_user_equal(struct _purple_logsize_user *lu1,
-		struct _purple_logsize_user *lu2)
-{
-	return (lu1->account == lu2->account && purple_strequal(lu1->name, lu2->name));
-}
-
-static void _purple_logsize_user_free_key(struct _purple_logsize_user *lu)
-{
-	g_free(lu->name);
-	g_free(lu);
-}
-
 int purple_log_get_total_size(PurpleLogType type, const char *name, PurpleAccount *account)
 {
-	gpointer ptrsize;
-	int size = 0;
+	PurpleLogIndex *index;
+	PurpleLogIndexEntry *entry;
 	GSList *n;
-	struct _purple_logsize_user *lu;
 
-	lu = g_new(struct _purple_logsize_user, 1);
-	lu->name = g_strdup(purple_normalize(account, name));
-	lu->account = account;
+	entry = log_index_lookup(type, name, account, &index);
+
+	if (entry->total < 0) {
+		int size = 0;
 
-	if(g_hash_table_lookup_extended(logsize_users, lu, NULL, &ptrsize)) {
-		size = GPOINTER_TO_INT(ptrsize);
-		g_free(lu->name);
-		g_free(lu);
-	} else {
 		for (n = loggers; n; n = n->next) {
 			PurpleLogLogger *logger = n->data;
 
@@ -215,28 +1733,23 @@ int purple_log_get_total_size(PurpleLogType type, const char *name, PurpleAccoun
 			}
 		}
 
-		g_hash_table_replace(logsize_users, lu, GINT_TO_POINTER(size));
+		entry->total = size;
+		log_index_set_dirty(index);
 	}
-	return size;
+
+	return (int)entry->total;
 }
 
 gint purple_log_get_activity_score(PurpleLogType type, const char *name, PurpleAccount *account)
 {
-	gpointer ptrscore;
-	int score;
+	PurpleLogIndex *index;
+	PurpleLogIndexEntry *entry;
+	gint64 now = g_get_real_time();
 	GSList *n;
-	struct _purple_logsize_user *lu;
 
-	lu = g_new(struct _purple_logsize_user, 1);
-	lu->name = g_strdup(purple_normalize(account, name));
-	lu->account = account;
+	entry = log_index_lookup(type, name, account, &index);
 
-	if(g_hash_table_lookup_extended(logsize_users_decayed, lu, NULL, &ptrscore)) {
-		score = GPOINTER_TO_INT(ptrscore);
-		g_free(lu->name);
-		g_free(lu);
-	} else {
-		GDateTime *now = g_date_time_new_now_utc();
+	if (entry->score < 0) {
 		double score_double = 0.0;
 		for (n = loggers; n; n = n->next) {
 			PurpleLogLogger *logger = n->data;
@@ -250,21 +1763,141 @@ gint purple_log_get_activity_score(PurpleLogType type, const char *name, PurpleA
 						g_warn_if_reached();
 						continue;
 					}
-					/* Activity score counts bytes in the log, exponentially
-					   decayed with a half-life of 14 days. */
 					score_double += purple_log_get_size(log) *
-						pow(0.5, g_date_time_difference(now, log->time)/(14LL*G_TIME_SPAN_DAY));
+						log_index_decay(log_index_age(now, log->time));
 					purple_log_free(log);
 					logs = g_list_delete_link(logs, logs);
 				}
 			}
 		}
-		g_date_time_unref(now);
 
-		score = (gint) ceil(score_double);
-		g_hash_table_replace(logsize_users_decayed, lu, GINT_TO_POINTER(score));
+		entry->score = score_double;
+		entry->stamp = now;
+		log_index_set_dirty(index);
 	}
-	return score;
+
+	return (gint)ceil(entry->score * log_index_decay(now - entry->stamp));
+}
+
+GList *
+purple_log_search(PurpleAccount *account, const char *buddy,
+                  const char *query, guint limit, PurpleLogSearchFlags flags,
+                  guint *unindexed)
+{
+	PurpleLogSearchQuery parsed;
+	GList *hits = NULL, *l;
+	guint missing = 0;
+
+	g_return_val_if_fail(account == NULL || PURPLE_IS_ACCOUNT(account), NULL);
+	g_return_val_if_fail(query != NULL, NULL);
+	g_return_val_if_fail(g_utf8_validate(query, -1, NULL), NULL);
+
+	if (unindexed != NULL)
+		*unindexed = 0;
+
+	if (!log_search_query_parse(&parsed, query))
+		return NULL;
+
+	if (buddy != NULL) {
+		GList *accounts = account ? NULL : purple_accounts_get_all();
+
+		if (account != NULL)
+			accounts = g_list_prepend(NULL, account);
+
+		for (l = accounts; l; l = l->next) {
+			hits = log_search_conversation(PURPLE_LOG_IM, buddy, l->data,
+			                               &parsed, hits, &missing);
+			hits = log_search_conversation(PURPLE_LOG_CHAT, buddy, l->data,
+			                               &parsed, hits, &missing);
+		}
+
+		if (account != NULL)
+			g_list_free(accounts);
+	} else {
+		GHashTable *sets = purple_log_get_log_sets();
+		GHashTableIter iter;
+		gpointer value;
+
+		g_hash_table_iter_init(&iter, sets);
+		while (g_hash_table_iter_next(&iter, NULL, &value)) {
+			PurpleLogSet *set = value;
+
+			if (set->account == NULL ||
+					(account != NULL && set->account != account)) {
+				continue;
+			}
+
+			hits = log_search_conversation(set->type, set->name, set->account,
+			                               &parsed, hits, &missing);
+		}
+
+		g_hash_table_destroy(sets);
+	}
+
+	hits = g_list_sort(hits, log_search_hit_compare);
+
+	if (limit > 0 && (l = g_list_nth(hits, limit)) != NULL) {
+		l->prev->next = NULL;
+		l->prev = NULL;
+		g_list_free_full(l, (GDestroyNotify)purple_log_search_hit_free);
+	}
+
+	if (flags & PURPLE_LOG_SEARCH_SNIPPETS) {
+		for (l = hits; l; l = l->next) {
+			PurpleLogSearchHit *hit = l->data;
+
+			hit->snippet = log_search_get_snippet(hit->log, &parsed);
+		}
+	}
+
+	log_search_query_clear(&parsed);
+
+	if (unindexed != NULL)
+		*unindexed = missing;
+
+	return hits;
+}
+
+gboolean
+purple_log_search_matches(PurpleLog *log, const char *query)
+{
+	PurpleLogSearchQuery parsed;
+	PurpleLogSearchIndex *index;
+	PurpleLogSearchDoc *doc = NULL;
+	gboolean match = TRUE;
+
+	g_return_val_if_fail(log != NULL, FALSE);
+	g_return_val_if_fail(query != NULL, FALSE);
+	g_return_val_if_fail(g_utf8_validate(query, -1, NULL), FALSE);
+
+	if (!log_search_query_parse(&parsed, query))
+		return FALSE;
+
+	if (parsed.terms->len > 0) {
+		index = log_search_index_get(log->type, log->name, log->account);
+		if (index != NULL && log->time != NULL)
+			doc = log_search_get_doc(index, log);
+
+		match = doc != NULL &&
+			log_search_index_has_doc(index, parsed.terms, doc->id);
+	}
+
+	if (match && parsed.substrings->len > 0)
+		match = log_search_log_contains(log, parsed.substrings);
+
+	log_search_query_clear(&parsed);
+
+	return match;
+}
+
+void
+purple_log_search_hit_free(PurpleLogSearchHit *hit)
+{
+	g_return_if_fail(hit != NULL);
+
+	purple_log_free(hit->log);
+	g_free(hit->snippet);
+	g_free(hit);
 }
 
 gboolean purple_log_is_deletable(PurpleLog *log)
@@ -286,14 +1919,21 @@ gboolean purple_log_delete(PurpleLog *log)
 	g_return_val_if_fail(log != NULL, FALSE);
 	g_return_val_if_fail(log->logger != NULL, FALSE);
 
-	if (log->logger->remove != NULL)
-		return log->logger->remove(log);
+	if (log->logger->remove != NULL) {
+		if (!log->logger->remove(log))
+			return FALSE;
+
+		log_index_remove(log->type, log->name, log->account);
+		log_search_remove_log(log);
+		return TRUE;
+	}
 
 	return FALSE;
 }
 
-char *
-purple_log_get_log_dir(PurpleLogType type, const char *name, PurpleAccount *account)
+static char *
+log_build_dir(const char *base, PurpleLogType type, const char *name,
+              PurpleAccount *account)
 {
 	PurpleProtocol *protocol;
 	const char *protocol_name;
@@ -320,13 +1960,19 @@ purple_log_get_log_dir(PurpleLogType type, const char *name, PurpleAccount *acco
 		target = purple_escape_filename(purple_normalize(account, name));
 	}
 
-	dir = g_build_filename(purple_data_dir(), "logs", protocol_name, acct_name, target, NULL);
+	dir = g_build_filename(base, "logs", protocol_name, acct_name, target, NULL);
 
 	g_free(acct_name);
 
 	return dir;
 }
 
+char *
+purple_log_get_log_dir(PurpleLogType type, const char *name, PurpleAccount *account)
+{
+	return log_build_dir(purple_data_dir(), type, name, account);
+}
+
 /****************************************************************************
  * LOGGER FUNCTIONS *********************************************************
  ****************************************************************************/
@@ -411,6 +2057,7 @@ void purple_log_logger_add (PurpleLogLogger *logger)
 	if (g_slist_find(loggers, logger))
 		return;
 	loggers = g_slist_append(loggers, logger);
+	g_clear_pointer(&log_index_signature, g_free);
 	if (purple_strequal(purple_prefs_get_string("/purple/logging/format"), logger->id)) {
 		purple_prefs_trigger_callback("/purple/logging/format");
 	}
@@ -420,6 +2067,7 @@ void purple_log_logger_remove (PurpleLogLogger *logger)
 {
 	g_return_if_fail(logger);
 	loggers = g_slist_remove(loggers, logger);
+	g_clear_pointer(&log_index_signature, g_free);
 }
 
 void purple_log_logger_set (PurpleLogLogger *logger)
@@ -577,6 +2225,335 @@ GList *purple_log_get_system_logs(PurpleAccount *account)
 	return g_list_sort(logs, purple_log_compare);
 }
 
+/****************************************************************************
+ * LOG WRITER ***************************************************************
+ ****************************************************************************/
+
+/*
+ * The HTML and text loggers format each record on the main thread (they need
+ * the image store and the "log-timestamp" signal) and hand it to a single
+ * writer thread, which appends it to the log file.  Instead of flushing after
+ * every line, the writer flushes all dirty files together once the oldest
+ * unflushed record is older than /purple/logging/flush_interval milliseconds
+ * or LOG_WRITER_FLUSH_SIZE bytes are pending, and fsyncs them every
+ * /purple/logging/sync_interval seconds.
+ *
+ * A flush_interval of 0 restores write-through logging: purple_log_write()
+ * doesn't return before the record has been handed to the kernel.  A
+ * sync_interval of 0 never fsyncs and leaves that to the operating system,
+ * which is how logging always behaved before.
+ */
+#define LOG_WRITER_FLUSH_SIZE (64 * 1024)
+
+typedef struct {
+	FILE *file;
+	GString *text;	/* NULL to close the file */
+} PurpleLogWriterRecord;
+
+static GMutex writer_lock;
+static GCond writer_cond;
+static GThread *writer_thread = NULL;
+static GQueue writer_queue = G_QUEUE_INIT;
+static guint writer_flush_serial = 0;
+static guint writer_flushed_serial = 0;
+static gboolean writer_quit = FALSE;
+static gboolean writer_closed = FALSE;	/* after purple_log_uninit() */
+static gint64 writer_flush_interval = G_USEC_PER_SEC;
+static gint64 writer_sync_interval = 30 * G_USEC_PER_SEC;
+
+/* Only touched by the writer thread. */
+static GHashTable *writer_unflushed = NULL;	/* FILE * set */
+static GHashTable *writer_unsynced = NULL;	/* FILE * set */
+static gsize writer_unflushed_size = 0;
+static gint64 writer_flush_deadline = 0;
+static gint64 writer_sync_deadline = 0;
+
+static gboolean
+log_writer_error_cb(gpointer data)
+{
+	purple_debug_error("log", "%s\n", (gchar *)data);
+	g_free(data);
+
+	return FALSE;
+}
+
+/* The debug UI ops aren't thread safe, so the writer thread reports errors
+ * through the main loop. */
+static void
+log_writer_error(const char *what)
+{
+	g_idle_add(log_writer_error_cb,
+	           g_strdup_printf("%s: %s", what, g_strerror(errno)));
+}
+
+static void
+log_writer_sync_file(FILE *file)
+{
+#ifdef _WIN32
+	if (_commit(_fileno(file)) != 0)
+#else
+	if (fsync(fileno(file)) != 0)
+#endif
+	{
+		log_writer_error("Error syncing log file");
+	}
+}
+
+static void
+log_writer_flush_all(void)
+{
+	GHashTableIter iter;
+	gpointer file;
+
+	g_hash_table_iter_init(&iter, writer_unflushed);
+	while (g_hash_table_iter_next(&iter, &file, NULL)) {
+		if (fflush(file) != 0)
+			log_writer_error("Error writing log file");
+		g_hash_table_add(writer_unsynced, file);
+	}
+
+	g_hash_table_remove_all(writer_unflushed);
+	writer_unflushed_size = 0;
+}
+
+static void
+log_writer_sync_all(void)
+{
+	GHashTableIter iter;
+	gpointer file;
+
+	g_hash_table_iter_init(&iter, writer_unsynced);
+	while (g_hash_table_iter_next(&iter, &file, NULL))
+		log_writer_sync_file(file);
+
+	g_hash_table_remove_all(writer_unsynced);
+}
+
+static void
+log_writer_process(PurpleLogWriterRecord *record, gint64 flush_interval,
+                   gint64 sync_interval)
+{
+	gint64 now = g_get_monotonic_time();
+
+	if (record->text == NULL) {
+		g_hash_table_remove(writer_unflushed, record->file);
+		g_hash_table_remove(writer_unsynced, record->file);
+
+		fflush(record->file);
+		if (sync_interval > 0)
+			log_writer_sync_file(record->file);
+		fclose(record->file);
+
+		g_slice_free(PurpleLogWriterRecord, record);
+		return;
+	}
+
+	if (fwrite(record->text->str, 1, record->text->len, record->file) !=
+			record->text->len) {
+		log_writer_error("Error writing log file");
+	}
+
+	if (g_hash_table_size(writer_unflushed) == 0) {
+		writer_flush_deadline = now + flush_interval;
+		if (g_hash_table_size(writer_unsynced) == 0)
+			writer_sync_deadline = now + sync_interval;
+	}
+
+	g_hash_table_add(writer_unflushed, record->file);
+	writer_unflushed_size += record->text->len;
+
+	g_string_free(record->text, TRUE);
+	g_slice_free(PurpleLogWriterRecord, record);
+}
+
+static gpointer
+log_writer_thread(gpointer data)
+{
+	g_mutex_lock(&writer_lock);
+
+	while (TRUE) {
+		PurpleLogWriterRecord *record;
+		gint64 flush_interval = writer_flush_interval;
+		gint64 sync_interval = writer_sync_interval;
+		guint flush_serial = writer_flush_serial;
+		gboolean quit = writer_quit;
+		gboolean drained;
+		gint64 now, deadline;
+
+		record = g_queue_pop_head(&writer_queue);
+		drained = (record == NULL);
+		g_mutex_unlock(&writer_lock);
+
+		if (record != NULL)
+			log_writer_process(record, flush_interval, sync_interval);
+
+		now = g_get_monotonic_time();
+
+		if (g_hash_table_size(writer_unflushed) > 0 &&
+				((drained && (quit || flush_serial != writer_flushed_serial)) ||
+				 writer_unflushed_size >= LOG_WRITER_FLUSH_SIZE ||
+				 now >= writer_flush_deadline)) {
+			log_writer_flush_all();
+		}
+
+		if (g_hash_table_size(writer_unsynced) > 0) {
+			if (sync_interval <= 0)
+				g_hash_table_remove_all(writer_unsynced);
+			else if ((drained && quit) || now >= writer_sync_deadline)
+				log_writer_sync_all();
+		}
+
+		g_mutex_lock(&writer_lock);
+
+		if (!drained)
+			continue;
+
+		if (writer_flushed_serial != flush_serial) {
+			/* Everything queued before this flush was asked for is out. */
+			writer_flushed_serial = flush_serial;
+			g_cond_broadcast(&writer_cond);
+		}
+
+		if (quit)
+			break;
+
+		if (!g_queue_is_empty(&writer_queue) || writer_quit ||
+				writer_flush_serial != writer_flushed_serial) {
+			continue;
+		}
+
+		deadline = G_MAXINT64;
+		if (g_hash_table_size(writer_unflushed) > 0)
+			deadline = writer_flush_deadline;
+		if (g_hash_table_size(writer_unsynced) > 0)
+			deadline = MIN(deadline, writer_sync_deadline);
+
+		if (deadline == G_MAXINT64)
+			g_cond_wait(&writer_cond, &writer_lock);
+		else
+			g_cond_wait_until(&writer_cond, &writer_lock, deadline);
+	}
+
+	g_mutex_unlock(&writer_lock);
+
+	return NULL;
+}
+
+/* Blocks until everything queued so far is written and flushed. */
+static void
+log_writer_flush(void)
+{
+	guint serial;
+
+	g_mutex_lock(&writer_lock);
+
+	if (writer_thread != NULL) {
+		serial = ++writer_flush_serial;
+		g_cond_broadcast(&writer_cond);
+
+		while ((gint)(serial - writer_flushed_serial) > 0)
+			g_cond_wait(&writer_cond, &writer_lock);
+	}
+
+	g_mutex_unlock(&writer_lock);
+}
+
+/* Takes ownership of text; a NULL text closes the file. */
+static void
+log_writer_write(FILE *file, GString *text)
+{
+	PurpleLogWriterRecord *record;
+	gboolean write_through;
+
+	g_mutex_lock(&writer_lock);
+
+	if (writer_closed) {
+		/* Nothing would join a new writer thread, so write through. */
+		g_mutex_unlock(&writer_lock);
+
+		if (text == NULL) {
+			fclose(file);
+			return;
+		}
+
+		if (fwrite(text->str, 1, text->len, file) != text->len ||
+				fflush(file) != 0) {
+			purple_debug_error("log", "Error writing log file: %s\n",
+			                   g_strerror(errno));
+		}
+
+		g_string_free(text, TRUE);
+		return;
+	}
+
+	record = g_slice_new(PurpleLogWriterRecord);
+	record->file = file;
+	record->text = text;
+
+	if (writer_thread == NULL) {
+		writer_unflushed = g_hash_table_new(g_direct_hash, g_direct_equal);
+		writer_unsynced = g_hash_table_new(g_direct_hash, g_direct_equal);
+		writer_quit = FALSE;
+		writer_thread = g_thread_new("purple-log-writer",
+				log_writer_thread, NULL);
+	}
+
+	g_queue_push_tail(&writer_queue, record);
+	g_cond_broadcast(&writer_cond);
+
+	write_through = (writer_flush_interval <= 0);
+
+	g_mutex_unlock(&writer_lock);
+
+	if (write_through)
+		log_writer_flush();
+}
+
+static void
+log_writer_shutdown(void)
+{
+	g_mutex_lock(&writer_lock);
+
+	writer_closed = TRUE;
+
+	if (writer_thread == NULL) {
+		g_mutex_unlock(&writer_lock);
+		return;
+	}
+
+	writer_quit = TRUE;
+	g_cond_broadcast(&writer_cond);
+	g_mutex_unlock(&writer_lock);
+
+	g_thread_join(writer_thread);
+	writer_thread = NULL;
+
+	g_hash_table_destroy(writer_unflushed);
+	writer_unflushed = NULL;
+	g_hash_table_destroy(writer_unsynced);
+	writer_unsynced = NULL;
+}
+
+static void
+log_writer_interval_pref_cb(const char *name, PurplePrefType type,
+                            gconstpointer value, gpointer data)
+{
+	gint64 interval = GPOINTER_TO_INT(value);
+
+	if (interval < 0)
+		interval = 0;
+
+	g_mutex_lock(&writer_lock);
+
+	if (purple_strequal(name, "/purple/logging/flush_interval"))
+		writer_flush_interval = interval * (G_USEC_PER_SEC / 1000);
+	else
+		writer_sync_interval = interval * G_USEC_PER_SEC;
+
+	g_cond_broadcast(&writer_cond);
+	g_mutex_unlock(&writer_lock);
+}
+
 /****************************************************************************
  * LOG SUBSYSTEM ************************************************************
  ****************************************************************************/
@@ -599,6 +2576,12 @@ void purple_log_init(void)
 	purple_prefs_add_bool("/purple/logging/log_system", FALSE);
 
 	purple_prefs_add_string("/purple/logging/format", "html");
+	purple_prefs_add_int("/purple/logging/flush_interval", 1000);
+	purple_prefs_add_int("/purple/logging/sync_interval", 30);
+
+	g_mutex_lock(&writer_lock);
+	writer_closed = FALSE;
+	g_mutex_unlock(&writer_lock);
 
 	html_logger = purple_log_logger_new("html", _("HTML"), 11,
 									  NULL,
@@ -635,16 +2618,23 @@ void purple_log_init(void)
 	                     G_TYPE_OBJECT,
 	                     G_TYPE_BOOLEAN);
 
+	purple_signal_register(handle, "log-search-indexed",
+	                       purple_marshal_VOID__POINTER, G_TYPE_NONE, 1,
+	                       PURPLE_TYPE_LOG);
+
 	purple_prefs_connect_callback(NULL, "/purple/logging/format",
 							    logger_pref_cb, NULL);
 	purple_prefs_trigger_callback("/purple/logging/format");
 
-	logsize_users = g_hash_table_new_full((GHashFunc)_purple_logsize_user_hash,
-			(GEqualFunc)_purple_logsize_user_equal,
-			(GDestroyNotify)_purple_logsize_user_free_key, NULL);
-	logsize_users_decayed = g_hash_table_new_full((GHashFunc)_purple_logsize_user_hash,
-				(GEqualFunc)_purple_logsize_user_equal,
-				(GDestroyNotify)_purple_logsize_user_free_key, NULL);
+	purple_prefs_connect_callback(handle, "/purple/logging/flush_interval",
+	                              log_writer_interval_pref_cb, NULL);
+	purple_prefs_trigger_callback("/purple/logging/flush_interval");
+	purple_prefs_connect_callback(handle, "/purple/logging/sync_interval",
+	                              log_writer_interval_pref_cb, NULL);
+	purple_prefs_trigger_callback("/purple/logging/sync_interval");
+
+	log_index_init();
+	log_search_init();
 }
 
 void
@@ -652,6 +2642,10 @@ purple_log_uninit(void)
 {
 	purple_signals_unregister_by_instance(purple_log_get_handle());
 
+	/* These still need the loggers. */
+	log_search_uninit();
+	log_index_uninit();
+
 	purple_log_logger_remove(html_logger);
 	purple_log_logger_free(html_logger);
 	html_logger = NULL;
@@ -660,8 +2654,8 @@ purple_log_uninit(void)
 	purple_log_logger_free(txt_logger);
 	txt_logger = NULL;
 
-	g_hash_table_destroy(logsize_users);
-	g_hash_table_destroy(logsize_users_decayed);
+	purple_prefs_disconnect_by_handle(purple_log_get_handle());
+	log_writer_shutdown();
 }
 
 static PurpleLog *
@@ -1202,7 +3196,8 @@ static gsize html_logger_write(PurpleLog *log, PurpleMessageFlags type,
 	PurpleProtocol *protocol =
 			purple_protocols_find(purple_account_get_protocol_id(log->account));
 	PurpleLogCommonLoggerData *data = log->logger_data;
-	gsize written = 0;
+	GString *text = NULL;
+	gsize written;
 
 	if(!data) {
 		const char *proto = purple_protocol_class_list_icon(protocol, log->account, NULL);
@@ -1221,9 +3216,9 @@ static gsize html_logger_write(PurpleLog *log, PurpleMessageFlags type,
 		date = g_date_time_format(dt, "%c");
 		g_date_time_unref(dt);
 
-		written += fprintf(data->file, "<html><head>");
-		written += fprintf(data->file, "<meta http-equiv=\"content-type\" content=\"text/html; charset=UTF-8\">");
-		written += fprintf(data->file, "<title>");
+		text = g_string_new("<html><head>");
+		g_string_append(text, "<meta http-equiv=\"content-type\" content=\"text/html; charset=UTF-8\">");
+		g_string_append(text, "<title>");
 		if (log->type == PURPLE_LOG_SYSTEM)
 			header = g_strdup_printf("System log for account %s (%s) connected at %s",
 					purple_account_get_username(log->account), proto, date);
@@ -1231,9 +3226,9 @@ static gsize html_logger_write(PurpleLog *log, PurpleMessageFlags type,
 			header = g_strdup_printf("Conversation with %s at %s on %s (%s)",
 					log->name, date, purple_account_get_username(log->account), proto);
 
-		written += fprintf(data->file, "%s", header);
-		written += fprintf(data->file, "</title></head><body>");
-		written += fprintf(data->file, "<h3>%s</h3>\n", header);
+		g_string_append(text, header);
+		g_string_append(text, "</title></head><body>");
+		g_string_append_printf(text, "<h3>%s</h3>\n", header);
 		g_free(date);
 		g_free(header);
 	}
@@ -1242,6 +3237,9 @@ static gsize html_logger_write(PurpleLog *log, PurpleMessageFlags type,
 	if(!data->file)
 		return 0;
 
+	if (text == NULL)
+		text = g_string_new(NULL);
+
 	escaped_from = g_markup_escape_text(from != NULL ? from : "<NULL>",
 			-1);
 
@@ -1256,43 +3254,45 @@ static gsize html_logger_write(PurpleLog *log, PurpleMessageFlags type,
 	date = log_get_timestamp(log, time);
 
 	if(log->type == PURPLE_LOG_SYSTEM){
-		written += fprintf(data->file, "---- %s @ %s ----<br/>\n", msg_fixed, date);
+		g_string_append_printf(text, "---- %s @ %s ----<br/>\n", msg_fixed, date);
 	} else {
 		if (type & PURPLE_MESSAGE_SYSTEM)
-			written += fprintf(data->file, "<font size=\"2\">(%s)</font><b> %s</b><br/>\n", date, msg_fixed);
+			g_string_append_printf(text, "<font size=\"2\">(%s)</font><b> %s</b><br/>\n", date, msg_fixed);
 		else if (type & PURPLE_MESSAGE_RAW)
-			written += fprintf(data->file, "<font size=\"2\">(%s)</font> %s<br/>\n", date, msg_fixed);
+			g_string_append_printf(text, "<font size=\"2\">(%s)</font> %s<br/>\n", date, msg_fixed);
 		else if (type & PURPLE_MESSAGE_ERROR)
-			written += fprintf(data->file, "<font color=\"#FF0000\"><font size=\"2\">(%s)</font><b> %s</b></font><br/>\n", date, msg_fixed);
+			g_string_append_printf(text, "<font color=\"#FF0000\"><font size=\"2\">(%s)</font><b> %s</b></font><br/>\n", date, msg_fixed);
 		else if (type & PURPLE_MESSAGE_AUTO_RESP) {
 			if (type & PURPLE_MESSAGE_SEND)
-				written += fprintf(data->file, _("<font color=\"#16569E\"><font size=\"2\">(%s)</font> <b>%s &lt;AUTO-REPLY&gt;:</b></font> %s<br/>\n"), date, escaped_from, msg_fixed);
+				g_string_append_printf(text, _("<font color=\"#16569E\"><font size=\"2\">(%s)</font> <b>%s &lt;AUTO-REPLY&gt;:</b></font> %s<br/>\n"), date, escaped_from, msg_fixed);
 			else if (type & PURPLE_MESSAGE_RECV)
-				written += fprintf(data->file, _("<font color=\"#A82F2F\"><font size=\"2\">(%s)</font> <b>%s &lt;AUTO-REPLY&gt;:</b></font> %s<br/>\n"), date, escaped_from, msg_fixed);
+				g_string_append_printf(text, _("<font color=\"#A82F2F\"><font size=\"2\">(%s)</font> <b>%s &lt;AUTO-REPLY&gt;:</b></font> %s<br/>\n"), date, escaped_from, msg_fixed);
 		} else if (type & PURPLE_MESSAGE_RECV) {
 			if(purple_message_meify(msg_fixed, -1))
-				written += fprintf(data->file, "<font color=\"#062585\"><font size=\"2\">(%s)</font> <b>***%s</b></font> %s<br/>\n",
+				g_string_append_printf(text, "<font color=\"#062585\"><font size=\"2\">(%s)</font> <b>***%s</b></font> %s<br/>\n",
 						date, escaped_from, msg_fixed);
 			else
-				written += fprintf(data->file, "<font color=\"#A82F2F\"><font size=\"2\">(%s)</font> <b>%s:</b></font> %s<br/>\n",
+				g_string_append_printf(text, "<font color=\"#A82F2F\"><font size=\"2\">(%s)</font> <b>%s:</b></font> %s<br/>\n",
 						date, escaped_from, msg_fixed);
 		} else if (type & PURPLE_MESSAGE_SEND) {
 			if(purple_message_meify(msg_fixed, -1))
-				written += fprintf(data->file, "<font color=\"#062585\"><font size=\"2\">(%s)</font> <b>***%s</b></font> %s<br/>\n",
+				g_string_append_printf(text, "<font color=\"#062585\"><font size=\"2\">(%s)</font> <b>***%s</b></font> %s<br/>\n",
 						date, escaped_from, msg_fixed);
 			else
-				written += fprintf(data->file, "<font color=\"#16569E\"><font size=\"2\">(%s)</font> <b>%s:</b></font> %s<br/>\n",
+				g_string_append_printf(text, "<font color=\"#16569E\"><font size=\"2\">(%s)</font> <b>%s:</b></font> %s<br/>\n",
 						date, escaped_from, msg_fixed);
 		} else {
 			purple_debug_error("log", "Unhandled message type.\n");
-			written += fprintf(data->file, "<font size=\"2\">(%s)</font><b> %s:</b></font> %s<br/>\n",
+			g_string_append_printf(text, "<font size=\"2\">(%s)</font><b> %s:</b></font> %s<br/>\n",
 						date, escaped_from, msg_fixed);
 		}
 	}
 	g_free(date);
 	g_free(msg_fixed);
 	g_free(escaped_from);
-	fflush(data->file);
+
+	written = text->len;
+	log_writer_write(data->file, text);
 
 	return written;
 }
@@ -1302,8 +3302,9 @@ static void html_logger_finalize(PurpleLog *log)
 	PurpleLogCommonLoggerData *data = log->logger_data;
 	if (data) {
 		if(data->file) {
-			fprintf(data->file, "</body></html>\n");
-			fclose(data->file);
+			log_writer_write(data->file,
+			                 g_string_new("</body></html>\n"));
+			log_writer_write(data->file, NULL);
 		}
 		g_free(data->path);
 
@@ -1328,6 +3329,7 @@ static char *html_logger_read(PurpleLog *log, PurpleLogReadFlags *flags)
 	*flags = PURPLE_LOG_READ_NO_NEWLINE;
 	if (!data || !data->path)
 		return g_strdup(_("<font color=\"red\"><b>Unable to find log path!</b></font>"));
+	log_writer_flush();
 	if (g_file_get_contents(data->path, &read, NULL, NULL)) {
 		char *minus_header = strchr(read, '\n');
 
@@ -1360,8 +3362,8 @@ static gsize txt_logger_write(PurpleLog *log, PurpleMessageFlags type,
 			purple_protocols_find(purple_account_get_protocol_id(log->account));
 	PurpleLogCommonLoggerData *data = log->logger_data;
 	char *stripped = NULL;
-
-	gsize written = 0;
+	GString *text = NULL;
+	gsize written;
 
 	if (data == NULL) {
 		/* This log is new.  We could use the loggers 'new' function, but
@@ -1381,12 +3383,13 @@ static gsize txt_logger_write(PurpleLog *log, PurpleMessageFlags type,
 
 		dt = g_date_time_to_local(log->time);
 		date = g_date_time_format(dt, "%c");
+		text = g_string_new(NULL);
 		if (log->type == PURPLE_LOG_SYSTEM)
-			written += fprintf(data->file, "System log for account %s (%s) connected at %s\n",
+			g_string_append_printf(text, "System log for account %s (%s) connected at %s\n",
 				purple_account_get_username(log->account), proto,
 				date);
 		else
-			written += fprintf(data->file, "Conversation with %s at %s on %s (%s)\n",
+			g_string_append_printf(text, "Conversation with %s at %s on %s (%s)\n",
 				log->name, date,
 				purple_account_get_username(log->account), proto);
 		g_free(date);
@@ -1397,40 +3400,48 @@ static gsize txt_logger_write(PurpleLog *log, PurpleMessageFlags type,
 	if(!data->file)
 		return 0;
 
+	if (text == NULL)
+		text = g_string_new(NULL);
+
 	stripped = purple_markup_strip_html(message);
 	date = log_get_timestamp(log, time);
 
 	if(log->type == PURPLE_LOG_SYSTEM){
-		written += fprintf(data->file, "---- %s @ %s ----\n", stripped, date);
+		g_string_append_printf(text, "---- %s @ %s ----\n", stripped, date);
 	} else {
 		if (type & PURPLE_MESSAGE_SEND ||
 			type & PURPLE_MESSAGE_RECV) {
 			if (type & PURPLE_MESSAGE_AUTO_RESP) {
-				written += fprintf(data->file, _("(%s) %s <AUTO-REPLY>: %s\n"), date,
+				g_string_append_printf(text, _("(%s) %s <AUTO-REPLY>: %s\n"), date,
 						from, stripped);
 			} else {
 				if(purple_message_meify(stripped, -1))
-					written += fprintf(data->file, "(%s) ***%s %s\n", date, from,
+					g_string_append_printf(text, "(%s) ***%s %s\n", date, from,
 							stripped);
 				else
-					written += fprintf(data->file, "(%s) %s: %s\n", date, from,
+					g_string_append_printf(text, "(%s) %s: %s\n", date, from,
 							stripped);
 			}
 		} else if (type & PURPLE_MESSAGE_SYSTEM ||
 			type & PURPLE_MESSAGE_ERROR ||
 			type & PURPLE_MESSAGE_RAW)
-			written += fprintf(data->file, "(%s) %s\n", date, stripped);
+			g_string_append_printf(text, "(%s) %s\n", date, stripped);
 		else if (type & PURPLE_MESSAGE_NO_LOG) {
 			/* This shouldn't happen */
+			g_free(date);
 			g_free(stripped);
+			written = text->len;
+			log_writer_write(data->file, text);
 			return written;
 		} else
-			written += fprintf(data->file, "(%s) %s%s %s\n", date, from ? from : "",
+			g_string_append_printf(text, "(%s) %s%s %s\n", date, from ? from : "",
 					from ? ":" : "", stripped);
 	}
 	g_free(date);
 	g_free(stripped);
-	fflush(data->file);
+
+	written = text->len;
+	log_writer_write(data->file, text);
 
 	return written;
 }
@@ -1440,7 +3451,7 @@ static void txt_logger_finalize(PurpleLog *log)
 	PurpleLogCommonLoggerData *data = log->logger_data;
 	if (data) {
 		if(data->file)
-			fclose(data->file);
+			log_writer_write(data->file, NULL);
 		g_free(data->path);
 
 		g_slice_free(PurpleLogCommonLoggerData, data);
@@ -1464,6 +3475,7 @@ static char *txt_logger_read(PurpleLog *log, PurpleLogReadFlags *flags)
 	*flags = 0;
 	if (!data || !data->path)
 		return g_strdup(_("<font color=\"red\"><b>Unable to find log path!</b></font>"));
+	log_writer_flush();
 	if (g_file_get_contents(data->path, &read, NULL, NULL)) {
 		minus_header = strchr(read, '\n');
 
@@ -41,6 +41,7 @@ typedef struct _PurpleLog PurpleLog;
 typedef struct _PurpleLogLogger PurpleLogLogger;
 typedef struct _PurpleLogCommonLoggerData PurpleLogCommonLoggerData;
 typedef struct _PurpleLogSet PurpleLogSet;
+typedef struct _PurpleLogSearchHit PurpleLogSearchHit;
 
 typedef enum {
 	PURPLE_LOG_IM,
@@ -52,6 +53,18 @@ typedef enum {
 	PURPLE_LOG_READ_NO_NEWLINE = 1
 } PurpleLogReadFlags;
 
+/**
+ * PurpleLogSearchFlags:
+ * @PURPLE_LOG_SEARCH_SNIPPETS: Fill in the snippet of each hit.
+ *
+ * Flags for purple_log_search().
+ *
+ * Since: 3.0.0
+ */
+typedef enum {
+	PURPLE_LOG_SEARCH_SNIPPETS = 1
+} PurpleLogSearchFlags;
+
 #include "account.h"
 #include "conversations.h"
 
@@ -196,6 +209,23 @@ struct _PurpleLogSet {
 	 * IMPORTANT: Update that code if you add members here. */
 };
 
+/**
+ * PurpleLogSearchHit:
+ * @log:     The log that matched.
+ * @score:   How well @log matched; higher is better.
+ * @snippet: Plain text surrounding the first match in @log, or %NULL if
+ *           #PURPLE_LOG_SEARCH_SNIPPETS was not given.
+ *
+ * A result of purple_log_search().
+ *
+ * Since: 3.0.0
+ */
+struct _PurpleLogSearchHit {
+	PurpleLog *log;
+	gdouble score;
+	char *snippet;
+};
+
 G_BEGIN_DECLS
 
 /***************************************/
@@ -342,6 +372,63 @@ int purple_log_get_total_size(PurpleLogType type, const char *name, PurpleAccoun
  */
 int purple_log_get_activity_score(PurpleLogType type, const char *name, PurpleAccount *account);
 
+/**
+ * purple_log_search:
+ * @account: (nullable): The account to search the logs of, or %NULL for all
+ *           accounts.
+ * @buddy:   (nullable): The name of the IM or chat to search the logs of, or
+ *           %NULL for every conversation including the system log.
+ * @query:   The words to search for.
+ * @limit:   The maximum number of hits to return, or 0 for all of them.
+ * @flags:   #PURPLE_LOG_SEARCH_SNIPPETS to fill in the snippet of each hit,
+ *           which means reading the log.
+ * @unindexed: (out) (optional): Return location for the number of logs that
+ *           were left out because they are not indexed yet.
+ *
+ * Searches logs through the full-text index libpurple keeps of them.  A log
+ * matches when it contains, for every word in @query, a word starting with
+ * it, regardless of case.  Words too short to be indexed, or a query with no
+ * words at all, are matched as substrings of the text of the logs instead.
+ *
+ * Logs that are not in the index yet are queued to be indexed in the
+ * background and left out.  The "log-search-indexed" signal is emitted for
+ * each of them once it has been indexed, and purple_log_search_matches() then
+ * tells whether it matches, without searching everything again.
+ *
+ * Returns: (element-type PurpleLogSearchHit) (transfer full): The hits,
+ *          best first.  Free them with purple_log_search_hit_free().
+ *
+ * Since: 3.0.0
+ */
+GList *purple_log_search(PurpleAccount *account, const char *buddy,
+                         const char *query, guint limit,
+                         PurpleLogSearchFlags flags, guint *unindexed);
+
+/**
+ * purple_log_search_matches:
+ * @log:   The log to check.
+ * @query: The words to search for.
+ *
+ * Checks a single log against @query the way purple_log_search() does.  A log
+ * that is not indexed yet only matches if @query has no words long enough to
+ * be looked up in the index.
+ *
+ * Returns: %TRUE if @log matches @query.
+ *
+ * Since: 3.0.0
+ */
+gboolean purple_log_search_matches(PurpleLog *log, const char *query);
+
+/**
+ * purple_log_search_hit_free:
+ * @hit: The hit to free.
+ *
+ * Frees a hit returned by purple_log_search(), including its log.
+ *
+ * Since: 3.0.0
+ */
+void purple_log_search_hit_free(PurpleLogSearchHit *hit);
+
 /**
  * purple_log_is_deletable:
  * @log:                 The log
@@ -434,6 +434,15 @@ chat_user_joined_cb(PurpleConversation *conv, const char *user,
 					purple_conversation_get_name(conv), user, flags, new_arrival);
 }
 
+static void
+chat_users_joined_cb(PurpleConversation *conv, GList *users,
+					 gboolean new_arrivals, void *data)
+{
+	purple_debug_misc("signals test", "chat-users-joined (%s, %u, %d)\n",
+					purple_conversation_get_name(conv), g_list_length(users),
+					new_arrivals);
+}
+
 static void
 chat_user_flags_cb(PurpleChatUser *cb, PurpleChatUserFlags oldflags,
 					 PurpleChatUserFlags newflags, void *data)
@@ -764,6 +773,8 @@ plugin_load(PurplePlugin *plugin, GError **error)
 						plugin, PURPLE_CALLBACK(chat_user_joining_cb), NULL);
 	purple_signal_connect(conv_handle, "chat-user-joined",
 						plugin, PURPLE_CALLBACK(chat_user_joined_cb), NULL);
+	purple_signal_connect(conv_handle, "chat-users-joined",
+						plugin, PURPLE_CALLBACK(chat_users_joined_cb), NULL);
 	purple_signal_connect(conv_handle, "chat-user-flags",
 						plugin, PURPLE_CALLBACK(chat_user_flags_cb), NULL);
 	purple_signal_connect(conv_handle, "chat-user-leaving",
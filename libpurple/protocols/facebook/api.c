@@ -36,6 +36,7 @@ enum
 	PROP_0,
 
 	PROP_CID,
+	PROP_CURSOR,
 	PROP_DID,
 	PROP_MID,
 	PROP_STOKEN,
@@ -65,6 +66,15 @@ typedef struct
 	guint unread;
 	FbId lastmid;
 	gchar *contacts_delta;
+
+	FbUtilZlib *zlib;
+	GByteArray *zbuf;
+
+	GHashTable *contactp;
+	GHashTable *contacta;
+	GHashTable *threadp;
+	GHashTable *threada;
+	guint lookupev;
 } FbApiPrivate;
 
 /**
@@ -109,6 +119,10 @@ fb_api_set_property(GObject *obj, guint prop, const GValue *val,
 		g_free(priv->cid);
 		priv->cid = g_value_dup_string(val);
 		break;
+	case PROP_CURSOR:
+		g_free(priv->contacts_delta);
+		priv->contacts_delta = g_value_dup_string(val);
+		break;
 	case PROP_DID:
 		g_free(priv->did);
 		priv->did = g_value_dup_string(val);
@@ -143,6 +157,9 @@ fb_api_get_property(GObject *obj, guint prop, GValue *val, GParamSpec *pspec)
 	case PROP_CID:
 		g_value_set_string(val, priv->cid);
 		break;
+	case PROP_CURSOR:
+		g_value_set_string(val, priv->contacts_delta);
+		break;
 	case PROP_DID:
 		g_value_set_string(val, priv->did);
 		break;
@@ -170,6 +187,8 @@ static void
 fb_api_dispose(GObject *obj)
 {
 	FbApiPrivate *priv = FB_API(obj)->priv;
+	FbUtilZlibStats dstats;
+	FbUtilZlibStats istats;
 
 	soup_session_abort(priv->cons);
 
@@ -177,9 +196,35 @@ fb_api_dispose(GObject *obj)
 		g_object_unref(priv->mqtt);
 	}
 
+	if (priv->lookupev != 0) {
+		g_source_remove(priv->lookupev);
+	}
+
 	g_object_unref(priv->cons);
 	g_queue_free_full(priv->msgs, (GDestroyNotify) fb_api_message_free);
 
+	fb_util_zlib_get_stats(priv->zlib, &istats, &dstats);
+	fb_util_debug_info("Inflated %" G_GUINT64_FORMAT " payloads, %"
+	                   G_GUINT64_FORMAT " to %" G_GUINT64_FORMAT
+	                   " bytes in %" G_GINT64_FORMAT " us",
+	                   istats.calls, istats.bytes_in, istats.bytes_out,
+	                   istats.usecs);
+	fb_util_debug_info("Deflated %" G_GUINT64_FORMAT " payloads, %"
+	                   G_GUINT64_FORMAT " to %" G_GUINT64_FORMAT
+	                   " bytes in %" G_GINT64_FORMAT " us",
+	                   dstats.calls, dstats.bytes_in, dstats.bytes_out,
+	                   dstats.usecs);
+	fb_util_zlib_free(priv->zlib);
+
+	if (priv->zbuf != NULL) {
+		g_byte_array_free(priv->zbuf, TRUE);
+	}
+
+	g_hash_table_destroy(priv->contactp);
+	g_hash_table_destroy(priv->contacta);
+	g_hash_table_destroy(priv->threadp);
+	g_hash_table_destroy(priv->threada);
+
 	g_free(priv->cid);
 	g_free(priv->did);
 	g_free(priv->stoken);
@@ -262,6 +307,21 @@ fb_api_class_init(FbApiClass *klass)
 		NULL,
 		G_PARAM_READWRITE);
 
+	/**
+	 * FbApi:cursor:
+	 *
+	 * The delta cursor of the contact list. When set, contacts are
+	 * fetched as deltas against the contact list this cursor was
+	 * issued with. This value should be saved and loaded alongside
+	 * that contact list for persistence.
+	 */
+	props[PROP_CURSOR] = g_param_spec_string(
+		"cursor",
+		"Contacts Cursor",
+		"Delta cursor of the contact list",
+		NULL,
+		G_PARAM_READWRITE);
+
 	/**
 	 * FbApi:uid:
 	 *
@@ -346,6 +406,7 @@ fb_api_class_init(FbApiClass *klass)
 	 * @api: The #FbApi.
 	 * @added: The #GSList of added #FbApiUser's.
 	 * @removed: The #GSList of strings with removed user ids.
+	 * @complete: #TRUE if the deltas are complete, otherwise #FALSE.
 	 *
 	 * Like 'contacts', but only the deltas.
 	 */
@@ -355,7 +416,7 @@ fb_api_class_init(FbApiClass *klass)
 	             0,
 	             NULL, NULL, NULL,
 	             G_TYPE_NONE,
-	             2, G_TYPE_POINTER, G_TYPE_POINTER);
+	             3, G_TYPE_POINTER, G_TYPE_POINTER, G_TYPE_BOOLEAN);
 
 	/**
 	 * FbApi::error:
@@ -506,6 +567,16 @@ fb_api_init(FbApi *api)
 	api->priv = priv;
 
 	priv->msgs = g_queue_new();
+	priv->zlib = fb_util_zlib_new();
+
+	priv->contactp = g_hash_table_new_full(fb_id_hash, fb_id_equal,
+	                                       g_free, NULL);
+	priv->contacta = g_hash_table_new_full(fb_id_hash, fb_id_equal,
+	                                       g_free, NULL);
+	priv->threadp = g_hash_table_new_full(fb_id_hash, fb_id_equal,
+	                                      g_free, NULL);
+	priv->threada = g_hash_table_new_full(fb_id_hash, fb_id_equal,
+	                                      g_free, NULL);
 }
 
 GQuark
@@ -686,11 +757,8 @@ fb_api_http_req(FbApi *api, const gchar *url, const gchar *name,
 {
 	FbApiPrivate *priv = api->priv;
 	gchar *data;
-	gchar *key;
 	gchar *val;
-	GList *keys;
-	GList *l;
-	GString *gstr;
+	gsize size;
 	SoupMessage *msg;
 
 	fb_http_params_set_str(params, "api_key", FB_API_KEY);
@@ -704,28 +772,12 @@ fb_api_http_req(FbApi *api, const gchar *url, const gchar *name,
 	g_free(val);
 
 	/* Ensure an old signature is not computed */
-	g_hash_table_remove(params, "sig");
-
-	gstr = g_string_new(NULL);
-	keys = g_hash_table_get_keys(params);
-	keys = g_list_sort(keys, (GCompareFunc) g_ascii_strcasecmp);
-
-	for (l = keys; l != NULL; l = l->next) {
-		key = l->data;
-		val = g_hash_table_lookup(params, key);
-		g_string_append_printf(gstr, "%s=%s", key, val);
-	}
+	fb_http_params_remove(params, "sig");
 
-	g_string_append(gstr, FB_API_SECRET);
-	data = g_compute_checksum_for_string(G_CHECKSUM_MD5, gstr->str,
-	                                     gstr->len);
-	fb_http_params_set_str(params, "sig", data);
-	g_string_free(gstr, TRUE);
-	g_list_free(keys);
-	g_free(data);
-
-	msg = soup_form_request_new_from_hash("POST", url, params);
-	fb_http_params_free(params);
+	data = fb_http_params_close(params, FB_API_SECRET, &size);
+	msg = soup_message_new("POST", url);
+	soup_message_set_request(msg, SOUP_FORM_MIME_TYPE_URLENCODED,
+	                         SOUP_MEMORY_TAKE, data, size);
 
 	if (priv->token != NULL) {
 		data = g_strdup_printf("OAuth %s", priv->token);
@@ -791,6 +843,113 @@ fb_api_http_query(FbApi *api, gint64 query, JsonBuilder *builder,
 	return fb_api_http_req(api, FB_API_URL_GQL, name, "get", prms, hcb);
 }
 
+static void
+fb_api_cb_contact(SoupSession *session, SoupMessage *res, gpointer data);
+
+static void
+fb_api_cb_thread(SoupSession *session, SoupMessage *res, gpointer data);
+
+static void
+fb_api_lookup_send(FbApi *api, gint64 query, GHashTable *pend,
+                   GHashTable *actv, SoupSessionCallback callback)
+{
+	FbId *id;
+	GArray *ids;
+	GHashTableIter iter;
+	JsonBuilder *bldr;
+	SoupMessage *msg;
+
+	if (g_hash_table_size(pend) < 1) {
+		return;
+	}
+
+	ids = g_array_sized_new(FALSE, FALSE, sizeof *id,
+	                        g_hash_table_size(pend));
+	bldr = fb_json_bldr_new(JSON_NODE_OBJECT);
+	fb_json_bldr_arr_begin(bldr, "0");
+	g_hash_table_iter_init(&iter, pend);
+
+	while (g_hash_table_iter_next(&iter, (gpointer) &id, NULL)) {
+		fb_json_bldr_add_strf(bldr, NULL, "%" FB_ID_FORMAT, *id);
+		g_array_append_val(ids, *id);
+
+		/* The id stays in flight until the reply */
+		g_hash_table_iter_steal(&iter);
+		g_hash_table_add(actv, id);
+	}
+
+	fb_json_bldr_arr_end(bldr);
+
+	if (query == FB_API_QUERY_CONTACT) {
+		fb_json_bldr_add_str(bldr, "1", "true");
+	} else {
+		fb_json_bldr_add_str(bldr, "10", "false");
+		fb_json_bldr_add_str(bldr, "11", "false");
+		fb_json_bldr_add_str(bldr, "13", "false");
+	}
+
+	msg = fb_api_http_query(api, query, bldr, callback);
+	g_object_set_data_full(G_OBJECT(msg), "fb-lookup-ids", ids,
+	                       (GDestroyNotify) g_array_unref);
+}
+
+static void
+fb_api_lookup_done(SoupMessage *res, GHashTable *actv)
+{
+	GArray *ids;
+	guint i;
+
+	ids = g_object_get_data(G_OBJECT(res), "fb-lookup-ids");
+
+	if (G_UNLIKELY(ids == NULL)) {
+		return;
+	}
+
+	for (i = 0; i < ids->len; i++) {
+		g_hash_table_remove(actv, &g_array_index(ids, FbId, i));
+	}
+}
+
+static gboolean
+fb_api_cb_lookup(gpointer data)
+{
+	FbApi *api = data;
+	FbApiPrivate *priv = api->priv;
+
+	priv->lookupev = 0;
+
+	fb_api_lookup_send(api, FB_API_QUERY_CONTACT, priv->contactp,
+	                   priv->contacta, fb_api_cb_contact);
+	fb_api_lookup_send(api, FB_API_QUERY_THREAD, priv->threadp,
+	                   priv->threada, fb_api_cb_thread);
+	return G_SOURCE_REMOVE;
+}
+
+static void
+fb_api_lookup(FbApi *api, FbId id, GHashTable *pend, GHashTable *actv)
+{
+	FbApiPrivate *priv = api->priv;
+
+	if (g_hash_table_contains(pend, &id) ||
+	    g_hash_table_contains(actv, &id))
+	{
+		return;
+	}
+
+	g_hash_table_add(pend, g_memdup(&id, sizeof id));
+
+	if (g_hash_table_size(pend) >= FB_API_LOOKUP_MAX) {
+		if (priv->lookupev != 0) {
+			g_source_remove(priv->lookupev);
+		}
+
+		fb_api_cb_lookup(api);
+	} else if (priv->lookupev == 0) {
+		priv->lookupev = g_timeout_add(FB_API_LOOKUP_DELAY,
+		                               fb_api_cb_lookup, api);
+	}
+}
+
 static void
 fb_api_cb_http_bool(G_GNUC_UNUSED SoupSession *session, SoupMessage *res,
                     gpointer data)
@@ -905,9 +1064,11 @@ fb_api_cb_mqtt_open(FbMqtt *mqtt, gpointer data)
 	fb_thrift_write_stop(thft);
 
 	bytes = fb_thrift_get_bytes(thft);
-	cytes = fb_util_zlib_deflate(bytes, &err);
+	cytes = g_byte_array_new();
+	fb_util_zlib_deflate(priv->zlib, bytes->data, bytes->len, cytes, &err);
 
 	FB_API_ERROR_EMIT(api, err,
+		g_byte_array_free(cytes, TRUE);
 		g_object_unref(thft);
 		return;
 	);
@@ -1422,22 +1583,53 @@ fb_api_cb_publish_ms_new_message(FbApi *api, JsonNode *root, GSList *msgs, GErro
 static GSList *
 fb_api_cb_publish_ms_event(FbApi *api, JsonNode *root, GSList *events, FbApiEventType type, GError **error);
 
+static void
+fb_api_cb_publish_ms_flush(FbApi *api, GSList **msgs, GSList **events)
+{
+	if (*msgs != NULL) {
+		*msgs = g_slist_reverse(*msgs);
+		g_signal_emit_by_name(api, "messages", *msgs);
+		g_slist_free_full(*msgs, (GDestroyNotify) fb_api_message_free);
+		*msgs = NULL;
+	}
+
+	if (*events != NULL) {
+		*events = g_slist_reverse(*events);
+		g_signal_emit_by_name(api, "events", *events);
+		g_slist_free_full(*events, (GDestroyNotify) fb_api_event_free);
+		*events = NULL;
+	}
+}
+
 static void
 fb_api_cb_publish_ms(FbApi *api, GByteArray *pload)
 {
 	const gchar *data;
+	const gchar *delta;
+	const gchar *name;
 	FbApiPrivate *priv = api->priv;
 	FbJsonValues *values;
-	FbThrift *thft;
+	FbThriftReader rdr;
+	gchar *head;
 	gchar *stoken;
 	GError *err = NULL;
-	GList *elms, *l;
 	GSList *msgs = NULL;
 	GSList *events = NULL;
+	gsize dend = 0;
+	gsize dsize;
+	gsize dstart = 0;
+	gsize end;
+	gsize mend;
+	gsize mpos;
+	gsize mstart;
+	gsize nsize;
+	gsize pos;
+	gsize start;
+	guint count = 0;
+	guint i;
 	guint size;
 	JsonNode *root;
 	JsonNode *node;
-	JsonArray *arr;
 
 	static const struct {
 		const gchar *member;
@@ -1451,19 +1643,31 @@ fb_api_cb_publish_ms(FbApi *api, GByteArray *pload)
 	};
 
 	/* Read identifier string (for Facebook employees) */
-	thft = fb_thrift_new(pload, 0);
-	fb_thrift_read_str(thft, NULL);
-	size = fb_thrift_get_pos(thft);
-	g_object_unref(thft);
+	fb_thrift_reader_init(&rdr, pload->data, pload->len);
+	fb_thrift_reader_read_str(&rdr, NULL);
+	size = rdr.pos;
 
 	g_return_if_fail(size < pload->len);
 	data = (gchar *) pload->data + size;
 	size = pload->len - size;
 
-	if (!fb_api_json_chk(api, data, size, &root)) {
+	/* The deltas can be several megabytes after a long absence, so
+	 * they are scanned separately from the rest of the payload, and
+	 * parsed one by one, rather than building a tree of everything.
+	 */
+	if (fb_json_scan_member(data, size, "deltas", &dstart, &dend)) {
+		head = g_strdup_printf("%.*s[]%.*s", (gint) dstart, data,
+		                       (gint) (size - dend), data + dend);
+	} else {
+		head = g_strndup(data, size);
+	}
+
+	if (!fb_api_json_chk(api, head, strlen(head), &root)) {
+		g_free(head);
 		return;
 	}
 
+	g_free(head);
 	values = fb_json_values_new(root);
 	fb_json_values_add(values, FB_JSON_TYPE_INT, FALSE,
 	                   "$.lastIssuedSeqId");
@@ -1479,61 +1683,79 @@ fb_api_cb_publish_ms(FbApi *api, GByteArray *pload)
 	priv->sid = fb_json_values_next_int(values, 0);
 	stoken = fb_json_values_next_str_dup(values, NULL);
 	g_object_unref(values);
+	json_node_free(root);
 
 	if (G_UNLIKELY(stoken != NULL)) {
 		g_free(priv->stoken);
 		priv->stoken = stoken;
 		g_signal_emit_by_name(api, "connect");
-		json_node_free(root);
 		return;
 	}
 
-	arr = fb_json_node_get_arr(root, "$.deltas", NULL);
-	elms = json_array_get_elements(arr);
+	data += dstart;
+	size = dend - dstart;
+	pos = 0;
 
-	for (l = elms; l != NULL; l = l->next) {
-		guint i = 0;
-		JsonObject *o = json_node_get_object(l->data);
-
-		for (i = 0; i < G_N_ELEMENTS(event_types); i++) {
-			if ((node = json_object_get_member(o, event_types[i].member))) {
-				if (event_types[i].is_message) {
-					msgs = fb_api_cb_publish_ms_new_message(
-						api, node, msgs, &err
-					);
-				} else {
-					events = fb_api_cb_publish_ms_event(
-						api, node, events, event_types[i].type, &err
-					);
+	while ((err == NULL) &&
+	       fb_json_scan_array(data, size, &pos, &start, &end))
+	{
+		delta = data + start;
+		dsize = end - start;
+		mpos = 0;
+
+		/* Only the members with a handler are ever parsed */
+		while ((err == NULL) &&
+		       fb_json_scan_object(delta, dsize, &mpos, &name, &nsize,
+		                           &mstart, &mend))
+		{
+			for (i = 0; i < G_N_ELEMENTS(event_types); i++) {
+				if ((strlen(event_types[i].member) == nsize) &&
+				    (memcmp(event_types[i].member, name,
+				            nsize) == 0))
+				{
+					break;
 				}
 			}
-		}
 
-		if (G_UNLIKELY(err != NULL)) {
-			break;
-		}
-	}
+			if (i >= G_N_ELEMENTS(event_types)) {
+				continue;
+			}
 
-	g_list_free(elms);
-	json_array_unref(arr);
+			node = fb_json_node_new(delta + mstart, mend - mstart,
+			                        &err);
 
-	if (G_LIKELY(err == NULL)) {
-		if (msgs) {
-			msgs = g_slist_reverse(msgs);
-			g_signal_emit_by_name(api, "messages", msgs);
+			if (G_UNLIKELY(node == NULL)) {
+				break;
+			}
+
+			if (event_types[i].is_message) {
+				msgs = fb_api_cb_publish_ms_new_message(
+					api, node, msgs, &err
+				);
+			} else {
+				events = fb_api_cb_publish_ms_event(
+					api, node, events, event_types[i].type, &err
+				);
+			}
+
+			json_node_free(node);
+			count++;
 		}
 
-		if (events) {
-			events = g_slist_reverse(events);
-			g_signal_emit_by_name(api, "events", events);
+		if ((err == NULL) && (count >= FB_API_DELTAS_BATCH)) {
+			fb_api_cb_publish_ms_flush(api, &msgs, &events);
+			count = 0;
 		}
+	}
+
+	if (G_LIKELY(err == NULL)) {
+		fb_api_cb_publish_ms_flush(api, &msgs, &events);
 	} else {
 		fb_api_error_emit(api, err);
 	}
 
 	g_slist_free_full(msgs, (GDestroyNotify) fb_api_message_free);
 	g_slist_free_full(events, (GDestroyNotify) fb_api_event_free);
-	json_node_free(root);
 }
 
 static GSList *
@@ -1719,7 +1941,8 @@ fb_api_cb_publish_ms_event(FbApi *api, JsonNode *root, GSList *events, FbApiEven
 }
 
 static void
-fb_api_cb_publish_pt(FbThrift *thft, GSList **press, GError **error)
+fb_api_cb_publish_pt(FbThriftReader *rdr, FbApiPresence **press, guint *count,
+                     GError **error)
 {
 	FbApiPresence *pres;
 	FbThriftType type;
@@ -1730,74 +1953,78 @@ fb_api_cb_publish_pt(FbThrift *thft, GSList **press, GError **error)
 	guint size = 0;
 
 	/* Read identifier string (for Facebook employees) */
-	FB_API_TCHK(fb_thrift_read_str(thft, NULL));
+	FB_API_TCHK(fb_thrift_reader_read_str(rdr, NULL));
 
 	/* Read the full list boolean field */
-	FB_API_TCHK(fb_thrift_read_field(thft, &type, &id, 0));
+	FB_API_TCHK(fb_thrift_reader_read_field(rdr, &type, &id, 0));
 	FB_API_TCHK(type == FB_THRIFT_TYPE_BOOL);
 	FB_API_TCHK(id == 1);
-	FB_API_TCHK(fb_thrift_read_bool(thft, NULL));
+	FB_API_TCHK(fb_thrift_reader_read_bool(rdr, NULL));
 
 	/* Read the list field */
-	FB_API_TCHK(fb_thrift_read_field(thft, &type, &id, id));
+	FB_API_TCHK(fb_thrift_reader_read_field(rdr, &type, &id, id));
 	FB_API_TCHK(type == FB_THRIFT_TYPE_LIST);
 	FB_API_TCHK(id == 2);
 
-	/* Read the list */
-	FB_API_TCHK(fb_thrift_read_list(thft, &type, &size));
+	/* Read the list, each element is at least a few bytes */
+	FB_API_TCHK(fb_thrift_reader_read_list(rdr, &type, &size));
 	FB_API_TCHK(type == FB_THRIFT_TYPE_STRUCT);
+	FB_API_TCHK(size <= (rdr->size - rdr->pos));
+
+	/* Decode into a single preallocated array */
+	*press = g_new(FbApiPresence, size);
 
 	for (i = 0; i < size; i++) {
 		/* Read the user identifier field */
-		FB_API_TCHK(fb_thrift_read_field(thft, &type, &id, 0));
+		FB_API_TCHK(fb_thrift_reader_read_field(rdr, &type, &id, 0));
 		FB_API_TCHK(type == FB_THRIFT_TYPE_I64);
 		FB_API_TCHK(id == 1);
-		FB_API_TCHK(fb_thrift_read_i64(thft, &i64));
+		FB_API_TCHK(fb_thrift_reader_read_i64(rdr, &i64));
 
 		/* Read the active field */
-		FB_API_TCHK(fb_thrift_read_field(thft, &type, &id, id));
+		FB_API_TCHK(fb_thrift_reader_read_field(rdr, &type, &id, id));
 		FB_API_TCHK(type == FB_THRIFT_TYPE_I32);
 		FB_API_TCHK(id == 2);
-		FB_API_TCHK(fb_thrift_read_i32(thft, &i32));
+		FB_API_TCHK(fb_thrift_reader_read_i32(rdr, &i32));
 
-		pres = fb_api_presence_dup(NULL);
+		pres = &(*press)[i];
 		pres->uid = i64;
 		pres->active = i32 != 0;
-		*press = g_slist_prepend(*press, pres);
+		*count = i + 1;
 
 		fb_util_debug_info("Presence: %" FB_ID_FORMAT " (%d)",
 		                   i64, i32 != 0);
 
 		while (id <= 5) {
-			if (fb_thrift_read_isstop(thft)) {
+			if (fb_thrift_reader_read_isstop(rdr)) {
 				break;
 			}
 
-			FB_API_TCHK(fb_thrift_read_field(thft, &type, &id, id));
+			FB_API_TCHK(fb_thrift_reader_read_field(rdr, &type, &id, id));
 
 			switch (id) {
 			case 3:
 				/* Read the last active timestamp field */
 				FB_API_TCHK(type == FB_THRIFT_TYPE_I64);
-				FB_API_TCHK(fb_thrift_read_i64(thft, NULL));
+				FB_API_TCHK(fb_thrift_reader_read_i64(rdr, NULL));
 				break;
 
 			case 4:
 				/* Read the active client bits field */
 				FB_API_TCHK(type == FB_THRIFT_TYPE_I16);
-				FB_API_TCHK(fb_thrift_read_i16(thft, NULL));
+				FB_API_TCHK(fb_thrift_reader_read_i16(rdr, NULL));
 				break;
 
 			case 5:
 				/* Read the VoIP compatibility bits field */
 				FB_API_TCHK(type == FB_THRIFT_TYPE_I64);
-				FB_API_TCHK(fb_thrift_read_i64(thft, NULL));
+				FB_API_TCHK(fb_thrift_reader_read_i64(rdr, NULL));
 				break;
 
 			case 6:
 				/* Unknown new field */
 				FB_API_TCHK(type == FB_THRIFT_TYPE_I64);
-				FB_API_TCHK(fb_thrift_read_i64(thft, NULL));
+				FB_API_TCHK(fb_thrift_reader_read_i64(rdr, NULL));
 				break;
 
 			default:
@@ -1805,37 +2032,44 @@ fb_api_cb_publish_pt(FbThrift *thft, GSList **press, GError **error)
 				FB_API_TCHK(type == FB_THRIFT_TYPE_I16 ||
 				            type == FB_THRIFT_TYPE_I32 ||
 				            type == FB_THRIFT_TYPE_I64);
-				FB_API_TCHK(fb_thrift_read_i64(thft, NULL));
+				FB_API_TCHK(fb_thrift_reader_read_i64(rdr, NULL));
 				break;
 			}
 		}
 
 		/* Read the field stop */
-		FB_API_TCHK(fb_thrift_read_stop(thft));
+		FB_API_TCHK(fb_thrift_reader_read_stop(rdr));
 	}
 
 	/* Read the field stop */
-	FB_API_TCHK(fb_thrift_read_stop(thft));
+	FB_API_TCHK(fb_thrift_reader_read_stop(rdr));
 }
 
 static void
 fb_api_cb_publish_p(FbApi *api, GByteArray *pload)
 {
-	FbThrift *thft;
+	FbApiPresence *press = NULL;
+	FbThriftReader rdr;
 	GError *err = NULL;
-	GSList *press = NULL;
+	GSList *list = NULL;
+	guint count = 0;
+	guint i;
 
-	thft = fb_thrift_new(pload, 0);
-	fb_api_cb_publish_pt(thft, &press, &err);
-	g_object_unref(thft);
+	fb_thrift_reader_init(&rdr, pload->data, pload->len);
+	fb_api_cb_publish_pt(&rdr, &press, &count, &err);
 
 	if (G_LIKELY(err == NULL)) {
-		g_signal_emit_by_name(api, "presences", press);
+		for (i = count; i > 0; i--) {
+			list = g_slist_prepend(list, &press[i - 1]);
+		}
+
+		g_signal_emit_by_name(api, "presences", list);
 	} else {
 		fb_api_error_emit(api, err);
 	}
 
-	g_slist_free_full(press, (GDestroyNotify) fb_api_presence_free);
+	g_slist_free(list);
+	g_free(press);
 }
 
 static void
@@ -1843,6 +2077,7 @@ fb_api_cb_mqtt_publish(FbMqtt *mqtt, const gchar *topic, GByteArray *pload,
                        gpointer data)
 {
 	FbApi *api = data;
+	FbApiPrivate *priv = api->priv;
 	gboolean comp;
 	GByteArray *bytes;
 	GError *err = NULL;
@@ -1863,8 +2098,22 @@ fb_api_cb_mqtt_publish(FbMqtt *mqtt, const gchar *topic, GByteArray *pload,
 	comp = fb_util_zlib_test(pload);
 
 	if (G_LIKELY(comp)) {
-		bytes = fb_util_zlib_inflate(pload, &err);
-		FB_API_ERROR_EMIT(api, err, return);
+		/* Reuse the inflate buffer, unless a parser is using it */
+		bytes = priv->zbuf;
+		priv->zbuf = NULL;
+
+		if (bytes == NULL) {
+			bytes = g_byte_array_new();
+		}
+
+		g_byte_array_set_size(bytes, 0);
+		fb_util_zlib_inflate(priv->zlib, pload->data, pload->len,
+		                     bytes, &err);
+
+		FB_API_ERROR_EMIT(api, err,
+			g_byte_array_free(bytes, TRUE);
+			return;
+		);
 	} else {
 		bytes = (GByteArray *) pload;
 	}
@@ -1880,7 +2129,14 @@ fb_api_cb_mqtt_publish(FbMqtt *mqtt, const gchar *topic, GByteArray *pload,
 		}
 	}
 
-	if (G_LIKELY(comp)) {
+	if (G_UNLIKELY(!comp)) {
+		return;
+	}
+
+	/* Keep the buffer around unless an oversized payload grew it */
+	if ((priv->zbuf == NULL) && (bytes->len <= FB_API_ZBUF_MAX)) {
+		priv->zbuf = bytes;
+	} else {
 		g_byte_array_free(bytes, TRUE);
 	}
 }
@@ -2141,61 +2397,66 @@ fb_api_cb_contact(G_GNUC_UNUSED SoupSession *session, SoupMessage *res,
 	FbApiUser user;
 	FbJsonValues *values;
 	GError *err = NULL;
-	JsonNode *node;
+	GList *l;
+	GList *nodes;
 	JsonNode *root;
 
+	fb_api_lookup_done(res, api->priv->contacta);
+
 	if (!fb_api_http_chk(api, res, &root)) {
 		return;
 	}
 
-	node = fb_json_node_get_nth(root, 0);
+	/* Each looked up contact is a member of the root */
+	nodes = json_object_get_values(json_node_get_object(root));
 
-	if (node == NULL) {
+	if (nodes == NULL) {
 		fb_api_error_literal(api, FB_API_ERROR_GENERAL,
 		                     _("Failed to obtain contact information"));
 		json_node_free(root);
 		return;
 	}
 
-	values = fb_json_values_new(node);
-	fb_json_values_add(values, FB_JSON_TYPE_STR, TRUE, "$.id");
-	fb_json_values_add(values, FB_JSON_TYPE_STR, TRUE, "$.name");
-	fb_json_values_add(values, FB_JSON_TYPE_STR, FALSE,
-	                   "$.profile_pic_large.uri");
-	fb_json_values_update(values, &err);
+	for (l = nodes; l != NULL; l = l->next) {
+		values = fb_json_values_new(l->data);
+		fb_json_values_add(values, FB_JSON_TYPE_STR, TRUE, "$.id");
+		fb_json_values_add(values, FB_JSON_TYPE_STR, TRUE, "$.name");
+		fb_json_values_add(values, FB_JSON_TYPE_STR, FALSE,
+		                   "$.profile_pic_large.uri");
+		fb_json_values_update(values, &err);
 
-	FB_API_ERROR_EMIT(api, err,
-		g_object_unref(values);
-		json_node_free(root);
-		return;
-	);
+		if (G_UNLIKELY(err != NULL)) {
+			fb_api_error_emit(api, err);
+			g_object_unref(values);
+			break;
+		}
 
-	fb_api_user_reset(&user, FALSE);
-	str = fb_json_values_next_str(values, "0");
-	user.uid = FB_ID_FROM_STR(str);
-	user.name = fb_json_values_next_str_dup(values, NULL);
-	user.icon = fb_json_values_next_str_dup(values, NULL);
+		fb_api_user_reset(&user, FALSE);
+		str = fb_json_values_next_str(values, "0");
+		user.uid = FB_ID_FROM_STR(str);
+		user.name = fb_json_values_next_str_dup(values, NULL);
+		user.icon = fb_json_values_next_str_dup(values, NULL);
 
-	user.csum = fb_api_user_icon_checksum(user.icon);
+		user.csum = fb_api_user_icon_checksum(user.icon);
 
-	g_signal_emit_by_name(api, "contact", &user);
-	fb_api_user_reset(&user, TRUE);
-	g_object_unref(values);
+		g_signal_emit_by_name(api, "contact", &user);
+		fb_api_user_reset(&user, TRUE);
+		g_object_unref(values);
+	}
+
+	g_list_free(nodes);
 	json_node_free(root);
 }
 
 void
 fb_api_contact(FbApi *api, FbId uid)
 {
-	JsonBuilder *bldr;
+	FbApiPrivate *priv;
 
-	bldr = fb_json_bldr_new(JSON_NODE_OBJECT);
-	fb_json_bldr_arr_begin(bldr, "0");
-	fb_json_bldr_add_strf(bldr, NULL, "%" FB_ID_FORMAT, uid);
-	fb_json_bldr_arr_end(bldr);
+	g_return_if_fail(FB_IS_API(api));
+	priv = api->priv;
 
-	fb_json_bldr_add_str(bldr, "1", "true");
-	fb_api_http_query(api, FB_API_QUERY_CONTACT, bldr, fb_api_cb_contact);
+	fb_api_lookup(api, uid, priv->contactp, priv->contacta);
 }
 
 static GSList *
@@ -2298,6 +2559,8 @@ fb_api_cb_contacts(G_GNUC_UNUSED SoupSession *session, SoupMessage *res,
 	gboolean is_delta;
 	GError *err = NULL;
 	GList *l;
+	GSList *added = NULL;
+	GSList *removed = NULL;
 	GSList *users = NULL;
 	JsonNode *root;
 	JsonNode *croot;
@@ -2317,8 +2580,6 @@ fb_api_cb_contacts(G_GNUC_UNUSED SoupSession *session, SoupMessage *res,
 		json_node_free(node);
 
 	} else {
-		GSList *added = NULL;
-		GSList *removed = NULL;
 		JsonArray *arr = fb_json_node_get_arr(croot, "$.nodes", NULL);
 		GList *elms = json_array_get_elements(arr);
 
@@ -2334,11 +2595,6 @@ fb_api_cb_contacts(G_GNUC_UNUSED SoupSession *session, SoupMessage *res,
 			}
 		}
 
-		g_signal_emit_by_name(api, "contacts-delta", added, removed);
-
-		g_slist_free_full(added, (GDestroyNotify) fb_api_user_free);
-		g_slist_free_full(removed, g_free);
-
 		g_list_free(elms);
 		json_array_unref(arr);
 	}
@@ -2364,11 +2620,16 @@ fb_api_cb_contacts(G_GNUC_UNUSED SoupSession *session, SoupMessage *res,
 			priv->contacts_delta = g_strdup(is_delta ? cursor : delta_cursor);
 		}
 
-		if (users) {
+		if (is_delta) {
+			g_signal_emit_by_name(api, "contacts-delta", added,
+			                      removed, complete);
+		} else if (users) {
 			g_signal_emit_by_name(api, "contacts", users, complete);
 		}
 
-		if (!complete) {
+		if (!complete && is_delta) {
+			fb_api_contacts_delta(api, cursor);
+		} else if (!complete) {
 			fb_api_contacts_after(api, cursor);
 		}
 	} else {
@@ -2376,12 +2637,66 @@ fb_api_cb_contacts(G_GNUC_UNUSED SoupSession *session, SoupMessage *res,
 	}
 
 	g_slist_free_full(users, (GDestroyNotify) fb_api_user_free);
+	g_slist_free_full(added, (GDestroyNotify) fb_api_user_free);
+	g_slist_free_full(removed, g_free);
 	g_object_unref(values);
 
 	json_node_free(croot);
 	json_node_free(root);
 }
 
+static gboolean
+fb_api_contacts_delta_rejected(SoupMessage *res)
+{
+	gboolean ret = FALSE;
+	gchar *str;
+	gint64 code;
+	JsonNode *node;
+	JsonNode *root;
+
+	root = fb_json_node_new(res->response_body->data,
+	                        res->response_body->length, NULL);
+
+	if (root == NULL) {
+		return FALSE;
+	}
+
+	node = fb_json_node_get(root, "$.error", NULL);
+
+	/* Authentication errors are not about the cursor */
+	if (node != NULL) {
+		str = fb_json_node_get_str(root, "$.error.type", NULL);
+		code = fb_json_node_get_int(root, "$.error_code", NULL);
+		ret = !purple_strequal(str, "OAuthException") && (code != 401);
+
+		json_node_free(node);
+		g_free(str);
+	}
+
+	json_node_free(root);
+	return ret;
+}
+
+static void
+fb_api_cb_contacts_delta(SoupSession *session, SoupMessage *res,
+                         gpointer data)
+{
+	FbApi *api = data;
+	FbApiPrivate *priv = api->priv;
+
+	if (fb_api_contacts_delta_rejected(res)) {
+		fb_util_debug_warning("Contacts cursor rejected, fetching "
+		                      "all contacts");
+
+		g_free(priv->contacts_delta);
+		priv->contacts_delta = NULL;
+		fb_api_contacts(api);
+		return;
+	}
+
+	fb_api_cb_contacts(session, res, data);
+}
+
 void
 fb_api_contacts(FbApi *api)
 {
@@ -2437,7 +2752,7 @@ fb_api_contacts_delta(FbApi *api, const gchar *delta_cursor)
 
 	fb_json_bldr_add_str(bldr, "2", G_STRINGIFY(FB_API_CONTACTS_COUNT));
 	fb_api_http_query(api, FB_API_QUERY_CONTACTS_DELTA, bldr,
-	                  fb_api_cb_contacts);
+	                  fb_api_cb_contacts_delta);
 }
 
 void
@@ -2543,9 +2858,11 @@ fb_api_publish(FbApi *api, const gchar *topic, const gchar *format, ...)
 	va_end(ap);
 
 	bytes = g_byte_array_new_take((guint8 *) msg, strlen(msg));
-	cytes = fb_util_zlib_deflate(bytes, &err);
+	cytes = g_byte_array_new();
+	fb_util_zlib_deflate(priv->zlib, bytes->data, bytes->len, cytes, &err);
 
 	FB_API_ERROR_EMIT(api, err,
+		g_byte_array_free(cytes, TRUE);
 		g_byte_array_free(bytes, TRUE);
 		return;
 	);
@@ -2963,57 +3280,64 @@ fb_api_cb_thread(G_GNUC_UNUSED SoupSession *session, SoupMessage *res,
 	FbApi *api = data;
 	FbApiThread thrd;
 	GError *err = NULL;
-	JsonNode *node;
+	GList *l;
+	GList *nodes;
 	JsonNode *root;
 
+	fb_api_lookup_done(res, api->priv->threada);
+
 	if (!fb_api_http_chk(api, res, &root)) {
 		return;
 	}
 
-	node = fb_json_node_get_nth(root, 0);
+	/* Each looked up thread is a member of the root */
+	nodes = json_object_get_values(json_node_get_object(root));
 
-	if (node == NULL) {
+	if (nodes == NULL) {
 		fb_api_error_literal(api, FB_API_ERROR_GENERAL,
 		                     _("Failed to obtain thread information"));
 		json_node_free(root);
 		return;
 	}
 
-	fb_api_thread_reset(&thrd, FALSE);
+	for (l = nodes; (l != NULL) && (err == NULL); l = l->next) {
+		fb_api_thread_reset(&thrd, FALSE);
 
-	if (!fb_api_thread_parse(api, &thrd, node, &err)) {
-		if (G_LIKELY(err == NULL)) {
-			if (thrd.tid) {
-				g_signal_emit_by_name(api, "thread-kicked", &thrd);
+		if (!fb_api_thread_parse(api, &thrd, l->data, &err)) {
+			if (G_LIKELY(err == NULL)) {
+				if (thrd.tid) {
+					g_signal_emit_by_name(api, "thread-kicked", &thrd);
+				} else {
+					fb_api_error_literal(api, FB_API_ERROR_GENERAL,
+					                     _("Failed to parse thread information"));
+				}
 			} else {
-				fb_api_error_literal(api, FB_API_ERROR_GENERAL,
-				                     _("Failed to parse thread information"));
+				g_signal_emit_by_name(api, "error", err);
 			}
 		} else {
-			fb_api_error_emit(api, err);
+			g_signal_emit_by_name(api, "thread", &thrd);
 		}
-	} else {
-		g_signal_emit_by_name(api, "thread", &thrd);
+
+		fb_api_thread_reset(&thrd, TRUE);
 	}
 
-	fb_api_thread_reset(&thrd, TRUE);
+	if (G_UNLIKELY(err != NULL)) {
+		g_error_free(err);
+	}
+
+	g_list_free(nodes);
 	json_node_free(root);
 }
 
 void
 fb_api_thread(FbApi *api, FbId tid)
 {
-	JsonBuilder *bldr;
+	FbApiPrivate *priv;
 
-	bldr = fb_json_bldr_new(JSON_NODE_OBJECT);
-	fb_json_bldr_arr_begin(bldr, "0");
-	fb_json_bldr_add_strf(bldr, NULL, "%" FB_ID_FORMAT, tid);
-	fb_json_bldr_arr_end(bldr);
+	g_return_if_fail(FB_IS_API(api));
+	priv = api->priv;
 
-	fb_json_bldr_add_str(bldr, "10", "false");
-	fb_json_bldr_add_str(bldr, "11", "false");
-	fb_json_bldr_add_str(bldr, "13", "false");
-	fb_api_http_query(api, FB_API_QUERY_THREAD, bldr, fb_api_cb_thread);
+	fb_api_lookup(api, tid, priv->threadp, priv->threada);
 }
 
 static void
@@ -322,6 +322,38 @@
  */
 #define FB_API_CONTACTS_COUNT  500
 
+/**
+ * FB_API_DELTAS_BATCH:
+ *
+ * The amount of deltas from a sync payload to handle before emitting
+ * the pending messages and events.
+ */
+#define FB_API_DELTAS_BATCH  100
+
+/**
+ * FB_API_ZBUF_MAX:
+ *
+ * The maximum size of the inflate buffer kept between MQTT payloads.
+ * Larger buffers are freed once the payload is handled.
+ */
+#define FB_API_ZBUF_MAX  0x40000 /* 256KiB */
+
+/**
+ * FB_API_LOOKUP_DELAY:
+ *
+ * The amount of time, in milliseconds, to collect contact and thread
+ * lookups for before sending them as a single request.
+ */
+#define FB_API_LOOKUP_DELAY  100
+
+/**
+ * FB_API_LOOKUP_MAX:
+ *
+ * The maximum amount of ids to look up in a single request. Reaching
+ * this sends the pending lookups immediately.
+ */
+#define FB_API_LOOKUP_MAX  50
+
 /**
  * FB_API_TCHK:
  * @e: The expression.
@@ -622,7 +654,9 @@ fb_api_auth(FbApi *api, const gchar *user, const gchar *pass);
  * @uid: The user #FbId.
  *
  * Sends a contact request. This will obtain the general information of
- * a single contact.
+ * a single contact. Requests are collected for #FB_API_LOOKUP_DELAY
+ * and sent together, requests for a contact already being looked up
+ * are ignored.
  */
 void
 fb_api_contact(FbApi *api, FbId uid);
@@ -632,7 +666,9 @@ fb_api_contact(FbApi *api, FbId uid);
  * @api: The #FbApi.
  *
  * Sends a contacts request. This will obtain a full list of detailed
- * contact information about the friends of the #FbApi user.
+ * contact information about the friends of the #FbApi user. When the
+ * #FbApi:cursor is set, only the changes since the cursor are fetched,
+ * falling back to the full list if the cursor is rejected.
  */
 void
 fb_api_contacts(FbApi *api);
@@ -707,7 +743,9 @@ fb_api_unread(FbApi *api);
  * @tid: The thread #FbId.
  *
  * Sends a thread request. This will obtain the general information of
- * a single thread.
+ * a single thread. Requests are collected for #FB_API_LOOKUP_DELAY
+ * and sent together, requests for a thread already being looked up
+ * are ignored.
  */
 void
 fb_api_thread(FbApi *api, FbId tid);
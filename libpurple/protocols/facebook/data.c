@@ -19,6 +19,9 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111-1301  USA
  */
 
+#include <errno.h>
+#include <fcntl.h>
+#include <glib/gstdio.h>
 #include <libsoup/soup.h>
 #include <string.h>
 
@@ -26,6 +29,7 @@
 
 #include "api.h"
 #include "data.h"
+#include "util.h"
 
 typedef struct
 {
@@ -33,12 +37,56 @@ typedef struct
 	SoupSession *cons;
 	PurpleConnection *gc;
 	PurpleRoomlist *roomlist;
-	GQueue *msgs;
+	GHashTable *msgs;
+	GQueue *msgq;
+	gsize msize;
+	gsize mmax;
+	gchar *sdir;
 	GHashTable *imgs;
+	GQueue *imgq;
+	GSList *imgl;
+	guint imga;
+	guint imgmax;
+	GCancellable *cancel;
+	gchar *cdir;
+	GHashTable *contacts;
+	GHashTable *pcontacts;
+	gchar *ccursor;
+	gboolean ccdirty;
+	FbDataFunc cfunc;
+	gpointer cdata;
 	GHashTable *unread;
 	GHashTable *evs;
 } FbDataPrivate;
 
+typedef struct
+{
+	gchar *key;
+	gsize size;
+} FbDataCacheEntry;
+
+/* The image cache is keyed by content, so it is shared by every account
+ * and lives for as long as any FbData does.
+ */
+typedef struct
+{
+	gchar *dir;
+	GHashTable *table;
+	GQueue queue;
+	gsize size;
+	guint refs;
+	guint save;
+} FbDataCache;
+
+typedef struct
+{
+	FbId uid;
+	GQueue *msgs;
+	gsize size;
+	gchar *spill;
+	GList *link;
+} FbDataMessages;
+
 /**
  * FbData:
  *
@@ -54,9 +102,11 @@ typedef struct
 {
 	FbData *fata;
 	gchar *url;
+	gchar *key;
 	FbDataImageFunc func;
 	gpointer data;
 	GDestroyNotify dunc;
+	GSList *dups;
 
 	gboolean active;
 	const guint8 *image;
@@ -84,14 +134,81 @@ static const gchar *fb_props_strs[] = {
 G_DEFINE_TYPE_WITH_PRIVATE(FbData, fb_data, G_TYPE_OBJECT);
 G_DEFINE_TYPE_WITH_PRIVATE(FbDataImage, fb_data_image, G_TYPE_OBJECT);
 
+static void
+fb_data_cache_entry_free(FbDataCacheEntry *entry)
+{
+	g_free(entry->key);
+	g_free(entry);
+}
+
+static void
+fb_data_messages_free(FbDataMessages *msgs)
+{
+	g_queue_free_full(msgs->msgs, (GDestroyNotify) fb_api_message_free);
+
+	if (msgs->spill != NULL) {
+		g_unlink(msgs->spill);
+		g_free(msgs->spill);
+	}
+
+	g_free(msgs);
+}
+
+static void fb_data_cache_ref(void);
+static void fb_data_cache_unref(void);
+
+static void
+fb_data_spill_clear(const gchar *dir)
+{
+	const gchar *name;
+	gchar *path;
+	GDir *gdir;
+
+	gdir = g_dir_open(dir, 0, NULL);
+
+	if (gdir == NULL) {
+		return;
+	}
+
+	while ((name = g_dir_read_name(gdir)) != NULL) {
+		path = g_build_filename(dir, name, NULL);
+		g_unlink(path);
+		g_free(path);
+	}
+
+	g_dir_close(gdir);
+	g_rmdir(dir);
+}
+
 static void
 fb_data_dispose(GObject *obj)
 {
-	FbDataPrivate *priv = FB_DATA(obj)->priv;
+	FbData *fata = FB_DATA(obj);
+	FbDataImage *img;
+	FbDataPrivate *priv = fata->priv;
 	GHashTableIter iter;
+	GSList *l;
+	GSList *m;
 	gpointer ptr;
 
 	soup_session_abort(priv->cons);
+	g_cancellable_cancel(priv->cancel);
+	fb_data_cache_unref();
+
+	/* Images still loading from the cache outlive the FbData, they
+	 * are freed once their cancelled loads return.
+	 */
+	for (l = priv->imgl; l != NULL; l = l->next) {
+		img = l->data;
+		g_hash_table_remove(priv->imgs, img->priv->url);
+		img->priv->fata = NULL;
+
+		for (m = img->priv->dups; m != NULL; m = m->next) {
+			FB_DATA_IMAGE(m->data)->priv->fata = NULL;
+		}
+	}
+
+	g_slist_free(priv->imgl);
 	g_hash_table_iter_init(&iter, priv->evs);
 
 	while (g_hash_table_iter_next(&iter, NULL, &ptr)) {
@@ -103,9 +220,18 @@ fb_data_dispose(GObject *obj)
 	}
 
 	g_object_unref(priv->cons);
-	g_queue_free_full(priv->msgs, (GDestroyNotify) fb_api_message_free);
-
+	g_object_unref(priv->cancel);
+	g_queue_free(priv->msgq);
+	g_queue_free_full(priv->imgq, g_object_unref);
+	g_free(priv->cdir);
+	g_free(priv->ccursor);
+
+	g_hash_table_destroy(priv->msgs);
+	fb_data_spill_clear(priv->sdir);
+	g_free(priv->sdir);
 	g_hash_table_destroy(priv->imgs);
+	g_hash_table_destroy(priv->contacts);
+	g_hash_table_destroy(priv->pcontacts);
 	g_hash_table_destroy(priv->unread);
 	g_hash_table_destroy(priv->evs);
 }
@@ -124,14 +250,25 @@ fb_data_init(FbData *fata)
 	FbDataPrivate *priv = fb_data_get_instance_private(fata);
 	fata->priv = priv;
 
-	priv->msgs = g_queue_new();
-
-	priv->imgs = g_hash_table_new_full(g_direct_hash, g_direct_equal,
-	                                   g_object_unref, NULL);
+	priv->msgs = g_hash_table_new_full(fb_id_hash, fb_id_equal, NULL,
+	                                   (GDestroyNotify) fb_data_messages_free);
+	priv->msgq = g_queue_new();
+	priv->mmax = FB_DATA_MESSAGES_SIZE_MAX;
+
+	priv->imgs = g_hash_table_new(g_str_hash, g_str_equal);
+	priv->imgq = g_queue_new();
+	priv->imgmax = FB_DATA_ICON_MAX;
+	priv->cancel = g_cancellable_new();
+	priv->contacts = g_hash_table_new_full(fb_id_hash, fb_id_equal, NULL,
+	                                       (GDestroyNotify) fb_api_user_free);
+	priv->pcontacts = g_hash_table_new_full(fb_id_hash, fb_id_equal, NULL,
+	                                        (GDestroyNotify) fb_api_user_free);
 	priv->unread = g_hash_table_new_full(fb_id_hash, fb_id_equal,
 	                                     g_free, NULL);
 	priv->evs = g_hash_table_new_full(g_str_hash, g_str_equal,
 					  g_free, NULL);
+
+	fb_data_cache_ref();
 }
 
 static void
@@ -143,10 +280,23 @@ fb_data_image_dispose(GObject *obj)
 
 	if ((priv->dunc != NULL) && (priv->data != NULL)) {
 		priv->dunc(priv->data);
+		priv->data = NULL;
+	}
+
+	g_slist_free_full(priv->dups, g_object_unref);
+	priv->dups = NULL;
+
+	if ((fata != NULL) && (priv->url != NULL) &&
+	    (g_hash_table_lookup(fata->priv->imgs, priv->url) == img))
+	{
+		g_hash_table_remove(fata->priv->imgs, priv->url);
 	}
 
 	g_free(priv->url);
-	g_hash_table_steal(fata->priv->imgs, img);
+	priv->url = NULL;
+
+	g_free(priv->key);
+	priv->key = NULL;
 }
 
 static void
@@ -164,20 +314,420 @@ fb_data_image_init(FbDataImage *img)
 	img->priv = priv;
 }
 
+static FbDataCache *fb_data_cache = NULL;
+
+static void
+fb_data_cache_insert(gchar *key, gsize size)
+{
+	FbDataCache *cache = fb_data_cache;
+	FbDataCacheEntry *entry;
+
+	entry = g_new0(FbDataCacheEntry, 1);
+	entry->key = key;
+	entry->size = size;
+
+	g_queue_push_tail(&cache->queue, entry);
+	g_hash_table_insert(cache->table, entry->key, cache->queue.tail);
+	cache->size += size;
+}
+
+static void
+fb_data_cache_save(void)
+{
+	FbDataCache *cache = fb_data_cache;
+	FbDataCacheEntry *entry;
+	gchar *path;
+	GList *l;
+	GString *gstr;
+
+	if (cache->save != 0) {
+		g_source_remove(cache->save);
+		cache->save = 0;
+	}
+
+	gstr = g_string_new(NULL);
+
+	for (l = cache->queue.head; l != NULL; l = l->next) {
+		entry = l->data;
+		g_string_append_printf(gstr, "%s %" G_GSIZE_FORMAT "\n",
+		                       entry->key, entry->size);
+	}
+
+	path = g_build_filename(cache->dir, FB_DATA_CACHE_INDEX, NULL);
+	purple_util_write_data_to_file_deferred(path,
+	                                        g_string_free_to_bytes(gstr));
+	g_free(path);
+}
+
+static gboolean
+fb_data_cache_save_cb(gpointer data)
+{
+	fb_data_cache->save = 0;
+	fb_data_cache_save();
+	return FALSE;
+}
+
+static void
+fb_data_cache_changed(void)
+{
+	FbDataCache *cache = fb_data_cache;
+
+	/* Saved shortly after, so a crash loses little */
+	if (cache->save == 0) {
+		cache->save = g_timeout_add_seconds(FB_DATA_CACHE_SAVE_DELAY,
+		                                    fb_data_cache_save_cb,
+		                                    NULL);
+	}
+}
+
+static void
+fb_data_cache_remove(GList *link)
+{
+	FbDataCache *cache = fb_data_cache;
+	FbDataCacheEntry *entry = link->data;
+	gchar *path;
+
+	path = g_build_filename(cache->dir, entry->key, NULL);
+	g_unlink(path);
+	g_free(path);
+
+	g_hash_table_remove(cache->table, entry->key);
+	g_queue_delete_link(&cache->queue, link);
+	cache->size -= entry->size;
+	fb_data_cache_entry_free(entry);
+	fb_data_cache_changed();
+}
+
+static void
+fb_data_cache_load(void)
+{
+	FbDataCache *cache = fb_data_cache;
+	gchar **lines;
+	gchar **parts;
+	gchar *data;
+	gchar *path;
+	guint i;
+	guint64 size;
+
+	path = g_build_filename(cache->dir, FB_DATA_CACHE_INDEX, NULL);
+
+	if (!g_file_get_contents(path, &data, NULL, NULL)) {
+		g_free(path);
+		return;
+	}
+
+	lines = g_strsplit(data, "\n", -1);
+
+	/* Each line is "<key> <size>", least recently used first */
+	for (i = 0; lines[i] != NULL; i++) {
+		parts = g_strsplit(lines[i], " ", 2);
+
+		if ((g_strv_length(parts) == 2) &&
+		    (strlen(parts[0]) == 40) &&
+		    fb_util_strtest(parts[0], G_ASCII_XDIGIT) &&
+		    !g_hash_table_contains(cache->table, parts[0]))
+		{
+			size = g_ascii_strtoull(parts[1], NULL, 10);
+			fb_data_cache_insert(g_strdup(parts[0]), size);
+		}
+
+		g_strfreev(parts);
+	}
+
+	g_strfreev(lines);
+	g_free(data);
+	g_free(path);
+}
+
+static void
+fb_data_cache_ref(void)
+{
+	if (fb_data_cache == NULL) {
+		fb_data_cache = g_new0(FbDataCache, 1);
+		fb_data_cache->dir = g_build_filename(purple_cache_dir(),
+		                                      "facebook", NULL);
+		fb_data_cache->table = g_hash_table_new(g_str_hash,
+		                                        g_str_equal);
+		g_queue_init(&fb_data_cache->queue);
+		fb_data_cache_load();
+	}
+
+	fb_data_cache->refs++;
+}
+
+static void
+fb_data_cache_unref(void)
+{
+	FbDataCache *cache = fb_data_cache;
+
+	g_return_if_fail(cache != NULL);
+
+	if (--cache->refs > 0) {
+		return;
+	}
+
+	if (cache->save != 0) {
+		fb_data_cache_save();
+	}
+
+	g_queue_foreach(&cache->queue, (GFunc) fb_data_cache_entry_free,
+	                NULL);
+	g_queue_clear(&cache->queue);
+	g_hash_table_destroy(cache->table);
+	g_free(cache->dir);
+	g_free(cache);
+	fb_data_cache = NULL;
+}
+
+static gchar *
+fb_data_cache_key(const gchar *url)
+{
+	const gchar *csum;
+	FbHttpParams *params;
+	gchar *ret;
+
+	/* Keyed by the Facebook checksum, which is shared by every URL
+	 * to the same content, otherwise the URL.
+	 */
+	params = fb_http_params_new_parse(url, TRUE);
+	csum = fb_http_params_get_str(params, "oh", NULL);
+
+	if (csum == NULL) {
+		csum = url;
+	}
+
+	ret = g_compute_checksum_for_string(G_CHECKSUM_SHA1, csum, -1);
+	fb_http_params_free(params);
+	return ret;
+}
+
+static void
+fb_data_cache_touch(const gchar *key)
+{
+	FbDataCache *cache = fb_data_cache;
+	GList *link;
+
+	link = g_hash_table_lookup(cache->table, key);
+
+	/* Mark as the most recently used, unless evicted meanwhile */
+	if (link != NULL) {
+		g_queue_unlink(&cache->queue, link);
+		g_queue_push_tail_link(&cache->queue, link);
+		fb_data_cache_changed();
+	}
+}
+
+static void
+fb_data_cache_forget(const gchar *key)
+{
+	GList *link;
+
+	link = g_hash_table_lookup(fb_data_cache->table, key);
+
+	if (link != NULL) {
+		fb_data_cache_remove(link);
+	}
+}
+
+static void
+fb_data_cache_store(const gchar *key, const guint8 *data, gsize size)
+{
+	FbDataCache *cache = fb_data_cache;
+	gchar *path;
+
+	if ((size < 1) || (size > FB_DATA_CACHE_SIZE_MAX) ||
+	    g_hash_table_contains(cache->table, key))
+	{
+		return;
+	}
+
+	/* Written in the background, a load racing the write fails and
+	 * drops the entry, which only costs a fetch.
+	 */
+	path = g_build_filename(cache->dir, key, NULL);
+	purple_util_write_data_to_file_deferred(path, g_bytes_new(data, size));
+	fb_data_cache_insert(g_strdup(key), size);
+	fb_data_cache_changed();
+	g_free(path);
+
+	/* Evict the least recently used entries */
+	while ((cache->size > FB_DATA_CACHE_SIZE_MAX) &&
+	       (cache->queue.head != NULL))
+	{
+		fb_data_cache_remove(cache->queue.head);
+	}
+}
+
+static gchar *
+fb_data_contacts_path(FbData *fata, FbId uid)
+{
+	gchar *name;
+	gchar *ret;
+
+	name = g_strdup_printf("contacts-%" FB_ID_FORMAT, uid);
+	ret = g_build_filename(fata->priv->cdir, name, NULL);
+
+	g_free(name);
+	return ret;
+}
+
+static void
+fb_data_contacts_parse(FbData *fata, gchar *data, gsize size)
+{
+	const gchar *csum;
+	const gchar *cursor;
+	const gchar *icon;
+	const gchar *name;
+	FbApiUser *user;
+	FbDataPrivate *priv = fata->priv;
+	gint64 id;
+	guint32 version;
+	GVariant *snap;
+	GVariantIter *iter;
+
+	snap = g_variant_new_from_data(G_VARIANT_TYPE(FB_DATA_CONTACTS_TYPE),
+	                               data, size, FALSE, g_free, data);
+	g_variant_ref_sink(snap);
+	g_variant_get(snap, "(u&sa(x&s&s&s))", &version, &cursor, &iter);
+
+	if ((version == FB_DATA_CONTACTS_VERSION) && (*cursor != '\0')) {
+		while (g_variant_iter_next(iter, "(x&s&s&s)", &id, &name,
+		                           &icon, &csum))
+		{
+			user = fb_api_user_dup(NULL, FALSE);
+			user->uid = id;
+			user->name = (*name != '\0') ? g_strdup(name) : NULL;
+			user->icon = (*icon != '\0') ? g_strdup(icon) : NULL;
+			user->csum = (*csum != '\0') ? g_strdup(csum) : NULL;
+			g_hash_table_replace(priv->contacts, &user->uid, user);
+		}
+
+		/* The cursor is only valid against this contact list */
+		g_free(priv->ccursor);
+		priv->ccursor = g_strdup(cursor);
+		g_object_set(priv->api, "cursor", cursor, NULL);
+	}
+
+	g_variant_iter_free(iter);
+	g_variant_unref(snap);
+}
+
+static void
+fb_data_contacts_cb_load(GObject *source, GAsyncResult *res, gpointer data)
+{
+	FbData *fata = data;
+	FbDataFunc func;
+	FbDataPrivate *priv;
+	gchar *contents;
+	gsize size;
+	GError *err = NULL;
+
+	if (g_file_load_contents_finish(G_FILE(source), res, &contents, &size,
+	                                NULL, &err))
+	{
+		fb_data_contacts_parse(fata, contents, size);
+	} else if (g_error_matches(err, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+		/* The FbData is already gone */
+		g_error_free(err);
+		return;
+	} else {
+		/* Without a snapshot the full list is fetched */
+		g_error_free(err);
+	}
+
+	priv = fata->priv;
+	func = priv->cfunc;
+	priv->cfunc = NULL;
+	func(fata, priv->cdata);
+}
+
+static void
+fb_data_contacts_save(FbData *fata, FbId uid)
+{
+	FbApiUser *user;
+	FbDataPrivate *priv = fata->priv;
+	gchar *cursor;
+	gchar *path;
+	GHashTableIter iter;
+	GVariant *snap;
+	GVariantBuilder bldr;
+
+	g_object_get(priv->api, "cursor", &cursor, NULL);
+
+	if (!priv->ccdirty && purple_strequal(cursor, priv->ccursor)) {
+		g_free(cursor);
+		return;
+	}
+
+	if (uid == 0) {
+		g_free(cursor);
+		return;
+	}
+
+	g_variant_builder_init(&bldr, G_VARIANT_TYPE("a(xsss)"));
+	g_hash_table_iter_init(&iter, priv->contacts);
+
+	while (g_hash_table_iter_next(&iter, NULL, (gpointer) &user)) {
+		g_variant_builder_add(&bldr, "(xsss)", user->uid,
+		                      user->name ? user->name : "",
+		                      user->icon ? user->icon : "",
+		                      user->csum ? user->csum : "");
+	}
+
+	snap = g_variant_new("(usa(xsss))", FB_DATA_CONTACTS_VERSION,
+	                     cursor ? cursor : "", &bldr);
+	g_variant_ref_sink(snap);
+
+	path = fb_data_contacts_path(fata, uid);
+	purple_util_write_data_to_file_deferred(path,
+	                                        g_variant_get_data_as_bytes(snap));
+
+	g_free(priv->ccursor);
+	priv->ccursor = cursor;
+	priv->ccdirty = FALSE;
+
+	g_variant_unref(snap);
+	g_free(path);
+}
+
 FbData *
 fb_data_new(PurpleConnection *gc, GProxyResolver *resolver)
 {
 	FbData *fata;
 	FbDataPrivate *priv;
+	const gchar *name;
+	gint max;
+	PurpleAccount *acct;
 
 	fata = g_object_new(FB_TYPE_DATA, NULL);
 	priv = fata->priv;
 
+	acct = purple_connection_get_account(gc);
+	max = purple_account_get_int(acct, "image-fetch-max", FB_DATA_ICON_MAX);
+	priv->imgmax = CLAMP(max, 1, FB_DATA_ICON_MAX_LIMIT);
+
+	max = purple_account_get_int(acct, "pending-messages-max",
+	                             FB_DATA_MESSAGES_SIZE_MAX / 1024);
+	priv->mmax = (gsize) MAX(max, 1) * 1024;
+
+	/* Spill files are per account, any left by a crash are stale */
+	name = purple_escape_filename(purple_normalize(acct,
+	                              purple_account_get_username(acct)));
+	priv->sdir = g_build_filename(purple_cache_dir(), "facebook", "spill",
+	                              name, NULL);
+	fb_data_spill_clear(priv->sdir);
+
+	/* Keep-alive connections are reused per host by the session */
 	priv->cons = soup_session_new_with_options(SOUP_SESSION_PROXY_RESOLVER,
-	                                           resolver, NULL);
+	                                           resolver,
+	                                           SOUP_SESSION_MAX_CONNS_PER_HOST,
+	                                           priv->imgmax,
+	                                           NULL);
 	priv->api = fb_api_new(gc, resolver);
 	priv->gc = gc;
 
+	priv->cdir = g_build_filename(purple_cache_dir(), "facebook", NULL);
+
 	return fata;
 }
 
@@ -239,6 +789,38 @@ fb_data_load(FbData *fata)
 	return ret;
 }
 
+void
+fb_data_load_contacts(FbData *fata, FbDataFunc func, gpointer data)
+{
+	FbDataPrivate *priv;
+	FbId uid;
+	gchar *path;
+	GFile *file;
+
+	g_return_if_fail(FB_IS_DATA(fata));
+	g_return_if_fail(func != NULL);
+	priv = fata->priv;
+	g_return_if_fail(priv->cfunc == NULL);
+
+	g_object_get(priv->api, "uid", &uid, NULL);
+
+	if (uid == 0) {
+		func(fata, data);
+		return;
+	}
+
+	priv->cfunc = func;
+	priv->cdata = data;
+
+	path = fb_data_contacts_path(fata, uid);
+	file = g_file_new_for_path(path);
+	g_file_load_contents_async(file, priv->cancel,
+	                           fb_data_contacts_cb_load, fata);
+
+	g_object_unref(file);
+	g_free(path);
+}
+
 void
 fb_data_save(FbData *fata)
 {
@@ -284,6 +866,80 @@ fb_data_save(FbData *fata)
 	dup = g_strdup_printf("%" FB_ID_FORMAT, uint);
 	purple_account_set_string(acct, "uid", dup);
 	g_free(dup);
+
+	fb_data_contacts_save(fata, uint);
+}
+
+void
+fb_data_add_contacts(FbData *fata, GSList *users, gboolean complete)
+{
+	FbApiUser *user;
+	FbDataPrivate *priv;
+	GHashTable *swap;
+	GSList *l;
+
+	g_return_if_fail(FB_IS_DATA(fata));
+	priv = fata->priv;
+
+	for (l = users; l != NULL; l = l->next) {
+		user = fb_api_user_dup(l->data, TRUE);
+		g_hash_table_replace(priv->pcontacts, &user->uid, user);
+	}
+
+	if (!complete) {
+		return;
+	}
+
+	/* The full list replaces the previous one once complete */
+	swap = priv->contacts;
+	priv->contacts = priv->pcontacts;
+	priv->pcontacts = swap;
+
+	g_hash_table_remove_all(priv->pcontacts);
+	priv->ccdirty = TRUE;
+}
+
+void
+fb_data_update_contacts(FbData *fata, GSList *added, GSList *removed)
+{
+	FbApiUser *user;
+	FbDataPrivate *priv;
+	FbId uid;
+	GSList *l;
+
+	g_return_if_fail(FB_IS_DATA(fata));
+	priv = fata->priv;
+
+	for (l = added; l != NULL; l = l->next) {
+		user = fb_api_user_dup(l->data, TRUE);
+		g_hash_table_replace(priv->contacts, &user->uid, user);
+	}
+
+	for (l = removed; l != NULL; l = l->next) {
+		uid = FB_ID_FROM_STR(l->data);
+		g_hash_table_remove(priv->contacts, &uid);
+	}
+
+	priv->ccdirty = TRUE;
+}
+
+GSList *
+fb_data_get_contacts(FbData *fata)
+{
+	FbDataPrivate *priv;
+	GHashTableIter iter;
+	gpointer user;
+	GSList *users = NULL;
+
+	g_return_val_if_fail(FB_IS_DATA(fata), NULL);
+	priv = fata->priv;
+	g_hash_table_iter_init(&iter, priv->contacts);
+
+	while (g_hash_table_iter_next(&iter, NULL, &user)) {
+		users = g_slist_prepend(users, user);
+	}
+
+	return users;
 }
 
 void
@@ -401,54 +1057,275 @@ fb_data_set_unread(FbData *fata, FbId id, gboolean unread)
 	g_hash_table_replace(priv->unread, key, GINT_TO_POINTER(unread));
 }
 
+static gsize
+fb_data_message_size(const FbApiMessage *msg)
+{
+	gsize size = sizeof *msg;
+
+	if (msg->text != NULL) {
+		size += strlen(msg->text) + 1;
+	}
+
+	return size;
+}
+
+static gint
+fb_data_message_cmp(gconstpointer a, gconstpointer b)
+{
+	const FbApiMessage *msga = a;
+	const FbApiMessage *msgb = b;
+
+	return (msga->tstamp > msgb->tstamp) - (msga->tstamp < msgb->tstamp);
+}
+
+static gboolean
+fb_data_messages_spill(FbData *fata, FbDataMessages *msgs)
+{
+	FbApiMessage *msg;
+	FbDataPrivate *priv = fata->priv;
+	FILE *file;
+	GByteArray *bytes;
+	gint fd;
+	gint64 i64;
+	GList *l;
+	guint32 u32;
+
+	if (msgs->spill == NULL) {
+		/* Message text stays private to the user, not in a shared /tmp */
+		if (g_mkdir_with_parents(priv->sdir, S_IRWXU) != 0) {
+			fb_util_debug_warning("Failed to create %s: %s",
+			                      priv->sdir, g_strerror(errno));
+			return FALSE;
+		}
+
+		msgs->spill = g_build_filename(priv->sdir, "messages-XXXXXX",
+		                               NULL);
+		fd = g_mkstemp_full(msgs->spill, O_RDWR | O_CREAT | O_EXCL,
+		                    S_IRUSR | S_IWUSR);
+
+		if (fd < 0) {
+			fb_util_debug_warning("Failed to spill messages: %s",
+			                      g_strerror(errno));
+			g_free(msgs->spill);
+			msgs->spill = NULL;
+			return FALSE;
+		}
+
+		g_close(fd, NULL);
+	}
+
+	/* Host order records: tid, tstamp, flags, text size, text */
+	bytes = g_byte_array_new();
+
+	for (l = msgs->msgs->head; l != NULL; l = l->next) {
+		msg = l->data;
+
+		i64 = msg->tid;
+		g_byte_array_append(bytes, (guint8 *) &i64, sizeof i64);
+		i64 = msg->tstamp;
+		g_byte_array_append(bytes, (guint8 *) &i64, sizeof i64);
+		u32 = msg->flags;
+		g_byte_array_append(bytes, (guint8 *) &u32, sizeof u32);
+		u32 = (msg->text != NULL) ? strlen(msg->text) : G_MAXUINT32;
+		g_byte_array_append(bytes, (guint8 *) &u32, sizeof u32);
+
+		if (msg->text != NULL) {
+			g_byte_array_append(bytes, (guint8 *) msg->text, u32);
+		}
+	}
+
+	file = g_fopen(msgs->spill, "ab");
+
+	if ((file == NULL) ||
+	    (fwrite(bytes->data, 1, bytes->len, file) != bytes->len))
+	{
+		fb_util_debug_warning("Failed to spill messages to %s",
+		                      msgs->spill);
+
+		if (file != NULL) {
+			fclose(file);
+		}
+
+		g_byte_array_unref(bytes);
+		return FALSE;
+	}
+
+	fclose(file);
+	g_byte_array_unref(bytes);
+
+	g_queue_free_full(msgs->msgs, (GDestroyNotify) fb_api_message_free);
+	msgs->msgs = g_queue_new();
+	priv->msize -= msgs->size;
+	msgs->size = 0;
+
+	g_queue_delete_link(priv->msgq, msgs->link);
+	msgs->link = NULL;
+	return TRUE;
+}
+
+static GSList *
+fb_data_messages_unspill(FbDataMessages *msgs, GSList *list)
+{
+	FbApiMessage *msg;
+	gchar *data;
+	gint64 i64;
+	gsize size;
+	gsize pos = 0;
+	guint32 u32;
+
+	if (!g_file_get_contents(msgs->spill, &data, &size, NULL)) {
+		fb_util_debug_warning("Failed to read spilled messages from %s",
+		                      msgs->spill);
+		return list;
+	}
+
+	while ((size - pos) >= ((sizeof i64 * 2) + (sizeof u32 * 2))) {
+		msg = fb_api_message_dup(NULL, FALSE);
+		msg->uid = msgs->uid;
+
+		memcpy(&i64, data + pos, sizeof i64);
+		msg->tid = i64;
+		pos += sizeof i64;
+		memcpy(&i64, data + pos, sizeof i64);
+		msg->tstamp = i64;
+		pos += sizeof i64;
+		memcpy(&u32, data + pos, sizeof u32);
+		msg->flags = u32;
+		pos += sizeof u32;
+		memcpy(&u32, data + pos, sizeof u32);
+		pos += sizeof u32;
+
+		if (u32 != G_MAXUINT32) {
+			if (u32 > (size - pos)) {
+				fb_api_message_free(msg);
+				break;
+			}
+
+			msg->text = g_strndup(data + pos, u32);
+			pos += u32;
+		}
+
+		list = g_slist_prepend(list, msg);
+	}
+
+	g_free(data);
+	return list;
+}
+
 void
 fb_data_add_message(FbData *fata, FbApiMessage *msg)
 {
+	FbDataMessages *msgs;
 	FbDataPrivate *priv;
+	gsize size;
+	GList *l;
 
 	g_return_if_fail(FB_IS_DATA(fata));
 	priv = fata->priv;
+	msgs = g_hash_table_lookup(priv->msgs, &msg->uid);
+
+	if (msgs == NULL) {
+		msgs = g_new0(FbDataMessages, 1);
+		msgs->uid = msg->uid;
+		msgs->msgs = g_queue_new();
+		g_hash_table_insert(priv->msgs, &msgs->uid, msgs);
+	}
+
+	/* Messages mostly arrive in order, search from the newest */
+	for (l = msgs->msgs->tail; l != NULL; l = l->prev) {
+		if (fb_data_message_cmp(l->data, msg) <= 0) {
+			break;
+		}
+	}
+
+	if (l != NULL) {
+		g_queue_insert_after(msgs->msgs, l, msg);
+	} else {
+		g_queue_push_head(msgs->msgs, msg);
+	}
+
+	size = fb_data_message_size(msg);
+	msgs->size += size;
+	priv->msize += size;
+
+	if (msgs->link == NULL) {
+		g_queue_push_tail(priv->msgq, msgs);
+		msgs->link = priv->msgq->tail;
+	}
 
-	g_queue_push_tail(priv->msgs, msg);
+	/* Spill the senders pending for the longest */
+	while ((priv->msize > priv->mmax) && (priv->msgq->head != NULL)) {
+		if (!fb_data_messages_spill(fata, priv->msgq->head->data)) {
+			break;
+		}
+	}
 }
 
 void
 fb_data_remove_message(FbData *fata, FbApiMessage *msg)
 {
+	FbDataMessages *msgs;
 	FbDataPrivate *priv;
+	gsize size;
 
 	g_return_if_fail(FB_IS_DATA(fata));
 	priv = fata->priv;
+	msgs = g_hash_table_lookup(priv->msgs, &msg->uid);
+
+	if ((msgs == NULL) || !g_queue_remove(msgs->msgs, msg)) {
+		return;
+	}
+
+	size = fb_data_message_size(msg);
+	msgs->size -= size;
+	priv->msize -= size;
+
+	if ((msgs->msgs->length == 0) && (msgs->link != NULL)) {
+		g_queue_delete_link(priv->msgq, msgs->link);
+		msgs->link = NULL;
+	}
 
-	g_queue_remove(priv->msgs, msg);
+	if ((msgs->msgs->length == 0) && (msgs->spill == NULL)) {
+		g_hash_table_remove(priv->msgs, &msgs->uid);
+	}
 }
 
 GSList *
 fb_data_take_messages(FbData *fata, FbId uid)
 {
 	FbApiMessage *msg;
+	FbDataMessages *msgs;
 	FbDataPrivate *priv;
-	GList *l;
-	GList *prev;
-	GSList *msgs = NULL;
+	GSList *list = NULL;
 
 	g_return_val_if_fail(FB_IS_DATA(fata), NULL);
 	priv = fata->priv;
-	l = priv->msgs->tail;
+	msgs = g_hash_table_lookup(priv->msgs, &uid);
 
-	while (l != NULL) {
-		msg = l->data;
-		prev = l->prev;
+	if (msgs == NULL) {
+		return NULL;
+	}
 
-		if (msg->uid == uid) {
-			msgs = g_slist_prepend(msgs, msg);
-			g_queue_delete_link(priv->msgs, l);
-		}
+	if (msgs->spill != NULL) {
+		list = fb_data_messages_unspill(msgs, list);
+	}
+
+	while ((msg = g_queue_pop_head(msgs->msgs)) != NULL) {
+		list = g_slist_prepend(list, msg);
+	}
 
-		l = prev;
+	if (msgs->link != NULL) {
+		g_queue_delete_link(priv->msgq, msgs->link);
 	}
 
-	return msgs;
+	priv->msize -= msgs->size;
+	g_hash_table_remove(priv->msgs, &uid);
+
+	/* Spilled messages come first, the stable sort keeps them ahead
+	 * of messages with the same timestamp.
+	 */
+	list = g_slist_reverse(list);
+	return g_slist_sort(list, fb_data_message_cmp);
 }
 
 FbDataImage *
@@ -456,11 +1333,14 @@ fb_data_image_add(FbData *fata, const gchar *url, FbDataImageFunc func,
                   gpointer data, GDestroyNotify dunc)
 {
 	FbDataImage *img;
+	FbDataImage *orig;
 	FbDataImagePrivate *priv;
+	FbDataPrivate *driv;
 
 	g_return_val_if_fail(FB_IS_DATA(fata), NULL);
 	g_return_val_if_fail(url != NULL, NULL);
 	g_return_val_if_fail(func != NULL, NULL);
+	driv = fata->priv;
 
 	img = g_object_new(FB_TYPE_DATA_IMAGE, NULL);
 	priv = img->priv;
@@ -471,7 +1351,18 @@ fb_data_image_add(FbData *fata, const gchar *url, FbDataImageFunc func,
 	priv->data = data;
 	priv->dunc = dunc;
 
-	g_hash_table_insert(fata->priv->imgs, img, img);
+	orig = g_hash_table_lookup(driv->imgs, url);
+
+	/* Share the fetch of an identical URL which is still pending */
+	if (orig != NULL) {
+		priv->active = orig->priv->active;
+		orig->priv->dups = g_slist_prepend(orig->priv->dups, img);
+		return img;
+	}
+
+	priv->key = fb_data_cache_key(url);
+	g_hash_table_insert(driv->imgs, priv->url, img);
+	g_queue_push_tail(driv->imgq, img);
 	return img;
 }
 
@@ -553,70 +1444,207 @@ fb_data_image_get_url(FbDataImage *img)
 	return priv->url;
 }
 
+static void
+fb_data_image_cb_chunk(SoupMessage *msg, SoupBuffer *chunk, gpointer data)
+{
+	FbDataImage *img = data;
+	FbDataPrivate *driv = img->priv->fata->priv;
+
+	/* The body already includes the chunk */
+	if (msg->response_body->length > FB_DATA_ICON_SIZE_MAX) {
+		soup_session_cancel_message(driv->cons, msg,
+		                            SOUP_STATUS_MALFORMED);
+	}
+}
+
+static void
+fb_data_image_cb_headers(SoupMessage *msg, gpointer data)
+{
+	FbDataImage *img = data;
+	FbDataPrivate *driv = img->priv->fata->priv;
+	goffset size;
+
+	size = soup_message_headers_get_content_length(msg->response_headers);
+
+	if (size > FB_DATA_ICON_SIZE_MAX) {
+		soup_session_cancel_message(driv->cons, msg,
+		                            SOUP_STATUS_MALFORMED);
+	}
+}
+
+static void
+fb_data_image_done(FbDataImage *img, const guint8 *image, gsize size,
+                   GError *error)
+{
+	FbDataImage *dimg;
+	FbDataImagePrivate *priv = img->priv;
+	GSList *dups;
+	GSList *l;
+
+	/* Later requests for the URL need a new fetch */
+	g_hash_table_remove(priv->fata->priv->imgs, priv->url);
+	dups = g_slist_reverse(priv->dups);
+	dups = g_slist_prepend(dups, img);
+	priv->dups = NULL;
+
+	for (l = dups; l != NULL; l = l->next) {
+		dimg = l->data;
+		dimg->priv->image = image;
+		dimg->priv->size = size;
+		dimg->priv->func(dimg, error);
+	}
+
+	g_slist_free_full(dups, g_object_unref);
+}
+
 static void
 fb_data_image_cb(G_GNUC_UNUSED SoupSession *session, SoupMessage *res,
                  gpointer data)
 {
+	FbData *fata;
 	FbDataImage *img = data;
-	FbDataImagePrivate *priv = img->priv;
 	GError *err = NULL;
 
-	fb_http_error_chk(res, &err);
+	fata = img->priv->fata;
+	fata->priv->imga--;
 
-	priv->image = (guint8 *)res->response_body->data;
-	priv->size = res->response_body->length;
-	priv->func(img, err);
+	if (fb_http_error_chk(res, &err)) {
+		fb_data_cache_store(img->priv->key,
+		                    (guint8 *) res->response_body->data,
+		                    res->response_body->length);
+	}
 
-	if (G_LIKELY(err == NULL)) {
-		fb_data_image_queue(priv->fata);
-	} else {
+	fb_data_image_done(img, (guint8 *) res->response_body->data,
+	                   res->response_body->length, err);
+
+	if (err != NULL) {
 		g_error_free(err);
 	}
 
-	g_object_unref(img);
+	/* Nothing more is fetched once the session is aborted */
+	if (res->status_code != SOUP_STATUS_CANCELLED) {
+		fb_data_image_queue(fata);
+	}
 }
 
-void
-fb_data_image_queue(FbData *fata)
+static void
+fb_data_image_fetch(FbData *fata, FbDataImage *img)
 {
-	const gchar *url;
-	FbDataImage *img;
+	FbDataPrivate *priv = fata->priv;
+	GError *err;
+	GSList *l;
+	SoupMessage *msg;
+
+	img->priv->active = TRUE;
+
+	for (l = img->priv->dups; l != NULL; l = l->next) {
+		FB_DATA_IMAGE(l->data)->priv->active = TRUE;
+	}
+
+	msg = soup_message_new("GET", img->priv->url);
+
+	if (G_UNLIKELY(msg == NULL)) {
+		err = g_error_new(FB_HTTP_ERROR, SOUP_STATUS_MALFORMED,
+		                  "Invalid URL: %s", img->priv->url);
+		fb_data_image_done(img, NULL, 0, err);
+		g_error_free(err);
+		return;
+	}
+
+	g_signal_connect(msg, "got-headers",
+	                 G_CALLBACK(fb_data_image_cb_headers), img);
+	g_signal_connect(msg, "got-chunk",
+	                 G_CALLBACK(fb_data_image_cb_chunk), img);
+
+	priv->imga++;
+	soup_session_queue_message(priv->cons, msg, fb_data_image_cb, img);
+}
+
+static void
+fb_data_image_cb_load(GObject *source, GAsyncResult *res, gpointer data)
+{
+	FbData *fata;
+	FbDataImage *img = data;
 	FbDataPrivate *priv;
-	GHashTableIter iter;
-	guint active = 0;
+	gchar *image;
+	gsize size;
+	GError *err = NULL;
 
-	g_return_if_fail(FB_IS_DATA(fata));
+	if (!g_file_load_contents_finish(G_FILE(source), res, &image, &size,
+	                                 NULL, &err) &&
+	    g_error_matches(err, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+	{
+		/* Detached from the FbData when it was disposed */
+		g_error_free(err);
+		g_object_unref(img);
+		return;
+	}
+
+	fata = img->priv->fata;
 	priv = fata->priv;
-	g_hash_table_iter_init(&iter, priv->imgs);
+	priv->imga--;
+	priv->imgl = g_slist_remove(priv->imgl, img);
 
-	while (g_hash_table_iter_next(&iter, (gpointer *) &img, NULL)) {
-		if (fb_data_image_get_active(img)) {
-			active++;
-		}
+	if (err == NULL) {
+		fb_data_cache_touch(img->priv->key);
+		fb_data_image_done(img, (guint8 *) image, size, NULL);
+		g_free(image);
+	} else {
+		/* The entry is stale, so fetch it again */
+		fb_data_cache_forget(img->priv->key);
+		g_error_free(err);
+		fb_data_image_fetch(fata, img);
 	}
 
-	if (active >= FB_DATA_ICON_MAX) {
-		return;
+	fb_data_image_queue(fata);
+}
+
+static gboolean
+fb_data_image_load(FbData *fata, FbDataImage *img)
+{
+	FbDataCache *cache = fb_data_cache;
+	FbDataPrivate *priv = fata->priv;
+	gchar *path;
+	GFile *file;
+
+	if (!g_hash_table_contains(cache->table, img->priv->key)) {
+		return FALSE;
 	}
 
-	g_hash_table_iter_init(&iter, priv->imgs);
+	path = g_build_filename(cache->dir, img->priv->key, NULL);
+	file = g_file_new_for_path(path);
 
-	while (g_hash_table_iter_next(&iter, (gpointer *) &img, NULL)) {
-		SoupMessage *msg;
+	priv->imga++;
+	priv->imgl = g_slist_prepend(priv->imgl, img);
+	g_file_load_contents_async(file, priv->cancel, fb_data_image_cb_load,
+	                           img);
 
-		if (fb_data_image_get_active(img)) {
-			continue;
-		}
+	g_object_unref(file);
+	g_free(path);
+	return TRUE;
+}
+
+void
+fb_data_image_queue(FbData *fata)
+{
+	FbDataImage *img;
+	FbDataPrivate *priv;
 
-		img->priv->active = TRUE;
-		url = fb_data_image_get_url(img);
+	g_return_if_fail(FB_IS_DATA(fata));
+	priv = fata->priv;
 
-		msg = soup_message_new("GET", url);
-		// purple_http_request_set_max_len(req, FB_DATA_ICON_SIZE_MAX);
-		soup_session_queue_message(priv->cons, msg, fb_data_image_cb, img);
+	while (priv->imga < priv->imgmax) {
+		img = g_queue_pop_head(priv->imgq);
 
-		if (++active >= FB_DATA_ICON_MAX) {
+		if (img == NULL) {
 			break;
 		}
+
+		/* Cached images are loaded without blocking, and count
+		 * against the same limit as fetches.
+		 */
+		if (!fb_data_image_load(fata, img)) {
+			fb_data_image_fetch(fata, img);
+		}
 	}
 }
@@ -45,10 +45,18 @@
 /**
  * FB_DATA_ICON_MAX:
  *
- * The maximum of number of concurrent icon fetches.
+ * The default maximum of number of concurrent icon fetches. This can
+ * be overridden with the `image-fetch-max` account setting.
  */
 #define FB_DATA_ICON_MAX  4
 
+/**
+ * FB_DATA_ICON_MAX_LIMIT:
+ *
+ * The upper limit of the `image-fetch-max` account setting.
+ */
+#define FB_DATA_ICON_MAX_LIMIT  16
+
 /**
  * FB_DATA_ICON_SIZE_MAX:
  *
@@ -56,6 +64,57 @@
  */
 #define FB_DATA_ICON_SIZE_MAX  0xa00000 /* 10MiB */
 
+/**
+ * FB_DATA_CACHE_SIZE_MAX:
+ *
+ * The maximum size of the on-disk image cache, which is shared by every
+ * account. The least recently used images are evicted once this is
+ * exceeded.
+ */
+#define FB_DATA_CACHE_SIZE_MAX  0x3200000 /* 50MiB */
+
+/**
+ * FB_DATA_MESSAGES_SIZE_MAX:
+ *
+ * The default maximum memory used by messages pending on a contact
+ * lookup. Beyond this, the messages of the senders pending for the
+ * longest are spilled to disk, into a directory per account which is
+ * emptied at login and when the #FbData is disposed. This can be
+ * overridden, in KiB, with the `pending-messages-max` account setting.
+ */
+#define FB_DATA_MESSAGES_SIZE_MAX  0x100000 /* 1MiB */
+
+/**
+ * FB_DATA_CONTACTS_TYPE:
+ *
+ * The #GVariant type of the on-disk contact list snapshot: the format
+ * version, the delta cursor, and an array of users as (uid, name,
+ * icon, checksum).
+ */
+#define FB_DATA_CONTACTS_TYPE  "(usa(xsss))"
+
+/**
+ * FB_DATA_CONTACTS_VERSION:
+ *
+ * The format version of the on-disk contact list snapshot.
+ */
+#define FB_DATA_CONTACTS_VERSION  1
+
+/**
+ * FB_DATA_CACHE_INDEX:
+ *
+ * The file name of the on-disk image cache index.
+ */
+#define FB_DATA_CACHE_INDEX  "index"
+
+/**
+ * FB_DATA_CACHE_SAVE_DELAY:
+ *
+ * The delay, in seconds, before changes to the image cache index are
+ * written out.
+ */
+#define FB_DATA_CACHE_SAVE_DELAY  5
+
 /**
  * fb_data_get_type:
  *
@@ -70,6 +129,15 @@ G_DECLARE_FINAL_TYPE(FbData, fb_data, FB, DATA, GObject)
  */
 G_DECLARE_FINAL_TYPE(FbDataImage, fb_data_image, FB, DATA_IMAGE, GObject)
 
+/**
+ * FbDataFunc:
+ * @fata: The #FbData.
+ * @data: The user defined data.
+ *
+ * The callback for a completed #FbData operation.
+ */
+typedef void (*FbDataFunc) (FbData *fata, gpointer data);
+
 /**
  * FbDataImageFunc:
  * @img: The #FbDataImage.
@@ -102,15 +170,67 @@ FbData *fb_data_new(PurpleConnection *gc, GProxyResolver *resolver);
 gboolean
 fb_data_load(FbData *fata);
 
+/**
+ * fb_data_load_contacts:
+ * @fata: The #FbData.
+ * @func: The #FbDataFunc.
+ * @data: The user defined data.
+ *
+ * Loads the contact list snapshot and its delta cursor, if any, without
+ * blocking. This should be called after #fb_data_load(). The @func is
+ * called once done, whether or not a snapshot was found, which may be
+ * before this returns. It is not called if @fata is disposed first.
+ */
+void
+fb_data_load_contacts(FbData *fata, FbDataFunc func, gpointer data);
+
 /**
  * fb_data_save:
  * @fata: The #FbData.
  *
- * Saves the internal data to the underlying #PurpleAccount.
+ * Saves the internal data to the underlying #PurpleAccount. This
+ * includes the contact list snapshot and its delta cursor, if either
+ * has changed.
  */
 void
 fb_data_save(FbData *fata);
 
+/**
+ * fb_data_add_contacts:
+ * @fata: The #FbData.
+ * @users: The #GSList of #FbApiUser's.
+ * @complete: #TRUE if the list is complete, otherwise #FALSE.
+ *
+ * Adds a page of the full contact list to the #FbData. Once @complete,
+ * the pages replace the contact list snapshot.
+ */
+void
+fb_data_add_contacts(FbData *fata, GSList *users, gboolean complete);
+
+/**
+ * fb_data_update_contacts:
+ * @fata: The #FbData.
+ * @added: The #GSList of added #FbApiUser's.
+ * @removed: The #GSList of strings with removed user ids.
+ *
+ * Applies contact list deltas to the contact list snapshot.
+ */
+void
+fb_data_update_contacts(FbData *fata, GSList *added, GSList *removed);
+
+/**
+ * fb_data_get_contacts:
+ * @fata: The #FbData.
+ *
+ * Gets the contact list snapshot from the #FbData. The returned
+ * #GSList should be freed with #g_slist_free() when no longer needed.
+ * The #FbApiUser's are owned by the #FbData.
+ *
+ * Returns: The #GSList of #FbApiUser's.
+ */
+GSList *
+fb_data_get_contacts(FbData *fata);
+
 /**
  * fb_data_add_timeout:
  * @fata: The #FbData.
@@ -211,7 +331,10 @@ fb_data_set_unread(FbData *fata, FbId id, gboolean unread);
  * @fata: The #FbData.
  * @msg: The #FbApiMessage.
  *
- * Adds an #FbApiMessage to the #FbData.
+ * Adds an #FbApiMessage to the #FbData. The #FbApiMessage is kept
+ * with the others of its sender, in timestamp order. Once the pending
+ * messages exceed their memory limit, they may be spilled to disk, in
+ * which case @msg is freed.
  */
 void
 fb_data_add_message(FbData *fata, FbApiMessage *msg);
@@ -221,7 +344,8 @@ fb_data_add_message(FbData *fata, FbApiMessage *msg);
  * @fata: The #FbData.
  * @msg: The #FbApiMessage.
  *
- * Removes an #FbApiMessage from the #FbData.
+ * Removes an #FbApiMessage from the #FbData. This has no effect if
+ * the #FbApiMessage was spilled to disk.
  */
 void
 fb_data_remove_message(FbData *fata, FbApiMessage *msg);
@@ -231,7 +355,8 @@ fb_data_remove_message(FbData *fata, FbApiMessage *msg);
  * @fata: The #FbData.
  * @uid: The user #FbId.
  *
- * Gets a #GSList of messages by the user #FbId from the #FbData. The
+ * Gets a #GSList of messages by the user #FbId from the #FbData, in
+ * timestamp order, including those spilled to disk. The
  * #FbApiMessage's are removed from the #FbData. The returned #GSList
  * and its #FbApiMessage's should be freed with #fb_api_message_free()
  * and #g_slist_free_full() when no longer needed.
@@ -249,7 +374,9 @@ fb_data_take_messages(FbData *fata, FbId uid);
  *
  * Adds a new #FbDataImage to the #FbData. This is used to fetch images
  * from HTTP sources. After calling this, #fb_data_image_queue() should
- * be called to queue the fetching process.
+ * be called to queue the fetching process. If an image with the same
+ * URL is already pending, both share a single fetch. Images found in
+ * the on-disk cache are not fetched at all.
  *
  * Return: The #FbDataImage.
  */
@@ -330,7 +457,8 @@ fb_data_image_get_url(FbDataImage *img);
  * fb_data_image_queue:
  * @fata: The #FbData.
  *
- * Queues the next #FbDataImage fetches.
+ * Queues the next #FbDataImage fetches, in the order in which they
+ * were added, up to the maximum of concurrent fetches.
  */
 void
 fb_data_image_queue(FbData *fata);
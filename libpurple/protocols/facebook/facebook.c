@@ -208,12 +208,12 @@ fb_sync_contacts_add_timeout(FbData *fata)
 }
 
 static void
-fb_cb_api_contacts(FbApi *api, GSList *users, gboolean complete, gpointer data)
+fb_sync_contacts(FbData *fata, GSList *users)
 {
 	const gchar *alias;
 	const gchar *csum;
+	FbApi *api;
 	FbApiUser *user;
-	FbData *fata = data;
 	FbId muid;
 	gchar uid[FB_ID_STRMAX];
 	GSList *l;
@@ -221,19 +221,15 @@ fb_cb_api_contacts(FbApi *api, GSList *users, gboolean complete, gpointer data)
 	PurpleAccount *acct;
 	PurpleBuddy *bdy;
 	PurpleConnection *gc;
-	PurpleConnectionState state;
 	PurpleGroup *grp;
 	PurpleGroup *grpn;
-	PurpleStatus *status;
-	PurpleStatusPrimitive pstat;
-	PurpleStatusType *type;
 
+	api = fb_data_get_api(fata);
 	gc = fb_data_get_connection(fata);
 	acct = purple_connection_get_account(gc);
 	grp = fb_get_group(TRUE);
 	grpn = fb_get_group(FALSE);
 	alias = purple_account_get_private_alias(acct);
-	state = purple_connection_get_state(gc);
 
 	g_value_init(&val, FB_TYPE_ID);
 	g_object_get_property(G_OBJECT(api), "uid", &val);
@@ -268,19 +264,32 @@ fb_cb_api_contacts(FbApi *api, GSList *users, gboolean complete, gpointer data)
 		purple_buddy_set_server_alias(bdy, user->name);
 		csum = purple_buddy_icons_get_checksum_for_user(bdy);
 
-		if (!purple_strequal(csum, user->csum)) {
+		if ((user->icon != NULL) &&
+		    !purple_strequal(csum, user->csum))
+		{
 			fb_data_image_add(fata, user->icon, fb_cb_icon,
 			                  bdy, NULL);
 		}
 	}
 
 	fb_data_image_queue(fata);
+}
 
-	if (!complete) {
-		return;
-	}
+static void
+fb_sync_contacts_done(FbData *fata)
+{
+	FbApi *api;
+	PurpleAccount *acct;
+	PurpleConnection *gc;
+	PurpleStatus *status;
+	PurpleStatusPrimitive pstat;
+	PurpleStatusType *type;
 
-	if (state != PURPLE_CONNECTION_CONNECTED) {
+	api = fb_data_get_api(fata);
+	gc = fb_data_get_connection(fata);
+	acct = purple_connection_get_account(gc);
+
+	if (purple_connection_get_state(gc) != PURPLE_CONNECTION_CONNECTED) {
 		status = purple_account_get_active_status(acct);
 		type = purple_status_get_status_type(status);
 		pstat = purple_status_type_get_primitive(type);
@@ -293,38 +302,33 @@ fb_cb_api_contacts(FbApi *api, GSList *users, gboolean complete, gpointer data)
 }
 
 static void
-fb_cb_api_contacts_delta(FbApi *api, GSList *added, GSList *removed, gpointer data)
+fb_cb_api_contacts(FbApi *api, GSList *users, gboolean complete, gpointer data)
+{
+	FbData *fata = data;
+
+	fb_data_add_contacts(fata, users, complete);
+	fb_sync_contacts(fata, users);
+
+	if (complete) {
+		fb_sync_contacts_done(fata);
+	}
+}
+
+static void
+fb_cb_api_contacts_delta(FbApi *api, GSList *added, GSList *removed,
+                         gboolean complete, gpointer data)
 {
-	FbApiUser *user;
 	FbData *fata = data;
-	gchar uid[FB_ID_STRMAX];
 	GSList *l;
 	PurpleAccount *acct;
 	PurpleBuddy *bdy;
 	PurpleConnection *gc;
-	PurpleGroup *grp;
-	PurpleGroup *grpn;
 
 	gc = fb_data_get_connection(fata);
 	acct = purple_connection_get_account(gc);
-	grp = fb_get_group(TRUE);
-	grpn = fb_get_group(FALSE);
-
-	for (l = added; l != NULL; l = l->next) {
-		user = l->data;
-		FB_ID_TO_STR(user->uid, uid);
-
-		bdy = purple_blist_find_buddy(acct, uid);
-
-		if ((bdy != NULL) && (purple_buddy_get_group(bdy) == grpn)) {
-			purple_blist_remove_buddy(bdy);
-		}
 
-		bdy = purple_buddy_new(acct, uid, NULL);
-		purple_blist_add_buddy(bdy, NULL, grp, NULL);
-
-		purple_buddy_set_server_alias(bdy, user->name);
-	}
+	fb_data_update_contacts(fata, added, removed);
+	fb_sync_contacts(fata, added);
 
 	for (l = removed; l != NULL; l = l->next) {
 		bdy = purple_blist_find_buddy(acct, l->data);
@@ -334,7 +338,9 @@ fb_cb_api_contacts_delta(FbApi *api, GSList *added, GSList *removed, gpointer da
 		}
 	}
 
-	fb_sync_contacts_add_timeout(fata);
+	if (complete) {
+		fb_sync_contacts_done(fata);
+	}
 }
 
 static void
@@ -515,9 +521,9 @@ fb_cb_api_messages(FbApi *api, GSList *msgs, gpointer data)
 		FB_ID_TO_STR(msg->uid, uid);
 
 		if (purple_blist_find_buddy(acct, uid) == NULL) {
+			fb_api_contact(api, msg->uid);
 			msg = fb_api_message_dup(msg, TRUE);
 			fb_data_add_message(fata, msg);
-			fb_api_contact(api, msg->uid);
 			continue;
 		}
 
@@ -957,12 +963,44 @@ fb_blist_chat_init(PurpleBlistNode *node, gpointer data)
 }
 
 static void
-fb_login(PurpleAccount *acct)
+fb_cb_login_contacts(FbData *fata, gpointer data)
 {
 	const gchar *pass;
 	const gchar *user;
+	FbApi *api;
+	gboolean loaded = GPOINTER_TO_INT(data);
+	GSList *users;
+	PurpleAccount *acct;
+	PurpleConnection *gc;
+
+	api = fb_data_get_api(fata);
+	gc = fb_data_get_connection(fata);
+	acct = purple_connection_get_account(gc);
+
+	if (!loaded || !purple_account_get_remember_password(acct)) {
+		user = purple_account_get_username(acct);
+		pass = purple_connection_get_password(gc);
+		purple_connection_update_progress(gc, _("Authenticating"),
+		                                  1, 4);
+		fb_api_auth(api, user, pass);
+		return;
+	}
+
+	/* Restore the snapshot, only its deltas are fetched */
+	users = fb_data_get_contacts(fata);
+	fb_sync_contacts(fata, users);
+	g_slist_free(users);
+
+	purple_connection_update_progress(gc, _("Fetching contacts"), 2, 4);
+	fb_api_contacts(api);
+}
+
+static void
+fb_login(PurpleAccount *acct)
+{
 	FbApi *api;
 	FbData *fata;
+	gboolean loaded;
 	gpointer convh;
 	PurpleConnection *gc;
 	GProxyResolver *resolver;
@@ -1051,17 +1089,12 @@ fb_login(PurpleAccount *acct)
 	                      G_CALLBACK(fb_cb_conv_deleting),
 	                      fata);
 
-	if (!fb_data_load(fata) || !purple_account_get_remember_password(acct)) {
-		user = purple_account_get_username(acct);
-		pass = purple_connection_get_password(gc);
-		purple_connection_update_progress(gc, _("Authenticating"),
-		                                  1, 4);
-		fb_api_auth(api, user, pass);
-		return;
-	}
-
-	purple_connection_update_progress(gc, _("Fetching contacts"), 2, 4);
-	fb_api_contacts(api);
+	/* Even authentication waits for the snapshot, as the delta cursor
+	 * is needed by the first fetch of the contacts.
+	 */
+	loaded = fb_data_load(fata);
+	fb_data_load_contacts(fata, fb_cb_login_contacts,
+	                      GINT_TO_POINTER(loaded));
 }
 
 static void
@@ -1531,6 +1564,16 @@ facebook_protocol_init(FacebookProtocol *self)
 	                                    "sync-interval", 5);
 	opts = g_list_prepend(opts, opt);
 
+	opt = purple_account_option_int_new(_("Maximum concurrent image fetches"),
+	                                    "image-fetch-max",
+	                                    FB_DATA_ICON_MAX);
+	opts = g_list_prepend(opts, opt);
+
+	opt = purple_account_option_int_new(_("Pending messages memory (KiB)"),
+	                                    "pending-messages-max",
+	                                    FB_DATA_MESSAGES_SIZE_MAX / 1024);
+	opts = g_list_prepend(opts, opt);
+
 	opt = purple_account_option_bool_new(_("Mark messages as read on focus"),
 	                                     "mark-read", TRUE);
 	opts = g_list_prepend(opts, opt);
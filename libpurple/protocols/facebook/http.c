@@ -25,6 +25,17 @@
 
 #include "http.h"
 
+typedef struct
+{
+	gchar *name;
+	gchar *value;
+} FbHttpParam;
+
+struct _FbHttpParams
+{
+	GArray *params;
+};
+
 GQuark
 fb_http_error_quark(void)
 {
@@ -49,15 +60,80 @@ fb_http_error_chk(SoupMessage *res, GError **error)
 	return FALSE;
 }
 
+static void
+fb_http_param_clear(FbHttpParam *param)
+{
+	g_free(param->name);
+	g_free(param->value);
+}
+
+static gint
+fb_http_param_cmp(const gchar *name1, const gchar *name2)
+{
+	gint ret;
+
+	/* The signature requires case insensitive ordering */
+	ret = g_ascii_strcasecmp(name1, name2);
+
+	if (ret == 0) {
+		ret = strcmp(name1, name2);
+	}
+
+	return ret;
+}
+
+static gboolean
+fb_http_params_find(FbHttpParams *params, const gchar *name, guint *index)
+{
+	FbHttpParam *param;
+	gint cmp;
+	guint hi;
+	guint lo = 0;
+	guint mid;
+
+	hi = params->params->len;
+
+	while (lo < hi) {
+		mid = lo + ((hi - lo) / 2);
+		param = &g_array_index(params->params, FbHttpParam, mid);
+		cmp = fb_http_param_cmp(name, param->name);
+
+		if (cmp == 0) {
+			*index = mid;
+			return TRUE;
+		}
+
+		if (cmp < 0) {
+			hi = mid;
+		} else {
+			lo = mid + 1;
+		}
+	}
+
+	*index = lo;
+	return FALSE;
+}
+
 FbHttpParams *
 fb_http_params_new(void)
 {
-        return g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+	FbHttpParams *params;
+
+	params = g_new(FbHttpParams, 1);
+	params->params = g_array_sized_new(FALSE, FALSE, sizeof (FbHttpParam),
+	                                   16);
+	g_array_set_clear_func(params->params,
+	                       (GDestroyNotify) fb_http_param_clear);
+	return params;
 }
 
 FbHttpParams *
 fb_http_params_new_parse(const gchar *data, gboolean isurl)
 {
+	GHashTable *form;
+	GHashTableIter iter;
+	gpointer key;
+	gpointer val;
 	SoupURI *uri = NULL;
 	FbHttpParams *params;
 
@@ -75,7 +151,18 @@ fb_http_params_new_parse(const gchar *data, gboolean isurl)
 		data = uri->query;
 	}
 
-	params = soup_form_decode(data);
+	params = fb_http_params_new();
+
+	if (data != NULL) {
+		form = soup_form_decode(data);
+		g_hash_table_iter_init(&iter, form);
+
+		while (g_hash_table_iter_next(&iter, &key, &val)) {
+			fb_http_params_set_str(params, key, val);
+		}
+
+		g_hash_table_destroy(form);
+	}
 
 	if (isurl) {
 		soup_uri_free(uri);
@@ -87,23 +174,108 @@ fb_http_params_new_parse(const gchar *data, gboolean isurl)
 void
 fb_http_params_free(FbHttpParams *params)
 {
-	g_hash_table_destroy(params);
+	g_array_unref(params->params);
+	g_free(params);
+}
+
+static void
+fb_http_params_encode(GString *str, const gchar *data)
+{
+	static const gchar hex[] = "0123456789ABCDEF";
+	const guchar *s = (const guchar *) data;
+
+	/* Same as the encoding of soup_form_encode() */
+	for (; *s != '\0'; s++) {
+		if (*s == ' ') {
+			g_string_append_c(str, '+');
+		} else if (g_ascii_isalnum(*s) || (*s == '-') ||
+		           (*s == '_') || (*s == '.'))
+		{
+			g_string_append_c(str, *s);
+		} else {
+			g_string_append_c(str, '%');
+			g_string_append_c(str, hex[*s >> 4]);
+			g_string_append_c(str, hex[*s & 0x0F]);
+		}
+	}
+}
+
+gchar *
+fb_http_params_close(FbHttpParams *params, const gchar *secret, gsize *size)
+{
+	const gchar *value;
+	FbHttpParam *param;
+	GChecksum *csum = NULL;
+	GString *gstr;
+	guint i;
+
+	gstr = g_string_sized_new(params->params->len * 32);
+
+	if (secret != NULL) {
+		csum = g_checksum_new(G_CHECKSUM_MD5);
+	}
+
+	for (i = 0; i < params->params->len; i++) {
+		param = &g_array_index(params->params, FbHttpParam, i);
+		value = (param->value != NULL) ? param->value : "";
+
+		if (csum != NULL) {
+			g_checksum_update(csum, (const guchar *) param->name, -1);
+			g_checksum_update(csum, (const guchar *) "=", 1);
+			g_checksum_update(csum, (const guchar *) value, -1);
+		}
+
+		if (i > 0) {
+			g_string_append_c(gstr, '&');
+		}
+
+		fb_http_params_encode(gstr, param->name);
+		g_string_append_c(gstr, '=');
+		fb_http_params_encode(gstr, value);
+	}
+
+	if (csum != NULL) {
+		g_checksum_update(csum, (const guchar *) secret, -1);
+
+		if (gstr->len > 0) {
+			g_string_append_c(gstr, '&');
+		}
+
+		g_string_append(gstr, "sig=");
+		g_string_append(gstr, g_checksum_get_string(csum));
+		g_checksum_free(csum);
+	}
+
+	if (size != NULL) {
+		*size = gstr->len;
+	}
+
+	fb_http_params_free(params);
+	return g_string_free(gstr, FALSE);
+}
+
+void
+fb_http_params_remove(FbHttpParams *params, const gchar *name)
+{
+	guint index;
+
+	if (fb_http_params_find(params, name, &index)) {
+		g_array_remove_index(params->params, index);
+	}
 }
 
 static const gchar *
 fb_http_params_get(FbHttpParams *params, const gchar *name, GError **error)
 {
-	const gchar *ret;
-
-	ret = g_hash_table_lookup(params, name);
+	guint index;
 
-	if (ret == NULL) {
+	if (!fb_http_params_find(params, name, &index)) {
 		g_set_error(error, FB_HTTP_ERROR, FB_HTTP_ERROR_NOMATCH,
 		            _("No matches for %s"), name);
 		return NULL;
 	}
 
-	return ret;
+	return g_array_index(params->params, FbHttpParam, index).value;
 }
 
 gboolean
@@ -171,10 +343,20 @@ fb_http_params_dup_str(FbHttpParams *params, const gchar *name,
 static void
 fb_http_params_set(FbHttpParams *params, const gchar *name, gchar *value)
 {
-	gchar *key;
+	FbHttpParam *param;
+	FbHttpParam nparam;
+	guint index;
+
+	if (fb_http_params_find(params, name, &index)) {
+		param = &g_array_index(params->params, FbHttpParam, index);
+		g_free(param->value);
+		param->value = value;
+		return;
+	}
 
-	key = g_strdup(name);
-	g_hash_table_replace(params, key, value);
+	nparam.name = g_strdup(name);
+	nparam.value = value;
+	g_array_insert_val(params->params, index, nparam);
 }
 
 void
@@ -44,9 +44,10 @@
 /**
  * FbHttpParams:
  *
- * Represents a set of key/value HTTP parameters.
+ * Represents a set of key/value HTTP parameters. The parameters are
+ * kept sorted by name, which is the order used for signing them.
  */
-typedef GHashTable FbHttpParams;
+typedef struct _FbHttpParams FbHttpParams;
 
 /**
  * FbHttpError:
@@ -121,6 +122,35 @@ fb_http_params_new_parse(const gchar *data, gboolean isurl);
 void
 fb_http_params_free(FbHttpParams *params);
 
+/**
+ * fb_http_params_close:
+ * @params: The #FbHttpParams.
+ * @secret: The signing secret or #NULL.
+ * @size: The return location for the size or #NULL.
+ *
+ * Closes the #FbHttpParams by returning their form encoded string, and
+ * freeing all memory used by the #FbHttpParams. When @secret is given,
+ * a `sig` parameter is appended, which is the MD5 hash of every
+ * name=value pair, in order, followed by @secret. The signature and
+ * the form encoding are computed in a single pass over the parameters.
+ * The returned string should be freed with #g_free() when no longer
+ * needed.
+ *
+ * Returns: The form encoded string.
+ */
+gchar *
+fb_http_params_close(FbHttpParams *params, const gchar *secret, gsize *size);
+
+/**
+ * fb_http_params_remove:
+ * @params: The #FbHttpParams.
+ * @name: The parameter name.
+ *
+ * Removes a parameter from the #FbHttpParams.
+ */
+void
+fb_http_params_remove(FbHttpParams *params, const gchar *name);
+
 /**
  * fb_http_params_get_bool:
  * @params: The #FbHttpParams.
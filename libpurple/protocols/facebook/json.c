@@ -32,6 +32,7 @@ typedef struct _FbJsonValue FbJsonValue;
 struct _FbJsonValue
 {
 	const gchar *expr;
+	gchar **path;
 	FbJsonType type;
 	gboolean required;
 	GValue value;
@@ -76,6 +77,7 @@ fb_json_values_dispose(GObject *obj)
 			g_value_unset(&value->value);
 		}
 
+		g_strfreev(value->path);
 		g_free(value);
 	}
 
@@ -445,6 +447,313 @@ fb_json_node_get_str(JsonNode *root, const gchar *expr, GError **error)
 	return ret;
 }
 
+static gchar **
+fb_json_values_compile(const gchar *expr)
+{
+	gchar **path;
+	gchar *str;
+	guint i;
+
+	if (purple_strequal(expr, "$")) {
+		return g_new0(gchar *, 1);
+	}
+
+	if (!g_str_has_prefix(expr, "$.")) {
+		return NULL;
+	}
+
+	path = g_strsplit(expr + 2, ".", -1);
+
+	/* Only plain member names can be walked directly, leave anything
+	 * else (indexes, wildcards, filters) to json_path_query().
+	 */
+	for (i = 0; path[i] != NULL; i++) {
+		if (*path[i] == 0) {
+			g_strfreev(path);
+			return NULL;
+		}
+
+		for (str = path[i]; *str != 0; str++) {
+			if (!g_ascii_isalnum(*str) && (*str != '_')) {
+				g_strfreev(path);
+				return NULL;
+			}
+		}
+	}
+
+	return path;
+}
+
+static JsonNode *
+fb_json_values_walk(JsonNode *root, FbJsonValue *value, GError **error)
+{
+	guint i;
+	JsonNode *node = root;
+
+	for (i = 0; value->path[i] != NULL; i++) {
+		if (!JSON_NODE_HOLDS_OBJECT(node)) {
+			node = NULL;
+			break;
+		}
+
+		node = json_object_get_member(json_node_get_object(node),
+		                              value->path[i]);
+
+		if (node == NULL) {
+			break;
+		}
+	}
+
+	if (node == NULL) {
+		g_set_error(error, FB_JSON_ERROR, FB_JSON_ERROR_NOMATCH,
+		            _("No matches for %s"), value->expr);
+		return NULL;
+	}
+
+	if ((i > 0) && JSON_NODE_HOLDS_NULL(node)) {
+		g_set_error(error, FB_JSON_ERROR, FB_JSON_ERROR_NULL,
+		            _("Null value for %s"), value->expr);
+		return NULL;
+	}
+
+	return node;
+}
+
+static gsize
+fb_json_scan_ws(const gchar *data, gsize size, gsize pos)
+{
+	while ((pos < size) && g_ascii_isspace(data[pos])) {
+		pos++;
+	}
+
+	return pos;
+}
+
+static gboolean
+fb_json_scan_value(const gchar *data, gsize size, gsize *pos)
+{
+	gchar c;
+	gsize i;
+	gsize start;
+	guint depth = 0;
+
+	i = fb_json_scan_ws(data, size, *pos);
+
+	if (i >= size) {
+		return FALSE;
+	}
+
+	c = data[i];
+
+	if ((c != '"') && (c != '{') && (c != '[')) {
+		/* Scalars end at the next delimiter */
+		for (start = i; i < size; i++) {
+			c = data[i];
+
+			if ((c == ',') || (c == '}') || (c == ']') ||
+			    g_ascii_isspace(c))
+			{
+				break;
+			}
+		}
+
+		if (i == start) {
+			return FALSE;
+		}
+
+		*pos = i;
+		return TRUE;
+	}
+
+	while (i < size) {
+		switch (data[i++]) {
+		case '"':
+			for (; (i < size) && (data[i] != '"'); i++) {
+				if (data[i] == '\\') {
+					i++;
+				}
+			}
+
+			if (i >= size) {
+				return FALSE;
+			}
+
+			i++;
+			break;
+
+		case '{':
+		case '[':
+			depth++;
+			break;
+
+		case '}':
+		case ']':
+			if (depth == 0) {
+				return FALSE;
+			}
+
+			depth--;
+			break;
+
+		default:
+			break;
+		}
+
+		if (depth == 0) {
+			*pos = i;
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+static gboolean
+fb_json_scan_open(const gchar *data, gsize size, gsize *pos, gchar open,
+                  gchar close)
+{
+	gsize i = *pos;
+
+	if (i == 0) {
+		i = fb_json_scan_ws(data, size, 0);
+
+		if ((i >= size) || (data[i] != open)) {
+			return FALSE;
+		}
+
+		i++;
+	}
+
+	i = fb_json_scan_ws(data, size, i);
+	*pos = i;
+	return (i < size) && (data[i] != close);
+}
+
+static void
+fb_json_scan_close(const gchar *data, gsize size, gsize *pos)
+{
+	gsize i;
+
+	i = fb_json_scan_ws(data, size, *pos);
+
+	if ((i < size) && (data[i] == ',')) {
+		i++;
+	}
+
+	*pos = i;
+}
+
+gboolean
+fb_json_scan_array(const gchar *data, gsize size, gsize *pos, gsize *start,
+                   gsize *end)
+{
+	gsize i;
+
+	g_return_val_if_fail(data != NULL, FALSE);
+	g_return_val_if_fail(pos != NULL, FALSE);
+
+	if (!fb_json_scan_open(data, size, pos, '[', ']')) {
+		return FALSE;
+	}
+
+	i = *pos;
+
+	if (!fb_json_scan_value(data, size, &i)) {
+		return FALSE;
+	}
+
+	if (start != NULL) {
+		*start = *pos;
+	}
+
+	if (end != NULL) {
+		*end = i;
+	}
+
+	fb_json_scan_close(data, size, &i);
+	*pos = i;
+	return TRUE;
+}
+
+gboolean
+fb_json_scan_object(const gchar *data, gsize size, gsize *pos,
+                    const gchar **name, gsize *nsize, gsize *start,
+                    gsize *end)
+{
+	gsize i;
+	gsize j;
+	gsize k;
+
+	g_return_val_if_fail(data != NULL, FALSE);
+	g_return_val_if_fail(pos != NULL, FALSE);
+
+	if (!fb_json_scan_open(data, size, pos, '{', '}')) {
+		return FALSE;
+	}
+
+	i = *pos;
+
+	if ((data[i] != '"') || !fb_json_scan_value(data, size, &i)) {
+		return FALSE;
+	}
+
+	if (name != NULL) {
+		*name = data + *pos + 1;
+	}
+
+	if (nsize != NULL) {
+		*nsize = i - *pos - 2;
+	}
+
+	i = fb_json_scan_ws(data, size, i);
+
+	if ((i >= size) || (data[i] != ':')) {
+		return FALSE;
+	}
+
+	j = fb_json_scan_ws(data, size, i + 1);
+	k = j;
+
+	if (!fb_json_scan_value(data, size, &k)) {
+		return FALSE;
+	}
+
+	if (start != NULL) {
+		*start = j;
+	}
+
+	if (end != NULL) {
+		*end = k;
+	}
+
+	fb_json_scan_close(data, size, &k);
+	*pos = k;
+	return TRUE;
+}
+
+gboolean
+fb_json_scan_member(const gchar *data, gsize size, const gchar *name,
+                    gsize *start, gsize *end)
+{
+	const gchar *key;
+	gsize klen;
+	gsize len;
+	gsize pos = 0;
+
+	g_return_val_if_fail(name != NULL, FALSE);
+	len = strlen(name);
+
+	while (fb_json_scan_object(data, size, &pos, &key, &klen,
+	                           start, end))
+	{
+		if ((klen == len) && (memcmp(key, name, len) == 0)) {
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
 FbJsonValues *
 fb_json_values_new(JsonNode *root)
 {
@@ -473,6 +782,7 @@ fb_json_values_add(FbJsonValues *values, FbJsonType type, gboolean required,
 
 	value = g_new0(FbJsonValue, 1);
 	value->expr = expr;
+	value->path = fb_json_values_compile(expr);
 	value->type = type;
 	value->required = required;
 
@@ -529,6 +839,7 @@ fb_json_values_update(FbJsonValues *values, GError **error)
 	GType type;
 	JsonNode *root;
 	JsonNode *node;
+	JsonNode *rslt;
 
 	g_return_val_if_fail(values != NULL, FALSE);
 	priv = values->priv;
@@ -555,14 +866,22 @@ fb_json_values_update(FbJsonValues *values, GError **error)
 
 	for (l = priv->queue->head; l != NULL; l = l->next) {
 		value = l->data;
-		node = fb_json_node_get(root, value->expr, &err);
+
+		/* Compiled paths are read in place, without any copying */
+		if (value->path != NULL) {
+			node = fb_json_values_walk(root, value, &err);
+			rslt = NULL;
+		} else {
+			node = fb_json_node_get(root, value->expr, &err);
+			rslt = node;
+		}
 
 		if (G_IS_VALUE(&value->value)) {
 			g_value_unset(&value->value);
 		}
 
 		if (err != NULL) {
-			json_node_free(node);
+			json_node_free(rslt);
 
 			if (value->required) {
 				g_propagate_error(error, err);
@@ -581,12 +900,12 @@ fb_json_values_update(FbJsonValues *values, GError **error)
 			            g_type_name(value->type),
 			            g_type_name(type),
 				    value->expr);
-			json_node_free(node);
+			json_node_free(rslt);
 			return FALSE;
 		}
 
 		json_node_get_value(node, &value->value);
-		json_node_free(node);
+		json_node_free(rslt);
 	}
 
 	priv->next = priv->queue->head;
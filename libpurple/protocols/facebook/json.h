@@ -342,6 +342,62 @@ fb_json_node_get_int(JsonNode *root, const gchar *expr, GError **error);
 gchar *
 fb_json_node_get_str(JsonNode *root, const gchar *expr, GError **error);
 
+/**
+ * fb_json_scan_array:
+ * @data: The JSON data.
+ * @size: The size of @data.
+ * @pos: The position, which must be initialized to zero.
+ * @start: The return location for the start of the element or #NULL.
+ * @end: The return location for the end of the element or #NULL.
+ *
+ * Scans to the next element of the JSON array in @data, without
+ * parsing it. This only tracks the structure of the data, anything
+ * within the returned range should be validated by a real parser.
+ *
+ * Returns: #TRUE if an element was found, otherwise #FALSE.
+ */
+gboolean
+fb_json_scan_array(const gchar *data, gsize size, gsize *pos, gsize *start,
+                   gsize *end);
+
+/**
+ * fb_json_scan_object:
+ * @data: The JSON data.
+ * @size: The size of @data.
+ * @pos: The position, which must be initialized to zero.
+ * @name: The return location for the raw member name or #NULL.
+ * @nsize: The return location for the size of @name or #NULL.
+ * @start: The return location for the start of the value or #NULL.
+ * @end: The return location for the end of the value or #NULL.
+ *
+ * Scans to the next member of the JSON object in @data, without
+ * parsing it. The member name is not unescaped. This only tracks the
+ * structure of the data, anything within the returned range should be
+ * validated by a real parser.
+ *
+ * Returns: #TRUE if a member was found, otherwise #FALSE.
+ */
+gboolean
+fb_json_scan_object(const gchar *data, gsize size, gsize *pos,
+                    const gchar **name, gsize *nsize, gsize *start,
+                    gsize *end);
+
+/**
+ * fb_json_scan_member:
+ * @data: The JSON data.
+ * @size: The size of @data.
+ * @name: The member name.
+ * @start: The return location for the start of the value or #NULL.
+ * @end: The return location for the end of the value or #NULL.
+ *
+ * Scans the JSON object in @data for a top-level member.
+ *
+ * Returns: #TRUE if the member was found, otherwise #FALSE.
+ */
+gboolean
+fb_json_scan_member(const gchar *data, gsize size, const gchar *name,
+                    gsize *start, gsize *end);
+
 /**
  * fb_json_values_new:
  * @root: The root #JsonNode.
@@ -361,7 +417,9 @@ fb_json_values_new(JsonNode *root);
  * @required: #TRUE if the node is required, otherwise #FALSE.
  * @expr: The #JsonPath expression.
  *
- * Adds a new #FbJsonValue to the #FbJsonValues.
+ * Adds a new #FbJsonValue to the #FbJsonValues. Expressions made up of
+ * plain member names (ex: $.a.b) are compiled once and resolved by a
+ * direct walk, anything else is evaluated with #json_path_query().
  */
 void
 fb_json_values_add(FbJsonValues *values, FbJsonType type, gboolean required,
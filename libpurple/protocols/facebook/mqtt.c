@@ -34,14 +34,15 @@ typedef struct
 {
 	PurpleConnection *gc;
 	GIOStream *conn;
-	GBufferedInputStream *input;
+	GInputStream *input;
 	PurpleQueuedOutputStream *output;
 	GCancellable *cancellable;
 	gboolean connected;
 	guint16 mid;
 
-	GByteArray *rbuf;
-	gsize remz;
+	guint8 *rbuf;
+	gsize rlen;
+	gsize rsize;
 
 	gint tev;
 } FbMqttPrivate;
@@ -65,10 +66,9 @@ typedef struct
 	FbMqttMessageFlags flags;
 
 	GByteArray *bytes;
+	GBytes *rbytes;
 	guint offset;
 	guint pos;
-
-	gboolean local;
 } FbMqttMessagePrivate;
 
 /**
@@ -89,11 +89,7 @@ static void fb_mqtt_read_packet(FbMqtt *mqtt);
 static void
 fb_mqtt_dispose(GObject *obj)
 {
-	FbMqtt *mqtt = FB_MQTT(obj);
-	FbMqttPrivate *priv = mqtt->priv;
-
-	fb_mqtt_close(mqtt);
-	g_byte_array_free(priv->rbuf, TRUE);
+	fb_mqtt_close(FB_MQTT(obj));
 }
 
 static void
@@ -172,8 +168,6 @@ fb_mqtt_init(FbMqtt *mqtt)
 	FbMqttPrivate *priv = fb_mqtt_get_instance_private(mqtt);
 
 	mqtt->priv = priv;
-
-	priv->rbuf = g_byte_array_new();
 }
 
 static void
@@ -181,9 +175,12 @@ fb_mqtt_message_dispose(GObject *obj)
 {
 	FbMqttMessagePrivate *priv = FB_MQTT_MESSAGE(obj)->priv;
 
-	if ((priv->bytes != NULL) && priv->local) {
+	if (priv->bytes != NULL) {
 		g_byte_array_free(priv->bytes, TRUE);
+		priv->bytes = NULL;
 	}
+
+	g_clear_pointer(&priv->rbytes, g_bytes_unref);
 }
 
 static void
@@ -248,16 +245,18 @@ fb_mqtt_close(FbMqtt *mqtt)
 	}
 
 	if (priv->conn != NULL) {
-		purple_gio_graceful_close(priv->conn,
-				G_INPUT_STREAM(priv->input),
+		purple_gio_graceful_close(priv->conn, priv->input,
 				G_OUTPUT_STREAM(priv->output));
 		g_clear_object(&priv->input);
 		g_clear_object(&priv->output);
 		g_clear_object(&priv->conn);
 	}
 
+	g_clear_pointer(&priv->rbuf, g_free);
+	priv->rlen = 0;
+	priv->rsize = 0;
+
 	priv->connected = FALSE;
-	g_byte_array_set_size(priv->rbuf, 0);
 }
 
 static void
@@ -371,12 +370,11 @@ fb_mqtt_ping(FbMqtt *mqtt)
 static void
 fb_mqtt_cb_fill(GObject *source, GAsyncResult *res, gpointer data)
 {
-	GBufferedInputStream *input = G_BUFFERED_INPUT_STREAM(source);
 	FbMqtt *mqtt = data;
 	gssize ret;
 	GError *err = NULL;
 
-	ret = g_buffered_input_stream_fill_finish(input, res, &err);
+	ret = g_input_stream_read_finish(G_INPUT_STREAM(source), res, &err);
 
 	if (ret < 1) {
 		if (ret == 0) {
@@ -389,107 +387,135 @@ fb_mqtt_cb_fill(GObject *source, GAsyncResult *res, gpointer data)
 		return;
 	}
 
+	mqtt->priv->rlen += ret;
 	fb_mqtt_read_packet(mqtt);
 }
 
 static void
-fb_mqtt_cb_read_packet(GObject *source, GAsyncResult *res, gpointer data)
+fb_mqtt_fill(FbMqtt *mqtt, gsize size)
 {
-	FbMqtt *mqtt = data;
-	FbMqttPrivate *priv;
-	gssize ret;
-	FbMqttMessage *msg;
-	GError *err = NULL;
-
-	ret = g_input_stream_read_finish(G_INPUT_STREAM(source), res, &err);
-
-	if (ret < 1) {
-		if (ret == 0) {
-			err = g_error_new_literal(G_IO_ERROR,
-					G_IO_ERROR_CONNECTION_CLOSED,
-					_("Connection closed"));
-		}
-
-		fb_mqtt_take_error(mqtt, err, _("Failed to read packet data"));
-		return;
-	}
-
-	priv = mqtt->priv;
-	priv->remz -= ret;
-
-	if (priv->remz > 0) {
-		g_input_stream_read_async(G_INPUT_STREAM(source),
-				priv->rbuf->data +
-				priv->rbuf->len - priv->remz, priv->remz,
-				G_PRIORITY_DEFAULT, priv->cancellable,
-				fb_mqtt_cb_read_packet, mqtt);
-		return;
-	}
-
-	msg = fb_mqtt_message_new_bytes(priv->rbuf);
+	FbMqttPrivate *priv = mqtt->priv;
 
-	if (G_UNLIKELY(msg == NULL)) {
-		fb_mqtt_error_literal(mqtt, FB_MQTT_ERROR_GENERAL,
-		                      _("Failed to parse message"));
-		return;
+	/* Ensure the whole packet fits into the buffer */
+	if (size > priv->rsize) {
+		priv->rbuf = g_realloc(priv->rbuf, size);
+		priv->rsize = size;
 	}
 
-	fb_mqtt_read(mqtt, msg);
-	g_object_unref(msg);
-
-	/* Read another packet if connection wasn't reset in fb_mqtt_read() */
-	if (fb_mqtt_connected(mqtt, FALSE)) {
-		fb_mqtt_read_packet(mqtt);
-	}
+	g_input_stream_read_async(priv->input, priv->rbuf + priv->rlen,
+			priv->rsize - priv->rlen, G_PRIORITY_DEFAULT,
+			priv->cancellable, fb_mqtt_cb_fill, mqtt);
 }
 
 static void
 fb_mqtt_read_packet(FbMqtt *mqtt)
 {
 	FbMqttPrivate *priv = mqtt->priv;
+	FbMqttMessage *msg;
+	GInputStream *input;
+	GBytes *bytes;
+	GBytes *chunk = NULL;
 	const guint8 *buf;
-	gsize count = 0;
+	gsize count;
+	gsize offset = 0;
 	gsize pos;
-	guint mult = 1;
+	gsize size;
+	guint mult;
 	guint8 byte;
-	gsize size = 0;
 
-	buf = g_buffered_input_stream_peek_buffer(priv->input, &count);
+	input = priv->input;
+	buf = priv->rbuf;
+	count = priv->rlen;
+
+	/* Handle every complete packet which is already buffered */
+	while (TRUE) {
+		/* Start at 1 to skip the first byte */
+		pos = 1;
+		mult = 1;
+		size = 0;
+
+		while (TRUE) {
+			if (offset + pos >= count) {
+				/* Not enough data yet, try again later */
+				size = 0;
+				break;
+			}
 
-	/* Start at 1 to skip the first byte */
-	pos = 1;
+			if (G_UNLIKELY(pos > 4)) {
+				if (chunk != NULL) {
+					g_bytes_unref(chunk);
+				}
 
-	do {
-		if (pos >= count) {
-			/* Not enough data yet, try again later */
-			g_buffered_input_stream_fill_async(priv->input, -1,
-					G_PRIORITY_DEFAULT, priv->cancellable,
-					fb_mqtt_cb_fill, mqtt);
-			return;
+				fb_mqtt_error_literal(mqtt,
+				                      FB_MQTT_ERROR_GENERAL,
+				                      _("Failed to parse message"));
+				return;
+			}
+
+			byte = buf[offset + pos++];
+
+			size += (byte & 127) * mult;
+			mult *= 128;
+
+			if ((byte & 128) == 0) {
+				/* Add header to size */
+				size += pos;
+				break;
+			}
 		}
 
-		byte = *(buf + pos++);
+		if ((size == 0) || (offset + size > count)) {
+			break;
+		}
 
-		size += (byte & 127) * mult;
-		mult *= 128;
-	} while ((byte & 128) != 0);
+		/* The messages are sliced out of the buffer, which is left
+		 * to them and freed with the last one.
+		 */
+		if (chunk == NULL) {
+			chunk = g_bytes_new_take(priv->rbuf, priv->rlen);
+			priv->rbuf = NULL;
+			priv->rlen = 0;
+			priv->rsize = 0;
+		}
 
-	/* Add header to size */
-	size += pos;
+		bytes = g_bytes_new_from_bytes(chunk, offset, size);
+		msg = fb_mqtt_message_new_bytes(bytes);
+		g_bytes_unref(bytes);
+		offset += size;
 
-	g_byte_array_set_size(priv->rbuf, size);
-	priv->remz = size;
+		if (G_UNLIKELY(msg == NULL)) {
+			g_bytes_unref(chunk);
+			fb_mqtt_error_literal(mqtt, FB_MQTT_ERROR_GENERAL,
+			                      _("Failed to parse message"));
+			return;
+		}
 
-	/* TODO: Use g_input_stream_read_all_async() when available. */
-	/* TODO: Alternately, it would be nice to let the
-	 * FbMqttMessage directly use the GBufferedInputStream
-	 * buffer instead of copying it, provided it's consumed
-	 * before the next read.
-	 */
-	g_input_stream_read_async(G_INPUT_STREAM(priv->input),
-			priv->rbuf->data, priv->rbuf->len,
-			G_PRIORITY_DEFAULT, priv->cancellable,
-			fb_mqtt_cb_read_packet, mqtt);
+		fb_mqtt_read(mqtt, msg);
+		g_object_unref(msg);
+
+		/* Stop if the connection was reset in fb_mqtt_read() */
+		if (!fb_mqtt_connected(mqtt, FALSE) || (priv->input != input)) {
+			g_bytes_unref(chunk);
+			return;
+		}
+	}
+
+	if (chunk != NULL) {
+		/* Read on into a new buffer, with only the start of the next
+		 * packet copied over. This also drops the room a large packet
+		 * needed once it has been handled.
+		 */
+		priv->rsize = MAX(size, FB_MQTT_READ_SIZE);
+		priv->rlen = count - offset;
+		priv->rbuf = g_malloc(priv->rsize);
+		memcpy(priv->rbuf, buf + offset, priv->rlen);
+		g_bytes_unref(chunk);
+	} else if (priv->rbuf == NULL) {
+		priv->rsize = MAX(size, FB_MQTT_READ_SIZE);
+		priv->rbuf = g_malloc(priv->rsize);
+	}
+
+	fb_mqtt_fill(mqtt, size);
 }
 
 void
@@ -508,9 +534,9 @@ fb_mqtt_read(FbMqtt *mqtt, FbMqttMessage *msg)
 	priv = mqtt->priv;
 	mriv = msg->priv;
 
-	fb_util_debug_hexdump(FB_UTIL_DEBUG_INFO, mriv->bytes,
-	                      "Reading %d (flags: 0x%0X)",
-			      mriv->type, mriv->flags);
+	fb_util_debug_hexdump_bytes(FB_UTIL_DEBUG_INFO, mriv->rbytes,
+	                            "Reading %d (flags: 0x%0X)",
+	                            mriv->type, mriv->flags);
 
 	switch (mriv->type) {
 	case FB_MQTT_MESSAGE_TYPE_CONNACK:
@@ -664,8 +690,7 @@ fb_mqtt_cb_open(GObject *source, GAsyncResult *res, gpointer data)
 
 	priv = mqtt->priv;
 	priv->conn = G_IO_STREAM(conn);
-	priv->input = G_BUFFERED_INPUT_STREAM(g_buffered_input_stream_new(
-			g_io_stream_get_input_stream(priv->conn)));
+	priv->input = g_object_ref(g_io_stream_get_input_stream(priv->conn));
 	priv->output = purple_queued_output_stream_new(
 			g_io_stream_get_output_stream(priv->conn));
 
@@ -862,50 +887,75 @@ fb_mqtt_message_new(FbMqttMessageType type, FbMqttMessageFlags flags)
 	priv->type = type;
 	priv->flags = flags;
 	priv->bytes = g_byte_array_new();
-	priv->local = TRUE;
 
 	return msg;
 }
 
 FbMqttMessage *
-fb_mqtt_message_new_bytes(GByteArray *bytes)
+fb_mqtt_message_new_bytes(GBytes *bytes)
 {
 	FbMqttMessage *msg;
 	FbMqttMessagePrivate *priv;
-	guint8 *byte;
+	const guint8 *data;
+	gsize size;
+	guint i;
 
 	g_return_val_if_fail(bytes != NULL, NULL);
-	g_return_val_if_fail(bytes->len >= 2, NULL);
+	data = g_bytes_get_data(bytes, &size);
+	g_return_val_if_fail(size >= 2, NULL);
 
 	msg = g_object_new(FB_TYPE_MQTT_MESSAGE, NULL);
 	priv = msg->priv;
 
-	priv->bytes = bytes;
-	priv->local = FALSE;
-	priv->type = (*bytes->data & 0xF0) >> 4;
-	priv->flags = *bytes->data & 0x0F;
+	priv->rbytes = g_bytes_ref(bytes);
+	priv->type = (*data & 0xF0) >> 4;
+	priv->flags = *data & 0x0F;
 
 	/* Skip the fixed header */
-	for (byte = priv->bytes->data + 1; (*(byte++) & 128) != 0; );
-	priv->offset = byte - bytes->data;
+	for (i = 1; (i < size) && ((data[i++] & 128) != 0); );
+	priv->offset = i;
 	priv->pos = priv->offset;
 
 	return msg;
 }
 
+static const guint8 *
+fb_mqtt_message_data(FbMqttMessagePrivate *priv, gsize *size)
+{
+	if (priv->rbytes != NULL) {
+		return g_bytes_get_data(priv->rbytes, size);
+	}
+
+	*size = priv->bytes->len;
+	return priv->bytes->data;
+}
+
 void
 fb_mqtt_message_reset(FbMqttMessage *msg)
 {
 	FbMqttMessagePrivate *priv;
+	GBytes *bytes;
+	gsize size;
 
 	g_return_if_fail(FB_IS_MQTT_MESSAGE(msg));
 	priv = msg->priv;
 
-	if (priv->offset > 0) {
+	if (priv->offset == 0) {
+		return;
+	}
+
+	if (priv->rbytes != NULL) {
+		size = g_bytes_get_size(priv->rbytes);
+		bytes = g_bytes_new_from_bytes(priv->rbytes, priv->offset,
+		                               size - priv->offset);
+		g_bytes_unref(priv->rbytes);
+		priv->rbytes = bytes;
+	} else {
 		g_byte_array_remove_range(priv->bytes, 0, priv->offset);
-		priv->offset = 0;
-		priv->pos = 0;
 	}
+
+	priv->offset = 0;
+	priv->pos = 0;
 }
 
 const GByteArray *
@@ -919,6 +969,7 @@ fb_mqtt_message_bytes(FbMqttMessage *msg)
 
 	g_return_val_if_fail(FB_IS_MQTT_MESSAGE(msg), NULL);
 	priv = msg->priv;
+	g_return_val_if_fail(priv->bytes != NULL, NULL);
 
 	i = 0;
 	size = priv->bytes->len - priv->offset;
@@ -952,16 +1003,19 @@ gboolean
 fb_mqtt_message_read(FbMqttMessage *msg, gpointer data, guint size)
 {
 	FbMqttMessagePrivate *priv;
+	const guint8 *bytes;
+	gsize len;
 
 	g_return_val_if_fail(FB_IS_MQTT_MESSAGE(msg), FALSE);
 	priv = msg->priv;
+	bytes = fb_mqtt_message_data(priv, &len);
 
-	if ((priv->pos + size) > priv->bytes->len) {
+	if ((priv->pos + size) > len) {
 		return FALSE;
 	}
 
 	if ((data != NULL) && (size > 0)) {
-		memcpy(data, priv->bytes->data + priv->pos, size);
+		memcpy(data, bytes + priv->pos, size);
 	}
 
 	priv->pos += size;
@@ -972,15 +1026,16 @@ gboolean
 fb_mqtt_message_read_r(FbMqttMessage *msg, GByteArray *bytes)
 {
 	FbMqttMessagePrivate *priv;
-	guint size;
+	const guint8 *data;
+	gsize size;
 
 	g_return_val_if_fail(FB_IS_MQTT_MESSAGE(msg), FALSE);
 	priv = msg->priv;
-	size = priv->bytes->len - priv->pos;
+	data = fb_mqtt_message_data(priv, &size);
 
-	if (G_LIKELY(size > 0)) {
-		g_byte_array_append(bytes, priv->bytes->data + priv->pos,
-		                    size);
+	if (G_LIKELY(size > priv->pos)) {
+		g_byte_array_append(bytes, data + priv->pos,
+		                    size - priv->pos);
 	}
 
 	return TRUE;
@@ -1048,6 +1103,7 @@ fb_mqtt_message_write(FbMqttMessage *msg, gconstpointer data, guint size)
 
 	g_return_if_fail(FB_IS_MQTT_MESSAGE(msg));
 	priv = msg->priv;
+	g_return_if_fail(priv->bytes != NULL);
 
 	g_byte_array_append(priv->bytes, data, size);
 	priv->pos += size;
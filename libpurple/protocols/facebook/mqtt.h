@@ -88,6 +88,14 @@
  */
 #define FB_MQTT_TIMEOUT_PING (FB_MQTT_KA)
 
+/**
+ * FB_MQTT_READ_SIZE:
+ *
+ * The size, in bytes, of the buffer incoming packets are read into. It
+ * only grows beyond this for a larger packet, until that is read.
+ */
+#define FB_MQTT_READ_SIZE  4096
+
 /**
  * FB_MQTT_ERROR:
  *
@@ -371,16 +379,17 @@ fb_mqtt_message_new(FbMqttMessageType type, FbMqttMessageFlags flags);
 
 /**
  * fb_mqtt_message_new_bytes:
- * @bytes: The #GByteArray.
+ * @bytes: The #GBytes.
  *
- * Creates a new #FbMqttMessage from a #GByteArray. The returned
+ * Creates a new read-only #FbMqttMessage from a #GBytes. The data is
+ * not copied, a reference to @bytes is held instead. The returned
  * #FbMqttMessage should be freed with #g_object_unref() when no
  * longer needed.
  *
  * Returns: The new #FbMqttMessage.
  */
 FbMqttMessage *
-fb_mqtt_message_new_bytes(GByteArray *bytes);
+fb_mqtt_message_new_bytes(GBytes *bytes);
 
 /**
  * fb_mqtt_message_reset:
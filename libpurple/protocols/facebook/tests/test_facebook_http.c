@@ -0,0 +1,185 @@
+#include <glib.h>
+#include <string.h>
+
+#include <purple.h>
+
+#include "protocols/facebook/http.h"
+
+#define TEST_FACEBOOK_HTTP_SECRET  "secret"
+
+static FbHttpParams *
+test_facebook_http_params_request(void)
+{
+	FbHttpParams *params;
+
+	/* Roughly what every API request is built from */
+	params = fb_http_params_new();
+	fb_http_params_set_str(params, "query_params",
+	                       "{\"0\":[\"100001234567890\"],\"1\":\"true\"}");
+	fb_http_params_set_int(params, "query_id",
+	                       G_GINT64_CONSTANT(10153915107411729));
+	fb_http_params_set_str(params, "api_key", "256002347743983");
+	fb_http_params_set_str(params, "device_id",
+	                       "c1ae7f93-2a0b-4b11-9ed7-bd6c1c3de4a1");
+	fb_http_params_set_str(params, "fb_api_req_friendly_name",
+	                       "UsersQuery");
+	fb_http_params_set_str(params, "format", "json");
+	fb_http_params_set_str(params, "method", "get");
+	fb_http_params_set_str(params, "locale", "en_US");
+	fb_http_params_set_str(params, "email", "someone@example.com");
+	fb_http_params_set_str(params, "password", "pass word&more");
+	fb_http_params_set_str(params, "generate_session_cookies", "1");
+	fb_http_params_set_str(params, "sig", "stale");
+	return params;
+}
+
+static void
+test_facebook_http_params_get_set(void)
+{
+	FbHttpParams *params;
+	GError *err = NULL;
+
+	params = fb_http_params_new();
+	fb_http_params_set_str(params, "str", "value");
+	fb_http_params_set_int(params, "int", -42);
+	fb_http_params_set_bool(params, "bool", TRUE);
+	fb_http_params_set_strf(params, "strf", "%s-%d", "a", 1);
+
+	g_assert_cmpstr(fb_http_params_get_str(params, "str", NULL), ==,
+	                "value");
+	g_assert_cmpint(fb_http_params_get_int(params, "int", NULL), ==, -42);
+	g_assert_true(fb_http_params_get_bool(params, "bool", NULL));
+	g_assert_cmpstr(fb_http_params_get_str(params, "strf", NULL), ==,
+	                "a-1");
+
+	fb_http_params_set_str(params, "str", "replaced");
+	g_assert_cmpstr(fb_http_params_get_str(params, "str", NULL), ==,
+	                "replaced");
+
+	g_assert_null(fb_http_params_get_str(params, "missing", &err));
+	g_assert_error(err, FB_HTTP_ERROR, FB_HTTP_ERROR_NOMATCH);
+	g_clear_error(&err);
+
+	fb_http_params_remove(params, "str");
+	fb_http_params_remove(params, "missing");
+	g_assert_null(fb_http_params_get_str(params, "str", NULL));
+	g_assert_cmpint(fb_http_params_get_int(params, "int", NULL), ==, -42);
+
+	fb_http_params_free(params);
+}
+
+static void
+test_facebook_http_params_parse(void)
+{
+	FbHttpParams *params;
+
+	params = fb_http_params_new_parse("https://example.com/p.jpg"
+	                                  "?oh=abc123&oe=5E2F&x=a%20b",
+	                                  TRUE);
+	g_assert_cmpstr(fb_http_params_get_str(params, "oh", NULL), ==,
+	                "abc123");
+	g_assert_cmpstr(fb_http_params_get_str(params, "x", NULL), ==, "a b");
+	fb_http_params_free(params);
+
+	params = fb_http_params_new_parse("https://example.com/p.jpg", TRUE);
+	g_assert_null(fb_http_params_get_str(params, "oh", NULL));
+	fb_http_params_free(params);
+
+	params = fb_http_params_new_parse("a=1&b=2", FALSE);
+	g_assert_cmpint(fb_http_params_get_int(params, "b", NULL), ==, 2);
+	fb_http_params_free(params);
+}
+
+static void
+test_facebook_http_params_close(void)
+{
+	FbHttpParams *params;
+	gchar *data;
+	gchar *expected;
+	gchar *sig;
+	gsize size;
+
+	params = fb_http_params_new();
+	fb_http_params_set_str(params, "c", "a b&c");
+	fb_http_params_set_str(params, "b", "2");
+	fb_http_params_set_str(params, "A", "1");
+
+	data = fb_http_params_close(params, NULL, &size);
+	g_assert_cmpstr(data, ==, "A=1&b=2&c=a+b%26c");
+	g_assert_cmpuint(size, ==, strlen(data));
+	g_free(data);
+
+	params = fb_http_params_new();
+	fb_http_params_set_str(params, "c", "a b&c");
+	fb_http_params_set_str(params, "b", "2");
+	fb_http_params_set_str(params, "A", "1");
+
+	/* Signed in case insensitive name order, without encoding */
+	sig = g_compute_checksum_for_string(G_CHECKSUM_MD5,
+	                                    "A=1b=2c=a b&c"
+	                                    TEST_FACEBOOK_HTTP_SECRET, -1);
+	expected = g_strdup_printf("A=1&b=2&c=a+b%%26c&sig=%s", sig);
+
+	data = fb_http_params_close(params, TEST_FACEBOOK_HTTP_SECRET, NULL);
+	g_assert_cmpstr(data, ==, expected);
+
+	g_free(expected);
+	g_free(data);
+	g_free(sig);
+
+	params = fb_http_params_new();
+	sig = g_compute_checksum_for_string(G_CHECKSUM_MD5,
+	                                    TEST_FACEBOOK_HTTP_SECRET, -1);
+	expected = g_strdup_printf("sig=%s", sig);
+
+	data = fb_http_params_close(params, TEST_FACEBOOK_HTTP_SECRET, NULL);
+	g_assert_cmpstr(data, ==, expected);
+
+	g_free(expected);
+	g_free(data);
+	g_free(sig);
+}
+
+static void
+test_facebook_http_params_benchmark(void)
+{
+	FbHttpParams *params;
+	gchar *data;
+	gdouble elapsed;
+	guint i;
+	guint n = 100000;
+
+	g_test_timer_start();
+
+	for (i = 0; i < n; i++) {
+		params = test_facebook_http_params_request();
+		fb_http_params_remove(params, "sig");
+		data = fb_http_params_close(params, TEST_FACEBOOK_HTTP_SECRET,
+		                            NULL);
+		g_free(data);
+	}
+
+	elapsed = g_test_timer_elapsed();
+	g_test_minimized_result(elapsed / n * G_USEC_PER_SEC,
+	                        "%u signed requests built, %.3f us each",
+	                        n, elapsed / n * G_USEC_PER_SEC);
+}
+
+gint
+main(gint argc, gchar **argv) {
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/facebook/http/params/get-set",
+	                test_facebook_http_params_get_set);
+	g_test_add_func("/facebook/http/params/parse",
+	                test_facebook_http_params_parse);
+	g_test_add_func("/facebook/http/params/close",
+	                test_facebook_http_params_close);
+
+	if (g_test_perf()) {
+		g_test_add_func("/facebook/http/params/benchmark",
+		                test_facebook_http_params_benchmark);
+	}
+
+	return g_test_run();
+}
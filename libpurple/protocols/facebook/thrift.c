@@ -132,6 +132,21 @@ fb_thrift_reset(FbThrift *thft)
 	priv->pos = priv->offset;
 }
 
+static void
+fb_thrift_get_reader(FbThriftPrivate *priv, FbThriftReader *rdr)
+{
+	fb_thrift_reader_init(rdr, priv->bytes->data, priv->bytes->len);
+	rdr->pos = priv->pos;
+	rdr->lastbool = priv->lastbool;
+}
+
+static void
+fb_thrift_set_reader(FbThriftPrivate *priv, const FbThriftReader *rdr)
+{
+	priv->pos = rdr->pos;
+	priv->lastbool = rdr->lastbool;
+}
+
 gboolean
 fb_thrift_read(FbThrift *thft, gpointer data, guint size)
 {
@@ -156,30 +171,16 @@ gboolean
 fb_thrift_read_bool(FbThrift *thft, gboolean *value)
 {
 	FbThriftPrivate *priv;
-	guint8 byte;
+	FbThriftReader rdr;
+	gboolean ret;
 
 	g_return_val_if_fail(FB_IS_THRIFT(thft), FALSE);
 	priv = thft->priv;
 
-	if ((priv->lastbool & 0x03) != 0x01) {
-		if (!fb_thrift_read_byte(thft, &byte)) {
-			return FALSE;
-		}
-
-		if (value != NULL) {
-			*value = (byte & 0x0F) == 0x01;
-		}
-
-		priv->lastbool = 0;
-		return TRUE;
-	}
-
-	if (value != NULL) {
-		*value = ((priv->lastbool & 0x04) >> 2) != 0;
-	}
-
-	priv->lastbool = 0;
-	return TRUE;
+	fb_thrift_get_reader(priv, &rdr);
+	ret = fb_thrift_reader_read_bool(&rdr, value);
+	fb_thrift_set_reader(priv, &rdr);
+	return ret;
 }
 
 gboolean
@@ -291,24 +292,17 @@ fb_thrift_read_i64(FbThrift *thft, gint64 *value)
 gboolean
 fb_thrift_read_vi64(FbThrift *thft, guint64 *value)
 {
-	guint i = 0;
-	guint8 byte;
-	guint64 u64 = 0;
-
-	do {
-		if (!fb_thrift_read_byte(thft, &byte)) {
-			return FALSE;
-		}
-
-		u64 |= ((guint64) (byte & 0x7F)) << i;
-		i += 7;
-	} while ((byte & 0x80) == 0x80);
+	FbThriftPrivate *priv;
+	FbThriftReader rdr;
+	gboolean ret;
 
-	if (value != NULL) {
-		*value = u64;
-	}
+	g_return_val_if_fail(FB_IS_THRIFT(thft), FALSE);
+	priv = thft->priv;
 
-	return TRUE;
+	fb_thrift_get_reader(priv, &rdr);
+	ret = fb_thrift_reader_read_vi64(&rdr, value);
+	fb_thrift_set_reader(priv, &rdr);
+	return ret;
 }
 
 gboolean
@@ -345,43 +339,16 @@ fb_thrift_read_field(FbThrift *thft, FbThriftType *type, gint16 *id,
 					 gint16 lastid)
 {
 	FbThriftPrivate *priv;
-	gint16 i16;
-	guint8 byte;
+	FbThriftReader rdr;
+	gboolean ret;
 
 	g_return_val_if_fail(FB_IS_THRIFT(thft), FALSE);
-	g_return_val_if_fail(type != NULL, FALSE);
-	g_return_val_if_fail(id != NULL, FALSE);
 	priv = thft->priv;
 
-	if (!fb_thrift_read_byte(thft, &byte)) {
-		return FALSE;
-	}
-
-	if (byte == FB_THRIFT_TYPE_STOP) {
-		*type = FB_THRIFT_TYPE_STOP;
-		return FALSE;
-	}
-
-	*type = fb_thrift_ct2t(byte & 0x0F);
-	i16 = (byte & 0xF0) >> 4;
-
-	if (i16 == 0) {
-		if (!fb_thrift_read_i16(thft, id)) {
-			return FALSE;
-		}
-	} else {
-		*id = lastid + i16;
-	}
-
-	if (*type == FB_THRIFT_TYPE_BOOL) {
-		priv->lastbool = 0x01;
-
-		if ((byte & 0x0F) == 0x01) {
-			priv->lastbool |= 0x01 << 2;
-		}
-	}
-
-	return TRUE;
+	fb_thrift_get_reader(priv, &rdr);
+	ret = fb_thrift_reader_read_field(&rdr, type, id, lastid);
+	fb_thrift_set_reader(priv, &rdr);
+	return ret;
 }
 
 gboolean
@@ -657,6 +624,209 @@ fb_thrift_write_set(FbThrift *thft, FbThriftType type, guint size)
 	fb_thrift_write_list(thft, type, size);
 }
 
+void
+fb_thrift_reader_init(FbThriftReader *rdr, const guint8 *data, gsize size)
+{
+	g_return_if_fail(rdr != NULL);
+
+	rdr->data = data;
+	rdr->size = size;
+	rdr->pos = 0;
+	rdr->lastbool = 0;
+}
+
+gboolean
+fb_thrift_reader_read(FbThriftReader *rdr, gpointer data, gsize size)
+{
+	if (G_UNLIKELY(size > (rdr->size - rdr->pos))) {
+		return FALSE;
+	}
+
+	if ((data != NULL) && (size > 0)) {
+		memcpy(data, rdr->data + rdr->pos, size);
+	}
+
+	rdr->pos += size;
+	return TRUE;
+}
+
+gboolean
+fb_thrift_reader_read_bool(FbThriftReader *rdr, gboolean *value)
+{
+	guint8 byte;
+
+	if ((rdr->lastbool & 0x03) != 0x01) {
+		if (!fb_thrift_reader_read_byte(rdr, &byte)) {
+			return FALSE;
+		}
+
+		if (value != NULL) {
+			*value = (byte & 0x0F) == 0x01;
+		}
+
+		rdr->lastbool = 0;
+		return TRUE;
+	}
+
+	if (value != NULL) {
+		*value = ((rdr->lastbool & 0x04) >> 2) != 0;
+	}
+
+	rdr->lastbool = 0;
+	return TRUE;
+}
+
+gboolean
+fb_thrift_reader_read_byte(FbThriftReader *rdr, guint8 *value)
+{
+	if (G_UNLIKELY(rdr->pos >= rdr->size)) {
+		return FALSE;
+	}
+
+	if (value != NULL) {
+		*value = rdr->data[rdr->pos];
+	}
+
+	rdr->pos++;
+	return TRUE;
+}
+
+gboolean
+fb_thrift_reader_read_i16(FbThriftReader *rdr, gint16 *value)
+{
+	gint64 i64;
+
+	if (!fb_thrift_reader_read_i64(rdr, &i64)) {
+		return FALSE;
+	}
+
+	if (value != NULL) {
+		*value = i64;
+	}
+
+	return TRUE;
+}
+
+gboolean
+fb_thrift_reader_read_i32(FbThriftReader *rdr, gint32 *value)
+{
+	gint64 i64;
+
+	if (!fb_thrift_reader_read_i64(rdr, &i64)) {
+		return FALSE;
+	}
+
+	if (value != NULL) {
+		*value = i64;
+	}
+
+	return TRUE;
+}
+
+gboolean
+fb_thrift_reader_read_str(FbThriftReader *rdr, gchar **value)
+{
+	guint64 size;
+
+	if (!fb_thrift_reader_read_vi64(rdr, &size) ||
+	    (size > (rdr->size - rdr->pos)))
+	{
+		return FALSE;
+	}
+
+	if (value != NULL) {
+		*value = g_strndup((const gchar *) rdr->data + rdr->pos, size);
+	}
+
+	rdr->pos += size;
+	return TRUE;
+}
+
+gboolean
+fb_thrift_reader_read_field(FbThriftReader *rdr, FbThriftType *type,
+                            gint16 *id, gint16 lastid)
+{
+	gint16 i16;
+	guint8 byte;
+
+	g_return_val_if_fail(type != NULL, FALSE);
+	g_return_val_if_fail(id != NULL, FALSE);
+
+	if (!fb_thrift_reader_read_byte(rdr, &byte)) {
+		return FALSE;
+	}
+
+	if (byte == FB_THRIFT_TYPE_STOP) {
+		*type = FB_THRIFT_TYPE_STOP;
+		return FALSE;
+	}
+
+	*type = fb_thrift_ct2t(byte & 0x0F);
+	i16 = (byte & 0xF0) >> 4;
+
+	if (i16 == 0) {
+		if (!fb_thrift_reader_read_i16(rdr, id)) {
+			return FALSE;
+		}
+	} else {
+		*id = lastid + i16;
+	}
+
+	if (*type == FB_THRIFT_TYPE_BOOL) {
+		rdr->lastbool = 0x01;
+
+		if ((byte & 0x0F) == 0x01) {
+			rdr->lastbool |= 0x01 << 2;
+		}
+	}
+
+	return TRUE;
+}
+
+gboolean
+fb_thrift_reader_read_stop(FbThriftReader *rdr)
+{
+	guint8 byte;
+
+	return fb_thrift_reader_read_byte(rdr, &byte) &&
+	       (byte == FB_THRIFT_TYPE_STOP);
+}
+
+gboolean
+fb_thrift_reader_read_isstop(FbThriftReader *rdr)
+{
+	return (rdr->pos < rdr->size) &&
+	       (rdr->data[rdr->pos] == FB_THRIFT_TYPE_STOP);
+}
+
+gboolean
+fb_thrift_reader_read_list(FbThriftReader *rdr, FbThriftType *type,
+                           guint *size)
+{
+	guint8 byte;
+	guint64 u64;
+
+	g_return_val_if_fail(type != NULL, FALSE);
+	g_return_val_if_fail(size != NULL, FALSE);
+
+	if (!fb_thrift_reader_read_byte(rdr, &byte)) {
+		return FALSE;
+	}
+
+	*type = fb_thrift_ct2t(byte & 0x0F);
+	*size = (byte & 0xF0) >> 4;
+
+	if (*size == 0x0F) {
+		if (!fb_thrift_reader_read_vi64(rdr, &u64)) {
+			return FALSE;
+		}
+
+		*size = (guint32) u64;
+	}
+
+	return TRUE;
+}
+
 guint8
 fb_thrift_t2ct(FbThriftType type)
 {
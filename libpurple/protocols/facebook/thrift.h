@@ -76,6 +76,27 @@ typedef enum
 	FB_THRIFT_TYPE_UNKNOWN
 } FbThriftType;
 
+typedef struct _FbThriftReader FbThriftReader;
+
+/**
+ * FbThriftReader:
+ * @data: The data.
+ * @size: The size of @data.
+ * @pos: The cursor position.
+ * @lastbool: The last boolean value.
+ *
+ * Represents a lightweight reader for compact Thrift data. Unlike an
+ * #FbThrift, this is meant to be allocated on the stack, and is only
+ * valid for as long as the data it was initialized with.
+ */
+struct _FbThriftReader
+{
+	const guint8 *data;
+	gsize size;
+	gsize pos;
+	guint lastbool;
+};
+
 /**
  * fb_thrift_get_type:
  *
@@ -546,6 +567,208 @@ fb_thrift_write_map(FbThrift *thft, FbThriftType ktype, FbThriftType vtype,
 void
 fb_thrift_write_set(FbThrift *thft, FbThriftType type, guint size);
 
+/**
+ * fb_thrift_reader_init:
+ * @rdr: The #FbThriftReader.
+ * @data: The data.
+ * @size: The size of @data.
+ *
+ * Initializes an #FbThriftReader over @data. The data is not copied.
+ */
+void
+fb_thrift_reader_init(FbThriftReader *rdr, const guint8 *data, gsize size);
+
+/**
+ * fb_thrift_reader_read:
+ * @rdr: The #FbThriftReader.
+ * @data: The data buffer or #NULL.
+ * @size: The size of @data.
+ *
+ * Reads data from the #FbThriftReader into a buffer. If @data is
+ * #NULL, this will simply advance the cursor position.
+ *
+ * Returns: #TRUE if the data was completely read, otherwise #FALSE.
+ */
+gboolean
+fb_thrift_reader_read(FbThriftReader *rdr, gpointer data, gsize size);
+
+/**
+ * fb_thrift_reader_read_vi64:
+ * @rdr: The #FbThriftReader.
+ * @value: The return location for the value or #NULL.
+ *
+ * Reads a 64-bit unsigned integer from the #FbThriftReader. This
+ * function only reads if the integer is encoded as a varint.
+ *
+ * Returns: #TRUE if the value was read, otherwise #FALSE.
+ */
+static inline gboolean
+fb_thrift_reader_read_vi64(FbThriftReader *rdr, guint64 *value)
+{
+	guint i = 0;
+	guint8 byte;
+	guint64 u64 = 0;
+
+	do {
+		if (G_UNLIKELY((rdr->pos >= rdr->size) || (i > 63))) {
+			return FALSE;
+		}
+
+		byte = rdr->data[rdr->pos++];
+		u64 |= ((guint64) (byte & 0x7F)) << i;
+		i += 7;
+	} while ((byte & 0x80) == 0x80);
+
+	if (value != NULL) {
+		*value = u64;
+	}
+
+	return TRUE;
+}
+
+/**
+ * fb_thrift_reader_read_i64:
+ * @rdr: The #FbThriftReader.
+ * @value: The return location for the value or #NULL.
+ *
+ * Reads a signed 64-bit integer from the #FbThriftReader. This will
+ * convert from the zigzag format.
+ *
+ * Returns: #TRUE if the value was read, otherwise #FALSE.
+ */
+static inline gboolean
+fb_thrift_reader_read_i64(FbThriftReader *rdr, gint64 *value)
+{
+	guint64 u64;
+
+	if (!fb_thrift_reader_read_vi64(rdr, &u64)) {
+		return FALSE;
+	}
+
+	if (value != NULL) {
+		/* Convert from zigzag to integer */
+		*value = (u64 >> 0x01) ^ -(u64 & 0x01);
+	}
+
+	return TRUE;
+}
+
+/**
+ * fb_thrift_reader_read_bool:
+ * @rdr: The #FbThriftReader.
+ * @value: The return location for the value or #NULL.
+ *
+ * Reads a boolean value from the #FbThriftReader.
+ *
+ * Returns: #TRUE if the value was read, otherwise #FALSE.
+ */
+gboolean
+fb_thrift_reader_read_bool(FbThriftReader *rdr, gboolean *value);
+
+/**
+ * fb_thrift_reader_read_byte:
+ * @rdr: The #FbThriftReader.
+ * @value: The return location for the value or #NULL.
+ *
+ * Reads an 8-bit integer value from the #FbThriftReader.
+ *
+ * Returns: #TRUE if the value was read, otherwise #FALSE.
+ */
+gboolean
+fb_thrift_reader_read_byte(FbThriftReader *rdr, guint8 *value);
+
+/**
+ * fb_thrift_reader_read_i16:
+ * @rdr: The #FbThriftReader.
+ * @value: The return location for the value or #NULL.
+ *
+ * Reads a signed 16-bit integer value from the #FbThriftReader. This
+ * will convert from the zigzag format.
+ *
+ * Returns: #TRUE if the value was read, otherwise #FALSE.
+ */
+gboolean
+fb_thrift_reader_read_i16(FbThriftReader *rdr, gint16 *value);
+
+/**
+ * fb_thrift_reader_read_i32:
+ * @rdr: The #FbThriftReader.
+ * @value: The return location for the value or #NULL.
+ *
+ * Reads a signed 32-bit integer value from the #FbThriftReader. This
+ * will convert from the zigzag format.
+ *
+ * Returns: #TRUE if the value was read, otherwise #FALSE.
+ */
+gboolean
+fb_thrift_reader_read_i32(FbThriftReader *rdr, gint32 *value);
+
+/**
+ * fb_thrift_reader_read_str:
+ * @rdr: The #FbThriftReader.
+ * @value: The return location for the value or #NULL.
+ *
+ * Reads a string value from the #FbThriftReader. The value returned
+ * to @value should be freed with #g_free() when no longer needed. If
+ * @value is #NULL, this will simply advance the cursor position.
+ *
+ * Returns: #TRUE if the value was read, otherwise #FALSE.
+ */
+gboolean
+fb_thrift_reader_read_str(FbThriftReader *rdr, gchar **value);
+
+/**
+ * fb_thrift_reader_read_field:
+ * @rdr: The #FbThriftReader.
+ * @type: The return location for the #FbThriftType.
+ * @id: The return location for the identifier.
+ * @lastid: The identifier of the previous field.
+ *
+ * Reads a field header from the #FbThriftReader.
+ *
+ * Returns: #TRUE if the field header was read, otherwise #FALSE.
+ */
+gboolean
+fb_thrift_reader_read_field(FbThriftReader *rdr, FbThriftType *type,
+                            gint16 *id, gint16 lastid);
+
+/**
+ * fb_thrift_reader_read_stop:
+ * @rdr: The #FbThriftReader.
+ *
+ * Reads a field stop from the #FbThriftReader.
+ *
+ * Returns: #TRUE if the field stop was read, otherwise #FALSE.
+ */
+gboolean
+fb_thrift_reader_read_stop(FbThriftReader *rdr);
+
+/**
+ * fb_thrift_reader_read_isstop:
+ * @rdr: The #FbThriftReader.
+ *
+ * Determines if the next byte of the #FbThriftReader is a field stop.
+ * This does not advance the cursor position.
+ *
+ * Returns: #TRUE if the next byte is a field stop, otherwise #FALSE.
+ */
+gboolean
+fb_thrift_reader_read_isstop(FbThriftReader *rdr);
+
+/**
+ * fb_thrift_reader_read_list:
+ * @rdr: The #FbThriftReader.
+ * @type: The return location for the #FbThriftType.
+ * @size: The return location for the size.
+ *
+ * Reads a list header from the #FbThriftReader.
+ *
+ * Returns: #TRUE if the list header was read, otherwise #FALSE.
+ */
+gboolean
+fb_thrift_reader_read_list(FbThriftReader *rdr, FbThriftType *type,
+                           guint *size);
+
 /**
  * fb_thrift_t2ct:
  * @type: The #FbThriftType.
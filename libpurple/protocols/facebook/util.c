@@ -177,35 +177,27 @@ fb_util_debug_fatal(const gchar *format, ...)
 	va_end(ap);
 }
 
-void
-fb_util_debug_hexdump(PurpleDebugLevel level, const GByteArray *bytes,
-                      const gchar *format, ...)
+static void
+fb_util_debug_hexdump_data(PurpleDebugLevel level, const guint8 *data,
+                           gsize size)
 {
 	gchar c;
-	guint i;
-	guint j;
+	gsize i;
+	gsize j;
 	GString *gstr;
-	va_list ap;
 
 	static const gchar *indent = "  ";
 
-	g_return_if_fail(bytes != NULL);
-
-	if (format != NULL) {
-		va_start(ap, format);
-		fb_util_vdebug(level, format, ap);
-		va_end(ap);
-	}
-
 	gstr = g_string_sized_new(80);
 
-	for (i = 0; i < bytes->len; i += 16) {
-		g_string_append_printf(gstr, "%s%08x  ", indent, i);
+	for (i = 0; i < size; i += 16) {
+		g_string_append_printf(gstr, "%s%08" G_GSIZE_MODIFIER "x  ",
+		                       indent, i);
 
 		for (j = 0; j < 16; j++) {
-			if ((i + j) < bytes->len) {
+			if ((i + j) < size) {
 				g_string_append_printf(gstr, "%02x ",
-				                       bytes->data[i + j]);
+				                       data[i + j]);
 			} else {
 				g_string_append(gstr, "   ");
 			}
@@ -217,8 +209,8 @@ fb_util_debug_hexdump(PurpleDebugLevel level, const GByteArray *bytes,
 
 		g_string_append(gstr, " |");
 
-		for (j = 0; (j < 16) && ((i + j) < bytes->len); j++) {
-			c = bytes->data[i + j];
+		for (j = 0; (j < 16) && ((i + j) < size); j++) {
+			c = data[i + j];
 
 			if (!g_ascii_isprint(c) || g_ascii_isspace(c)) {
 				c = '.';
@@ -232,11 +224,48 @@ fb_util_debug_hexdump(PurpleDebugLevel level, const GByteArray *bytes,
 		g_string_erase(gstr, 0, -1);
 	}
 
-	g_string_append_printf(gstr, "%s%08x", indent, i);
+	g_string_append_printf(gstr, "%s%08" G_GSIZE_MODIFIER "x", indent, i);
 	fb_util_debug(level, "%s", gstr->str);
 	g_string_free(gstr, TRUE);
 }
 
+void
+fb_util_debug_hexdump(PurpleDebugLevel level, const GByteArray *bytes,
+                      const gchar *format, ...)
+{
+	va_list ap;
+
+	g_return_if_fail(bytes != NULL);
+
+	if (format != NULL) {
+		va_start(ap, format);
+		fb_util_vdebug(level, format, ap);
+		va_end(ap);
+	}
+
+	fb_util_debug_hexdump_data(level, bytes->data, bytes->len);
+}
+
+void
+fb_util_debug_hexdump_bytes(PurpleDebugLevel level, GBytes *bytes,
+                            const gchar *format, ...)
+{
+	const guint8 *data;
+	gsize size;
+	va_list ap;
+
+	g_return_if_fail(bytes != NULL);
+
+	if (format != NULL) {
+		va_start(ap, format);
+		fb_util_vdebug(level, format, ap);
+		va_end(ap);
+	}
+
+	data = g_bytes_get_data(bytes, &size);
+	fb_util_debug_hexdump_data(level, data, size);
+}
+
 gchar *
 fb_util_get_locale(void)
 {
@@ -519,69 +548,145 @@ fb_util_zlib_test(const GByteArray *bytes)
 	       ((b0 & 0x0F) == 8 /* Z_DEFLATED */); /* Check the method */
 }
 
-static GByteArray *
-fb_util_zlib_conv(GConverter *conv, const GByteArray *bytes, GError **error)
+struct _FbUtilZlib
+{
+	GConverter *deflater;
+	GConverter *inflater;
+	FbUtilZlibStats dstats;
+	FbUtilZlibStats istats;
+};
+
+FbUtilZlib *
+fb_util_zlib_new(void)
+{
+	FbUtilZlib *zlib;
+
+	zlib = g_new0(FbUtilZlib, 1);
+	zlib->deflater = G_CONVERTER(g_zlib_compressor_new(
+		G_ZLIB_COMPRESSOR_FORMAT_ZLIB, -1));
+	zlib->inflater = G_CONVERTER(g_zlib_decompressor_new(
+		G_ZLIB_COMPRESSOR_FORMAT_ZLIB));
+	return zlib;
+}
+
+void
+fb_util_zlib_free(FbUtilZlib *zlib)
+{
+	g_object_unref(zlib->deflater);
+	g_object_unref(zlib->inflater);
+	g_free(zlib);
+}
+
+void
+fb_util_zlib_get_stats(FbUtilZlib *zlib, FbUtilZlibStats *inflate,
+                       FbUtilZlibStats *deflate)
+{
+	g_return_if_fail(zlib != NULL);
+
+	if (inflate != NULL) {
+		*inflate = zlib->istats;
+	}
+
+	if (deflate != NULL) {
+		*deflate = zlib->dstats;
+	}
+}
+
+static gboolean
+fb_util_zlib_conv(GConverter *conv, FbUtilZlibStats *stats,
+                  const guint8 *data, gsize size, GByteArray *out,
+                  gsize hint, GError **error)
 {
-	GByteArray *ret;
 	GConverterResult res;
+	GError *err = NULL;
+	gint64 start;
 	gsize cize = 0;
 	gsize rize;
+	gsize used;
 	gsize wize;
-	guint8 data[1024];
+	guint len;
+
+	start = g_get_monotonic_time();
+	len = out->len;
+	used = out->len;
 
-	ret = g_byte_array_new();
+	g_converter_reset(conv);
+	g_byte_array_set_size(out, used + MAX(hint, 64));
 
 	while (TRUE) {
 		rize = 0;
 		wize = 0;
 
-		res = g_converter_convert(conv,
-		                          bytes->data + cize,
-		                          bytes->len - cize,
-		                          data, sizeof data,
+		res = g_converter_convert(conv, data + cize, size - cize,
+		                          out->data + used, out->len - used,
 		                          G_CONVERTER_INPUT_AT_END,
-		                          &rize, &wize, error);
-
-		switch (res) {
-		case G_CONVERTER_CONVERTED:
-			g_byte_array_append(ret, data, wize);
-			cize += rize;
-			break;
+		                          &rize, &wize, &err);
 
-		case G_CONVERTER_ERROR:
-			g_byte_array_free(ret, TRUE);
-			return NULL;
+		if ((res == G_CONVERTER_ERROR) &&
+		    !g_error_matches(err, G_IO_ERROR, G_IO_ERROR_NO_SPACE))
+		{
+			g_propagate_error(error, err);
+			g_byte_array_set_size(out, len);
+			return FALSE;
+		}
 
-		case G_CONVERTER_FINISHED:
-			g_byte_array_append(ret, data, wize);
-			return ret;
+		g_clear_error(&err);
+		cize += rize;
+		used += wize;
 
-		default:
+		if (res == G_CONVERTER_FINISHED) {
 			break;
 		}
+
+		/* Out of space, grow by the amount produced so far */
+		if ((used == out->len) || (res == G_CONVERTER_ERROR)) {
+			g_byte_array_set_size(out, out->len + MAX(used - len, 64));
+		}
 	}
+
+	g_byte_array_set_size(out, used);
+
+	stats->calls++;
+	stats->bytes_in += size;
+	stats->bytes_out += used - len;
+	stats->usecs += g_get_monotonic_time() - start;
+	return TRUE;
 }
 
-GByteArray *
-fb_util_zlib_deflate(const GByteArray *bytes, GError **error)
+gboolean
+fb_util_zlib_deflate(FbUtilZlib *zlib, const guint8 *data, gsize size,
+                     GByteArray *out, GError **error)
 {
-	GByteArray *ret;
-	GZlibCompressor *conv;
+	gsize hint;
 
-	conv = g_zlib_compressor_new(G_ZLIB_COMPRESSOR_FORMAT_ZLIB, -1);
-	ret = fb_util_zlib_conv(G_CONVERTER(conv), bytes, error);
-	g_object_unref(conv);
-	return ret;
+	g_return_val_if_fail(zlib != NULL, FALSE);
+	g_return_val_if_fail(out != NULL, FALSE);
+
+	/* Slightly above the worst case of zlib's deflateBound() */
+	hint = size + (size >> 10) + 64;
+
+	return fb_util_zlib_conv(zlib->deflater, &zlib->dstats, data, size,
+	                         out, hint, error);
 }
 
-GByteArray *
-fb_util_zlib_inflate(const GByteArray *bytes, GError **error)
+gboolean
+fb_util_zlib_inflate(FbUtilZlib *zlib, const guint8 *data, gsize size,
+                     GByteArray *out, GError **error)
 {
-	GByteArray *ret;
-	GZlibDecompressor *conv;
+	FbUtilZlibStats *stats;
+	gsize hint;
+
+	g_return_val_if_fail(zlib != NULL, FALSE);
+	g_return_val_if_fail(out != NULL, FALSE);
+	stats = &zlib->istats;
+
+	/* Expect the ratio seen so far, with some headroom */
+	if (stats->bytes_in > 0) {
+		hint = (size * stats->bytes_out / stats->bytes_in) * 5 / 4;
+	} else {
+		hint = size * 4;
+	}
 
-	conv = g_zlib_decompressor_new(G_ZLIB_COMPRESSOR_FORMAT_ZLIB);
-	ret = fb_util_zlib_conv(G_CONVERTER(conv), bytes, error);
-	g_object_unref(conv);
-	return ret;
+	return fb_util_zlib_conv(zlib->inflater, stats, data, size, out,
+	                         hint, error);
 }
@@ -89,6 +89,30 @@ typedef enum
 	FB_UTIL_ERROR_GENERAL
 } FbUtilError;
 
+/**
+ * FbUtilZlib:
+ *
+ * Represents a reusable zlib codec.
+ */
+typedef struct _FbUtilZlib FbUtilZlib;
+
+/**
+ * FbUtilZlibStats:
+ * @calls: The number of conversions.
+ * @bytes_in: The amount of bytes converted.
+ * @bytes_out: The amount of bytes produced.
+ * @usecs: The time spent converting in microseconds.
+ *
+ * Represents the statistics of one direction of an #FbUtilZlib.
+ */
+typedef struct
+{
+	guint64 calls;
+	guint64 bytes_in;
+	guint64 bytes_out;
+	gint64 usecs;
+} FbUtilZlibStats;
+
 /**
  * fb_util_error_quark:
  *
@@ -209,6 +233,21 @@ fb_util_debug_hexdump(PurpleDebugLevel level, const GByteArray *bytes,
                       const gchar *format, ...)
                       G_GNUC_PRINTF(3, 4);
 
+/**
+ * fb_util_debug_hexdump_bytes:
+ * @level: The #PurpleDebugLevel.
+ * @bytes: The #GBytes.
+ * @format: The format string literal.
+ * @...: The arguments for @format.
+ *
+ * Logs a hexdump of a #GBytes. If the messages is unsafe or verbose,
+ * apply the appropriate #FbUtilDebugFlags.
+ */
+void
+fb_util_debug_hexdump_bytes(PurpleDebugLevel level, GBytes *bytes,
+                            const gchar *format, ...)
+                            G_GNUC_PRINTF(3, 4);
+
 /**
  * fb_util_get_locale:
  *
@@ -315,30 +354,73 @@ fb_util_strtest(const gchar *str, GAsciiType type);
 gboolean
 fb_util_zlib_test(const GByteArray *bytes);
 
+/**
+ * fb_util_zlib_new:
+ *
+ * Creates a new #FbUtilZlib. The codec state is reused by every
+ * conversion. The returned #FbUtilZlib should be freed with
+ * #fb_util_zlib_free() when no longer needed.
+ *
+ * Returns: The new #FbUtilZlib.
+ */
+FbUtilZlib *
+fb_util_zlib_new(void);
+
+/**
+ * fb_util_zlib_free:
+ * @zlib: The #FbUtilZlib.
+ *
+ * Frees all memory used by the #FbUtilZlib.
+ */
+void
+fb_util_zlib_free(FbUtilZlib *zlib);
+
+/**
+ * fb_util_zlib_get_stats:
+ * @zlib: The #FbUtilZlib.
+ * @inflate: The return location for the inflate #FbUtilZlibStats.
+ * @deflate: The return location for the deflate #FbUtilZlibStats.
+ *
+ * Gets the statistics of the #FbUtilZlib.
+ */
+void
+fb_util_zlib_get_stats(FbUtilZlib *zlib, FbUtilZlibStats *inflate,
+                       FbUtilZlibStats *deflate);
+
 /**
  * fb_util_zlib_deflate:
- * @bytes: The #GByteArray.
+ * @zlib: The #FbUtilZlib.
+ * @data: The data.
+ * @size: The size of @data.
+ * @out: The #GByteArray to append to.
  * @error: The return location for the #GError or #NULL.
  *
- * Deflates a #GByteArray with zlib. The returned #GByteArray should be
- * freed with #g_byte_array_free() when no longer needed.
+ * Deflates data with zlib, appending the result to @out. The output
+ * is sized ahead of time, so this is usually a single conversion.
  *
- * Returns: The deflated #GByteArray or #NULL on error.
+ * Returns: #TRUE if the data was deflated, otherwise #FALSE.
  */
-GByteArray *
-fb_util_zlib_deflate(const GByteArray *bytes, GError **error);
+gboolean
+fb_util_zlib_deflate(FbUtilZlib *zlib, const guint8 *data, gsize size,
+                     GByteArray *out, GError **error);
 
 /**
  * fb_util_zlib_inflate:
- * @bytes: The #GByteArray.
+ * @zlib: The #FbUtilZlib.
+ * @data: The data.
+ * @size: The size of @data.
+ * @out: The #GByteArray to append to.
  * @error: The return location for the #GError or #NULL.
  *
- * Inflates a #GByteArray with zlib. The returned #GByteArray should be
- * freed with #g_byte_array_free() when no longer needed.
+ * Inflates data with zlib, appending the result to @out. The output
+ * is sized from the ratio of the previous inflations, so this is
+ * usually a single conversion. @out may be reused across calls to
+ * avoid reallocating it.
  *
- * Returns: The inflated #GByteArray or #NULL on error.
+ * Returns: #TRUE if the data was inflated, otherwise #FALSE.
  */
-GByteArray *
-fb_util_zlib_inflate(const GByteArray *bytes, GError **error);
+gboolean
+fb_util_zlib_inflate(FbUtilZlib *zlib, const guint8 *data, gsize size,
+                     GByteArray *out, GError **error);
 
 #endif /* PURPLE_FACEBOOK_UTIL_H */
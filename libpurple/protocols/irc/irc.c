@@ -47,6 +47,7 @@ static gboolean irc_nick_equal(const char *nick1, const char *nick2);
 static void irc_buddy_free(struct irc_buddy *ib);
 
 PurpleProtocol *_irc_protocol = NULL;
+gulong _irc_receiving_text_signal = 0;
 
 static gint
 irc_uri_handler_match_server(PurpleAccount *account, const gchar *match_server)
@@ -1116,7 +1117,7 @@ plugin_load(PurplePlugin *plugin, GError **error)
 			     purple_marshal_VOID__POINTER_POINTER, G_TYPE_NONE, 2,
 			     PURPLE_TYPE_CONNECTION,
 			     G_TYPE_POINTER); /* pointer to a string */
-	purple_signal_register(_irc_protocol, "irc-receiving-text",
+	_irc_receiving_text_signal = purple_signal_register(_irc_protocol, "irc-receiving-text",
 			     purple_marshal_VOID__POINTER_POINTER, G_TYPE_NONE, 2,
 			     PURPLE_TYPE_CONNECTION,
 			     G_TYPE_POINTER); /* pointer to a string */
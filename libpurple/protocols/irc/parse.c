@@ -40,6 +40,7 @@ static char *irc_mirc_colors[16] = {
 		"pink", "grey", "light grey" };
 
 extern PurpleProtocol *_irc_protocol;
+extern gulong _irc_receiving_text_signal;
 
 /*typedef void (*IRCMsgCallback)(struct irc_conn *irc, char *from, char *name, char **args);*/
 static struct _irc_msg {
@@ -684,7 +685,8 @@ void irc_parse_msg(struct irc_conn *irc, char *input)
 	 * TODO: It should be passed as an array of bytes and a length
 	 * instead of a null terminated string.
 	 */
-	purple_signal_emit(_irc_protocol, "irc-receiving-text", gc, &input);
+	if (purple_signal_has_handlers(_irc_receiving_text_signal))
+		purple_signal_emit_by_id(_irc_receiving_text_signal, gc, &input);
 
 	if (purple_debug_is_verbose()) {
 		char *clean = purple_utf8_salvage(input);
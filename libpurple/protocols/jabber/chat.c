@@ -445,6 +445,9 @@ void jabber_chat_free(JabberChat *chat)
 	g_free(chat->handle);
 	g_hash_table_destroy(chat->members);
 	g_hash_table_destroy(chat->components);
+	g_list_free_full(chat->pending_users, g_free);
+	g_list_free_full(chat->pending_jids, g_free);
+	g_list_free(chat->pending_flags);
 	g_free(chat);
 }
 
@@ -977,6 +980,48 @@ void jabber_chat_remove_handle(JabberChat *chat, const char *handle)
 	g_hash_table_remove(chat->members, handle);
 }
 
+void jabber_chat_queue_user(JabberChat *chat, const char *handle,
+		const char *jid, PurpleChatUserFlags flags)
+{
+	/* Only a handle we have seen before can be queued already */
+	if (g_hash_table_contains(chat->members, handle)) {
+		GList *user, *flag;
+
+		for (user = chat->pending_users, flag = chat->pending_flags;
+				user != NULL; user = user->next, flag = flag->next) {
+			if (purple_strequal(user->data, handle)) {
+				flag->data = GINT_TO_POINTER(flags);
+				return;
+			}
+		}
+	}
+
+	chat->pending_users = g_list_prepend(chat->pending_users,
+			g_strdup(handle));
+	chat->pending_jids = g_list_prepend(chat->pending_jids, g_strdup(jid));
+	chat->pending_flags = g_list_prepend(chat->pending_flags,
+			GINT_TO_POINTER(flags));
+}
+
+void jabber_chat_add_pending_users(JabberChat *chat)
+{
+	GList *users, *jids, *flags;
+
+	if (chat->pending_users == NULL || chat->conv == NULL)
+		return;
+
+	users = g_list_reverse(chat->pending_users);
+	jids = g_list_reverse(chat->pending_jids);
+	flags = g_list_reverse(chat->pending_flags);
+	chat->pending_users = chat->pending_jids = chat->pending_flags = NULL;
+
+	purple_chat_conversation_add_users(chat->conv, users, jids, flags, FALSE);
+
+	g_list_free_full(users, g_free);
+	g_list_free_full(jids, g_free);
+	g_list_free(flags);
+}
+
 gboolean jabber_chat_ban_user(JabberChat *chat, const char *who, const char *why)
 {
 	JabberChatMember *jcm;
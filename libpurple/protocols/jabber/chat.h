@@ -51,6 +51,11 @@ typedef struct {
 	GHashTable *members;
 	gboolean left;
 	time_t joined;
+	/* Occupants seen while joining, newest first; see
+	 * jabber_chat_add_pending_users() */
+	GList *pending_users;
+	GList *pending_jids;
+	GList *pending_flags;
 } JabberChat;
 
 GList *jabber_chat_info(PurpleConnection *gc);
@@ -93,6 +98,23 @@ void jabber_chat_part(JabberChat *chat, const char *msg);
 void jabber_chat_track_handle(JabberChat *chat, const char *handle,
 		const char *jid, const char *affiliation, const char *role);
 void jabber_chat_remove_handle(JabberChat *chat, const char *handle);
+
+/**
+ * Queue an occupant that was announced while joining the room. Servers
+ * send every occupant's presence before our own, so they are added to
+ * the conversation in one go once that arrives, which lets the core
+ * take its bulk path for busy rooms.
+ *
+ * This must be called before jabber_chat_track_handle() for the user.
+ */
+void jabber_chat_queue_user(JabberChat *chat, const char *handle,
+		const char *jid, PurpleChatUserFlags flags);
+
+/**
+ * Add the occupants queued by jabber_chat_queue_user() to the
+ * conversation.
+ */
+void jabber_chat_add_pending_users(JabberChat *chat);
 gboolean jabber_chat_ban_user(JabberChat *chat, const char *who,
 		const char *why);
 gboolean jabber_chat_affiliate_user(JabberChat *chat, const char *who,
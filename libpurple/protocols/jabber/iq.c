@@ -441,10 +441,15 @@ void jabber_iq_parse(JabberStream *js, PurpleXmlNode *packet)
 	 * or if an outside plugin is interested.
 	 */
 	if(child && (xmlns = purple_xmlnode_get_namespace(child))) {
-		char *key = g_strdup_printf("%s %s", child->name, xmlns);
-		JabberIqHandler *jih = g_hash_table_lookup(iq_handlers, key);
-		int signal_ref = GPOINTER_TO_INT(g_hash_table_lookup(signal_iq_handlers, key));
-		g_free(key);
+		JabberHandlerKey key;
+		JabberIqHandler *jih = NULL;
+		int signal_ref = 0;
+
+		if (jabber_handler_key_init(&key, child->name, xmlns, FALSE)) {
+			jih = g_hash_table_lookup(iq_handlers, &key);
+			signal_ref = GPOINTER_TO_INT(
+			        g_hash_table_lookup(signal_iq_handlers, &key));
+		}
 
 		if (signal_ref > 0) {
 			signal_return = GPOINTER_TO_INT(purple_signal_emit_return_1(purple_connection_get_protocol(js->gc), "jabber-watched-iq",
@@ -490,57 +495,52 @@ void jabber_iq_parse(JabberStream *js, PurpleXmlNode *packet)
 
 void jabber_iq_register_handler(const char *node, const char *xmlns, JabberIqHandler *handlerfunc)
 {
-	/*
-	 * This is valid because nodes nor namespaces cannot have spaces in them
-	 * (see http://www.w3.org/TR/2006/REC-xml-20060816/ and
-	 * http://www.w3.org/TR/REC-xml-names/)
-	 */
-	char *key = g_strdup_printf("%s %s", node, xmlns);
-	g_hash_table_replace(iq_handlers, key, handlerfunc);
+	g_hash_table_replace(iq_handlers, jabber_handler_key_new(node, xmlns),
+	                     handlerfunc);
 }
 
 void jabber_iq_signal_register(const gchar *node, const gchar *xmlns)
 {
-	gchar *key;
+	JabberHandlerKey *key;
 	int ref;
 
 	g_return_if_fail(node != NULL && *node != '\0');
 	g_return_if_fail(xmlns != NULL && *xmlns != '\0');
 
-	key = g_strdup_printf("%s %s", node, xmlns);
+	key = jabber_handler_key_new(node, xmlns);
 	ref = GPOINTER_TO_INT(g_hash_table_lookup(signal_iq_handlers, key));
-	if (ref == 0) {
-		g_hash_table_insert(signal_iq_handlers, key, GINT_TO_POINTER(1));
-	} else {
-		g_hash_table_insert(signal_iq_handlers, key, GINT_TO_POINTER(ref + 1));
-		g_free(key);
-	}
+	g_hash_table_replace(signal_iq_handlers, key, GINT_TO_POINTER(ref + 1));
 }
 
 void jabber_iq_signal_unregister(const gchar *node, const gchar *xmlns)
 {
-	gchar *key;
+	JabberHandlerKey key;
 	int ref;
 
 	g_return_if_fail(node != NULL && *node != '\0');
 	g_return_if_fail(xmlns != NULL && *xmlns != '\0');
 
-	key = g_strdup_printf("%s %s", node, xmlns);
-	ref = GPOINTER_TO_INT(g_hash_table_lookup(signal_iq_handlers, key));
+	if (!jabber_handler_key_init(&key, node, xmlns, FALSE))
+		return;
+
+	ref = GPOINTER_TO_INT(g_hash_table_lookup(signal_iq_handlers, &key));
 
 	if (ref == 1) {
-		g_hash_table_remove(signal_iq_handlers, key);
+		g_hash_table_remove(signal_iq_handlers, &key);
 	} else if (ref > 1) {
-		g_hash_table_insert(signal_iq_handlers, key, GINT_TO_POINTER(ref - 1));
+		g_hash_table_replace(signal_iq_handlers,
+		                     jabber_handler_key_new(node, xmlns),
+		                     GINT_TO_POINTER(ref - 1));
 	}
-
-	g_free(key);
 }
 
 void jabber_iq_init(void)
 {
-	iq_handlers = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
-	signal_iq_handlers = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	iq_handlers = g_hash_table_new_full(jabber_handler_key_hash,
+	                                    jabber_handler_key_equal, g_free, NULL);
+	signal_iq_handlers = g_hash_table_new_full(jabber_handler_key_hash,
+	                                           jabber_handler_key_equal,
+	                                           g_free, NULL);
 
 	jabber_iq_register_handler("jingle", JINGLE, jingle_parse);
 	jabber_iq_register_handler("mailbox", NS_GOOGLE_MAIL_NOTIFY,
@@ -63,6 +63,11 @@
  */
 #define DEFAULT_INACTIVITY_TIME 120
 
+/* The receive buffer starts small and doubles while reads keep filling it,
+ * so large roster or history dumps take fewer reads and parser calls. */
+#define JABBER_RECV_BUFFER_MIN (4 * 1024)
+#define JABBER_RECV_BUFFER_MAX (256 * 1024)
+
 GList *jabber_features = NULL;
 GList *jabber_identities = NULL;
 
@@ -316,11 +321,13 @@ void jabber_process_packet(JabberStream *js, PurpleXmlNode **packet)
 	const char *name;
 	const char *xmlns;
 
-	purple_signal_emit(purple_connection_get_protocol(js->gc), "jabber-receiving-xmlnode", js->gc, packet);
+	if (purple_signal_has_handlers(js->receiving_xmlnode_signal)) {
+		purple_signal_emit_by_id(js->receiving_xmlnode_signal, js->gc, packet);
 
-	/* if the signal leaves us with a null packet, we're done */
-	if(NULL == *packet)
-		return;
+		/* if the signal leaves us with a null packet, we're done */
+		if(NULL == *packet)
+			return;
+	}
 
 	name = (*packet)->name;
 	xmlns = purple_xmlnode_get_namespace(*packet);
@@ -581,14 +588,21 @@ jabber_recv_cb(GObject *stream, gpointer data)
 	PurpleConnection *gc = data;
 	JabberStream *js = purple_connection_get_protocol_data(gc);
 	gssize len;
-	gchar buf[4096];
+	gssize peak = 0;
+	gchar *buf;
 	GError *error = NULL;
 
 	PURPLE_ASSERT_CONNECTION_IS_VALID(gc);
 
+	if (js->recv_buf == NULL) {
+		js->recv_buf_size = JABBER_RECV_BUFFER_MIN;
+		js->recv_buf = g_malloc(js->recv_buf_size);
+	}
+
 	do {
+		buf = js->recv_buf;
 		len = g_pollable_input_stream_read_nonblocking(
-		        G_POLLABLE_INPUT_STREAM(stream), buf, sizeof(buf) - 1,
+		        G_POLLABLE_INPUT_STREAM(stream), buf, js->recv_buf_size - 1,
 		        js->cancellable, &error);
 		if (len == 0) {
 			purple_connection_error(js->gc,
@@ -598,6 +612,14 @@ jabber_recv_cb(GObject *stream, gpointer data)
 		} else if (len < 0) {
 			if (error->code == G_IO_ERROR_WOULD_BLOCK) {
 				g_error_free(error);
+
+				/* Drained; give back memory once traffic calms down */
+				if (js->recv_buf_size > JABBER_RECV_BUFFER_MIN &&
+						(gsize)peak < js->recv_buf_size / 4) {
+					js->recv_buf_size /= 2;
+					g_free(js->recv_buf);
+					js->recv_buf = g_malloc(js->recv_buf_size);
+				}
 				return G_SOURCE_CONTINUE;
 			} else if (error->code == G_IO_ERROR_CANCELLED) {
 				g_error_free(error);
@@ -609,6 +631,7 @@ jabber_recv_cb(GObject *stream, gpointer data)
 			return G_SOURCE_REMOVE;
 		}
 
+		peak = MAX(peak, len);
 		purple_connection_update_last_received(gc);
 #ifdef HAVE_CYRUS_SASL
 		if (js->sasl_maxbuf > 0) {
@@ -628,7 +651,9 @@ jabber_recv_cb(GObject *stream, gpointer data)
 					PURPLE_CONNECTION_ERROR_NETWORK_ERROR,
 					error);
 			} else if (olen > 0) {
-				purple_debug_info("jabber", "RecvSASL (%u): %s\n", olen, out);
+				if (purple_debug_is_enabled_for(PURPLE_DEBUG_INFO, "jabber"))
+					purple_debug_info("jabber", "RecvSASL (%u): %.*s\n",
+					                  olen, (int)olen, out);
 				jabber_parser_process(js, out, olen);
 				if (js->reinit)
 					jabber_stream_init(js);
@@ -636,12 +661,23 @@ jabber_recv_cb(GObject *stream, gpointer data)
 			return G_SOURCE_CONTINUE;
 		}
 #endif
-		buf[len] = '\0';
-		purple_debug_misc("jabber", "Recv (%" G_GSSIZE_FORMAT "): %s", len,
-		                  buf);
+		if (purple_debug_is_enabled_for(PURPLE_DEBUG_MISC, "jabber")) {
+			buf[len] = '\0';
+			purple_debug_misc("jabber", "Recv (%" G_GSSIZE_FORMAT "): %s",
+			                  len, buf);
+		}
 		jabber_parser_process(js, buf, len);
 		if(js->reinit)
 			jabber_stream_init(js);
+
+		/* A full buffer means the server has more queued; read it in
+		 * bigger pieces */
+		if ((gsize)len == js->recv_buf_size - 1 &&
+				js->recv_buf_size < JABBER_RECV_BUFFER_MAX) {
+			js->recv_buf_size *= 2;
+			g_free(js->recv_buf);
+			js->recv_buf = g_malloc(js->recv_buf_size);
+		}
 	} while (len > 0);
 
 	return G_SOURCE_CONTINUE;
@@ -914,6 +950,8 @@ jabber_stream_new(PurpleAccount *account)
 	js = g_new0(JabberStream, 1);
 	purple_connection_set_protocol_data(gc, js);
 	js->gc = gc;
+	js->receiving_xmlnode_signal = purple_signal_lookup(
+			purple_connection_get_protocol(gc), "jabber-receiving-xmlnode");
 	js->http_conns = soup_session_new_with_options(SOUP_SESSION_PROXY_RESOLVER,
 	                                               resolver, NULL);
 	g_object_unref(resolver);
@@ -1682,6 +1720,7 @@ void jabber_close(PurpleConnection *gc)
 	g_object_unref(G_OBJECT(js->cancellable));
 
 	g_free(js->stun_ip);
+	g_free(js->recv_buf);
 
 	/* remove Google relay-related stuff */
 	g_free(js->google_relay_token);
@@ -1836,7 +1875,7 @@ static void jabber_blocklist_parse(JabberStream *js, const char *from,
 {
 	PurpleXmlNode *blocklist, *item;
 	PurpleAccount *account;
-	GSList *deny;
+	GSList *deny = NULL;
 
 	blocklist = purple_xmlnode_get_child_with_namespace(packet,
 			"blocklist", NS_SIMPLE_BLOCKING);
@@ -1848,19 +1887,18 @@ static void jabber_blocklist_parse(JabberStream *js, const char *from,
 	/* This is the only privacy method supported by XEP-0191 */
 	purple_account_set_privacy_type(account, PURPLE_ACCOUNT_PRIVACY_DENY_USERS);
 
-	/*
-	 * TODO: When account->deny is something more than a hash table, this can
-	 * be re-written to find the set intersection and difference.
-	 */
-	while ((deny = purple_account_privacy_get_denied(account)))
-		purple_account_privacy_deny_remove(account, deny->data, TRUE);
-
 	item = purple_xmlnode_get_child(blocklist, "item");
 	while (item != NULL) {
 		const char *jid = purple_xmlnode_get_attrib(item, "jid");
-		purple_account_privacy_deny_add(account, jid, TRUE);
+		if (jid != NULL && *jid != '\0')
+			deny = g_slist_prepend(deny, (gpointer)jid);
 		item = purple_xmlnode_get_next_twin(item);
 	}
+
+	/* Only touch the entries that actually differ from the server's list */
+	deny = g_slist_reverse(deny);
+	purple_account_privacy_deny_set_list(account, deny, TRUE);
+	g_slist_free(deny);
 }
 
 void jabber_request_block_list(JabberStream *js)
@@ -119,6 +119,16 @@ struct _JabberStream
 	xmlParserCtxt *context;
 	PurpleXmlNode *current;
 
+	/* Stanzas completed by the chunk being parsed, waiting to be handled */
+	GQueue packets;
+
+	/* Receive buffer, grown while the server keeps it full */
+	gchar *recv_buf;
+	gsize recv_buf_size;
+
+	/* The "jabber-receiving-xmlnode" signal of this stream's protocol */
+	gulong receiving_xmlnode_signal;
+
 	struct {
 		guint8 major;
 		guint8 minor;
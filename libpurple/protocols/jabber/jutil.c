@@ -647,3 +647,44 @@ jabber_buddy_state_get_status_id(JabberBuddyState state)
 	return NULL;
 }
 
+gboolean
+jabber_handler_key_init(JabberHandlerKey *key, const char *node,
+                        const char *xmlns, gboolean intern)
+{
+	if (intern) {
+		key->node = g_quark_from_string(node);
+		key->xmlns = g_quark_from_string(xmlns);
+		return TRUE;
+	}
+
+	key->node = g_quark_try_string(node);
+	key->xmlns = g_quark_try_string(xmlns);
+
+	return key->node != 0 && (key->xmlns != 0 || xmlns == NULL);
+}
+
+JabberHandlerKey *
+jabber_handler_key_new(const char *node, const char *xmlns)
+{
+	JabberHandlerKey *key = g_new(JabberHandlerKey, 1);
+
+	jabber_handler_key_init(key, node, xmlns, TRUE);
+
+	return key;
+}
+
+guint
+jabber_handler_key_hash(gconstpointer key)
+{
+	const JabberHandlerKey *k = key;
+
+	return k->node * 31 + k->xmlns;
+}
+
+gboolean
+jabber_handler_key_equal(gconstpointer a, gconstpointer b)
+{
+	const JabberHandlerKey *ka = a, *kb = b;
+
+	return ka->node == kb->node && ka->xmlns == kb->xmlns;
+}
@@ -44,6 +44,16 @@ typedef enum {
 
 #include "jabber.h"
 
+/*
+ * Key for the IQ and presence handler tables: an element name and its
+ * namespace, both interned as quarks, so lookups compare two integers
+ * instead of building and hashing a "name xmlns" string.
+ */
+typedef struct {
+	GQuark node;
+	GQuark xmlns;
+} JabberHandlerKey;
+
 JabberID* jabber_id_new(const char *str);
 
 /**
@@ -84,6 +94,21 @@ gboolean jabber_resourceprep_validate(const char *);
  */
 char *jabber_saslprep(const char *);
 
+/**
+ * Fill in a handler key for an element name and namespace.
+ *
+ * @param intern Whether to intern the strings. When FALSE (for lookups),
+ *               strings that were never interned cannot have a handler,
+ *               and FALSE is returned so the caller can skip the lookup.
+ *
+ * @returns TRUE if the key can match a registered handler.
+ */
+gboolean jabber_handler_key_init(JabberHandlerKey *key, const char *node,
+                                 const char *xmlns, gboolean intern);
+JabberHandlerKey *jabber_handler_key_new(const char *node, const char *xmlns);
+guint jabber_handler_key_hash(gconstpointer key);
+gboolean jabber_handler_key_equal(gconstpointer a, gconstpointer b);
+
 /* state -> readable name */
 const char *jabber_buddy_state_get_name(JabberBuddyState state);
 /* state -> core id */
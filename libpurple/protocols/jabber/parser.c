@@ -153,11 +153,9 @@ jabber_parser_element_end_libxml(void *user_data, const xmlChar *element_name,
 		if(!xmlStrcmp((xmlChar*) js->current->name, element_name))
 			js->current = js->current->parent;
 	} else {
-		PurpleXmlNode *packet = js->current;
+		/* Handled once libxml2 is done with the whole chunk */
+		g_queue_push_tail(&js->packets, js->current);
 		js->current = NULL;
-		jabber_process_packet(js, &packet);
-		if (packet != NULL)
-			purple_xmlnode_free(packet);
 	}
 }
 
@@ -248,24 +246,50 @@ jabber_parser_setup(JabberStream *js)
 	jabber_parser_free(js);
 }
 
+static void
+jabber_parser_dispatch(JabberStream *js)
+{
+	PurpleXmlNode *packet;
+
+	/* A handler may reset the parser, which drops the rest */
+	while ((packet = g_queue_pop_head(&js->packets)) != NULL) {
+		jabber_process_packet(js, &packet);
+		if (packet != NULL)
+			purple_xmlnode_free(packet);
+	}
+}
+
 void jabber_parser_free(JabberStream *js) {
+	PurpleXmlNode *packet;
+
 	if (js->context) {
 		xmlParseChunk(js->context, NULL,0,1);
 		xmlFreeParserCtxt(js->context);
 		js->context = NULL;
 	}
+
+	while ((packet = g_queue_pop_head(&js->packets)) != NULL)
+		purple_xmlnode_free(packet);
 }
 
 void jabber_parser_process(JabberStream *js, const char *buf, int len)
 {
-	int ret;
+	int ret = XML_ERR_OK;
 
 	if (js->context == NULL) {
 		/* libxml inconsistently starts parsing on creating the
 		 * parser, so do a ParseChunk right afterwards to force it. */
 		js->context = xmlCreatePushParserCtxt(&jabber_parser_libxml, js, buf, len, NULL);
 		xmlParseChunk(js->context, "", 0, 0);
-	} else if ((ret = xmlParseChunk(js->context, buf, len, 0)) != XML_ERR_OK) {
+	} else {
+		ret = xmlParseChunk(js->context, buf, len, 0);
+	}
+
+	/* Handle every stanza this chunk completed in one go, outside of the
+	 * parser callbacks. */
+	jabber_parser_dispatch(js);
+
+	if (ret != XML_ERR_OK && js->context != NULL) {
 		xmlError *err = xmlCtxtGetLastError(js->context);
 		/*
 		 * libxml2 uses a global setting to determine whether or not to store
@@ -550,6 +550,7 @@ handle_presence_chat(JabberStream *js, JabberPresence *presence, PurpleXmlNode *
 		const char *affiliation = NULL;
 		const char *role = NULL;
 		gboolean is_our_resource = FALSE; /* Is the presence about us? */
+		gboolean pending;
 		JabberBuddyResource *jbr;
 
 		/*
@@ -615,14 +616,24 @@ handle_presence_chat(JabberStream *js, JabberPresence *presence, PurpleXmlNode *
 		jbr = jabber_buddy_track_resource(presence->jb, presence->jid_from->resource, presence->priority, presence->state, presence->status);
 		jbr->commands_fetched = TRUE;
 
+		/* Until our own presence arrives, this is the occupant list */
+		pending = chat->joined == 0 && !is_our_resource &&
+				!jabber_chat_find_buddy(chat->conv, presence->jid_from->resource);
+		if (pending)
+			jabber_chat_queue_user(chat, presence->jid_from->resource, jid, flags);
+
 		jabber_chat_track_handle(chat, presence->jid_from->resource, jid, affiliation, role);
 
-		if(!jabber_chat_find_buddy(chat->conv, presence->jid_from->resource))
-			purple_chat_conversation_add_user(chat->conv, presence->jid_from->resource,
-					jid, flags, chat->joined > 0 && ((!presence->delayed) || (presence->sent > chat->joined)));
-		else
-			purple_chat_user_set_flags(purple_chat_conversation_find_user(chat->conv, presence->jid_from->resource),
-					flags);
+		if (!pending) {
+			jabber_chat_add_pending_users(chat);
+
+			if(!jabber_chat_find_buddy(chat->conv, presence->jid_from->resource))
+				purple_chat_conversation_add_user(chat->conv, presence->jid_from->resource,
+						jid, flags, chat->joined > 0 && ((!presence->delayed) || (presence->sent > chat->joined)));
+			else
+				purple_chat_user_set_flags(purple_chat_conversation_find_user(chat->conv, presence->jid_from->resource),
+						flags);
+		}
 
 		if (is_our_resource && chat->joined == 0)
 			chat->joined = time(NULL);
@@ -645,6 +656,8 @@ handle_presence_chat(JabberStream *js, JabberPresence *presence, PurpleXmlNode *
 			return FALSE;
 		}
 
+		jabber_chat_add_pending_users(chat);
+
 		is_our_resource = purple_strequal(presence->jid_from->resource, chat->handle);
 
 		jabber_buddy_remove_resource(presence->jb, presence->jid_from->resource);
@@ -984,16 +997,17 @@ void jabber_presence_parse(JabberStream *js, PurpleXmlNode *packet)
 	}
 
 	for (child = packet->child; child; child = child->next) {
-		const char *xmlns;
-		char *key;
+		JabberHandlerKey key;
 		JabberPresenceHandler *pih;
 		if (child->type != PURPLE_XMLNODE_TYPE_TAG)
 			continue;
 
-		xmlns = purple_xmlnode_get_namespace(child);
-		key = g_strdup_printf("%s %s", child->name, xmlns ? xmlns : "");
-		pih = g_hash_table_lookup(presence_handlers, key);
-		g_free(key);
+		if (!jabber_handler_key_init(&key, child->name,
+		                             purple_xmlnode_get_namespace(child),
+		                             FALSE))
+			continue;
+
+		pih = g_hash_table_lookup(presence_handlers, &key);
 		if (pih)
 			pih(js, &presence, child);
 	}
@@ -1249,18 +1263,15 @@ parse_muc_user(JabberStream *js, JabberPresence *presence, PurpleXmlNode *x)
 void jabber_presence_register_handler(const char *node, const char *xmlns,
                                       JabberPresenceHandler *handler)
 {
-	/*
-	 * This is valid because nodes nor namespaces cannot have spaces in them
-	 * (see http://www.w3.org/TR/2006/REC-xml-20060816/ and
-	 * http://www.w3.org/TR/REC-xml-names/)
-	 */
-	char *key = g_strdup_printf("%s %s", node, xmlns);
-	g_hash_table_replace(presence_handlers, key, handler);
+	g_hash_table_replace(presence_handlers,
+	                     jabber_handler_key_new(node, xmlns), handler);
 }
 
 void jabber_presence_init(void)
 {
-	presence_handlers = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	presence_handlers = g_hash_table_new_full(jabber_handler_key_hash,
+	                                          jabber_handler_key_equal,
+	                                          g_free, NULL);
 
 	/* Core RFC things */
 	jabber_presence_register_handler("priority", "jabber:client", parse_priority);
@@ -209,6 +209,30 @@ test_jabber_util_jabber_normalize(const PurpleTestStringData *data)
 	g_assert_cmpstr(data->output, ==, jabber_normalize(NULL, data->input));
 }
 
+static void
+test_jabber_util_handler_key(void) {
+	JabberHandlerKey *registered, key;
+
+	/* nothing interned yet, so nothing can be registered */
+	g_assert_false(jabber_handler_key_init(&key, "test-handler-key",
+	                                       "urn:test:handler-key", FALSE));
+
+	registered = jabber_handler_key_new("test-handler-key",
+	                                    "urn:test:handler-key");
+
+	g_assert_true(jabber_handler_key_init(&key, "test-handler-key",
+	                                      "urn:test:handler-key", FALSE));
+	g_assert_true(jabber_handler_key_equal(registered, &key));
+	g_assert_cmpuint(jabber_handler_key_hash(registered), ==,
+	                 jabber_handler_key_hash(&key));
+
+	/* the namespace is part of the key */
+	jabber_handler_key_init(&key, "test-handler-key", "jabber:client", TRUE);
+	g_assert_false(jabber_handler_key_equal(registered, &key));
+
+	g_free(registered);
+}
+
 gint
 main(gint argc, gchar **argv) {
 	gchar *test_name;
@@ -270,6 +294,9 @@ main(gint argc, gchar **argv) {
 	g_test_add_func("/jabber/util/id_new/jid_parts",
 	                test_jabber_util_jid_parts);
 
+	g_test_add_func("/jabber/util/handler_key",
+	                test_jabber_util_handler_key);
+
 	for (i = 0; test_jabber_util_jabber_normalize_data[i].input; i++) {
 		test_name = g_strdup_printf("/jabber/util/normalize/%d", i);
 		g_test_add_data_func(test_name,
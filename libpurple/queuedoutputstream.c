@@ -35,6 +35,8 @@
  * To create a queued output stream, use #purple_queued_output_stream_new().
  *
  * To queue data, use #purple_queued_output_stream_push_bytes_async().
+ * Everything queued while a write is in progress goes out together in the
+ * next write, limited by #purple_queued_output_stream_set_write_limits().
  *
  * If there's a fatal stream error, it's suggested to clear the remaining
  * bytes queued with #purple_queued_output_stream_clear_queue() to avoid
@@ -48,87 +50,221 @@ struct _PurpleQueuedOutputStream
 
 typedef struct
 {
-	GAsyncQueue *queue;
+	/* Tasks waiting to be written, oldest first.  Each task's data is the
+	 * GBytes it was pushed with. */
+	GQueue *queue;
 	gboolean pending_queued;
+
+	/* How much of the task at the head of the queue has been written
+	 * already, after a partial write. */
+	gsize head_offset;
+
+	/* The tasks and vectors of the write in progress, and how much of the
+	 * first task had been written before it. */
+	GPtrArray *batch;
+	GArray *vectors;
+	gsize batch_offset;
+#if !GLIB_CHECK_VERSION(2, 60, 0)
+	GByteArray *coalesced;
+#endif
+
+	gsize max_write_size;
+	guint max_write_vectors;
+
+	gsize queued_bytes;
+	gsize high_watermark;
 } PurpleQueuedOutputStreamPrivate;
 
 G_DEFINE_TYPE_WITH_PRIVATE(PurpleQueuedOutputStream,
 		purple_queued_output_stream, G_TYPE_FILTER_OUTPUT_STREAM)
 
+#define PURPLE_QUEUED_OUTPUT_STREAM_MAX_WRITE_SIZE  (64 * 1024)
+#define PURPLE_QUEUED_OUTPUT_STREAM_MAX_WRITE_VECTORS  64
+
 /******************************************************************************
  * Helpers
  *****************************************************************************/
 
-static void purple_queued_output_stream_start_push_bytes_async(GTask *task);
+static void purple_queued_output_stream_start_write(
+		PurpleQueuedOutputStream *stream);
+
+static gsize
+purple_queued_output_stream_task_size(GTask *task)
+{
+	return g_bytes_get_size(g_task_get_task_data(task));
+}
 
 static void
-purple_queued_output_stream_push_bytes_async_cb(GObject *source,
+purple_queued_output_stream_write_cb(GObject *source,
 		GAsyncResult *res, gpointer user_data)
 {
-	GTask *task = G_TASK(user_data);
-	PurpleQueuedOutputStream *stream = g_task_get_source_object(task);
+	PurpleQueuedOutputStream *stream = PURPLE_QUEUED_OUTPUT_STREAM(user_data);
 	PurpleQueuedOutputStreamPrivate *priv = purple_queued_output_stream_get_instance_private(stream);
-	gssize written;
-	GBytes *bytes;
-	gsize size;
+	GPtrArray *batch;
+	gsize written = 0;
+	gsize offset;
+	guint i;
 	GError *error = NULL;
 
-	written = g_output_stream_write_bytes_finish(G_OUTPUT_STREAM(source),
-			res, &error);
-
-	bytes = g_task_get_task_data(task);
-	size = g_bytes_get_size(bytes);
-
-	if (written < 0) {
-		/* Error occurred, return error */
-		g_task_return_error(task, error);
-		g_clear_object(&task);
-	} else if (size > written) {
-		/* Partial write, prepare to send remaining data */
-		bytes = g_bytes_new_from_bytes(bytes, written, size - written);
-		g_task_set_task_data(task, bytes,
-				(GDestroyNotify)g_bytes_unref);
+#if GLIB_CHECK_VERSION(2, 60, 0)
+	g_output_stream_writev_finish(G_OUTPUT_STREAM(source), res,
+			&written, &error);
+#else
+	{
+		gssize ret = g_output_stream_write_finish(G_OUTPUT_STREAM(source),
+				res, &error);
+		written = MAX(ret, 0);
+		g_clear_pointer(&priv->coalesced, g_byte_array_unref);
+	}
+#endif
+
+	/* Take over the batch before returning any task, as the callbacks may
+	 * push more data or clear the queue. */
+	batch = priv->batch;
+	priv->batch = g_ptr_array_new();
+	offset = priv->batch_offset;
+	priv->batch_offset = 0;
+
+	if (error == NULL) {
+		/* Put back whatever was not written, then account for the rest. */
+		gsize remaining = written + offset;
+
+		for (i = 0; i < batch->len; i++) {
+			gsize size = purple_queued_output_stream_task_size(
+					g_ptr_array_index(batch, i));
+
+			if (remaining < size)
+				break;
+			remaining -= size;
+		}
+
+		if (i < batch->len) {
+			guint j;
+
+			for (j = batch->len; j > i; j--) {
+				g_queue_push_head(priv->queue,
+						g_ptr_array_index(batch, j - 1));
+			}
+			priv->head_offset = remaining;
+			g_ptr_array_set_size(batch, i);
+		}
+
+		priv->queued_bytes -= written;
 	} else {
-		/* Full write, this task is finished */
-		g_task_return_boolean(task, TRUE);
-		g_clear_object(&task);
+		for (i = 0; i < batch->len; i++) {
+			priv->queued_bytes -= purple_queued_output_stream_task_size(
+					g_ptr_array_index(batch, i));
+		}
+		priv->queued_bytes += offset;
 	}
 
-	/* If g_task_return_* was called in this function, the callback
-	 * may have cleared the stream. If so, there will be no remaining
-	 * tasks to process here.
-	 */
+	for (i = 0; i < batch->len; i++) {
+		GTask *task = g_ptr_array_index(batch, i);
 
-	if (task == NULL) {
-		/* Any queued data left? */
-		task = g_async_queue_try_pop(priv->queue);
+		if (error != NULL)
+			g_task_return_error(task, g_error_copy(error));
+		else
+			g_task_return_boolean(task, TRUE);
+		g_object_unref(task);
 	}
 
-	if (task != NULL) {
-		/* More to process */
-		purple_queued_output_stream_start_push_bytes_async(task);
-	} else {
-		/* All done */
-		priv->pending_queued = FALSE;
-		g_output_stream_clear_pending(G_OUTPUT_STREAM(stream));
-	}
+	g_ptr_array_unref(batch);
+	g_clear_error(&error);
+
+	/* Any queued data left? */
+	purple_queued_output_stream_start_write(stream);
+
+	g_object_unref(stream);
 }
 
+/* Writes as much of the queue as the limits allow in one call, or marks the
+ * stream idle if the queue is empty. */
 static void
-purple_queued_output_stream_start_push_bytes_async(GTask *task)
+purple_queued_output_stream_start_write(PurpleQueuedOutputStream *stream)
 {
-	PurpleQueuedOutputStream *stream = g_task_get_source_object(task);
+	PurpleQueuedOutputStreamPrivate *priv = purple_queued_output_stream_get_instance_private(stream);
 	GOutputStream *base_stream;
+	GCancellable *cancellable = NULL;
+	GTask *task;
+	gsize batch_size = 0;
+	int io_priority = G_PRIORITY_DEFAULT;
+
+	g_array_set_size(priv->vectors, 0);
+
+	while ((task = g_queue_peek_head(priv->queue)) != NULL) {
+		GBytes *bytes = g_task_get_task_data(task);
+		GOutputVector vector;
+		gsize offset = priv->head_offset;
+		gsize size = g_bytes_get_size(bytes) - offset;
+
+		if (priv->batch->len > 0 &&
+				(priv->batch->len >= priv->max_write_vectors ||
+				 batch_size + size > priv->max_write_size)) {
+			break;
+		}
+
+		g_queue_pop_head(priv->queue);
+		priv->head_offset = 0;
+
+		if (g_task_return_error_if_cancelled(task)) {
+			priv->queued_bytes -= size;
+			g_object_unref(task);
+			continue;
+		}
+
+		if (priv->batch->len == 0) {
+			priv->batch_offset = offset;
+
+			/* A single request keeps its own cancellable, but one request
+			 * being cancelled must not abort the others in a batch. */
+			cancellable = g_task_get_cancellable(task);
+			io_priority = g_task_get_priority(task);
+		} else {
+			cancellable = NULL;
+		}
+
+		vector.buffer = (const guint8 *)g_bytes_get_data(bytes, NULL) + offset;
+		vector.size = size;
+		g_array_append_val(priv->vectors, vector);
+		g_ptr_array_add(priv->batch, task);
+		batch_size += size;
+	}
+
+	if (priv->batch->len == 0) {
+		/* All done */
+		priv->pending_queued = FALSE;
+		g_output_stream_clear_pending(G_OUTPUT_STREAM(stream));
+		return;
+	}
 
 	base_stream = g_filter_output_stream_get_base_stream(
 			G_FILTER_OUTPUT_STREAM(stream));
 
-	g_output_stream_write_bytes_async(base_stream,
-			g_task_get_task_data(task),
-			g_task_get_priority(task),
-			g_task_get_cancellable(task),
-			purple_queued_output_stream_push_bytes_async_cb,
-			task);
+#if GLIB_CHECK_VERSION(2, 60, 0)
+	g_output_stream_writev_async(base_stream,
+			(GOutputVector *)priv->vectors->data, priv->vectors->len,
+			io_priority, cancellable,
+			purple_queued_output_stream_write_cb,
+			g_object_ref(stream));
+#else
+	{
+		guint i;
+
+		priv->coalesced = g_byte_array_sized_new(batch_size);
+		for (i = 0; i < priv->vectors->len; i++) {
+			GOutputVector *vector = &g_array_index(priv->vectors,
+					GOutputVector, i);
+			g_byte_array_append(priv->coalesced, vector->buffer,
+					vector->size);
+		}
+
+		g_output_stream_write_async(base_stream,
+				priv->coalesced->data, priv->coalesced->len,
+				io_priority, cancellable,
+				purple_queued_output_stream_write_cb,
+				g_object_ref(stream));
+	}
+#endif
 }
 
 /******************************************************************************
@@ -139,27 +275,50 @@ static void
 purple_queued_output_stream_dispose(GObject *object)
 {
 	PurpleQueuedOutputStream *stream = PURPLE_QUEUED_OUTPUT_STREAM(object);
-	PurpleQueuedOutputStreamPrivate *priv = purple_queued_output_stream_get_instance_private(stream);
 
-	g_clear_pointer(&priv->queue, g_async_queue_unref);
+	/* Fails whatever is still waiting with G_IO_ERROR_CANCELLED.  A write
+	 * in progress holds a reference, so its batch is returned by the write
+	 * callback. */
+	purple_queued_output_stream_clear_queue(stream);
 
 	G_OBJECT_CLASS(purple_queued_output_stream_parent_class)->dispose(object);
 }
 
+static void
+purple_queued_output_stream_finalize(GObject *object)
+{
+	PurpleQueuedOutputStream *stream = PURPLE_QUEUED_OUTPUT_STREAM(object);
+	PurpleQueuedOutputStreamPrivate *priv = purple_queued_output_stream_get_instance_private(stream);
+
+	g_queue_free(priv->queue);
+	g_ptr_array_unref(priv->batch);
+	g_array_unref(priv->vectors);
+#if !GLIB_CHECK_VERSION(2, 60, 0)
+	g_clear_pointer(&priv->coalesced, g_byte_array_unref);
+#endif
+
+	G_OBJECT_CLASS(purple_queued_output_stream_parent_class)->finalize(object);
+}
+
 static void
 purple_queued_output_stream_class_init(PurpleQueuedOutputStreamClass *klass)
 {
 	GObjectClass *obj_class = G_OBJECT_CLASS(klass);
 
 	obj_class->dispose = purple_queued_output_stream_dispose;
+	obj_class->finalize = purple_queued_output_stream_finalize;
 }
 
 static void
 purple_queued_output_stream_init(PurpleQueuedOutputStream *stream)
 {
 	PurpleQueuedOutputStreamPrivate *priv = purple_queued_output_stream_get_instance_private(stream);
-	priv->queue = g_async_queue_new_full((GDestroyNotify)g_bytes_unref);
+	priv->queue = g_queue_new();
 	priv->pending_queued = FALSE;
+	priv->batch = g_ptr_array_new();
+	priv->vectors = g_array_new(FALSE, FALSE, sizeof(GOutputVector));
+	priv->max_write_size = PURPLE_QUEUED_OUTPUT_STREAM_MAX_WRITE_SIZE;
+	priv->max_write_vectors = PURPLE_QUEUED_OUTPUT_STREAM_MAX_WRITE_VECTORS;
 }
 
 /******************************************************************************
@@ -219,12 +378,14 @@ purple_queued_output_stream_push_bytes_async(PurpleQueuedOutputStream *stream,
 	g_clear_error (&error);
 	priv->pending_queued = TRUE;
 
+	g_queue_push_tail(priv->queue, task);
+	priv->queued_bytes += g_bytes_get_size(bytes);
+	priv->high_watermark = MAX(priv->high_watermark, priv->queued_bytes);
+
 	if (set_pending) {
-		/* Start processing if there were no pending operations */
-		purple_queued_output_stream_start_push_bytes_async(task);
-	} else {
-		/* Otherwise queue the data */
-		g_async_queue_push(priv->queue, task);
+		/* Start processing if there were no pending operations, otherwise
+		 * the data goes out with the next write */
+		purple_queued_output_stream_start_write(stream);
 	}
 }
 
@@ -250,9 +411,50 @@ purple_queued_output_stream_clear_queue(PurpleQueuedOutputStream *stream)
 
 	priv = purple_queued_output_stream_get_instance_private(stream);
 
-	while ((task = g_async_queue_try_pop(priv->queue)) != NULL) {
+	while ((task = g_queue_pop_head(priv->queue)) != NULL) {
+		priv->queued_bytes -= purple_queued_output_stream_task_size(task) -
+				priv->head_offset;
+		priv->head_offset = 0;
+
 		g_task_return_new_error(task, G_IO_ERROR, G_IO_ERROR_CANCELLED,
 				"PurpleQueuedOutputStream queue cleared");
 		g_object_unref(task);
 	}
 }
+
+void
+purple_queued_output_stream_set_write_limits(PurpleQueuedOutputStream *stream,
+		gsize max_size, guint max_vectors)
+{
+	PurpleQueuedOutputStreamPrivate *priv = NULL;
+
+	g_return_if_fail(PURPLE_IS_QUEUED_OUTPUT_STREAM(stream));
+	g_return_if_fail(max_size > 0);
+	g_return_if_fail(max_vectors > 0);
+
+	priv = purple_queued_output_stream_get_instance_private(stream);
+	priv->max_write_size = max_size;
+	priv->max_write_vectors = max_vectors;
+}
+
+gsize
+purple_queued_output_stream_get_queued_bytes(PurpleQueuedOutputStream *stream)
+{
+	PurpleQueuedOutputStreamPrivate *priv = NULL;
+
+	g_return_val_if_fail(PURPLE_IS_QUEUED_OUTPUT_STREAM(stream), 0);
+
+	priv = purple_queued_output_stream_get_instance_private(stream);
+	return priv->queued_bytes;
+}
+
+gsize
+purple_queued_output_stream_get_high_watermark(PurpleQueuedOutputStream *stream)
+{
+	PurpleQueuedOutputStreamPrivate *priv = NULL;
+
+	g_return_val_if_fail(PURPLE_IS_QUEUED_OUTPUT_STREAM(stream), 0);
+
+	priv = purple_queued_output_stream_get_instance_private(stream);
+	return priv->high_watermark;
+}
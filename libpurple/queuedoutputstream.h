@@ -104,6 +104,46 @@ gboolean purple_queued_output_stream_push_bytes_finish(
  */
 void purple_queued_output_stream_clear_queue(PurpleQueuedOutputStream *stream);
 
+/*
+ * purple_queued_output_stream_set_write_limits
+ * @stream: #PurpleQueuedOutputStream to configure
+ * @max_size: Most bytes to hand to the base stream in one write
+ * @max_vectors: Most queued buffers to hand to the base stream in one write
+ *
+ * Sets how much queued data is written at once.  Buffers queued while a
+ * write is in progress are written together with a single vectored write,
+ * up to these limits.  A single buffer larger than @max_size is still
+ * written on its own.  The defaults are 64 KiB and 64 buffers.
+ */
+void purple_queued_output_stream_set_write_limits(
+		PurpleQueuedOutputStream *stream,
+		gsize max_size, guint max_vectors);
+
+/*
+ * purple_queued_output_stream_get_queued_bytes
+ * @stream: #PurpleQueuedOutputStream to query
+ *
+ * Gets the number of bytes pushed to the stream which have not been
+ * written yet, including any write in progress.  Protocols can use this to
+ * hold back optional traffic while the connection is congested.
+ *
+ * Returns: The number of bytes waiting to be written
+ */
+gsize purple_queued_output_stream_get_queued_bytes(
+		PurpleQueuedOutputStream *stream);
+
+/*
+ * purple_queued_output_stream_get_high_watermark
+ * @stream: #PurpleQueuedOutputStream to query
+ *
+ * Gets the most bytes that have been waiting to be written at once over the
+ * life of the stream.
+ *
+ * Returns: The peak of #purple_queued_output_stream_get_queued_bytes()
+ */
+gsize purple_queued_output_stream_get_high_watermark(
+		PurpleQueuedOutputStream *stream);
+
 G_END_DECLS
 
 #endif /* PURPLE_QUEUED_OUTPUT_STREAM_H */
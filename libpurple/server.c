@@ -54,6 +54,11 @@ purple_serv_send_typing(PurpleConnection *gc, const char *name, PurpleIMTypingSt
 }
 
 static GSList *last_auto_responses = NULL;
+
+/* Looked up on first use; signal IDs never change once registered. */
+static gulong receiving_im_msg_signal = 0;
+static gulong receiving_chat_msg_signal = 0;
+
 struct last_auto_response {
 	PurpleConnection *gc;
 	char name[80];
@@ -518,9 +523,13 @@ void purple_serv_got_im(PurpleConnection *gc, const char *who, const char *msg,
 	buffy = g_strdup(msg);
 	angel = g_strdup(who);
 
-	plugin_return = GPOINTER_TO_INT(
-		purple_signal_emit_return_1(purple_conversations_get_handle(),
-								  "receiving-im-msg", purple_connection_get_account(gc),
+	if (G_UNLIKELY(receiving_im_msg_signal == 0))
+		receiving_im_msg_signal = purple_signal_lookup(
+				purple_conversations_get_handle(), "receiving-im-msg");
+
+	plugin_return = purple_signal_has_handlers(receiving_im_msg_signal) &&
+		GPOINTER_TO_INT(purple_signal_emit_return_1_by_id(receiving_im_msg_signal,
+								  purple_connection_get_account(gc),
 								  &angel, &buffy, im, &flags));
 
 	if (!buffy || !angel || plugin_return) {
@@ -772,8 +781,7 @@ PurpleChatConversation *purple_serv_got_joined_chat(PurpleConnection *gc,
 	chat = purple_chat_conversation_new(account, name);
 	g_return_val_if_fail(chat != NULL, NULL);
 
-	if (!g_slist_find(purple_connection_get_active_chats(gc), chat))
-		_purple_connection_add_active_chat(gc, chat);
+	_purple_connection_add_active_chat(gc, chat);
 
 	purple_chat_conversation_set_id(chat, id);
 
@@ -862,9 +870,13 @@ void purple_serv_got_chat_in(PurpleConnection *g, int id, const char *who,
 	buffy = g_strdup(message);
 	angel = g_strdup(who);
 
-	plugin_return = GPOINTER_TO_INT(
-		purple_signal_emit_return_1(purple_conversations_get_handle(),
-								  "receiving-chat-msg", purple_connection_get_account(g),
+	if (G_UNLIKELY(receiving_chat_msg_signal == 0))
+		receiving_chat_msg_signal = purple_signal_lookup(
+				purple_conversations_get_handle(), "receiving-chat-msg");
+
+	plugin_return = purple_signal_has_handlers(receiving_chat_msg_signal) &&
+		GPOINTER_TO_INT(purple_signal_emit_return_1_by_id(receiving_chat_msg_signal,
+								  purple_connection_get_account(g),
 								  &angel, &buffy, chat, &flags));
 
 	if (!buffy || !angel || plugin_return) {
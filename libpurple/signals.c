@@ -33,8 +33,6 @@ typedef struct
 	GHashTable *signals;
 	size_t signal_count;
 
-	gulong next_signal_id;
-
 } PurpleInstanceData;
 
 typedef struct
@@ -47,8 +45,11 @@ typedef struct
 	GType *value_types;
 	GType ret_type;
 
-	GList *handlers;
-	size_t handler_count;
+	/* A GArray of PurpleSignalHandlerData sorted by priority, or NULL if
+	 * nothing is connected.  The array is never changed once it is set here;
+	 * connecting or disconnecting replaces it, so an emission can keep
+	 * walking the array it started with. */
+	GArray *handlers;
 
 	gulong next_handler_id;
 } PurpleSignalData;
@@ -64,8 +65,99 @@ typedef struct
 
 } PurpleSignalHandlerData;
 
+typedef struct
+{
+	void *instance;
+	GQuark signal;
+} PurpleSignalKey;
+
 static GHashTable *instance_table = NULL;
 
+/*
+ * Signal IDs are handed out once per instance and signal name, and are kept
+ * for the life of the process, like quarks.  This way an ID cached by an
+ * emitter stays valid if the signal is unregistered and registered again.
+ * PurpleSignalKey => ID, and ID => PurpleSignalData (NULL if unregistered).
+ */
+static GHashTable *signal_ids = NULL;
+static GPtrArray *signals_by_id = NULL;
+
+static guint
+signal_key_hash(const PurpleSignalKey *key)
+{
+	return g_direct_hash(key->instance) ^ key->signal;
+}
+
+static gboolean
+signal_key_equal(const PurpleSignalKey *a, const PurpleSignalKey *b)
+{
+	return (a->instance == b->instance && a->signal == b->signal);
+}
+
+static gulong
+signal_id_for(void *instance, const char *signal, gboolean create)
+{
+	PurpleSignalKey key, *new_key;
+	gulong id;
+
+	key.instance = instance;
+	key.signal = create ? g_quark_from_string(signal) : g_quark_try_string(signal);
+
+	if (key.signal == 0)
+		return 0;
+
+	id = GPOINTER_TO_SIZE(g_hash_table_lookup(signal_ids, &key));
+
+	if (id == 0 && create) {
+		id = signals_by_id->len;
+		g_ptr_array_add(signals_by_id, NULL);
+
+		new_key = g_new(PurpleSignalKey, 1);
+		*new_key = key;
+		g_hash_table_insert(signal_ids, new_key, GSIZE_TO_POINTER(id));
+	}
+
+	return id;
+}
+
+static PurpleSignalData *
+signal_data_for_id(gulong id)
+{
+	if (signals_by_id == NULL || id >= signals_by_id->len)
+		return NULL;
+
+	return g_ptr_array_index(signals_by_id, id);
+}
+
+static void
+signal_data_set_handlers(PurpleSignalData *signal_data, GArray *handlers)
+{
+	if (signal_data->handlers != NULL)
+		g_array_unref(signal_data->handlers);
+
+	if (handlers != NULL && handlers->len == 0) {
+		g_array_unref(handlers);
+		handlers = NULL;
+	}
+
+	signal_data->handlers = handlers;
+}
+
+static GArray *
+signal_data_copy_handlers(PurpleSignalData *signal_data, guint reserve)
+{
+	GArray *old = signal_data->handlers;
+	GArray *handlers;
+
+	handlers = g_array_sized_new(FALSE, FALSE, sizeof(PurpleSignalHandlerData),
+	                             (old ? old->len : 0) + reserve);
+
+	if (old != NULL)
+		g_array_append_vals(handlers, old->data, old->len);
+
+	return handlers;
+}
+
 static void
 destroy_instance_data(PurpleInstanceData *instance_data)
 {
@@ -77,7 +169,10 @@ destroy_instance_data(PurpleInstanceData *instance_data)
 static void
 destroy_signal_data(PurpleSignalData *signal_data)
 {
-	g_list_free_full(signal_data->handlers, g_free);
+	if (signal_data_for_id(signal_data->id) == signal_data)
+		g_ptr_array_index(signals_by_id, signal_data->id) = NULL;
+
+	signal_data_set_handlers(signal_data, NULL);
 	g_free(signal_data->value_types);
 	g_free(signal_data);
 }
@@ -103,7 +198,6 @@ purple_signal_register(void *instance, const char *signal,
 		instance_data = g_new0(PurpleInstanceData, 1);
 
 		instance_data->instance = instance;
-		instance_data->next_signal_id = 1;
 
 		instance_data->signals =
 			g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
@@ -113,7 +207,7 @@ purple_signal_register(void *instance, const char *signal,
 	}
 
 	signal_data = g_new0(PurpleSignalData, 1);
-	signal_data->id              = instance_data->next_signal_id;
+	signal_data->id              = signal_id_for(instance, signal, TRUE);
 	signal_data->marshal         = marshal;
 	signal_data->next_handler_id = 1;
 	signal_data->ret_type        = ret_type;
@@ -135,8 +229,8 @@ purple_signal_register(void *instance, const char *signal,
 
 	g_hash_table_insert(instance_data->signals,
 						g_strdup(signal), signal_data);
+	g_ptr_array_index(signals_by_id, signal_data->id) = signal_data;
 
-	instance_data->next_signal_id++;
 	instance_data->signal_count++;
 
 	return signal_data->id;
@@ -212,21 +306,15 @@ purple_signal_get_types(void *instance, const char *signal,
 		*ret_type = signal_data->ret_type;
 }
 
-static gint handler_priority(void * a, void * b) {
-	PurpleSignalHandlerData *ah = (PurpleSignalHandlerData*)a;
-	PurpleSignalHandlerData *bh = (PurpleSignalHandlerData*)b;
-	if (ah->priority > bh->priority) return 1;
-	if (ah->priority < bh->priority) return -1;
-	return 0;
-}
-
 static gulong
 signal_connect_common(void *instance, const char *signal, void *handle,
 					  PurpleCallback func, void *data, int priority, gboolean use_vargs)
 {
 	PurpleInstanceData *instance_data;
 	PurpleSignalData *signal_data;
-	PurpleSignalHandlerData *handler_data;
+	PurpleSignalHandlerData handler_data;
+	GArray *handlers;
+	guint i;
 
 	g_return_val_if_fail(instance != NULL, 0);
 	g_return_val_if_fail(signal   != NULL, 0);
@@ -257,19 +345,25 @@ signal_connect_common(void *instance, const char *signal, void *handle,
 	}
 
 	/* Create the signal handler data */
-	handler_data = g_new0(PurpleSignalHandlerData, 1);
-	handler_data->id        = signal_data->next_handler_id;
-	handler_data->cb        = func;
-	handler_data->handle    = handle;
-	handler_data->data      = data;
-	handler_data->use_vargs = use_vargs;
-	handler_data->priority = priority;
-
-	signal_data->handlers = g_list_insert_sorted(signal_data->handlers, handler_data, (GCompareFunc)handler_priority);
-	signal_data->handler_count++;
+	handler_data.id        = signal_data->next_handler_id;
+	handler_data.cb        = func;
+	handler_data.handle    = handle;
+	handler_data.data      = data;
+	handler_data.use_vargs = use_vargs;
+	handler_data.priority = priority;
+
+	/* Goes before any handlers with the same priority. */
+	handlers = signal_data_copy_handlers(signal_data, 1);
+	for (i = 0; i < handlers->len; i++) {
+		if (g_array_index(handlers, PurpleSignalHandlerData, i).priority >= priority)
+			break;
+	}
+	g_array_insert_val(handlers, i, handler_data);
+
+	signal_data_set_handlers(signal_data, handlers);
 	signal_data->next_handler_id++;
 
-	return handler_data->id;
+	return handler_data.id;
 }
 
 gulong
@@ -307,7 +401,8 @@ purple_signal_disconnect(void *instance, const char *signal,
 	PurpleInstanceData *instance_data;
 	PurpleSignalData *signal_data;
 	PurpleSignalHandlerData *handler_data;
-	GList *l;
+	GArray *handlers;
+	guint i;
 	gboolean found = FALSE;
 
 	g_return_if_fail(instance != NULL);
@@ -333,17 +428,16 @@ purple_signal_disconnect(void *instance, const char *signal,
 	}
 
 	/* Find the handler data. */
-	for (l = signal_data->handlers; l != NULL; l = l->next)
+	for (i = 0; signal_data->handlers && i < signal_data->handlers->len; i++)
 	{
-		handler_data = (PurpleSignalHandlerData *)l->data;
+		handler_data = &g_array_index(signal_data->handlers,
+		                              PurpleSignalHandlerData, i);
 
 		if (handler_data->handle == handle && handler_data->cb == func)
 		{
-			g_free(handler_data);
-
-			signal_data->handlers = g_list_delete_link(signal_data->handlers,
-												       l);
-			signal_data->handler_count--;
+			handlers = signal_data_copy_handlers(signal_data, 0);
+			g_array_remove_index(handlers, i);
+			signal_data_set_handlers(signal_data, handlers);
 
 			found = TRUE;
 
@@ -355,31 +449,37 @@ purple_signal_disconnect(void *instance, const char *signal,
 	g_return_if_fail(found);
 }
 
-/*
- * TODO: Make this all more efficient by storing a list of handlers, keyed
- *       to a handle.
- */
 static void
 disconnect_handle_from_signals(const char *signal,
 							   PurpleSignalData *signal_data, void *handle)
 {
-	GList *l, *l_next;
 	PurpleSignalHandlerData *handler_data;
+	GArray *handlers = NULL;
+	guint i;
 
-	for (l = signal_data->handlers; l != NULL; l = l_next)
+	if (signal_data->handlers == NULL)
+		return;
+
+	for (i = 0; i < signal_data->handlers->len; i++)
 	{
-		handler_data = (PurpleSignalHandlerData *)l->data;
-		l_next = l->next;
+		handler_data = &g_array_index(signal_data->handlers,
+		                              PurpleSignalHandlerData, i);
 
 		if (handler_data->handle == handle)
-		{
-			g_free(handler_data);
+			continue;
 
-			signal_data->handler_count--;
-			signal_data->handlers = g_list_delete_link(signal_data->handlers,
-			                                           l);
-		}
+		if (handlers == NULL)
+			handlers = g_array_sized_new(FALSE, FALSE,
+			                             sizeof(PurpleSignalHandlerData),
+			                             signal_data->handlers->len);
+
+		g_array_append_val(handlers, *handler_data);
 	}
+
+	if (handlers == NULL || handlers->len != signal_data->handlers->len)
+		signal_data_set_handlers(signal_data, handlers);
+	else
+		g_array_unref(handlers);
 }
 
 static void
@@ -400,35 +500,37 @@ purple_signals_disconnect_by_handle(void *handle)
 						 (GHFunc)disconnect_handle_from_instance, handle);
 }
 
-void
-purple_signal_emit(void *instance, const char *signal, ...)
+gulong
+purple_signal_lookup(void *instance, const char *signal)
 {
-	va_list args;
+	gulong id;
 
-	g_return_if_fail(instance != NULL);
-	g_return_if_fail(signal   != NULL);
+	g_return_val_if_fail(instance != NULL, 0);
+	g_return_val_if_fail(signal   != NULL, 0);
 
-	va_start(args, signal);
-	purple_signal_emit_vargs(instance, signal, args);
-	va_end(args);
+	id = signal_id_for(instance, signal, FALSE);
+
+	return (signal_data_for_id(id) != NULL) ? id : 0;
 }
 
-void
-purple_signal_emit_vargs(void *instance, const char *signal, va_list args)
+gboolean
+purple_signal_has_handlers(gulong signal_id)
+{
+	PurpleSignalData *signal_data = signal_data_for_id(signal_id);
+
+	return (signal_data != NULL && signal_data->handlers != NULL);
+}
+
+static PurpleSignalData *
+signal_data_lookup(void *instance, const char *signal)
 {
 	PurpleInstanceData *instance_data;
 	PurpleSignalData *signal_data;
-	PurpleSignalHandlerData *handler_data;
-	GList *l, *l_next;
-	va_list tmp;
-
-	g_return_if_fail(instance != NULL);
-	g_return_if_fail(signal   != NULL);
 
 	instance_data =
 		(PurpleInstanceData *)g_hash_table_lookup(instance_table, instance);
 
-	g_return_if_fail(instance_data != NULL);
+	g_return_val_if_fail(instance_data != NULL, NULL);
 
 	signal_data =
 		(PurpleSignalData *)g_hash_table_lookup(instance_data->signals, signal);
@@ -437,14 +539,30 @@ purple_signal_emit_vargs(void *instance, const char *signal, va_list args)
 	{
 		purple_debug(PURPLE_DEBUG_ERROR, "signals",
 				   "Signal data for %s not found!\n", signal);
-		return;
 	}
 
-	for (l = signal_data->handlers; l != NULL; l = l_next)
-	{
-		l_next = l->next;
+	return signal_data;
+}
 
-		handler_data = (PurpleSignalHandlerData *)l->data;
+static void
+signal_emit(PurpleSignalData *signal_data, va_list args)
+{
+	PurpleSignalMarshalFunc marshal = signal_data->marshal;
+	PurpleSignalHandlerData *handler_data;
+	GArray *handlers = signal_data->handlers;
+	guint i;
+	va_list tmp;
+
+	if (handlers == NULL)
+		return;
+
+	/* Keep the handlers we started with, even if they are replaced or the
+	 * signal is unregistered by one of them. */
+	g_array_ref(handlers);
+
+	for (i = 0; i < handlers->len; i++)
+	{
+		handler_data = &g_array_index(handlers, PurpleSignalHandlerData, i);
 
 		/* This is necessary because a va_list may only be
 		 * evaluated once */
@@ -457,12 +575,97 @@ purple_signal_emit_vargs(void *instance, const char *signal, va_list args)
 		}
 		else
 		{
-			signal_data->marshal(handler_data->cb, tmp,
-								 handler_data->data, NULL);
+			marshal(handler_data->cb, tmp, handler_data->data, NULL);
 		}
 
 		va_end(tmp);
 	}
+
+	g_array_unref(handlers);
+}
+
+static void *
+signal_emit_return_1(PurpleSignalData *signal_data, va_list args)
+{
+	PurpleSignalMarshalFunc marshal = signal_data->marshal;
+	PurpleSignalHandlerData *handler_data;
+	GArray *handlers = signal_data->handlers;
+	void *ret_val = NULL;
+	guint i;
+	va_list tmp;
+
+	if (handlers == NULL)
+		return NULL;
+
+	g_array_ref(handlers);
+
+	for (i = 0; i < handlers->len && ret_val == NULL; i++)
+	{
+		handler_data = &g_array_index(handlers, PurpleSignalHandlerData, i);
+
+		G_VA_COPY(tmp, args);
+		if (handler_data->use_vargs)
+		{
+			ret_val = ((void *(*)(va_list, void *))handler_data->cb)(
+				tmp, handler_data->data);
+		}
+		else
+		{
+			marshal(handler_data->cb, tmp, handler_data->data, &ret_val);
+		}
+		va_end(tmp);
+	}
+
+	g_array_unref(handlers);
+
+	return ret_val;
+}
+
+void
+purple_signal_emit(void *instance, const char *signal, ...)
+{
+	va_list args;
+
+	g_return_if_fail(instance != NULL);
+	g_return_if_fail(signal   != NULL);
+
+	va_start(args, signal);
+	purple_signal_emit_vargs(instance, signal, args);
+	va_end(args);
+}
+
+void
+purple_signal_emit_vargs(void *instance, const char *signal, va_list args)
+{
+	PurpleSignalData *signal_data;
+
+	g_return_if_fail(instance != NULL);
+	g_return_if_fail(signal   != NULL);
+
+	signal_data = signal_data_lookup(instance, signal);
+
+	if (signal_data != NULL)
+		signal_emit(signal_data, args);
+}
+
+void
+purple_signal_emit_by_id(gulong signal_id, ...)
+{
+	PurpleSignalData *signal_data;
+	va_list args;
+
+	signal_data = signal_data_for_id(signal_id);
+
+	if (signal_data == NULL)
+	{
+		purple_debug(PURPLE_DEBUG_ERROR, "signals",
+				   "Signal data for ID %lu not found!\n", signal_id);
+		return;
+	}
+
+	va_start(args, signal_id);
+	signal_emit(signal_data, args);
+	va_end(args);
 }
 
 void *
@@ -485,56 +688,40 @@ void *
 purple_signal_emit_vargs_return_1(void *instance, const char *signal,
 								va_list args)
 {
-	PurpleInstanceData *instance_data;
 	PurpleSignalData *signal_data;
-	PurpleSignalHandlerData *handler_data;
-	GList *l, *l_next;
-	va_list tmp;
 
 	g_return_val_if_fail(instance != NULL, NULL);
 	g_return_val_if_fail(signal   != NULL, NULL);
 
-	instance_data =
-		(PurpleInstanceData *)g_hash_table_lookup(instance_table, instance);
+	signal_data = signal_data_lookup(instance, signal);
 
-	g_return_val_if_fail(instance_data != NULL, NULL);
+	if (signal_data == NULL)
+		return NULL;
 
-	signal_data =
-		(PurpleSignalData *)g_hash_table_lookup(instance_data->signals, signal);
+	return signal_emit_return_1(signal_data, args);
+}
+
+void *
+purple_signal_emit_return_1_by_id(gulong signal_id, ...)
+{
+	PurpleSignalData *signal_data;
+	void *ret_val;
+	va_list args;
+
+	signal_data = signal_data_for_id(signal_id);
 
 	if (signal_data == NULL)
 	{
 		purple_debug(PURPLE_DEBUG_ERROR, "signals",
-				   "Signal data for %s not found!\n", signal);
-		return 0;
+				   "Signal data for ID %lu not found!\n", signal_id);
+		return NULL;
 	}
 
-	for (l = signal_data->handlers; l != NULL; l = l_next)
-	{
-		void *ret_val = NULL;
-
-		l_next = l->next;
-
-		handler_data = (PurpleSignalHandlerData *)l->data;
-
-		G_VA_COPY(tmp, args);
-		if (handler_data->use_vargs)
-		{
-			ret_val = ((void *(*)(va_list, void *))handler_data->cb)(
-				tmp, handler_data->data);
-		}
-		else
-		{
-			signal_data->marshal(handler_data->cb, tmp,
-								 handler_data->data, &ret_val);
-		}
-		va_end(tmp);
-
-		if (ret_val != NULL)
-			return ret_val;
-	}
+	va_start(args, signal_id);
+	ret_val = signal_emit_return_1(signal_data, args);
+	va_end(args);
 
-	return NULL;
+	return ret_val;
 }
 
 void
@@ -545,6 +732,16 @@ purple_signals_init()
 	instance_table =
 		g_hash_table_new_full(g_direct_hash, g_direct_equal,
 							  NULL, (GDestroyNotify)destroy_instance_data);
+
+	if (signal_ids == NULL) {
+		signal_ids = g_hash_table_new_full((GHashFunc)signal_key_hash,
+		                                   (GEqualFunc)signal_key_equal,
+		                                   g_free, NULL);
+
+		/* ID 0 means "no signal". */
+		signals_by_id = g_ptr_array_new();
+		g_ptr_array_add(signals_by_id, NULL);
+	}
 }
 
 void
@@ -552,6 +749,8 @@ purple_signals_uninit()
 {
 	g_return_if_fail(instance_table != NULL);
 
+	/* signal_ids and signals_by_id are kept so IDs stay stable if the
+	 * subsystem is initialized again; every signal is unregistered here. */
 	g_hash_table_destroy(instance_table);
 	instance_table = NULL;
 }
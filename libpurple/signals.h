@@ -86,8 +86,9 @@ G_BEGIN_DECLS
  *
  * Registers a signal in an instance.
  *
- * Returns: The signal ID local to that instance, or 0 if the signal
- *          couldn't be registered.
+ * Returns: The signal ID, or 0 if the signal couldn't be registered.  The
+ *          ID can be used with purple_signal_emit_by_id(), and stays the same
+ *          if the signal is unregistered and registered again.
  */
 gulong purple_signal_register(void *instance, const char *signal,
 							PurpleSignalMarshalFunc marshal,
@@ -243,6 +244,31 @@ void purple_signal_disconnect(void *instance, const char *signal,
  */
 void purple_signals_disconnect_by_handle(void *handle);
 
+/**
+ * purple_signal_lookup:
+ * @instance: The instance the signal is registered on.
+ * @signal:   The signal name.
+ *
+ * Looks up the ID of a registered signal, so that frequently emitted signals
+ * can be emitted with purple_signal_emit_by_id() without looking up the
+ * instance and signal name every time.
+ *
+ * Returns: The signal ID, or 0 if the signal is not registered.
+ */
+gulong purple_signal_lookup(void *instance, const char *signal);
+
+/**
+ * purple_signal_has_handlers:
+ * @signal_id: The signal ID.
+ *
+ * Checks whether any handlers are connected to a signal.  This is cheap
+ * enough to call before every emission, so an emitter can skip building the
+ * arguments for a signal nobody listens to.
+ *
+ * Returns: %TRUE if at least one handler is connected.
+ */
+gboolean purple_signal_has_handlers(gulong signal_id);
+
 /**
  * purple_signal_emit:
  * @instance: The instance emitting the signal.
@@ -267,6 +293,18 @@ void purple_signal_emit(void *instance, const char *signal, ...);
  */
 void purple_signal_emit_vargs(void *instance, const char *signal, va_list args);
 
+/**
+ * purple_signal_emit_by_id:
+ * @signal_id: The ID of the signal being emitted.
+ * @...:       The arguments to pass to the callbacks.
+ *
+ * Emits a signal by the ID returned from purple_signal_register() or
+ * purple_signal_lookup().
+ *
+ * See purple_signal_emit()
+ */
+void purple_signal_emit_by_id(gulong signal_id, ...);
+
 /**
  * purple_signal_emit_return_1:
  * @instance: The instance emitting the signal.
@@ -298,6 +336,19 @@ void *purple_signal_emit_return_1(void *instance, const char *signal, ...);
 void *purple_signal_emit_vargs_return_1(void *instance, const char *signal,
 									  va_list args);
 
+/**
+ * purple_signal_emit_return_1_by_id:
+ * @signal_id: The ID of the signal being emitted.
+ * @...:       The arguments to pass to the callbacks.
+ *
+ * Emits a signal by ID and returns the first non-NULL return value.
+ *
+ * See purple_signal_emit_return_1()
+ *
+ * Returns: The first non-NULL return value
+ */
+void *purple_signal_emit_return_1_by_id(gulong signal_id, ...);
+
 /**
  * purple_signals_init:
  *
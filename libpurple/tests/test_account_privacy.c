@@ -0,0 +1,166 @@
+/*
+ * Purple
+ *
+ * Purple is the legal property of its developers, whose names are too
+ * numerous to list here. Please refer to the COPYRIGHT file distributed
+ * with this source distribution
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02111-1301 USA
+ */
+
+#include <glib.h>
+#include <string.h>
+
+#include <purple.h>
+
+#include "test_ui.h"
+
+/******************************************************************************
+ * Helpers
+ *****************************************************************************/
+static void
+test_account_privacy_assert_list(GSList *list, ...) {
+	const gchar *expected;
+	va_list vargs;
+
+	va_start(vargs, list);
+
+	while ((expected = va_arg(vargs, const gchar *)) != NULL) {
+		g_assert_nonnull(list);
+		g_assert_cmpstr(list->data, ==, expected);
+		list = list->next;
+	}
+
+	va_end(vargs);
+
+	g_assert_null(list);
+}
+
+/******************************************************************************
+ * Tests
+ *****************************************************************************/
+static void
+test_account_privacy_add_remove(void) {
+	PurpleAccount *account = purple_account_new("privacy-add-remove",
+	                                            "prpl-privacy");
+
+	g_assert_true(purple_account_privacy_permit_add(account, "a", TRUE));
+	g_assert_true(purple_account_privacy_permit_add(account, "b", TRUE));
+	g_assert_true(purple_account_privacy_permit_add(account, "c", TRUE));
+	g_assert_false(purple_account_privacy_permit_add(account, "b", TRUE));
+	test_account_privacy_assert_list(
+		purple_account_privacy_get_permitted(account), "a", "b", "c", NULL);
+
+	/* removing the tail has to keep appending working */
+	g_assert_true(purple_account_privacy_permit_remove(account, "c", TRUE));
+	g_assert_false(purple_account_privacy_permit_remove(account, "c", TRUE));
+	g_assert_true(purple_account_privacy_permit_add(account, "d", TRUE));
+	test_account_privacy_assert_list(
+		purple_account_privacy_get_permitted(account), "a", "b", "d", NULL);
+
+	g_assert_true(purple_account_privacy_permit_remove(account, "a", TRUE));
+	g_assert_true(purple_account_privacy_permit_remove(account, "d", TRUE));
+	g_assert_true(purple_account_privacy_permit_remove(account, "b", TRUE));
+	g_assert_null(purple_account_privacy_get_permitted(account));
+
+	g_assert_true(purple_account_privacy_permit_add(account, "e", TRUE));
+	test_account_privacy_assert_list(
+		purple_account_privacy_get_permitted(account), "e", NULL);
+
+	/* the lists are independent */
+	g_assert_null(purple_account_privacy_get_denied(account));
+
+	g_object_unref(account);
+}
+
+static void
+test_account_privacy_check(void) {
+	PurpleAccount *account = purple_account_new("privacy-check",
+	                                            "prpl-privacy");
+
+	purple_account_privacy_permit_add(account, "friend", TRUE);
+	purple_account_privacy_deny_add(account, "spammer", TRUE);
+
+	purple_account_set_privacy_type(account,
+	                                PURPLE_ACCOUNT_PRIVACY_ALLOW_USERS);
+	g_assert_true(purple_account_privacy_check(account, "friend"));
+	g_assert_false(purple_account_privacy_check(account, "stranger"));
+
+	purple_account_set_privacy_type(account,
+	                                PURPLE_ACCOUNT_PRIVACY_DENY_USERS);
+	g_assert_false(purple_account_privacy_check(account, "spammer"));
+	g_assert_true(purple_account_privacy_check(account, "stranger"));
+
+	purple_account_privacy_deny_remove(account, "spammer", TRUE);
+	g_assert_true(purple_account_privacy_check(account, "spammer"));
+
+	g_object_unref(account);
+}
+
+static void
+test_account_privacy_set_list(void) {
+	PurpleAccount *account = purple_account_new("privacy-set-list",
+	                                            "prpl-privacy");
+	GSList *names = NULL;
+
+	names = g_slist_append(names, "a");
+	names = g_slist_append(names, "b");
+	names = g_slist_append(names, "a");
+	g_assert_cmpuint(
+		purple_account_privacy_deny_add_list(account, names, TRUE), ==, 2);
+	test_account_privacy_assert_list(
+		purple_account_privacy_get_denied(account), "a", "b", NULL);
+	g_slist_free(names);
+
+	names = NULL;
+	names = g_slist_append(names, "c");
+	names = g_slist_append(names, "b");
+	names = g_slist_append(names, "d");
+
+	/* "a" goes away, "c" and "d" are added and "b" is left alone */
+	g_assert_cmpuint(
+		purple_account_privacy_deny_set_list(account, names, TRUE), ==, 3);
+	test_account_privacy_assert_list(
+		purple_account_privacy_get_denied(account), "b", "c", "d", NULL);
+
+	g_assert_cmpuint(
+		purple_account_privacy_deny_set_list(account, names, TRUE), ==, 0);
+	g_slist_free(names);
+
+	g_assert_cmpuint(
+		purple_account_privacy_deny_set_list(account, NULL, TRUE), ==, 3);
+	g_assert_null(purple_account_privacy_get_denied(account));
+
+	g_object_unref(account);
+}
+
+/******************************************************************************
+ * Main
+ *****************************************************************************/
+gint
+main(gint argc, gchar **argv) {
+	g_test_init(&argc, &argv, NULL);
+
+	test_ui_purple_init();
+
+	g_test_add_func("/account/privacy/add-remove",
+	                test_account_privacy_add_remove);
+	g_test_add_func("/account/privacy/check",
+	                test_account_privacy_check);
+	g_test_add_func("/account/privacy/set-list",
+	                test_account_privacy_set_list);
+
+	return g_test_run();
+}
@@ -0,0 +1,200 @@
+/*
+ * Purple
+ *
+ * Purple is the legal property of its developers, whose names are too
+ * numerous to list here. Please refer to the COPYRIGHT file distributed
+ * with this source distribution
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02111-1301 USA
+ */
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <purple.h>
+
+#include "test_ui.h"
+
+#define TEST_LOG_PROTOCOL_ID "prpl-test-log"
+#define TEST_LOG_PROTOCOL_ICON "test-log"
+#define TEST_LOG_ACCOUNT "someone"
+#define TEST_LOG_BUDDY "buddy"
+#define TEST_LOG_FILE "2020-01-01.000000+0000UTC.html"
+
+/******************************************************************************
+ * TestPurpleProtocolLog Implementation
+ *****************************************************************************/
+static GType test_purple_protocol_log_get_type(void);
+
+typedef struct {
+	PurpleProtocol parent;
+} TestPurpleProtocolLog;
+
+typedef struct {
+	PurpleProtocolClass parent;
+} TestPurpleProtocolLogClass;
+
+G_DEFINE_TYPE(TestPurpleProtocolLog, test_purple_protocol_log,
+              PURPLE_TYPE_PROTOCOL);
+
+static void
+test_purple_protocol_log_login(PurpleAccount *account) {
+}
+
+static void
+test_purple_protocol_log_close(PurpleConnection *gc) {
+}
+
+static GList *
+test_purple_protocol_log_status_types(PurpleAccount *account) {
+	GList *types = NULL;
+
+	types = g_list_append(types,
+		purple_status_type_new(PURPLE_STATUS_AVAILABLE, NULL, NULL, TRUE));
+	types = g_list_append(types,
+		purple_status_type_new(PURPLE_STATUS_OFFLINE, NULL, NULL, TRUE));
+
+	return types;
+}
+
+static const char *
+test_purple_protocol_log_list_icon(PurpleAccount *account, PurpleBuddy *buddy) {
+	return TEST_LOG_PROTOCOL_ICON;
+}
+
+static void
+test_purple_protocol_log_init(TestPurpleProtocolLog *prpl) {
+	PurpleProtocol *protocol = PURPLE_PROTOCOL(prpl);
+
+	protocol->id = TEST_LOG_PROTOCOL_ID;
+	protocol->name = "Test Log";
+}
+
+static void
+test_purple_protocol_log_class_init(TestPurpleProtocolLogClass *klass) {
+	PurpleProtocolClass *protocol_class = PURPLE_PROTOCOL_CLASS(klass);
+
+	protocol_class->login = test_purple_protocol_log_login;
+	protocol_class->close = test_purple_protocol_log_close;
+	protocol_class->status_types = test_purple_protocol_log_status_types;
+	protocol_class->list_icon = test_purple_protocol_log_list_icon;
+}
+
+/******************************************************************************
+ * Helpers
+ *****************************************************************************/
+static void
+test_log_append(const gchar *filename, const gchar *text) {
+	FILE *file = g_fopen(filename, "ab");
+
+	g_assert_nonnull(file);
+	g_assert_cmpuint(fwrite(text, 1, strlen(text), file), ==, strlen(text));
+	fclose(file);
+}
+
+/* Removes path and then each of its parents up to, but not including, base,
+ * for as long as they are empty. */
+static void
+test_log_remove_up_to(const gchar *base, const gchar *path) {
+	gchar *current = g_strdup(path);
+
+	while (!purple_strequal(current, base) && g_remove(current) == 0) {
+		gchar *parent = g_path_get_dirname(current);
+
+		g_free(current);
+		current = parent;
+	}
+
+	g_free(current);
+}
+
+/******************************************************************************
+ * Index Tests
+ *****************************************************************************/
+static void
+test_log_index_save_load(void) {
+	PurpleAccount *account;
+	gchar *log_dir, *log_file, *index_dir, *index_file;
+
+	log_dir = g_build_filename(purple_data_dir(), "logs",
+	                           TEST_LOG_PROTOCOL_ICON, TEST_LOG_ACCOUNT,
+	                           TEST_LOG_BUDDY, NULL);
+	log_file = g_build_filename(log_dir, TEST_LOG_FILE, NULL);
+	index_dir = g_build_filename(purple_cache_dir(), "logs",
+	                             TEST_LOG_PROTOCOL_ICON, NULL);
+	index_file = g_build_filename(index_dir, TEST_LOG_ACCOUNT ".index",
+	                              NULL);
+
+	/* The index goes into a directory that doesn't exist yet */
+	g_assert_false(g_file_test(index_dir, G_FILE_TEST_EXISTS));
+
+	g_assert_cmpint(g_mkdir_with_parents(log_dir, S_IRWXU), ==, 0);
+	test_log_append(log_file, "0123456789");
+
+	account = purple_account_new(TEST_LOG_ACCOUNT, TEST_LOG_PROTOCOL_ID);
+	g_assert_cmpint(purple_log_get_total_size(PURPLE_LOG_IM, TEST_LOG_BUDDY,
+	                                          account), ==, 10);
+
+	/* Dropping the account saves its index */
+	g_object_unref(account);
+	purple_util_flush_deferred_writes();
+	g_assert_true(g_file_test(index_file, G_FILE_TEST_IS_REGULAR));
+
+	/* Appending doesn't touch the log directory, so only the index knows
+	 * the old size, and a fresh account has to get it from the file. */
+	test_log_append(log_file, "01234");
+
+	account = purple_account_new(TEST_LOG_ACCOUNT, TEST_LOG_PROTOCOL_ID);
+	g_assert_cmpint(purple_log_get_total_size(PURPLE_LOG_IM, TEST_LOG_BUDDY,
+	                                          account), ==, 10);
+	g_object_unref(account);
+	purple_util_flush_deferred_writes();
+
+	test_log_remove_up_to(purple_data_dir(), log_file);
+	test_log_remove_up_to(purple_cache_dir(), index_file);
+
+	g_free(index_file);
+	g_free(index_dir);
+	g_free(log_file);
+	g_free(log_dir);
+}
+
+/******************************************************************************
+ * Main
+ *****************************************************************************/
+gint
+main(gint argc, gchar **argv) {
+	PurpleProtocol *protocol;
+	GError *error = NULL;
+	gint res;
+
+	g_test_init(&argc, &argv, NULL);
+
+	test_ui_purple_init();
+
+	protocol = purple_protocols_add(test_purple_protocol_log_get_type(),
+	                                &error);
+	g_assert_no_error(error);
+
+	g_test_add_func("/log/index/save-load", test_log_index_save_load);
+
+	res = g_test_run();
+
+	purple_protocols_remove(protocol, NULL);
+
+	return res;
+}
@@ -162,6 +162,12 @@ test_queued_output_stream_push_bytes_async_multiple(void) {
 
 	g_assert_cmpint(done, ==, 0);
 
+	g_assert_cmpuint(purple_queued_output_stream_get_queued_bytes(queued),
+			==, 0);
+	g_assert_cmpuint(purple_queued_output_stream_get_high_watermark(queued),
+			==, test_bytes_data_len + test_bytes_data_len2 +
+			test_bytes_data_len3);
+
 	all_test_bytes_data = g_strconcat((const gchar *)test_bytes_data,
 			test_bytes_data2, test_bytes_data3, NULL);
 
@@ -179,6 +185,68 @@ test_queued_output_stream_push_bytes_async_multiple(void) {
 	g_clear_object(&output);
 }
 
+static void
+test_queued_output_stream_push_bytes_async_limits(void) {
+	GMemoryOutputStream *output;
+	PurpleQueuedOutputStream *queued;
+	GBytes *bytes;
+	GString *expected;
+	GError *err = NULL;
+	gint done = 0;
+	gint i;
+
+	output = G_MEMORY_OUTPUT_STREAM(g_memory_output_stream_new_resizable());
+	g_assert_nonnull(output);
+
+	queued = purple_queued_output_stream_new(G_OUTPUT_STREAM(output));
+	g_assert_true(PURPLE_IS_QUEUED_OUTPUT_STREAM(queued));
+
+	/* Small enough to split the queue across several writes */
+	purple_queued_output_stream_set_write_limits(queued, 10, 2);
+
+	expected = g_string_new(NULL);
+	for (i = 0; i < 20; i++) {
+		const guint8 *data = (i % 2) ? test_bytes_data2 : test_bytes_data3;
+		gsize len = (i % 2) ? test_bytes_data_len2 : test_bytes_data_len3;
+
+		bytes = g_bytes_new_static(data, len);
+		purple_queued_output_stream_push_bytes_async(queued, bytes,
+				G_PRIORITY_DEFAULT, NULL,
+				test_queued_output_stream_push_bytes_async_multiple_cb,
+				&done);
+		g_bytes_unref(bytes);
+
+		g_string_append_len(expected, (const gchar *)data, len);
+		done++;
+	}
+
+	g_assert_cmpuint(purple_queued_output_stream_get_queued_bytes(queued),
+			==, expected->len);
+
+	while (done > 0) {
+		g_main_context_iteration(NULL, TRUE);
+	}
+
+	g_assert_cmpint(done, ==, 0);
+	g_assert_cmpuint(purple_queued_output_stream_get_queued_bytes(queued),
+			==, 0);
+	g_assert_cmpuint(purple_queued_output_stream_get_high_watermark(queued),
+			==, expected->len);
+
+	g_assert_cmpmem(g_memory_output_stream_get_data(output),
+			g_memory_output_stream_get_data_size(output),
+			expected->str, expected->len);
+
+	g_string_free(expected, TRUE);
+
+	g_assert_true(g_output_stream_close(
+			G_OUTPUT_STREAM(queued), NULL, &err));
+	g_assert_no_error(err);
+
+	g_clear_object(&queued);
+	g_clear_object(&output);
+}
+
 static void
 test_queued_output_stream_push_bytes_async_error_cb(GObject *source,
 		GAsyncResult *res, gpointer user_data)
@@ -269,6 +337,8 @@ main(gint argc, gchar **argv) {
 			test_queued_output_stream_push_bytes_async);
 	g_test_add_func("/queued-output-stream/push-bytes-async-multiple",
 			test_queued_output_stream_push_bytes_async_multiple);
+	g_test_add_func("/queued-output-stream/push-bytes-async-limits",
+			test_queued_output_stream_push_bytes_async_limits);
 	g_test_add_func("/queued-output-stream/push-bytes-async-error",
 			test_queued_output_stream_push_bytes_async_error);
 
@@ -0,0 +1,137 @@
+/*
+ * Purple
+ *
+ * Purple is the legal property of its developers, whose names are too
+ * numerous to list here. Please refer to the COPYRIGHT file distributed
+ * with this source distribution
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02111-1301 USA
+ */
+
+#include <glib.h>
+
+#include <purple.h>
+
+#include "test_ui.h"
+
+static int test_signals_instance;
+static int test_signals_handle;
+
+/******************************************************************************
+ * Helpers
+ *****************************************************************************/
+static void
+test_signals_register(void) {
+	purple_signal_register(&test_signals_instance, "test-signal",
+	                       purple_marshal_VOID__POINTER, G_TYPE_NONE, 1,
+	                       G_TYPE_POINTER);
+}
+
+static void
+test_signals_append_cb(GString *str, gpointer data) {
+	g_string_append(str, data);
+}
+
+static void
+test_signals_disconnect_cb(GString *str, gpointer data) {
+	g_string_append(str, data);
+
+	purple_signal_disconnect(&test_signals_instance, "test-signal",
+	                         &test_signals_handle,
+	                         PURPLE_CALLBACK(test_signals_disconnect_cb));
+}
+
+/******************************************************************************
+ * Tests
+ *****************************************************************************/
+static void
+test_signals_lookup(void) {
+	gulong id;
+
+	g_assert_cmpuint(purple_signal_lookup(&test_signals_instance,
+	                                      "test-signal"), ==, 0);
+
+	test_signals_register();
+	id = purple_signal_lookup(&test_signals_instance, "test-signal");
+	g_assert_cmpuint(id, !=, 0);
+	g_assert_false(purple_signal_has_handlers(id));
+
+	/* IDs survive unregistering and registering again */
+	purple_signal_unregister(&test_signals_instance, "test-signal");
+	g_assert_cmpuint(purple_signal_lookup(&test_signals_instance,
+	                                      "test-signal"), ==, 0);
+	g_assert_false(purple_signal_has_handlers(id));
+
+	test_signals_register();
+	g_assert_cmpuint(purple_signal_lookup(&test_signals_instance,
+	                                      "test-signal"), ==, id);
+
+	purple_signals_unregister_by_instance(&test_signals_instance);
+}
+
+static void
+test_signals_emit(void) {
+	GString *str = g_string_new(NULL);
+	gulong id;
+
+	test_signals_register();
+	id = purple_signal_lookup(&test_signals_instance, "test-signal");
+
+	purple_signal_connect(&test_signals_instance, "test-signal",
+	                      &test_signals_handle,
+	                      PURPLE_CALLBACK(test_signals_append_cb), "b");
+	purple_signal_connect_priority(&test_signals_instance, "test-signal",
+	                               &test_signals_handle,
+	                               PURPLE_CALLBACK(test_signals_append_cb),
+	                               "c", PURPLE_SIGNAL_PRIORITY_HIGHEST);
+	purple_signal_connect_priority(&test_signals_instance, "test-signal",
+	                               &test_signals_handle,
+	                               PURPLE_CALLBACK(test_signals_disconnect_cb),
+	                               "a", PURPLE_SIGNAL_PRIORITY_LOWEST);
+	g_assert_true(purple_signal_has_handlers(id));
+
+	/* lowest priority first; a handler can disconnect itself */
+	purple_signal_emit(&test_signals_instance, "test-signal", str);
+	g_assert_cmpstr(str->str, ==, "abc");
+
+	g_string_truncate(str, 0);
+	purple_signal_emit_by_id(id, str);
+	g_assert_cmpstr(str->str, ==, "bc");
+
+	purple_signals_disconnect_by_handle(&test_signals_handle);
+	g_assert_false(purple_signal_has_handlers(id));
+
+	g_string_truncate(str, 0);
+	purple_signal_emit_by_id(id, str);
+	g_assert_cmpstr(str->str, ==, "");
+
+	purple_signals_unregister_by_instance(&test_signals_instance);
+	g_string_free(str, TRUE);
+}
+
+/******************************************************************************
+ * Main
+ *****************************************************************************/
+gint
+main(gint argc, gchar **argv) {
+	g_test_init(&argc, &argv, NULL);
+
+	test_ui_purple_init();
+
+	g_test_add_func("/signals/lookup", test_signals_lookup);
+	g_test_add_func("/signals/emit", test_signals_emit);
+
+	return g_test_run();
+}
@@ -21,6 +21,7 @@
  *
  */
 #include <glib.h>
+#include <glib/gstdio.h>
 
 #include <purple.h>
 
@@ -507,6 +508,189 @@ test_uri_escape_for_open(void) {
 	g_free(result);
 }
 
+/******************************************************************************
+ * purple_normalize_atom tests
+ *****************************************************************************/
+static void
+test_util_normalize_atom(void) {
+	const gchar *composed = "caf\xc3\xa9";
+	const gchar *decomposed = "cafe\xcc\x81";
+	const gchar *name, *other;
+
+	name = purple_normalize_atom(NULL, composed);
+	g_assert_cmpstr(name, ==, purple_normalize(NULL, composed));
+
+	/* Equal normalized forms come back as the same atom */
+	other = purple_normalize_atom(NULL, decomposed);
+	g_assert_true(name == other);
+	purple_normalize_atom_unref(other);
+
+	/* The result can be fed back in */
+	other = purple_normalize_atom(NULL, name);
+	g_assert_true(name == other);
+	purple_normalize_atom_unref(other);
+
+	other = purple_normalize_atom(NULL, "cafe");
+	g_assert_false(name == other);
+	purple_normalize_atom_unref(other);
+
+	purple_normalize_atom_unref(name);
+}
+
+static void
+test_util_normalize_atom_evict(void) {
+	const gchar *held, *name;
+	gchar *str;
+	guint i;
+
+	held = purple_normalize_atom(NULL, "held@example.com");
+
+	/* Enough other names to push everything else out of the cache */
+	for (i = 0; i < 20000; i++) {
+		str = g_strdup_printf("passing-%u@example.com", i);
+		name = purple_normalize_atom(NULL, str);
+		g_assert_cmpstr(name, ==, str);
+		purple_normalize_atom_unref(name);
+		g_free(str);
+	}
+
+	/* A referenced atom outlives the eviction of its string */
+	g_assert_cmpstr(held, ==, "held@example.com");
+	name = purple_normalize_atom(NULL, "held@example.com");
+	g_assert_true(name == held);
+	purple_normalize_atom_unref(name);
+
+	purple_normalize_atom_unref(held);
+}
+
+/* Looks up every name in a 10k buddy list keyed the way buddylist.c was
+ * before atoms, and the way it is now, and reports both rates. */
+static void
+test_util_normalize_atom_benchmark(void) {
+	GHashTable *before, *after;
+	const gchar *name;
+	gchar **names;
+	gdouble before_elapsed, after_elapsed;
+	guint i, j;
+	guint n = 10000, rounds = 100;
+
+	before = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	after = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+	                              (GDestroyNotify)purple_normalize_atom_unref,
+	                              NULL);
+
+	names = g_new0(gchar *, n + 1);
+	for (i = 0; i < n; i++) {
+		names[i] = g_strdup_printf("Buddy-%u@Example.com", i);
+		g_hash_table_add(before, g_strdup(purple_normalize(NULL, names[i])));
+		g_hash_table_add(after, (gpointer)purple_normalize_atom(NULL, names[i]));
+	}
+
+	g_test_timer_start();
+	for (j = 0; j < rounds; j++) {
+		for (i = 0; i < n; i++) {
+			name = purple_normalize(NULL, names[i]);
+			g_assert_true(g_hash_table_contains(before, name));
+		}
+	}
+	before_elapsed = g_test_timer_elapsed();
+
+	g_test_timer_start();
+	for (j = 0; j < rounds; j++) {
+		for (i = 0; i < n; i++) {
+			name = purple_normalize_atom(NULL, names[i]);
+			g_assert_true(g_hash_table_contains(after, name));
+			purple_normalize_atom_unref(name);
+		}
+	}
+	after_elapsed = g_test_timer_elapsed();
+
+	g_test_message("%.0f lookups per second over %u buddies with "
+	               "purple_normalize()", n * rounds / before_elapsed, n);
+	g_test_maximized_result(n * rounds / after_elapsed,
+	                        "%.0f lookups per second over %u buddies with "
+	                        "purple_normalize_atom()",
+	                        n * rounds / after_elapsed, n);
+
+	/* The whole list stays cached, so it has to beat normalizing */
+	g_assert_cmpfloat(after_elapsed, <, before_elapsed);
+
+	g_hash_table_destroy(after);
+	g_hash_table_destroy(before);
+	g_strfreev(names);
+}
+
+/******************************************************************************
+ * purple_util_write_data_to_file_deferred tests
+ *****************************************************************************/
+static void
+test_util_write_data_deferred(void) {
+	GBytes *bytes;
+	GError *error = NULL;
+	gchar *dir, *filename, *contents = NULL;
+	gsize length = 0;
+
+	dir = g_dir_make_tmp("purple-test-util-XXXXXX", &error);
+	g_assert_no_error(error);
+	filename = g_build_filename(dir, "deferred.xml", NULL);
+
+	bytes = g_bytes_new_static("first", 5);
+	purple_util_write_data_to_file_deferred(filename, bytes);
+	g_bytes_unref(bytes);
+
+	/* Whatever is still queued is replaced, the last write wins */
+	bytes = g_bytes_new_static("second", 6);
+	purple_util_write_data_to_file_deferred(filename, bytes);
+	g_bytes_unref(bytes);
+
+	purple_util_flush_deferred_writes();
+
+	g_assert_true(g_file_get_contents(filename, &contents, &length, &error));
+	g_assert_no_error(error);
+	g_assert_cmpuint(length, ==, 6);
+	g_assert_cmpstr(contents, ==, "second");
+
+	g_free(contents);
+	g_unlink(filename);
+	g_rmdir(dir);
+	g_free(filename);
+	g_free(dir);
+}
+
+static void
+test_util_write_data_deferred_nested(void) {
+	GBytes *bytes;
+	GError *error = NULL;
+	gchar *dir, *subdir, *filename, *contents = NULL;
+
+	dir = g_dir_make_tmp("purple-test-util-XXXXXX", &error);
+	g_assert_no_error(error);
+	subdir = g_build_filename(dir, "a", "b", NULL);
+	filename = g_build_filename(subdir, "nested.index", NULL);
+
+	/* Every missing directory on the way is created */
+	bytes = g_bytes_new_static("nested", 6);
+	purple_util_write_data_to_file_deferred(filename, bytes);
+	g_bytes_unref(bytes);
+
+	purple_util_flush_deferred_writes();
+
+	g_assert_true(g_file_get_contents(filename, &contents, NULL, &error));
+	g_assert_no_error(error);
+	g_assert_cmpstr(contents, ==, "nested");
+
+	g_free(contents);
+	g_unlink(filename);
+	g_rmdir(subdir);
+	g_free(subdir);
+	subdir = g_build_filename(dir, "a", NULL);
+	g_rmdir(subdir);
+	g_rmdir(dir);
+	g_free(subdir);
+	g_free(filename);
+	g_free(dir);
+}
+
 /******************************************************************************
  * MANE
  *****************************************************************************/
@@ -550,5 +734,20 @@ main(gint argc, gchar **argv) {
 	g_test_add_func("/util/test_uri_escape_for_open",
 	                test_uri_escape_for_open);
 
+	g_test_add_func("/util/normalize/atom",
+	                test_util_normalize_atom);
+	g_test_add_func("/util/normalize/atom/evict",
+	                test_util_normalize_atom_evict);
+
+	if (g_test_perf()) {
+		g_test_add_func("/util/normalize/atom/benchmark",
+		                test_util_normalize_atom_benchmark);
+	}
+
+	g_test_add_func("/util/write data/deferred",
+	                test_util_write_data_deferred);
+	g_test_add_func("/util/write data/deferred/nested",
+	                test_util_write_data_deferred_nested);
+
 	return g_test_run();
 }
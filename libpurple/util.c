@@ -34,6 +34,56 @@ static gchar *cache_dir = NULL;
 static gchar *config_dir = NULL;
 static gchar *data_dir = NULL;
 
+/*
+ * Names handed out by purple_normalize_atom() are refcounted atoms, shared by
+ * every string with the same normalized form.  Each account caches the
+ * strings it normalized most recently, and evicts the least recently used
+ * one once the cache is full.  Atoms with references from outside the caches,
+ * like buddy list keys, raise that limit, so a whole buddy list stays cached
+ * while names from the network come and go.  All of this is protected by
+ * normalize_lock, which is never held while calling into a protocol.
+ */
+typedef struct {
+	guint refs;	/* references from outside the caches */
+	guint cached;	/* cache entries pointing at this atom */
+	gchar str[1];
+} PurpleNormalizeAtom;
+
+typedef struct {
+	GList link;	/* in the cache queue, the data is the entry */
+	gchar *key;
+	PurpleNormalizeAtom *atom;
+} PurpleNormalizeEntry;
+
+typedef struct {
+	GHashTable *table;	/* key => PurpleNormalizeEntry */
+	GQueue queue;		/* least recently used first */
+} PurpleNormalizeCache;
+
+#define PURPLE_NORMALIZE_ATOM(name) \
+	((PurpleNormalizeAtom *)((name) - G_STRUCT_OFFSET(PurpleNormalizeAtom, str)))
+
+static GMutex normalize_lock;
+static GHashTable *normalize_atoms = NULL;	/* str => PurpleNormalizeAtom */
+static PurpleNormalizeCache *normalize_cache = NULL;	/* without an account */
+static guint normalize_pinned = 0;	/* atoms with outside references */
+
+static void normalize_cache_free(PurpleNormalizeCache *cache);
+
+/*
+ * Files handed to purple_util_write_data_to_file_deferred() are written by a
+ * single worker thread, in the order they were first queued.  Only the latest
+ * contents of a file are kept while it waits, so a file that is saved over
+ * and over again is only written once per pass of the worker.
+ */
+static GMutex writer_lock;
+static GCond writer_cond;
+static GThread *writer_thread = NULL;
+static GHashTable *writer_pending = NULL;	/* filename => GBytes */
+static GQueue writer_queue = G_QUEUE_INIT;	/* filenames, owned here */
+static gboolean writer_busy = FALSE;
+static gboolean writer_quit = FALSE;
+
 void
 purple_util_init(void)
 {
@@ -42,8 +92,29 @@ purple_util_init(void)
 void
 purple_util_uninit(void)
 {
+	/* Stop the writer once it is done with whatever is still queued. */
+	if (writer_thread != NULL) {
+		g_mutex_lock(&writer_lock);
+		writer_quit = TRUE;
+		g_cond_broadcast(&writer_cond);
+		g_mutex_unlock(&writer_lock);
+
+		g_thread_join(writer_thread);
+		writer_thread = NULL;
+
+		g_hash_table_destroy(writer_pending);
+		writer_pending = NULL;
+	}
+
 	/* Free these so we don't have leaks at shutdown. */
 
+	g_clear_pointer(&normalize_cache, normalize_cache_free);
+
+	/* Atoms still referenced are freed by their last unref */
+	g_mutex_lock(&normalize_lock);
+	g_clear_pointer(&normalize_atoms, g_hash_table_destroy);
+	g_mutex_unlock(&normalize_lock);
+
 	g_free(custom_user_dir);
 	custom_user_dir = NULL;
 
@@ -2228,34 +2299,144 @@ void purple_util_set_user_dir(const char *dir)
 		custom_user_dir = NULL;
 }
 
+static gboolean
+purple_util_write_error_cb(gpointer data)
+{
+	purple_debug_error("util", "%s\n", (gchar *)data);
+	g_free(data);
+
+	return FALSE;
+}
+
+static gpointer
+purple_util_writer_thread(gpointer data)
+{
+	g_mutex_lock(&writer_lock);
+
+	for (;;) {
+		GFile *file;
+		GBytes *bytes;
+		GError *err = NULL;
+		gchar *filename, *dir;
+
+		while (g_queue_is_empty(&writer_queue) && !writer_quit)
+			g_cond_wait(&writer_cond, &writer_lock);
+
+		filename = g_queue_pop_head(&writer_queue);
+		if (filename == NULL)
+			break;
+
+		bytes = g_hash_table_lookup(writer_pending, filename);
+		g_hash_table_steal(writer_pending, filename);
+		writer_busy = TRUE;
+
+		g_mutex_unlock(&writer_lock);
+
+		/* Ensure the directory, and any missing parents, exist */
+		dir = g_path_get_dirname(filename);
+		if (g_mkdir_with_parents(dir, S_IRWXU) != 0) {
+			g_idle_add(purple_util_write_error_cb,
+				g_strdup_printf("Error creating directory %s: %s",
+				                dir, g_strerror(errno)));
+		}
+		g_free(dir);
+
+		/* This writes to a temporary file and renames it over the old one */
+		file = g_file_new_for_path(filename);
+		if (!g_file_replace_contents(file, g_bytes_get_data(bytes, NULL),
+				g_bytes_get_size(bytes), NULL, FALSE,
+				G_FILE_CREATE_PRIVATE, NULL, NULL, &err))
+		{
+			g_idle_add(purple_util_write_error_cb,
+				g_strdup_printf("Error writing file: %s: %s",
+				                filename, err->message));
+			g_clear_error(&err);
+		}
+		g_object_unref(file);
+
+		g_bytes_unref(bytes);
+		g_free(filename);
+
+		g_mutex_lock(&writer_lock);
+
+		writer_busy = FALSE;
+		g_cond_broadcast(&writer_cond);
+	}
+
+	g_mutex_unlock(&writer_lock);
+
+	return NULL;
+}
+
+void
+purple_util_write_data_to_file_deferred(const char *filename_full, GBytes *data)
+{
+	g_return_if_fail(filename_full != NULL);
+	g_return_if_fail(data != NULL);
+
+	g_mutex_lock(&writer_lock);
+
+	if (writer_thread == NULL) {
+		writer_pending = g_hash_table_new_full(g_str_hash, g_str_equal,
+				NULL, (GDestroyNotify)g_bytes_unref);
+		writer_quit = FALSE;
+		writer_thread = g_thread_new("purple-writer",
+				purple_util_writer_thread, NULL);
+	}
+
+	if (g_hash_table_contains(writer_pending, filename_full)) {
+		/* Still waiting, so just replace what will be written */
+		gpointer key = NULL;
+
+		g_hash_table_lookup_extended(writer_pending, filename_full, &key,
+				NULL);
+		g_hash_table_replace(writer_pending, key, g_bytes_ref(data));
+	} else {
+		gchar *filename = g_strdup(filename_full);
+
+		g_hash_table_insert(writer_pending, filename, g_bytes_ref(data));
+		g_queue_push_tail(&writer_queue, filename);
+		g_cond_broadcast(&writer_cond);
+	}
+
+	g_mutex_unlock(&writer_lock);
+}
+
+void
+purple_util_flush_deferred_writes(void)
+{
+	g_mutex_lock(&writer_lock);
+
+	while (!g_queue_is_empty(&writer_queue) || writer_busy)
+		g_cond_wait(&writer_cond, &writer_lock);
+
+	g_mutex_unlock(&writer_lock);
+}
+
 static gboolean
 purple_util_write_data_to_file_common(const char *dir, const char *filename, const char *data, gssize size)
 {
 	gchar *filename_full;
-	gboolean ret = FALSE;
+	GBytes *bytes;
 
 	g_return_val_if_fail(dir != NULL, FALSE);
+	g_return_val_if_fail(size >= -1, FALSE);
 
 	purple_debug_misc("util", "Writing file %s to directory %s",
 			  filename, dir);
 
-	/* Ensure the directory exists */
-	if (!g_file_test(dir, G_FILE_TEST_IS_DIR))
-	{
-		if (g_mkdir(dir, S_IRUSR | S_IWUSR | S_IXUSR) == -1)
-		{
-			purple_debug_error("util", "Error creating directory %s: %s\n",
-					   dir, g_strerror(errno));
-			return FALSE;
-		}
+	if (size == -1) {
+		size = strlen(data);
 	}
 
 	filename_full = g_build_filename(dir, filename, NULL);
+	bytes = g_bytes_new(data, size);
 
-	ret = purple_util_write_data_to_file_absolute(filename_full, data, size);
+	purple_util_write_data_to_file_deferred(filename_full, bytes);
 
+	g_bytes_unref(bytes);
 	g_free(filename_full);
-	return ret;
+	return TRUE;
 }
 
 gboolean
@@ -2610,6 +2791,194 @@ purple_normalize(PurpleAccount *account, const char *str)
 	return ret;
 }
 
+/* The least recently used strings are evicted beyond this many, plus the
+ * number of atoms referenced from outside the caches */
+#define PURPLE_NORMALIZE_CACHE_MAX 4096
+
+/* Called with normalize_lock held */
+static void
+normalize_atom_release(PurpleNormalizeAtom *atom)
+{
+	if (atom->refs == 0 && atom->cached == 0) {
+		if (normalize_atoms != NULL)
+			g_hash_table_remove(normalize_atoms, atom->str);
+
+		g_free(atom);
+	}
+}
+
+/* Called with normalize_lock held */
+static void
+normalize_cache_evict(PurpleNormalizeCache *cache, GList *link)
+{
+	PurpleNormalizeEntry *entry = link->data;
+
+	g_queue_unlink(&cache->queue, link);
+	g_hash_table_remove(cache->table, entry->key);
+
+	entry->atom->cached--;
+	normalize_atom_release(entry->atom);
+
+	g_free(entry->key);
+	g_free(entry);
+}
+
+static void
+normalize_cache_free(PurpleNormalizeCache *cache)
+{
+	g_mutex_lock(&normalize_lock);
+
+	while (cache->queue.head != NULL)
+		normalize_cache_evict(cache, cache->queue.head);
+
+	g_mutex_unlock(&normalize_lock);
+
+	g_hash_table_destroy(cache->table);
+	g_free(cache);
+}
+
+/* Called with normalize_lock held */
+static PurpleNormalizeCache *
+normalize_cache_get(PurpleAccount *account)
+{
+	static GQuark quark = 0;
+	PurpleNormalizeCache *cache;
+
+	if (G_UNLIKELY(quark == 0))
+		quark = g_quark_from_static_string("purple-normalize-cache");
+
+	if (account != NULL)
+		cache = g_object_get_qdata(G_OBJECT(account), quark);
+	else
+		cache = normalize_cache;
+
+	if (G_UNLIKELY(cache == NULL)) {
+		cache = g_new0(PurpleNormalizeCache, 1);
+		cache->table = g_hash_table_new(g_str_hash, g_str_equal);
+		g_queue_init(&cache->queue);
+
+		if (account != NULL) {
+			g_object_set_qdata_full(G_OBJECT(account), quark, cache,
+			                        (GDestroyNotify)normalize_cache_free);
+		} else {
+			normalize_cache = cache;
+		}
+	}
+
+	if (G_UNLIKELY(normalize_atoms == NULL))
+		normalize_atoms = g_hash_table_new(g_str_hash, g_str_equal);
+
+	return cache;
+}
+
+/* Called with normalize_lock held */
+static PurpleNormalizeEntry *
+normalize_cache_insert(PurpleNormalizeCache *cache, const char *str,
+                       const char *normalized)
+{
+	PurpleNormalizeAtom *atom;
+	PurpleNormalizeEntry *entry;
+	gsize len;
+
+	/* Another thread may have got here first */
+	entry = g_hash_table_lookup(cache->table, str);
+	if (entry != NULL)
+		return entry;
+
+	atom = g_hash_table_lookup(normalize_atoms, normalized);
+	if (atom == NULL) {
+		len = strlen(normalized);
+		atom = g_malloc(G_STRUCT_OFFSET(PurpleNormalizeAtom, str) + len + 1);
+		atom->refs = 0;
+		atom->cached = 0;
+		memcpy(atom->str, normalized, len + 1);
+		g_hash_table_insert(normalize_atoms, atom->str, atom);
+	}
+
+	entry = g_new0(PurpleNormalizeEntry, 1);
+	entry->link.data = entry;
+	entry->key = g_strdup(str);
+	entry->atom = atom;
+	atom->cached++;
+
+	g_hash_table_insert(cache->table, entry->key, entry);
+	g_queue_push_tail_link(&cache->queue, &entry->link);
+
+	return entry;
+}
+
+const gchar *
+purple_normalize_atom(PurpleAccount *account, const char *str)
+{
+	PurpleNormalizeCache *cache;
+	PurpleNormalizeEntry *entry;
+	PurpleNormalizeAtom *atom;
+	gchar *normalized;
+
+	g_return_val_if_fail(str != NULL, NULL);
+
+	g_mutex_lock(&normalize_lock);
+
+	cache = normalize_cache_get(account);
+	entry = g_hash_table_lookup(cache->table, str);
+
+	if (entry != NULL) {
+		/* Mark as the most recently used */
+		g_queue_unlink(&cache->queue, &entry->link);
+		g_queue_push_tail_link(&cache->queue, &entry->link);
+	} else {
+		g_mutex_unlock(&normalize_lock);
+		normalized = g_strdup(purple_normalize(account, str));
+		g_mutex_lock(&normalize_lock);
+
+		entry = normalize_cache_insert(cache, str, normalized);
+		g_free(normalized);
+	}
+
+	atom = entry->atom;
+	if (atom->refs++ == 0)
+		normalize_pinned++;
+
+	/* The entry is the most recently used, so it is never evicted here */
+	while (cache->queue.length > PURPLE_NORMALIZE_CACHE_MAX + normalize_pinned)
+		normalize_cache_evict(cache, cache->queue.head);
+
+	g_mutex_unlock(&normalize_lock);
+
+	return atom->str;
+}
+
+const gchar *
+purple_normalize_atom_ref(const gchar *atom)
+{
+	g_return_val_if_fail(atom != NULL, NULL);
+
+	g_mutex_lock(&normalize_lock);
+	if (PURPLE_NORMALIZE_ATOM(atom)->refs++ == 0)
+		normalize_pinned++;
+	g_mutex_unlock(&normalize_lock);
+
+	return atom;
+}
+
+void
+purple_normalize_atom_unref(const gchar *atom)
+{
+	PurpleNormalizeAtom *a;
+
+	g_return_if_fail(atom != NULL);
+
+	g_mutex_lock(&normalize_lock);
+
+	a = PURPLE_NORMALIZE_ATOM(atom);
+	if (--a->refs == 0) {
+		normalize_pinned--;
+		normalize_atom_release(a);
+	}
+
+	g_mutex_unlock(&normalize_lock);
+}
+
 /*
  * You probably don't want to call this directly, it is
  * mainly for use as a protocol callback function.  See the
@@ -618,9 +618,12 @@ gboolean purple_util_write_data_to_file(const char *filename, const char *data,
  * Write a string of data to a file of the given name in the Purple
  * cache directory ($HOME/.cache/purple by default).
  * 
+ * The file is written in the background, see
+ * purple_util_write_data_to_file_deferred().
+ *
  *  See purple_util_write_data_to_file()
  *
- * Returns: TRUE if the file was written successfully.  FALSE otherwise.
+ * Returns: TRUE if the file was queued to be written.  FALSE otherwise.
  */
 gboolean
 purple_util_write_data_to_cache_file(const char *filename, const char *data, gssize size);
@@ -635,9 +638,12 @@ purple_util_write_data_to_cache_file(const char *filename, const char *data, gss
  * Write a string of data to a file of the given name in the Purple
  * config directory ($HOME/.config/purple by default).
  *
+ * The file is written in the background, see
+ * purple_util_write_data_to_file_deferred().
+ *
  *  See purple_util_write_data_to_file()
  *
- * Returns: TRUE if the file was written successfully.  FALSE otherwise.
+ * Returns: TRUE if the file was queued to be written.  FALSE otherwise.
  */
 gboolean
 purple_util_write_data_to_config_file(const char *filename, const char *data, gssize size);
@@ -652,9 +658,12 @@ purple_util_write_data_to_config_file(const char *filename, const char *data, gs
  * Write a string of data to a file of the given name in the Purple
  * data directory ($HOME/.local/share/purple by default).
  *
+ * The file is written in the background, see
+ * purple_util_write_data_to_file_deferred().
+ *
  *  See purple_util_write_data_to_file()
  *
- * Returns: TRUE if the file was written successfully.  FALSE otherwise.
+ * Returns: TRUE if the file was queued to be written.  FALSE otherwise.
  */
 gboolean
 purple_util_write_data_to_data_file(const char *filename, const char *data, gssize size);
@@ -679,6 +688,35 @@ purple_util_write_data_to_data_file(const char *filename, const char *data, gssi
 gboolean
 purple_util_write_data_to_file_absolute(const char *filename_full, const char *data, gssize size);
 
+/**
+ * purple_util_write_data_to_file_deferred:
+ * @filename_full: Filename to write to
+ * @data:          The data to write.
+ *
+ * Queues @data to be written to @filename_full by a background thread, which
+ * replaces the file atomically.  Files are written in the order they were
+ * queued, and if @filename_full is still waiting from an earlier call only
+ * the newer @data is written.  Errors are logged on the main loop.
+ *
+ * Use this for files the main loop should not wait on, and
+ * purple_util_flush_deferred_writes() when they have to be on disk.
+ *
+ * Since: 3.0.0
+ */
+void
+purple_util_write_data_to_file_deferred(const char *filename_full, GBytes *data);
+
+/**
+ * purple_util_flush_deferred_writes:
+ *
+ * Blocks until every file queued with
+ * purple_util_write_data_to_file_deferred() has been written.
+ *
+ * Since: 3.0.0
+ */
+void
+purple_util_flush_deferred_writes(void);
+
 /**
  * purple_util_read_xml_from_file:
  * @filename:    The basename of the file to open in the purple_user_dir.
@@ -894,6 +932,53 @@ purple_strequal(const gchar *left, const gchar *right)
  */
 const char *purple_normalize(PurpleAccount *account, const char *str);
 
+/**
+ * purple_normalize_atom:
+ * @account:  The account the string belongs to, or NULL if you do
+ *                 not know the account.
+ * @str:      The string to normalize.
+ *
+ * Normalizes a string like purple_normalize(), but returns a refcounted atom
+ * which is shared by every string with the same normalized form, so atoms
+ * can be hashed and compared by pointer.
+ *
+ * The strings normalized most recently are remembered per account, so
+ * normalizing them again neither allocates nor calls into the protocol.
+ * The least recently used strings are forgotten one at a time once there
+ * are too many, not counting those whose atoms are still referenced
+ * elsewhere.  This is safe to call from any thread, as long as the
+ * protocol's normalize function is.
+ *
+ * Returns: (transfer full): The normalized string, which stays valid until
+ *          it is released with purple_normalize_atom_unref().
+ *
+ * Since: 3.0.0
+ */
+const gchar *purple_normalize_atom(PurpleAccount *account, const char *str);
+
+/**
+ * purple_normalize_atom_ref:
+ * @atom: A string returned by purple_normalize_atom().
+ *
+ * Adds a reference to a normalized atom.
+ *
+ * Returns: @atom.
+ *
+ * Since: 3.0.0
+ */
+const gchar *purple_normalize_atom_ref(const gchar *atom);
+
+/**
+ * purple_normalize_atom_unref:
+ * @atom: A string returned by purple_normalize_atom().
+ *
+ * Releases a reference to a normalized atom, which is freed once it is
+ * neither referenced nor cached.
+ *
+ * Since: 3.0.0
+ */
+void purple_normalize_atom_unref(const gchar *atom);
+
 /**
  * purple_normalize_nocase:
  * @account:  The account the string belongs to.
@@ -34,12 +34,6 @@
 #include "util.h"
 #include "xmlnode.h"
 
-#ifdef _WIN32
-# define NEWLINE_S "\r\n"
-#else
-# define NEWLINE_S "\n"
-#endif
-
 static PurpleXmlNode*
 new_node(const char *name, PurpleXmlNodeType type)
 {
@@ -599,6 +593,15 @@ purple_xmlnode_to_str(const PurpleXmlNode *node, int *len)
 	return purple_xmlnode_to_str_helper(node, len, FALSE, 0);
 }
 
+char *
+_purple_xmlnode_to_formatted_str_at_depth(const PurpleXmlNode *node, int depth,
+                                          int *len)
+{
+	g_return_val_if_fail(node != NULL, NULL);
+
+	return purple_xmlnode_to_str_helper(node, len, TRUE, depth);
+}
+
 char *
 purple_xmlnode_to_formatted_str(const PurpleXmlNode *node, int *len)
 {
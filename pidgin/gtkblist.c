@@ -613,6 +613,9 @@ chat_components_edit_ok(PurpleChat *chat, PurpleRequestFields *allfields)
 			}
 		}
 	}
+
+	purple_blist_save_node(purple_blist_get_default(),
+	                       PURPLE_BLIST_NODE(chat));
 }
 
 static void chat_components_edit(GtkWidget *w, PurpleBlistNode *node)
@@ -4535,6 +4535,7 @@ pidgin_conv_destroy(PurpleConversation *conv)
 	if (gtkconv->attach_timer) {
 		g_source_remove(gtkconv->attach_timer);
 	}
+	g_list_free_full(gtkconv->attach_current, g_object_unref);
 
 	g_array_unref(gtkconv->nick_colors);
 
@@ -4800,10 +4801,13 @@ pidgin_conv_write_conv(PurpleConversation *conv, PurpleMessage *pmsg)
 			history_since_s = purple_utf8_strftime(
 				"%Y-%m-%dT%H:%M:%SZ", history_since_tm);
 			if (!purple_strequal(prev_history_since_s,
-				history_since_s))
+				history_since_s)) {
 				g_hash_table_replace(comps,
 					g_strdup("history_since"),
 					g_strdup(history_since_s));
+				purple_blist_save_node(purple_blist_get_default(),
+					PURPLE_BLIST_NODE(chat));
+			}
 		}
 	}
 
@@ -6253,11 +6257,8 @@ add_message_history_to_gtkconv(gpointer data)
 		}
 		/* XXX: should it be gtkconv->active_conv? */
 		pidgin_conv_write_conv(gtkconv->active_conv, msg);
-		if (im) {
-			gtkconv->attach_current = g_list_delete_link(gtkconv->attach_current, gtkconv->attach_current);
-		} else {
-			gtkconv->attach_current = gtkconv->attach_current->prev;
-		}
+		gtkconv->attach_current = g_list_delete_link(gtkconv->attach_current, gtkconv->attach_current);
+		g_object_unref(msg);
 		count++;
 	}
 	gtkconv->attach_timer = timer;
@@ -6337,21 +6338,25 @@ gboolean pidgin_conv_attach_to_conversation(PurpleConversation *conv)
 
 	list = purple_conversation_get_message_history(conv);
 	if (list) {
+		/* The history drops old messages as new ones arrive, so hold on to
+		 * our own copy while it is being added. */
+		list = g_list_copy_deep(list, (GCopyFunc)g_object_ref, NULL);
 		if (PURPLE_IS_IM_CONVERSATION(conv)) {
 			GList *convs;
-			list = g_list_copy(list);
 			for (convs = purple_conversations_get_ims(); convs; convs = convs->next)
 				if (convs->data != conv &&
 						pidgin_conv_find_gtkconv(convs->data) == gtkconv) {
 					pidgin_conv_attach(convs->data);
-					list = g_list_concat(list, g_list_copy(purple_conversation_get_message_history(convs->data)));
+					list = g_list_concat(list, g_list_copy_deep(
+							purple_conversation_get_message_history(convs->data),
+							(GCopyFunc)g_object_ref, NULL));
 				}
 			list = g_list_sort(list, (GCompareFunc)message_compare);
-			gtkconv->attach_current = list;
-			list = g_list_last(list);
 		} else if (PURPLE_IS_CHAT_CONVERSATION(conv)) {
-			gtkconv->attach_current = g_list_last(list);
+			list = g_list_reverse(list);
 		}
+		gtkconv->attach_current = list;
+		list = g_list_last(list);
 
 		g_object_set_data(G_OBJECT(gtkconv->editor), "attach-start-time",
 			GINT_TO_POINTER(purple_message_get_time(list->data)));
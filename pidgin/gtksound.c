@@ -164,6 +164,14 @@ chat_user_join_cb(PurpleChatConversation *chat, const char *name,
 		play_conv_event(PURPLE_CONVERSATION(chat), event);
 }
 
+static void
+chat_users_join_cb(PurpleChatConversation *chat, GList *users,
+				   gboolean new_arrivals, PurpleSoundEventID event)
+{
+	if (new_arrivals)
+		play_conv_event(PURPLE_CONVERSATION(chat), event);
+}
+
 static void
 chat_user_left_cb(PurpleChatConversation *chat, const char *name,
 				   const char *reason, PurpleSoundEventID event)
@@ -335,6 +343,9 @@ pidgin_sound_init(void)
 	purple_signal_connect(conv_handle, "chat-user-joined",
 						gtk_sound_handle, PURPLE_CALLBACK(chat_user_join_cb),
 						GINT_TO_POINTER(PURPLE_SOUND_CHAT_JOIN));
+	purple_signal_connect(conv_handle, "chat-users-joined",
+						gtk_sound_handle, PURPLE_CALLBACK(chat_users_join_cb),
+						GINT_TO_POINTER(PURPLE_SOUND_CHAT_JOIN));
 	purple_signal_connect(conv_handle, "chat-user-left",
 						gtk_sound_handle, PURPLE_CALLBACK(chat_user_left_cb),
 						GINT_TO_POINTER(PURPLE_SOUND_CHAT_LEAVE));
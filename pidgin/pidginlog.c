@@ -154,6 +154,14 @@ static gchar *log_get_date(PurpleLog *log)
 	return ret;
 }
 
+static gchar *
+log_get_search_key(PurpleLog *log)
+{
+	return g_strdup_printf("%p:%p:%d:%s:%" G_GINT64_FORMAT, log->logger,
+	                       log->account, log->type, log->name,
+	                       g_date_time_to_unix(log->time));
+}
+
 static void
 entry_stop_search_cb(GtkWidget *entry, PidginLogViewer *lv)
 {
@@ -167,10 +175,63 @@ entry_stop_search_cb(GtkWidget *entry, PidginLogViewer *lv)
 	select_first_log(lv);
 }
 
+/* The search left out logs that weren't indexed yet; add them to the results
+ * as they get indexed. */
+static void
+log_search_indexed_cb(PurpleLog *indexed, PidginLogViewer *lv)
+{
+	GtkTreeModel *model = GTK_TREE_MODEL(lv->treestore);
+	GtkTreeIter iter, sibling;
+	PurpleLog *log = NULL;
+	gchar *log_date;
+	gboolean valid;
+	GList *l;
+
+	if (lv->search == NULL || indexed->type == PURPLE_LOG_SYSTEM)
+		return;
+
+	for (l = lv->logs; l != NULL; l = l->next) {
+		PurpleLog *other = l->data;
+
+		if (other->logger == indexed->logger &&
+				other->account == indexed->account &&
+				other->type == indexed->type && other->time != NULL &&
+				g_date_time_equal(other->time, indexed->time) &&
+				purple_strequal(other->name, indexed->name)) {
+			log = other;
+			break;
+		}
+	}
+
+	if (log == NULL || !purple_log_search_matches(log, lv->search))
+		return;
+
+	/* The results are in the same order as the logs */
+	valid = gtk_tree_model_get_iter_first(model, &sibling);
+	while (valid) {
+		PurpleLog *row;
+
+		gtk_tree_model_get(model, &sibling, 1, &row, -1);
+		if (row == log)
+			return;
+		if (purple_log_compare(log, row) < 0)
+			break;
+
+		valid = gtk_tree_model_iter_next(model, &sibling);
+	}
+
+	log_date = log_get_date(log);
+	gtk_tree_store_insert_before(lv->treestore, &iter, NULL,
+	                             valid ? &sibling : NULL);
+	gtk_tree_store_set(lv->treestore, &iter, 0, log_date, 1, log, -1);
+	g_free(log_date);
+}
+
 static void
 entry_search_changed_cb(GtkWidget *button, PidginLogViewer *lv)
 {
 	const char *search_term = gtk_entry_get_text(GTK_ENTRY(lv->entry));
+	GHashTable *searched, *matches;
 	GList *logs;
 
 	if (lv->search != NULL && purple_strequal(lv->search, search_term))
@@ -190,11 +251,54 @@ entry_search_changed_cb(GtkWidget *button, PidginLogViewer *lv)
 	gtk_tree_store_clear(lv->treestore);
 	talkatu_buffer_clear(TALKATU_BUFFER(lv->log_buffer));
 
+	searched = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	matches = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
+	/* Conversation logs are looked up in the search index, once per
+	 * conversation.  Those that aren't indexed yet are added by
+	 * log_search_indexed_cb() later. */
 	for (logs = lv->logs; logs != NULL; logs = logs->next) {
-		char *read = purple_log_read((PurpleLog*)logs->data, NULL);
-		if (read && *read && purple_strcasestr(read, search_term)) {
+		PurpleLog *log = logs->data;
+		GList *hits;
+		gchar *key;
+
+		if (log->type == PURPLE_LOG_SYSTEM)
+			continue;
+
+		key = g_strdup_printf("%p:%s", log->account, log->name);
+		if (g_hash_table_contains(searched, key)) {
+			g_free(key);
+			continue;
+		}
+		g_hash_table_add(searched, key);
+
+		hits = purple_log_search(log->account, log->name, search_term, 0, 0,
+		                         NULL);
+		while (hits != NULL) {
+			PurpleLogSearchHit *hit = hits->data;
+
+			g_hash_table_add(matches, log_get_search_key(hit->log));
+			purple_log_search_hit_free(hit);
+			hits = g_list_delete_link(hits, hits);
+		}
+	}
+
+	for (logs = lv->logs; logs != NULL; logs = logs->next) {
+		PurpleLog *log = logs->data;
+		gboolean match;
+
+		if (log->type == PURPLE_LOG_SYSTEM) {
+			char *read = purple_log_read(log, NULL);
+			match = (read && *read && purple_strcasestr(read, search_term));
+			g_free(read);
+		} else {
+			gchar *key = log_get_search_key(log);
+			match = g_hash_table_contains(matches, key);
+			g_free(key);
+		}
+
+		if (match) {
 			GtkTreeIter iter;
-			PurpleLog *log = logs->data;
 			gchar *log_date = log_get_date(log);
 
 			gtk_tree_store_append (lv->treestore, &iter, NULL);
@@ -203,9 +307,11 @@ entry_search_changed_cb(GtkWidget *button, PidginLogViewer *lv)
 					   1, log, -1);
 			g_free(log_date);
 		}
-		g_free(read);
 	}
 
+	g_hash_table_destroy(searched);
+	g_hash_table_destroy(matches);
+
 	select_first_log(lv);
 	pidgin_clear_cursor(GTK_WIDGET(lv));
 }
@@ -259,6 +365,7 @@ destroy_cb(GtkWidget *w, gint resp, struct log_viewer_hash *ht)
 		syslog_viewer = NULL;
 
 	purple_request_close_with_handle(lv);
+	purple_signals_disconnect_by_handle(lv);
 
 	g_list_free_full(lv->logs, (GDestroyNotify)purple_log_free);
 
@@ -618,6 +725,9 @@ display_log_viewer(struct log_viewer_hash *ht, GList *logs, const char *title,
 	if (ht != NULL)
 		g_hash_table_insert(log_viewers, ht, lv);
 
+	purple_signal_connect(purple_log_get_handle(), "log-search-indexed", lv,
+	                      PURPLE_CALLBACK(log_search_indexed_cb), lv);
+
 #ifndef _WIN32
 	gtk_widget_hide(lv->browse_button);
 #endif